@@ -0,0 +1,228 @@
+#! /usr/bin/perl -w
+# -*- Perl -*-
+#
+# bench.pl
+#
+# Run `tabench' over a corpus of fonts, collect the results in a JSON
+# file, and compare them against a baseline.
+#
+# Copyright (C) 2022 by Werner Lemberg.
+#
+# This file is part of the ttfautohint library, and may only be used,
+# modified, and distributed under the terms given in `COPYING'.  By
+# continuing to use, modify, or distribute this file you indicate that you
+# have read `COPYING' and understand and accept it fully.
+#
+# The file `COPYING' mentioned in the previous paragraph is distributed
+# with the ttfautohint library.
+
+use strict;
+use warnings;
+use English '-no_match_vars';
+
+use Cwd qw(abs_path getcwd);
+use File::Basename qw(dirname);
+use File::Spec;
+use Getopt::Long;
+use JSON::PP;
+
+
+my $prog = $PROGRAM_NAME;
+$prog =~ s| .* / ||x;      # Remove path.
+
+my $usage = <<"END";
+usage: $prog [options]
+
+  --tabench=FILE     the `tabench' program (mandatory)
+  --corpus=FILE      the corpus file (mandatory); see `corpus.example'
+  --output=FILE      write results to FILE (default: stdout)
+  --baseline=FILE    compare results against FILE (if it exists)
+  --tolerance=PCT    allowed deviation from the baseline in percent
+                     (default: 10)
+  --runs=N           number of runs per font (default: 5)
+END
+
+my $tabench;
+my $corpus;
+my $output;
+my $baseline;
+my $tolerance = 10;
+my $runs = 5;
+
+GetOptions("tabench=s" => \$tabench,
+           "corpus=s" => \$corpus,
+           "output=s" => \$output,
+           "baseline=s" => \$baseline,
+           "tolerance=f" => \$tolerance,
+           "runs=i" => \$runs)
+  or die $usage;
+die $usage if !defined $tabench || !defined $corpus || @ARGV;
+
+die "$prog: corpus file `$corpus' not found"
+    . " (see `bench/corpus.example' for its format)\n"
+  if !-f $corpus;
+
+$tabench = abs_path($tabench);
+$output = File::Spec->rel2abs($output) if defined $output;
+
+
+# Read the corpus file.  Each non-empty line that doesn't start with `#'
+# holds a unique name, a font file, and optional `tabench' options, all
+# separated by whitespace.  File names are relative to the corpus file's
+# directory.
+
+my @entries;
+my %seen;
+
+open(my $corpus_fh, "<", $corpus)
+  or die "$prog: can't open `$corpus': $OS_ERROR\n";
+while (my $line = <$corpus_fh>)
+{
+  next if $line =~ /^ \s* (?: \# | $ )/x;
+
+  my ($name, $font, @options) = split(" ", $line);
+  die "$prog: $corpus:$INPUT_LINE_NUMBER: missing font file\n"
+    if !defined $font;
+  die "$prog: $corpus:$INPUT_LINE_NUMBER: duplicate name `$name'\n"
+    if $seen{$name}++;
+
+  push @entries, { name => $name, font => $font, options => \@options };
+}
+close($corpus_fh);
+
+die "$prog: corpus file `$corpus' is empty\n" if !@entries;
+
+
+# Run `tabench' for each entry in a separate process, so that the peak
+# memory usage gets measured per font.
+
+my $cwd = getcwd();
+chdir(dirname($corpus))
+  or die "$prog: can't change to directory of `$corpus': $OS_ERROR\n";
+
+my $json = JSON::PP->new->canonical->pretty;
+my %results;
+
+foreach my $entry (@entries)
+{
+  my @command = ($tabench, "--json", "--runs=$runs",
+                 @{$entry->{options}}, $entry->{font});
+
+  print STDERR "$prog: $entry->{name}\n";
+
+  open(my $fh, "-|", @command)
+    or die "$prog: can't run `$tabench': $OS_ERROR\n";
+  my $text = do { local $INPUT_RECORD_SEPARATOR; <$fh> };
+  close($fh)
+    or die "$prog: `@command' failed\n";
+
+  my $result = $json->decode($text);
+  $result->{options} = join(" ", @{$entry->{options}});
+  $results{$entry->{name}} = $result;
+}
+
+chdir($cwd);
+
+
+my %all = (runs => $runs, fonts => \%results);
+
+if (defined $output)
+{
+  open(my $fh, ">", $output)
+    or die "$prog: can't open `$output': $OS_ERROR\n";
+  print $fh $json->encode(\%all);
+  close($fh);
+}
+else
+{
+  print $json->encode(\%all);
+}
+
+
+# Compare against the baseline.  Glyphs per second, peak memory usage,
+# and output size are checked; changed phase times (of at least 1ms) are
+# only reported since phases are too noisy to be reliable.
+
+exit 0 if !defined $baseline || !-f $baseline;
+
+open(my $baseline_fh, "<", $baseline)
+  or die "$prog: can't open `$baseline': $OS_ERROR\n";
+my $old = $json->decode(do { local $INPUT_RECORD_SEPARATOR; <$baseline_fh> });
+close($baseline_fh);
+
+my $regressions = 0;
+
+# Return the relative change in percent, with the sign adjusted so that
+# positive values are improvements.
+sub change
+{
+  my ($old_value, $new_value, $higher_is_better) = @_;
+
+  return 0 if !$old_value;
+
+  my $diff = ($new_value - $old_value) / $old_value;
+  return 100 * ($higher_is_better ? $diff : -$diff);
+}
+
+print STDERR "\ncomparison against `$baseline'"
+             . " (tolerance $tolerance%):\n";
+
+foreach my $name (sort keys %results)
+{
+  my $new_result = $results{$name};
+  my $old_result = $old->{fonts}{$name};
+
+  if (!defined $old_result)
+  {
+    print STDERR "  $name: not in baseline\n";
+    next;
+  }
+
+  my @checks = (["glyphs/s", "glyphs_per_second", 1],
+                ["peak RSS", "peak_rss_kb", 0],
+                ["output size", "output_size", 0]);
+
+  foreach my $check (@checks)
+  {
+    my ($label, $key, $higher_is_better) = @$check;
+    my $old_value = $old_result->{$key};
+    my $new_value = $new_result->{$key};
+    my $change = change($old_value, $new_value, $higher_is_better);
+    my $status = "";
+
+    if ($change < -$tolerance)
+    {
+      $status = "  REGRESSION";
+      $regressions++;
+    }
+
+    printf STDERR "  %-20s %-12s %12s -> %12s (%+.1f%%)%s\n",
+                  $name, $label, $old_value, $new_value,
+                  $change, $status;
+  }
+
+  foreach my $phase (sort keys %{$new_result->{phases_ms}})
+  {
+    my $old_value = $old_result->{phases_ms}{$phase};
+    my $new_value = $new_result->{phases_ms}{$phase};
+
+    next if !defined $old_value;
+    next if $old_value < 1 && $new_value < 1;
+
+    my $change = change($old_value, $new_value, 0);
+    printf STDERR "  %-20s phase `%s' %.3fms -> %.3fms (%+.1f%%)\n",
+                  $name, $phase, $old_value, $new_value, $change
+      if abs($change) > $tolerance;
+  }
+}
+
+if ($regressions)
+{
+  print STDERR "$prog: $regressions regression"
+               . ($regressions == 1 ? "" : "s") . " found\n";
+  exit 1;
+}
+
+exit 0;
+
+# end of bench.pl
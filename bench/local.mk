@@ -0,0 +1,50 @@
+# bench/local.mk
+
+# Copyright (C) 2022 by Werner Lemberg.
+#
+# This file is part of the ttfautohint library, and may only be used,
+# modified, and distributed under the terms given in `COPYING'.  By
+# continuing to use, modify, or distribute this file you indicate that you
+# have read `COPYING' and understand and accept it fully.
+#
+# The file `COPYING' mentioned in the previous paragraph is distributed
+# with the ttfautohint library.
+
+# `make bench' runs `lib/tabench' over the fonts listed in
+# `$(BENCH_CORPUS)', writes the results to `bench-results.json', and
+# compares them against `$(BENCH_BASELINE)' (if it exists); it fails if
+# glyphs per second, peak memory usage, or output size of a font are
+# worse than the baseline by more than `$(BENCH_TOLERANCE)' percent.
+#
+# `make bench-baseline' stores the current results as the new baseline.
+
+BENCH_CORPUS = $(srcdir)/bench/corpus
+BENCH_BASELINE = $(srcdir)/bench/baseline.json
+BENCH_TOLERANCE = 10
+BENCH_RUNS = 5
+
+BENCH_COMMAND = \
+  perl $(srcdir)/bench/bench.pl \
+    --tabench=lib/tabench$(EXEEXT) \
+    --corpus=$(BENCH_CORPUS) \
+    --runs=$(BENCH_RUNS)
+
+bench: lib/tabench$(EXEEXT)
+	$(BENCH_COMMAND) \
+	  --output=bench-results.json \
+	  --baseline=$(BENCH_BASELINE) \
+	  --tolerance=$(BENCH_TOLERANCE)
+
+bench-baseline: lib/tabench$(EXEEXT)
+	$(BENCH_COMMAND) \
+	  --output=$(BENCH_BASELINE)
+
+.PHONY: bench bench-baseline
+
+EXTRA_DIST += \
+  bench/bench.pl \
+  bench/corpus.example
+
+CLEANFILES += bench-results.json
+
+# end of bench/local.mk
@@ -0,0 +1,895 @@
+// batch.cpp
+
+// Copyright (C) 2022 by Werner Lemberg.
+//
+// This file is part of the ttfautohint library, and may only be used,
+// modified, and distributed under the terms given in `COPYING'.  By
+// continuing to use, modify, or distribute this file you indicate that you
+// have read `COPYING' and understand and accept it fully.
+//
+// The file `COPYING' mentioned in the previous paragraph is distributed
+// with the ttfautohint library.
+
+
+// Hint many fonts in a single process, using a pool of worker threads.
+//
+// Calls to `TTF_autohint' don't share any state (except in debug mode),
+// thus each worker simply takes the next job from a common list.  Control
+// instructions and reference fonts are read only once and passed as
+// buffers to all jobs that use them.
+
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <ctype.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <dirent.h>
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+// the next header files are from gnulib
+#include "glthread/lock.h"
+#include "glthread/thread.h"
+#include "nproc.h"
+#include "timespec.h"
+
+#include "batch.h"
+#include "info.h"
+
+
+using namespace std;
+
+
+struct Batch_Job
+{
+  string in_name;
+  string out_name;
+  Batch_Settings settings;
+
+  bool failed;
+  double seconds;
+};
+
+
+struct Batch_Data
+{
+  vector<Batch_Job> jobs;
+  size_t next_job;
+  int num_failed;
+
+  // indexed by file name
+  map<string, File_Buffer> control_buffers;
+  map<string, File_Buffer> reference_buffers;
+
+  TA_Error_Func err_func;
+};
+
+
+// serializes access to `Batch_Data' and output to stdout and stderr
+gl_lock_define_initialized(static, batch_lock)
+
+
+extern "C" {
+
+typedef struct Batch_Error_Data_
+{
+  Error_Data error_data;
+  const char* in_name;
+  TA_Error_Func err_func;
+} Batch_Error_Data;
+
+
+// Prefix error messages with the input file name and make them atomic.
+
+static void
+batch_err(TA_Error error,
+          const char* error_string,
+          unsigned int errlinenum,
+          const char* errline,
+          const char* errpos,
+          void* user)
+{
+  Batch_Error_Data* data = static_cast<Batch_Error_Data*>(user);
+
+  if (!error)
+    return;
+
+  gl_lock_lock(batch_lock);
+  fprintf(stderr, "%s:\n", data->in_name);
+  data->err_func(error, error_string, errlinenum, errline, errpos,
+                 &data->error_data);
+  gl_lock_unlock(batch_lock);
+}
+
+} // extern "C"
+
+
+static double
+elapsed(const struct timespec& start,
+        const struct timespec& end)
+{
+  return double(end.tv_sec - start.tv_sec)
+         + double(end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+
+// Read file `name' completely into `buf'.
+
+bool
+batch_read_file(const string& name,
+                bool is_text,
+                File_Buffer& buf)
+{
+  FILE* f = fopen(name.c_str(), is_text ? "r" : "rb");
+  if (!f)
+    return false;
+
+  char tmp[0x10000];
+  size_t read_bytes;
+
+  buf.clear();
+  while ((read_bytes = fread(tmp, 1, sizeof (tmp), f)) > 0)
+    buf.insert(buf.end(), tmp, tmp + read_bytes);
+
+  bool ok = !ferror(f);
+  fclose(f);
+
+  return ok;
+}
+
+
+// Control instructions are text files unless they are compiled.
+
+bool
+batch_read_control_file(const string& name,
+                        File_Buffer& buf)
+{
+  FILE* f = fopen(name.c_str(), "rb");
+  if (!f)
+    return false;
+
+  char tag[4];
+  size_t len = fread(tag, 1, 4, f);
+  fclose(f);
+
+  return batch_read_file(name, !(len == 4 && !memcmp(tag, "TACB", 4)), buf);
+}
+
+
+// Split `line' into whitespace-separated tokens, honouring double quotes.
+// Everything after an unquoted `#' is ignored.
+
+bool
+batch_tokenize(const string& line,
+               vector<string>& tokens)
+{
+  size_t i = 0;
+  size_t len = line.size();
+
+  tokens.clear();
+
+  for (;;)
+  {
+    while (i < len && isspace((unsigned char)line[i]))
+      i++;
+    if (i == len || line[i] == '#')
+      return true;
+
+    string token;
+
+    if (line[i] == '"')
+    {
+      size_t end = line.find('"', i + 1);
+      if (end == string::npos)
+        return false;
+
+      token = line.substr(i + 1, end - i - 1);
+      i = end + 1;
+    }
+    else
+    {
+      size_t start = i;
+      while (i < len && !isspace((unsigned char)line[i]))
+        i++;
+      token = line.substr(start, i - start);
+    }
+
+    tokens.push_back(token);
+  }
+}
+
+
+static bool
+parse_int(const string& s,
+          int& value)
+{
+  char* endptr;
+
+  errno = 0;
+  long v = strtol(s.c_str(), &endptr, 10);
+  if (s.empty() || *endptr || errno || v < -0x7FFF || v > 0x7FFF)
+    return false;
+
+  value = int(v);
+  return true;
+}
+
+
+static bool
+parse_stem_width_mode(const string& s,
+                      Batch_Settings& settings)
+{
+  int modes[3];
+
+  if (s.size() != 3)
+    return false;
+
+  for (int i = 0; i < 3; i++)
+  {
+    switch (s[i])
+    {
+    case 'n':
+      modes[i] = TA_STEM_WIDTH_MODE_NATURAL;
+      break;
+    case 'q':
+      modes[i] = TA_STEM_WIDTH_MODE_QUANTIZED;
+      break;
+    case 's':
+      modes[i] = TA_STEM_WIDTH_MODE_STRONG;
+      break;
+    default:
+      return false;
+    }
+  }
+
+  settings.gray_stem_width_mode = modes[0];
+  settings.gdi_cleartype_stem_width_mode = modes[1];
+  settings.dw_cleartype_stem_width_mode = modes[2];
+
+  return true;
+}
+
+
+// Apply a per-file option override from a manifest.
+// We only accept the long names of options that affect a single font.
+
+bool
+batch_parse_option(const string& arg,
+                   Batch_Settings& settings)
+{
+  size_t start = 0;
+  while (start < 2 && start < arg.size() && arg[start] == '-')
+    start++;
+  if (!start)
+    return false;
+
+  size_t equal = arg.find('=', start);
+  string name = arg.substr(start, equal == string::npos ? string::npos
+                                                        : equal - start);
+  bool have_value = (equal != string::npos);
+  string value = have_value ? arg.substr(equal + 1) : "";
+
+  // flags
+  if (!have_value)
+  {
+    if (name == "adaptive-sweep")
+      settings.adaptive_sweep = true;
+    else if (name == "adjust-subglyphs" || name == "pre-hinting")
+      settings.adjust_subglyphs = true;
+    else if (name == "composites")
+      settings.hint_composites = true;
+    else if (name == "dehint")
+      settings.dehint = true;
+    else if (name == "detailed-info")
+    {
+      settings.detailed_info = true;
+      settings.no_info = false;
+    }
+    else if (name == "fallback-scaling")
+      settings.fallback_scaling = true;
+    else if (name == "ignore-restrictions")
+      settings.ignore_restrictions = true;
+    else if (name == "no-info")
+    {
+      settings.no_info = true;
+      settings.detailed_info = false;
+    }
+    else if (name == "symbol")
+      settings.symbol = true;
+    else if (name == "ttfa-table")
+      settings.TTFA_info = true;
+    else if (name == "windows-compatibility")
+      settings.windows_compatibility = true;
+    else
+      return false;
+
+    return true;
+  }
+
+  // options with arguments
+  if (name == "control-file")
+    settings.control_name = value;
+  else if (name == "default-script")
+    settings.default_script = value;
+  else if (name == "fallback-script")
+    settings.fallback_script = value;
+  else if (name == "fallback-stem-width")
+    return parse_int(value, settings.fallback_stem_width)
+           && settings.fallback_stem_width > 0;
+  else if (name == "family-suffix")
+  {
+    if (check_family_suffix(value.c_str()))
+      return false;
+    settings.family_suffix = value;
+  }
+  else if (name == "hinting-limit")
+    return parse_int(value, settings.hinting_limit);
+  else if (name == "hinting-range-max")
+    return parse_int(value, settings.hinting_range_max);
+  else if (name == "hinting-range-min")
+    return parse_int(value, settings.hinting_range_min);
+  else if (name == "increase-x-height")
+    return parse_int(value, settings.increase_x_height);
+  else if (name == "previous")
+    settings.previous_name = value;
+  else if (name == "reference")
+    settings.reference_name = value;
+  else if (name == "reference-index")
+    return parse_int(value, settings.reference_index)
+           && settings.reference_index >= 0;
+  else if (name == "stem-width-mode")
+    return parse_stem_width_mode(value, settings);
+  else if (name == "x-height-snapping-exceptions")
+    settings.x_height_snapping_exceptions_string = value;
+  else
+    return false;
+
+  return true;
+}
+
+
+static bool
+has_font_suffix(const char* name)
+{
+  size_t len = strlen(name);
+
+  if (len < 5 || name[len - 4] != '.')
+    return false;
+
+  const char* suffix = name + len - 3;
+
+  return tolower(suffix[0]) == 't'
+         && tolower(suffix[1]) == 't'
+         && (tolower(suffix[2]) == 'f' || tolower(suffix[2]) == 'c');
+}
+
+
+static bool
+collect_directory(const char* in_dir_name,
+                  const char* out_dir_name,
+                  const Batch_Settings& defaults,
+                  Batch_Data& data)
+{
+  if (!out_dir_name)
+  {
+    fprintf(stderr, "Batch processing of directory `%s'"
+                    " needs an output directory\n",
+                    in_dir_name);
+    return false;
+  }
+
+  struct stat in_stat, out_stat;
+
+  if (stat(out_dir_name, &out_stat) || !S_ISDIR(out_stat.st_mode))
+  {
+    fprintf(stderr, "`%s' is not a directory\n", out_dir_name);
+    return false;
+  }
+  if (!stat(in_dir_name, &in_stat)
+      && in_stat.st_ino
+      && in_stat.st_dev == out_stat.st_dev
+      && in_stat.st_ino == out_stat.st_ino)
+  {
+    fprintf(stderr, "Input and output directories must not be identical\n");
+    return false;
+  }
+
+  DIR* dir = opendir(in_dir_name);
+  if (!dir)
+  {
+    fprintf(stderr,
+            "The following error occurred"
+              " while opening directory `%s':\n"
+            "\n"
+            "  %s\n",
+            in_dir_name, strerror(errno));
+    return false;
+  }
+
+  vector<string> names;
+  struct dirent* entry;
+
+  while ((entry = readdir(dir)))
+    if (has_font_suffix(entry->d_name))
+      names.push_back(entry->d_name);
+
+  closedir(dir);
+
+  // make the order of the status lines reproducible
+  sort(names.begin(), names.end());
+
+  for (size_t i = 0; i < names.size(); i++)
+  {
+    Batch_Job job;
+
+    job.in_name = string(in_dir_name) + "/" + names[i];
+    job.out_name = string(out_dir_name) + "/" + names[i];
+    job.settings = defaults;
+
+    data.jobs.push_back(job);
+  }
+
+  return true;
+}
+
+
+static bool
+collect_manifest(const char* manifest_name,
+                 const char* out_dir_name,
+                 const Batch_Settings& defaults,
+                 Batch_Data& data)
+{
+  if (out_dir_name)
+  {
+    fprintf(stderr, "Batch manifest `%s' doesn't take"
+                    " an output directory\n",
+                    manifest_name);
+    return false;
+  }
+
+  File_Buffer buf;
+  if (!batch_read_file(manifest_name, true, buf))
+  {
+    fprintf(stderr,
+            "The following error occurred"
+              " while reading batch manifest `%s':\n"
+            "\n"
+            "  %s\n",
+            manifest_name, strerror(errno));
+    return false;
+  }
+
+  string contents(buf.begin(), buf.end());
+  size_t pos = 0;
+  unsigned int linenum = 0;
+  vector<string> tokens;
+
+  while (pos < contents.size())
+  {
+    size_t end = contents.find('\n', pos);
+    if (end == string::npos)
+      end = contents.size();
+
+    string line = contents.substr(pos, end - pos);
+    pos = end + 1;
+    linenum++;
+
+    if (!batch_tokenize(line, tokens))
+    {
+      fprintf(stderr, "%s:%u: unterminated quote\n",
+                      manifest_name, linenum);
+      return false;
+    }
+    if (tokens.empty())
+      continue;
+
+    if (tokens.size() < 2)
+    {
+      fprintf(stderr, "%s:%u: output file name missing\n",
+                      manifest_name, linenum);
+      return false;
+    }
+    if (tokens[0] == tokens[1])
+    {
+      fprintf(stderr, "%s:%u: input and output file names"
+                        " must not be identical\n",
+                      manifest_name, linenum);
+      return false;
+    }
+
+    Batch_Job job;
+
+    job.in_name = tokens[0];
+    job.out_name = tokens[1];
+    job.settings = defaults;
+
+    for (size_t i = 2; i < tokens.size(); i++)
+      if (!batch_parse_option(tokens[i], job.settings))
+      {
+        fprintf(stderr, "%s:%u: invalid option `%s'\n",
+                        manifest_name, linenum, tokens[i].c_str());
+        return false;
+      }
+
+    data.jobs.push_back(job);
+  }
+
+  return true;
+}
+
+
+// Load all control instruction files and reference fonts in advance.
+
+static bool
+load_shared_files(Batch_Data& data)
+{
+  for (size_t i = 0; i < data.jobs.size(); i++)
+  {
+    const Batch_Settings& s = data.jobs[i].settings;
+
+    if (!s.control_name.empty()
+        && !data.control_buffers.count(s.control_name)
+        && !batch_read_control_file(s.control_name,
+                                    data.control_buffers[s.control_name]))
+    {
+      fprintf(stderr,
+              "The following error occurred"
+                " while reading control file `%s':\n"
+              "\n"
+              "  %s\n",
+              s.control_name.c_str(), strerror(errno));
+      return false;
+    }
+
+    if (!s.reference_name.empty()
+        && !data.reference_buffers.count(s.reference_name)
+        && !batch_read_file(s.reference_name, false,
+                      data.reference_buffers[s.reference_name]))
+    {
+      fprintf(stderr,
+              "The following error occurred"
+                " while reading reference font `%s':\n"
+              "\n"
+              "  %s\n",
+              s.reference_name.c_str(), strerror(errno));
+      return false;
+    }
+  }
+
+  return true;
+}
+
+
+// Set up the data for the `info-callback' function.
+// The return value is the one of `build_version_string'.
+
+int
+batch_info_data(const Batch_Settings& s,
+                Info_Data& info_data)
+{
+  info_data.no_info = s.no_info;
+  info_data.detailed_info = s.detailed_info;
+  info_data.info_string = NULL; // must be deallocated after use
+  info_data.info_string_wide = NULL; // must be deallocated after use
+  info_data.info_string_len = 0;
+  info_data.info_string_wide_len = 0;
+
+  info_data.control_name = s.control_name.empty()
+                             ? NULL
+                             : s.control_name.c_str();
+  info_data.reference_name = s.reference_name.empty()
+                               ? NULL
+                               : s.reference_name.c_str();
+  info_data.reference_index = s.reference_index;
+
+  info_data.hinting_range_min = s.hinting_range_min;
+  info_data.hinting_range_max = s.hinting_range_max;
+  info_data.hinting_limit = s.hinting_limit;
+
+  info_data.gray_stem_width_mode = s.gray_stem_width_mode;
+  info_data.gdi_cleartype_stem_width_mode = s.gdi_cleartype_stem_width_mode;
+  info_data.dw_cleartype_stem_width_mode = s.dw_cleartype_stem_width_mode;
+
+  info_data.windows_compatibility = s.windows_compatibility;
+  info_data.adjust_subglyphs = s.adjust_subglyphs;
+  info_data.hint_composites = s.hint_composites;
+  info_data.increase_x_height = s.increase_x_height;
+  info_data.x_height_snapping_exceptions_string =
+    s.x_height_snapping_exceptions_string.c_str();
+  info_data.family_suffix = s.family_suffix.c_str();
+  info_data.family_data_head = NULL;
+  info_data.fallback_stem_width = s.fallback_stem_width;
+  info_data.symbol = s.symbol;
+  info_data.fallback_scaling = s.fallback_scaling;
+  info_data.TTFA_info = s.TTFA_info;
+  info_data.adaptive_sweep = s.adaptive_sweep;
+
+  strncpy(info_data.default_script,
+          s.default_script.c_str(),
+          sizeof (info_data.default_script));
+  strncpy(info_data.fallback_script,
+          s.fallback_script.c_str(),
+          sizeof (info_data.fallback_script));
+
+  info_data.dehint = s.dehint;
+
+  if (s.no_info)
+    return 0;
+
+  return build_version_string(&info_data);
+}
+
+
+static bool
+run_job(Batch_Data* data,
+        Batch_Job& job)
+{
+  const Batch_Settings& s = job.settings;
+  const char* in_name = job.in_name.c_str();
+  const char* out_name = job.out_name.c_str();
+
+  FILE* in = fopen(in_name, "rb");
+  if (!in)
+  {
+    gl_lock_lock(batch_lock);
+    fprintf(stderr,
+            "The following error occurred while opening font `%s':\n"
+            "\n"
+            "  %s\n",
+            in_name, strerror(errno));
+    gl_lock_unlock(batch_lock);
+    return false;
+  }
+
+  FILE* out = fopen(out_name, "wb");
+  if (!out)
+  {
+    gl_lock_lock(batch_lock);
+    fprintf(stderr,
+            "The following error occurred while opening font `%s':\n"
+            "\n"
+            "  %s\n",
+            out_name, strerror(errno));
+    gl_lock_unlock(batch_lock);
+    fclose(in);
+    return false;
+  }
+
+  // the maps don't change while the workers are running
+  const char* control_buf = NULL;
+  size_t control_len = 0;
+  if (!s.control_name.empty())
+  {
+    const File_Buffer& buf = data->control_buffers.find(s.control_name)
+                               ->second;
+    control_buf = buf.empty() ? NULL : &buf[0];
+    control_len = buf.size();
+  }
+
+  const char* reference_buf = NULL;
+  size_t reference_len = 0;
+  if (!s.reference_name.empty())
+  {
+    const File_Buffer& buf = data->reference_buffers.find(s.reference_name)
+                               ->second;
+    reference_buf = buf.empty() ? NULL : &buf[0];
+    reference_len = buf.size();
+  }
+
+  // each font has its own previous version, so we don't share it
+  File_Buffer previous;
+  if (!s.previous_name.empty()
+      && !batch_read_file(s.previous_name, false, previous))
+  {
+    gl_lock_lock(batch_lock);
+    fprintf(stderr,
+            "The following error occurred"
+              " while reading previous font `%s':\n"
+            "\n"
+            "  %s\n",
+            s.previous_name.c_str(), strerror(errno));
+    gl_lock_unlock(batch_lock);
+    fclose(in);
+    fclose(out);
+    remove(out_name);
+    return false;
+  }
+
+  Batch_Error_Data error_data;
+  error_data.error_data.control_name = s.control_name.empty()
+                                         ? NULL
+                                         : s.control_name.c_str();
+  error_data.in_name = in_name;
+  error_data.err_func = data->err_func;
+
+  Info_Data info_data;
+
+  int ret = batch_info_data(s, info_data);
+  if (ret)
+  {
+    gl_lock_lock(batch_lock);
+    if (ret == 1)
+      fprintf(stderr, "%s:\n"
+                      "Warning: Can't allocate memory"
+                        " for ttfautohint options string in `name' table\n",
+                      in_name);
+    else if (ret == 2)
+      fprintf(stderr, "%s:\n"
+                      "Warning: ttfautohint options string"
+                        " in `name' table too long\n",
+                      in_name);
+    gl_lock_unlock(batch_lock);
+  }
+
+  TA_Error error =
+    TTF_autohint("in-file, out-file, control-buffer, control-buffer-len,"
+                 "reference-buffer, reference-buffer-len,"
+                 "reference-index, reference-name,"
+                 "hinting-range-min, hinting-range-max, hinting-limit,"
+                 "gray-stem-width-mode, gdi-cleartype-stem-width-mode,"
+                 "dw-cleartype-stem-width-mode,"
+                 "error-callback, error-callback-data,"
+                 "info-callback, info-post-callback, info-callback-data,"
+                 "ignore-restrictions, windows-compatibility,"
+                 "adjust-subglyphs, hint-composites,"
+                 "increase-x-height, x-height-snapping-exceptions,"
+                 "fallback-stem-width, default-script,"
+                 "fallback-script, fallback-scaling,"
+                 "symbol, dehint, TTFA-info, epoch, threads,"
+                 "adaptive-sweep, previous-buffer, previous-buffer-len",
+                 in, out, control_buf, control_len,
+                 reference_buf, reference_len,
+                 s.reference_index, info_data.reference_name,
+                 s.hinting_range_min, s.hinting_range_max, s.hinting_limit,
+                 s.gray_stem_width_mode, s.gdi_cleartype_stem_width_mode,
+                 s.dw_cleartype_stem_width_mode,
+                 batch_err, &error_data,
+                 info, s.family_suffix.empty() ? NULL : info_post,
+                 &info_data,
+                 s.ignore_restrictions, s.windows_compatibility,
+                 s.adjust_subglyphs, s.hint_composites,
+                 s.increase_x_height,
+                 info_data.x_height_snapping_exceptions_string,
+                 s.fallback_stem_width, s.default_script.c_str(),
+                 s.fallback_script.c_str(), s.fallback_scaling,
+                 s.symbol, s.dehint, s.TTFA_info, s.epoch,
+                 s.num_threads, s.adaptive_sweep,
+                 previous.empty() ? NULL : &previous[0], previous.size());
+
+  if (!s.no_info)
+  {
+    free(info_data.info_string);
+    free(info_data.info_string_wide);
+  }
+
+  fclose(in);
+  fclose(out);
+
+  // don't leave incomplete output behind
+  if (error)
+    remove(out_name);
+
+  return !error;
+}
+
+
+extern "C" {
+
+static void*
+worker(void* user)
+{
+  Batch_Data* data = static_cast<Batch_Data*>(user);
+
+  for (;;)
+  {
+    gl_lock_lock(batch_lock);
+    size_t idx = data->next_job++;
+    gl_lock_unlock(batch_lock);
+
+    if (idx >= data->jobs.size())
+      break;
+
+    Batch_Job& job = data->jobs[idx];
+
+    struct timespec start = current_timespec();
+    job.failed = !run_job(data, job);
+    job.seconds = elapsed(start, current_timespec());
+
+    gl_lock_lock(batch_lock);
+    if (job.failed)
+      data->num_failed++;
+    fprintf(stdout, "%-6s %9.3fs  %s -> %s\n",
+                    job.failed ? "FAILED" : "ok",
+                    job.seconds,
+                    job.in_name.c_str(),
+                    job.out_name.c_str());
+    fflush(stdout);
+    gl_lock_unlock(batch_lock);
+  }
+
+  return NULL;
+}
+
+} // extern "C"
+
+
+int
+batch(const char* batch_name,
+      const char* out_dir_name,
+      int num_jobs,
+      const Batch_Settings& defaults,
+      TA_Error_Func err_func)
+{
+  Batch_Data data;
+  struct stat st;
+
+  if (stat(batch_name, &st))
+  {
+    fprintf(stderr,
+            "The following error occurred while accessing `%s':\n"
+            "\n"
+            "  %s\n",
+            batch_name, strerror(errno));
+    return -1;
+  }
+
+  if (S_ISDIR(st.st_mode))
+  {
+    if (!collect_directory(batch_name, out_dir_name, defaults, data))
+      return -1;
+  }
+  else
+  {
+    if (!collect_manifest(batch_name, out_dir_name, defaults, data))
+      return -1;
+  }
+
+  if (!load_shared_files(data))
+    return -1;
+
+  data.next_job = 0;
+  data.num_failed = 0;
+  data.err_func = err_func;
+
+  size_t num_threads = num_jobs > 0
+                         ? size_t(num_jobs)
+                         : size_t(num_processors(NPROC_CURRENT));
+  if (num_threads > data.jobs.size())
+    num_threads = data.jobs.size();
+
+  struct timespec start = current_timespec();
+
+  // the main thread is a worker, too; if thread creation fails
+  // (or threads are not supported at all), we simply get fewer workers
+  vector<gl_thread_t> threads;
+  for (size_t i = 1; i < num_threads; i++)
+  {
+    gl_thread_t thread;
+
+    if (glthread_create(&thread, worker, &data))
+      break;
+    threads.push_back(thread);
+  }
+
+  worker(&data);
+
+  for (size_t i = 0; i < threads.size(); i++)
+    glthread_join(threads[i], NULL);
+
+  fprintf(stdout, "%lu fonts, %d failed, %.3fs with %lu threads\n",
+                  (unsigned long)data.jobs.size(),
+                  data.num_failed,
+                  elapsed(start, current_timespec()),
+                  (unsigned long)(threads.size() + 1));
+
+  return data.num_failed;
+}
+
+// end of batch.cpp
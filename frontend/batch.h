@@ -0,0 +1,149 @@
+// batch.h
+
+// Copyright (C) 2022 by Werner Lemberg.
+//
+// This file is part of the ttfautohint library, and may only be used,
+// modified, and distributed under the terms given in `COPYING'.  By
+// continuing to use, modify, or distribute this file you indicate that you
+// have read `COPYING' and understand and accept it fully.
+//
+// The file `COPYING' mentioned in the previous paragraph is distributed
+// with the ttfautohint library.
+
+
+#ifndef BATCH_H_
+#define BATCH_H_
+
+#include <ttfautohint.h>
+
+#include <string>
+#include <vector>
+
+#include "info.h"
+
+
+extern "C" {
+
+// the data passed to the `error-callback' function
+typedef struct Error_Data_
+{
+  const char* control_name;
+} Error_Data;
+
+} // extern "C"
+
+
+// The options of a batch job.  Option values given on the command line
+// serve as the defaults for all jobs; a manifest line can override them.
+// For string options, an empty string means `not set'.
+
+struct Batch_Settings
+{
+  int hinting_range_min;
+  int hinting_range_max;
+  int hinting_limit;
+
+  int gray_stem_width_mode;
+  int gdi_cleartype_stem_width_mode;
+  int dw_cleartype_stem_width_mode;
+
+  int increase_x_height;
+  std::string x_height_snapping_exceptions_string;
+  int fallback_stem_width;
+
+  bool ignore_restrictions;
+  bool windows_compatibility;
+  bool adjust_subglyphs;
+  bool adaptive_sweep;
+  bool hint_composites;
+  bool no_info;
+  bool detailed_info;
+  bool TTFA_info;
+  bool symbol;
+  bool fallback_scaling;
+  bool dehint;
+
+  std::string default_script;
+  std::string fallback_script;
+  std::string family_suffix;
+
+  std::string control_name;
+  std::string reference_name;
+  int reference_index;
+
+  // only set in a manifest line
+  std::string previous_name;
+
+  unsigned long long epoch;
+
+  // threads per font, for the subfonts of a TTC
+  unsigned int num_threads;
+};
+
+
+typedef std::vector<char> File_Buffer;
+
+
+// Read file `name' completely into `buf'; `is_text' selects text mode.
+bool
+batch_read_file(const std::string& name,
+                bool is_text,
+                File_Buffer& buf);
+
+// Read a control instructions file, which might be compiled.
+bool
+batch_read_control_file(const std::string& name,
+                        File_Buffer& buf);
+
+// Split `line' into whitespace-separated tokens, honouring double quotes
+// and ignoring everything after `#'.  Return false for an unterminated
+// quote.
+bool
+batch_tokenize(const std::string& line,
+               std::vector<std::string>& tokens);
+
+// Override an entry in `settings' with `arg', a long command line option
+// like `--symbol' or `--hinting-limit=50'.  Return false if `arg' is
+// unknown or its value is invalid.
+bool
+batch_parse_option(const std::string& arg,
+                   Batch_Settings& settings);
+
+// Fill `info_data' for the `info-callback' function; the return value is
+// the one of `build_version_string'.  String pointers in `info_data'
+// point into `settings'.
+int
+batch_info_data(const Batch_Settings& settings,
+                Info_Data& info_data);
+
+
+// Process all fonts given by `batch_name' with `num_jobs' worker threads
+// (0 means the number of available processors).
+//
+// If `batch_name' is a directory, all files ending with `.ttf' or `.ttc'
+// in it are hinted and written with the same name to directory
+// `out_dir_name'.  Otherwise, `batch_name' is a manifest file where each
+// non-empty line has the form
+//
+//   <input file> <output file> [<option>...]
+//
+// `#' starts a line comment; file names containing spaces must be
+// enclosed in double quotes.  <option> is a long command line option
+// like `--hinting-range-max=30' or `--symbol', overriding the settings
+// in `defaults' for this font only.
+//
+// For each font, a status line with the elapsed time is printed to
+// stdout; error messages go to stderr.  The return value is the number of
+// fonts that couldn't be processed, or -1 for a problem with the batch
+// data itself.
+
+int
+batch(const char* batch_name,
+      const char* out_dir_name,
+      int num_jobs,
+      const Batch_Settings& defaults,
+      TA_Error_Func err_func);
+
+#endif // BATCH_H_
+
+// end of batch.h
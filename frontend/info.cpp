@@ -129,6 +129,8 @@ build_version_string(Info_Data* idata)
     d = sdscat(d, " -S");
   if (idata->TTFA_info)
     d = sdscat(d, " -t");
+  if (idata->adaptive_sweep)
+    d = sdscat(d, " --adaptive-sweep");
 
   if (idata->x_height_snapping_exceptions_string)
   {
@@ -53,6 +53,7 @@ typedef struct Info_Data_
   bool symbol;
   bool dehint;
   bool TTFA_info;
+  bool adaptive_sweep;
 
   const char* control_name;
   const char* reference_name;
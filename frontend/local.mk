@@ -44,12 +44,17 @@ LDADD = lib/libttfautohint.la \
 bin_PROGRAMS = frontend/ttfautohint
 
 frontend_ttfautohint_SOURCES = \
+  frontend/batch.cpp \
+  frontend/batch.h \
   frontend/info.cpp \
   frontend/info.h \
-  frontend/main.cpp
+  frontend/main.cpp \
+  frontend/server.cpp \
+  frontend/server.h
 frontend_ttfautohint_CPPFLAGS = $(AM_CPPFLAGS) \
                                 $(FREETYPE_CPPFLAGS)
-frontend_ttfautohint_LDADD = $(LDADD)
+frontend_ttfautohint_LDADD = $(LDADD) \
+                             $(LTLIBMULTITHREAD)
 
 manpages = frontend/ttfautohint.1
 
@@ -43,6 +43,8 @@
 #  include FT_FREETYPE_H
 #  include FT_TRUETYPE_TABLES_H // for option `-T'
 #  include "info.h"
+#  include "batch.h"
+#  include "server.h"
 #endif
 
 #include <ttfautohint.h>
@@ -110,6 +112,7 @@ typedef struct Progress_Data_
   long last_sfnt;
   bool begin;
   int last_percent;
+  bool parallel;
 } Progress_Data;
 
 
@@ -122,6 +125,15 @@ progress(long curr_idx,
 {
   Progress_Data* data = (Progress_Data*)user;
 
+  // with option --threads, calls for different subfonts are interleaved
+  if (data->parallel && num_sfnts > 1)
+  {
+    if (curr_idx + 1 == num_glyphs)
+      fprintf(stderr, "subfont %ld of %ld: %ld glyphs\n",
+                      curr_sfnt + 1, num_sfnts, num_glyphs);
+    return 0;
+  }
+
   if (num_sfnts > 1 && curr_sfnt != data->last_sfnt)
   {
     fprintf(stderr, "subfont %ld of %ld\n", curr_sfnt + 1, num_sfnts);
@@ -154,10 +166,81 @@ progress(long curr_idx,
 }
 
 
-typedef struct Error_Data_
+typedef struct Glyph_Report_Data_
+{
+  FILE* file;
+  bool json;
+  bool first;
+} Glyph_Report_Data;
+
+
+// print a glyph name as a quoted CSV or JSON string
+static void
+glyph_report_string(FILE* file,
+                    const char* s,
+                    bool json)
 {
-  const char* control_name;
-} Error_Data;
+  fputc('"', file);
+  for (; *s; s++)
+  {
+    if (*s == '"')
+      fputs(json ? "\\\"" : "\"\"", file);
+    else if (json && *s == '\\')
+      fputs("\\\\", file);
+    else if (json && (unsigned char)*s < 0x20)
+      fprintf(file, "\\u%04x", (unsigned char)*s);
+    else
+      fputc(*s, file);
+  }
+  fputc('"', file);
+}
+
+
+static void
+glyph_report(const TA_Glyph_Report* report,
+             void* user)
+{
+  Glyph_Report_Data* data = (Glyph_Report_Data*)user;
+  FILE* file = data->file;
+
+  if (data->json)
+  {
+    fprintf(file, "%s\n  {\"sfnt\": %ld, \"index\": %ld, \"name\": ",
+                  data->first ? "" : ",",
+                  report->curr_sfnt, report->glyph_idx);
+    if (report->glyph_name)
+      glyph_report_string(file, report->glyph_name, true);
+    else
+      fputs("null", file);
+    fprintf(file, ", \"style\": \"%s\","
+                  " \"points\": %u, \"segments\": %u, \"edges\": %u,"
+                  " \"action_hints_records\": %u,"
+                  " \"point_hints_records\": %u,"
+                  " \"ins_len\": %lu, \"ins_extra_len\": %lu,"
+                  " \"time_ms\": %.3f}",
+                  report->style,
+                  report->num_points, report->num_segments, report->num_edges,
+                  report->num_action_hints_records,
+                  report->num_point_hints_records,
+                  report->ins_len, report->ins_extra_len,
+                  report->time);
+  }
+  else
+  {
+    fprintf(file, "%ld,%ld,", report->curr_sfnt, report->glyph_idx);
+    if (report->glyph_name)
+      glyph_report_string(file, report->glyph_name, false);
+    fprintf(file, ",%s,%u,%u,%u,%u,%u,%lu,%lu,%.3f\n",
+                  report->style,
+                  report->num_points, report->num_segments, report->num_edges,
+                  report->num_action_hints_records,
+                  report->num_point_hints_records,
+                  report->ins_len, report->ins_extra_len,
+                  report->time);
+  }
+
+  data->first = false;
+}
 
 
 static void
@@ -252,6 +335,19 @@ err(TA_Error error,
       if (error_string)
         fprintf(stderr, " %s", error_string);
     }
+    else if (error >= 0x400 && error < 0x500)
+    {
+      fprintf(stderr, "An error with code 0x%03x occurred"
+                        " while parsing the argument of option"
+                        " `--hint-glyphs'",
+                      error);
+      fprintf(stderr, errline ? ":\n" : ".\n");
+
+      if (errline)
+        fprintf(stderr, "  %s\n", errline);
+      if (errpos && errline)
+        fprintf(stderr, "  %*s\n", int(errpos - errline + 1), "^");
+    }
   }
 }
 
@@ -277,9 +373,14 @@ show_help(bool
 "A GUI application to replace hints in a TrueType font.\n"
 #else
 "Usage: ttfautohint [OPTION]... [IN-FILE [OUT-FILE]]\n"
+"       ttfautohint [OPTION]... --batch=MANIFEST\n"
+"       ttfautohint [OPTION]... --batch=IN-DIR OUT-DIR\n"
+"       ttfautohint [OPTION]... --server=SOCKET\n"
 "Replace hints in TrueType font IN-FILE and write output to OUT-FILE.\n"
 "If OUT-FILE is missing, standard output is used instead;\n"
 "if IN-FILE is missing also, standard input and output are used.\n"
+"With option --batch, process many fonts in parallel;\n"
+"with option --server, hint fonts sent over a Unix domain socket.\n"
 #endif
 "\n"
 "The new hints are based on FreeType's auto-hinter.\n"
@@ -303,6 +404,12 @@ show_help(bool
   fprintf(handle,
 "Options:\n"
 #ifndef BUILD_GUI
+"      --adaptive-sweep       sample PPEM values while computing hints\n"
+"                             (a lossy heuristic)\n"
+"      --batch=NAME           hint all fonts listed in manifest NAME\n"
+"                             or contained in directory NAME\n"
+"      --compile-control=FILE compile control instructions (option -m)\n"
+"                             for IN-FILE into binary FILE and exit\n"
 "      --debug                print debugging information\n"
 #endif
 "  -a, --stem-width-mode=S    select stem width mode for grayscale, GDI\n"
@@ -318,6 +425,15 @@ show_help(bool
 "                             in the `name' table\n"
 "  -G, --hinting-limit=N      switch off hinting above this PPEM value\n"
 "                             (default: %d); value 0 means no limit\n"
+#ifndef BUILD_GUI
+"      --glyph-report=FILE    write per-glyph statistics to FILE\n"
+"                             (as JSON if FILE ends with `.json',\n"
+"                             as CSV otherwise)\n"
+"      --hint-glyphs=LIST     hint only the glyphs with indices in LIST;\n"
+"                             all other glyphs keep their bytecode\n"
+"                             from IN-FILE, already hinted with\n"
+"                             option -t (or the font given with --previous)\n"
+#endif
 "  -h, --help                 display this help and exit\n"
 "  -H, --fallback-stem-width=N\n"
 "                             set fallback stem width\n"
@@ -328,6 +444,10 @@ show_help(bool
 "  -i, --ignore-restrictions  override font license restrictions\n"
 "  -I, --detailed-info        add detailed ttfautohint info\n"
 "                             to the version string(s) in the `name' table\n"
+#ifndef BUILD_GUI
+"      --jobs=N               use N threads with option --batch or --server\n"
+"                             (default: number of processors)\n"
+#endif
 "  -l, --hinting-range-min=N  the minimum PPEM value for hint sets\n"
 "                             (default: %d)\n"
 #ifndef BUILD_GUI
@@ -341,13 +461,25 @@ show_help(bool
 "  -r, --hinting-range-max=N  the maximum PPEM value for hint sets\n"
 "                             (default: %d)\n"
 #ifndef BUILD_GUI
+"      --previous=FILE        reuse the bytecode of unchanged glyphs\n"
+"                             from FILE, an older output of ttfautohint\n"
+"                             (created with option -t)\n"
 "  -R, --reference=FILE       derive blue zones from reference font FILE\n"
 #endif
+#ifndef BUILD_GUI
+"      --server=SOCKET        listen on Unix domain socket SOCKET\n"
+"                             for fonts to hint\n"
+#endif
 "  -s, --symbol               input is symbol font\n"
 "  -S, --fallback-scaling     use fallback scaling, not hinting\n"
 "  -t, --ttfa-table           add TTFA information table\n"
 #ifndef BUILD_GUI
+"      --threads=N            use up to N threads for a single font\n"
+"                             (default: 1)\n"
 "  -T, --ttfa-info            display TTFA table in IN-FILE and exit\n"
+"      --trace=FILE           write a Chrome trace of the hinting process\n"
+"                             to FILE\n"
+"      --trace-ppem           also trace each PPEM value of a glyph\n"
 #endif
 "  -v, --verbose              show progress information\n"
 "  -V, --version              print version information and exit\n"
@@ -518,6 +650,20 @@ show_help(bool
 "Key letters `l', `r', `n', `p', `t', `w', `x', and `y'\n"
 "have the verbose aliases `left', `right', `nodir', `point', `touch',\n"
 "`width', `xshift', and `yshift', respectively.\n"
+"\n"
+"Option --compile-control stores the parsed control instructions\n"
+"in a binary format that option -m reads much faster;\n"
+"such a file is only valid for the font it has been compiled with.\n"
+"\n"
+"A batch manifest (option --batch) contains lines of the form\n"
+"\n"
+"  <in file> <out file> [<option>...]\n"
+"\n"
+"where <option> is a long option like `--symbol' or `--hinting-limit=50'\n"
+"that overrides the command line for this font only.  If the argument of\n"
+"--batch is a directory, all TTF and TTC files in it get processed,\n"
+"writing output files with the same names to OUT-DIR.  A status line\n"
+"with the elapsed time is printed for each font.\n"
 #endif
 "\n"
 #ifdef BUILD_GUI
@@ -696,6 +842,100 @@ Exit:
 
   exit(EXIT_SUCCESS);
 }
+
+
+// Compiled control instructions must be read in binary mode;
+// everything else is a text file.
+
+static FILE*
+open_control_file(const char* control_name)
+{
+  FILE* control = fopen(control_name, "rb");
+  if (!control)
+  {
+    fprintf(stderr,
+            "The following error occurred"
+              " while opening control file `%s':\n"
+            "\n"
+            "  %s\n",
+            control_name, strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+
+  unsigned char tag[4];
+  size_t len = fread(tag, 1, 4, control);
+
+  if (len == 4 && !memcmp(tag, "TACB", 4))
+    rewind(control);
+  else
+  {
+    fclose(control);
+    control = fopen(control_name, "r");
+    if (!control)
+    {
+      fprintf(stderr,
+              "The following error occurred"
+                " while opening control file `%s':\n"
+              "\n"
+              "  %s\n",
+              control_name, strerror(errno));
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  return control;
+}
+
+
+static void
+compile_control(FILE* in,
+                const char* control_name,
+                const char* compile_control_name)
+{
+  if (!control_name)
+  {
+    fprintf(stderr, "Option --compile-control needs option -m\n");
+    exit(EXIT_FAILURE);
+  }
+
+  FILE* control = open_control_file(control_name);
+
+  FILE* out = fopen(compile_control_name, "wb");
+  if (!out)
+  {
+    fprintf(stderr,
+            "The following error occurred"
+              " while opening compiled control file `%s':\n"
+            "\n"
+            "  %s\n",
+            compile_control_name, strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+
+  if (in == stdin)
+    SET_BINARY(stdin);
+
+  Error_Data error_data = {control_name};
+
+  TA_Error error =
+    TTF_autohint("in-file, control-file, control-binary-file,"
+                 "error-callback, error-callback-data",
+                 in, control, out,
+                 err, &error_data);
+
+  if (in != stdin)
+    fclose(in);
+  fclose(control);
+  fclose(out);
+
+  if (error)
+  {
+    remove(compile_control_name);
+    exit(EXIT_FAILURE);
+  }
+
+  exit(EXIT_SUCCESS);
+}
 #endif
 
 
@@ -750,6 +990,7 @@ main(int argc,
 
 #ifndef BUILD_GUI
   bool debug = false;
+  bool adaptive_sweep = false;
 
   TA_Progress_Func progress_func = NULL;
   TA_Error_Func err_func = err;
@@ -757,8 +998,18 @@ main(int argc,
   TA_Info_Post_Func info_post_func = info_post;
 
   const char* control_name = NULL;
+  const char* compile_control_name = NULL;
+  const char* batch_name = NULL;
+  const char* server_name = NULL;
+  int num_jobs = 0;
+  int num_threads = 1;
   const char* reference_name = NULL;
   int reference_index = 0;
+  const char* trace_name = NULL;
+  bool trace_ppem = false;
+  const char* glyph_report_name = NULL;
+  const char* hint_glyphs_string = NULL;
+  const char* previous_name = NULL;
 
   unsigned long long epoch = ULLONG_MAX;
 #endif
@@ -783,7 +1034,18 @@ main(int argc,
     {
       PASS_THROUGH = CHAR_MAX + 1,
       HELP_ALL_OPTION,
-      DEBUG_OPTION
+      ADAPTIVE_SWEEP_OPTION,
+      DEBUG_OPTION,
+      COMPILE_CONTROL_OPTION,
+      BATCH_OPTION,
+      GLYPH_REPORT_OPTION,
+      HINT_GLYPHS_OPTION,
+      JOBS_OPTION,
+      PREVIOUS_OPTION,
+      SERVER_OPTION,
+      THREADS_OPTION,
+      TRACE_OPTION,
+      TRACE_PPEM_OPTION
     };
 
     static struct option long_options[] =
@@ -794,9 +1056,14 @@ main(int argc,
 #endif
 
       // ttfautohint options
+#ifndef BUILD_GUI
+      {"adaptive-sweep", no_argument, NULL, ADAPTIVE_SWEEP_OPTION},
+#endif
       {"adjust-subglyphs", no_argument, NULL, 'p'},
       {"composites", no_argument, NULL, 'c'},
 #ifndef BUILD_GUI
+      {"batch", required_argument, NULL, BATCH_OPTION},
+      {"compile-control", required_argument, NULL, COMPILE_CONTROL_OPTION},
       {"control-file", required_argument, NULL, 'm'},
       {"debug", no_argument, NULL, DEBUG_OPTION},
 #endif
@@ -807,20 +1074,34 @@ main(int argc,
       {"fallback-script", required_argument, NULL, 'f'},
       {"fallback-stem-width", required_argument, NULL, 'H'},
       {"family-suffix", required_argument, NULL, 'F'},
+#ifndef BUILD_GUI
+      {"glyph-report", required_argument, NULL, GLYPH_REPORT_OPTION},
+      {"hint-glyphs", required_argument, NULL, HINT_GLYPHS_OPTION},
+#endif
       {"hinting-limit", required_argument, NULL, 'G'},
       {"hinting-range-max", required_argument, NULL, 'r'},
       {"hinting-range-min", required_argument, NULL, 'l'},
       {"ignore-restrictions", no_argument, NULL, 'i'},
       {"increase-x-height", required_argument, NULL, 'x'},
+#ifndef BUILD_GUI
+      {"jobs", required_argument, NULL, JOBS_OPTION},
+#endif
       {"no-info", no_argument, NULL, 'n'},
       {"pre-hinting", no_argument, NULL, 'p'},
 #ifndef BUILD_GUI
+      {"previous", required_argument, NULL, PREVIOUS_OPTION},
       {"reference", required_argument, NULL, 'R'},
       {"reference-index", required_argument, NULL, 'Z'},
+      {"server", required_argument, NULL, SERVER_OPTION},
 #endif
       {"stem-width-mode", required_argument, NULL, 'a'},
       {"strong-stem-width", required_argument, NULL, 'w'},
       {"symbol", no_argument, NULL, 's'},
+#ifndef BUILD_GUI
+      {"threads", required_argument, NULL, THREADS_OPTION},
+      {"trace", required_argument, NULL, TRACE_OPTION},
+      {"trace-ppem", no_argument, NULL, TRACE_PPEM_OPTION},
+#endif
       {"ttfa-table", no_argument, NULL, 't'},
 #ifndef BUILD_GUI
       {"ttfa-info", no_argument, NULL, 'T'},
@@ -1082,6 +1363,61 @@ main(int argc,
     case DEBUG_OPTION:
       debug = true;
       break;
+
+    case COMPILE_CONTROL_OPTION:
+      compile_control_name = optarg;
+      break;
+
+    case BATCH_OPTION:
+      batch_name = optarg;
+      break;
+
+    case SERVER_OPTION:
+      server_name = optarg;
+      break;
+
+    case JOBS_OPTION:
+      num_jobs = atoi(optarg);
+      if (num_jobs < 1)
+      {
+        fprintf(stderr, "The number of jobs must be a positive integer\n");
+        exit(EXIT_FAILURE);
+      }
+      break;
+
+    case THREADS_OPTION:
+      num_threads = atoi(optarg);
+      if (num_threads < 1)
+      {
+        fprintf(stderr, "The number of threads"
+                        " must be a positive integer\n");
+        exit(EXIT_FAILURE);
+      }
+      break;
+
+    case ADAPTIVE_SWEEP_OPTION:
+      adaptive_sweep = true;
+      break;
+
+    case GLYPH_REPORT_OPTION:
+      glyph_report_name = optarg;
+      break;
+
+    case HINT_GLYPHS_OPTION:
+      hint_glyphs_string = optarg;
+      break;
+
+    case PREVIOUS_OPTION:
+      previous_name = optarg;
+      break;
+
+    case TRACE_OPTION:
+      trace_name = optarg;
+      break;
+
+    case TRACE_PPEM_OPTION:
+      trace_ppem = true;
+      break;
 #endif
 
 #ifdef BUILD_GUI
@@ -1312,6 +1648,115 @@ main(int argc,
   if (num_args > 2)
     show_help(false, true);
 
+  if (batch_name || server_name)
+  {
+    const char* option = batch_name ? "--batch" : "--server";
+
+    if (batch_name && server_name)
+    {
+      fprintf(stderr, "Options --batch and --server"
+                      " are mutually exclusive\n");
+      exit(EXIT_FAILURE);
+    }
+    if (show_TTFA_info || compile_control_name)
+    {
+      fprintf(stderr, "Option %s can't be used together with"
+                      " options -T and --compile-control\n",
+                      option);
+      exit(EXIT_FAILURE);
+    }
+    // the debugging code uses global variables
+    if (debug)
+    {
+      fprintf(stderr, "Option %s can't be used together with"
+                      " option --debug\n",
+                      option);
+      exit(EXIT_FAILURE);
+    }
+    if (trace_name)
+    {
+      fprintf(stderr, "Option %s can't be used together with"
+                      " option --trace\n",
+                      option);
+      exit(EXIT_FAILURE);
+    }
+    if (glyph_report_name)
+    {
+      fprintf(stderr, "Option %s can't be used together with"
+                      " option --glyph-report\n",
+                      option);
+      exit(EXIT_FAILURE);
+    }
+    if (hint_glyphs_string)
+    {
+      fprintf(stderr, "Option %s can't be used together with"
+                      " option --hint-glyphs\n",
+                      option);
+      exit(EXIT_FAILURE);
+    }
+    if (previous_name)
+    {
+      fprintf(stderr, "Option %s can't be used together with"
+                      " option --previous\n",
+                      option);
+      exit(EXIT_FAILURE);
+    }
+    if (num_args > (batch_name ? 1 : 0))
+      show_help(false, true);
+
+    Batch_Settings settings;
+
+    settings.hinting_range_min = hinting_range_min;
+    settings.hinting_range_max = hinting_range_max;
+    settings.hinting_limit = hinting_limit;
+
+    settings.gray_stem_width_mode = gray_stem_width_mode;
+    settings.gdi_cleartype_stem_width_mode = gdi_cleartype_stem_width_mode;
+    settings.dw_cleartype_stem_width_mode = dw_cleartype_stem_width_mode;
+
+    settings.increase_x_height = increase_x_height;
+    settings.x_height_snapping_exceptions_string =
+      x_height_snapping_exceptions_string;
+    settings.fallback_stem_width = fallback_stem_width;
+
+    settings.ignore_restrictions = ignore_restrictions;
+    settings.windows_compatibility = windows_compatibility;
+    settings.adjust_subglyphs = adjust_subglyphs;
+    settings.adaptive_sweep = adaptive_sweep;
+    settings.hint_composites = hint_composites;
+    settings.no_info = no_info;
+    settings.detailed_info = detailed_info;
+    settings.TTFA_info = TTFA_info;
+    settings.symbol = symbol;
+    settings.fallback_scaling = fallback_scaling;
+    settings.dehint = dehint;
+
+    settings.default_script = default_script;
+    settings.fallback_script = fallback_script;
+    settings.family_suffix = family_suffix;
+
+    settings.control_name = control_name ? control_name : "";
+    settings.reference_name = reference_name ? reference_name : "";
+    settings.reference_index = reference_index;
+    settings.previous_name = "";
+
+    settings.epoch = epoch;
+
+    settings.num_threads = (unsigned int)num_threads;
+
+    int ret;
+    if (batch_name)
+      ret = batch(batch_name,
+                  num_args ? argv[optind] : NULL,
+                  num_jobs,
+                  settings,
+                  err);
+    else
+      ret = server(server_name, num_jobs, settings);
+
+    exit(ret ? EXIT_FAILURE : EXIT_SUCCESS);
+  }
+
   FILE* in;
   if (num_args > 0)
   {
@@ -1336,6 +1781,10 @@ main(int argc,
   if (show_TTFA_info)
     display_TTFA(in); // this function doesn't return
 
+  if (compile_control_name)
+    compile_control(in, control_name,
+                    compile_control_name); // this function doesn't return
+
   FILE* out;
   if (num_args > 1)
   {
@@ -1365,22 +1814,23 @@ main(int argc,
 
   FILE* control = NULL;
   if (control_name)
-  {
-    control = fopen(control_name, "r");
-    if (!control)
-    {
-      fprintf(stderr,
-              "The following error occurred"
-                " while opening control file `%s':\n"
-              "\n"
-              "  %s\n",
-              control_name, strerror(errno));
-      exit(EXIT_FAILURE);
-    }
-  }
+    control = open_control_file(control_name);
   else
     control = NULL;
 
+  File_Buffer previous;
+  if (previous_name
+      && !batch_read_file(previous_name, false, previous))
+  {
+    fprintf(stderr,
+            "The following error occurred"
+              " while reading previous font `%s':\n"
+            "\n"
+            "  %s\n",
+            previous_name, strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+
   FILE* reference = NULL;
   if (reference_name)
   {
@@ -1436,7 +1886,59 @@ main(int argc,
   else
     reference = NULL;
 
-  Progress_Data progress_data = {-1, 1, 0};
+  FILE* trace = NULL;
+  if (trace_name)
+  {
+    trace = fopen(trace_name, "w");
+    if (!trace)
+    {
+      fprintf(stderr,
+              "The following error occurred"
+                " while opening trace file `%s':\n"
+              "\n"
+              "  %s\n",
+              trace_name, strerror(errno));
+      exit(EXIT_FAILURE);
+    }
+  }
+  else if (trace_ppem)
+  {
+    fprintf(stderr, "Option --trace-ppem needs option --trace\n");
+    exit(EXIT_FAILURE);
+  }
+
+  TA_Glyph_Report_Func glyph_report_func = NULL;
+  Glyph_Report_Data glyph_report_data = {NULL, false, true};
+  if (glyph_report_name)
+  {
+    glyph_report_data.file = fopen(glyph_report_name, "w");
+    if (!glyph_report_data.file)
+    {
+      fprintf(stderr,
+              "The following error occurred"
+                " while opening glyph report file `%s':\n"
+              "\n"
+              "  %s\n",
+              glyph_report_name, strerror(errno));
+      exit(EXIT_FAILURE);
+    }
+
+    size_t len = strlen(glyph_report_name);
+    glyph_report_data.json = len >= 5
+                             && !strcmp(glyph_report_name + len - 5, ".json");
+
+    if (glyph_report_data.json)
+      fprintf(glyph_report_data.file, "[");
+    else
+      fprintf(glyph_report_data.file,
+              "sfnt,index,name,style,points,segments,edges,"
+              "action_hints_records,point_hints_records,"
+              "ins_len,ins_extra_len,time_ms\n");
+
+    glyph_report_func = glyph_report;
+  }
+
+  Progress_Data progress_data = {-1, 1, 0, num_threads > 1};
   Error_Data error_data = {control_name};
   Info_Data info_data;
 
@@ -1473,6 +1975,7 @@ main(int argc,
   info_data.symbol = symbol;
   info_data.fallback_scaling = fallback_scaling;
   info_data.TTFA_info = TTFA_info;
+  info_data.adaptive_sweep = adaptive_sweep;
 
   strncpy(info_data.default_script,
           default_script,
@@ -1508,12 +2011,15 @@ main(int argc,
                  "progress-callback, progress-callback-data,"
                  "error-callback, error-callback-data,"
                  "info-callback, info-post-callback, info-callback-data,"
+                 "glyph-report-callback, glyph-report-callback-data,"
                  "ignore-restrictions, windows-compatibility,"
                  "adjust-subglyphs, hint-composites,"
                  "increase-x-height, x-height-snapping-exceptions,"
                  "fallback-stem-width, default-script,"
                  "fallback-script, fallback-scaling,"
-                 "symbol, dehint, debug, TTFA-info, epoch",
+                 "symbol, dehint, debug, TTFA-info, epoch, threads,"
+                 "trace-file, trace-ppem, adaptive-sweep, hint-glyphs,"
+                 "previous-buffer, previous-buffer-len",
                  in, out, control,
                  reference, reference_index, reference_name,
                  hinting_range_min, hinting_range_max, hinting_limit,
@@ -1522,12 +2028,16 @@ main(int argc,
                  progress_func, &progress_data,
                  err_func, &error_data,
                  info_func, info_post_func, &info_data,
+                 glyph_report_func, &glyph_report_data,
                  ignore_restrictions, windows_compatibility,
                  adjust_subglyphs, hint_composites,
                  increase_x_height, x_height_snapping_exceptions_string,
                  fallback_stem_width, default_script,
                  fallback_script, fallback_scaling,
-                 symbol, dehint, debug, TTFA_info, epoch);
+                 symbol, dehint, debug, TTFA_info, epoch,
+                 (unsigned int)num_threads,
+                 trace, trace_ppem, adaptive_sweep, hint_glyphs_string,
+                 previous.empty() ? NULL : &previous[0], previous.size());
 
   if (!no_info)
   {
@@ -1543,6 +2053,14 @@ main(int argc,
     fclose(control);
   if (reference)
     fclose(reference);
+  if (trace)
+    fclose(trace);
+  if (glyph_report_data.file)
+  {
+    if (glyph_report_data.json)
+      fprintf(glyph_report_data.file, "\n]\n");
+    fclose(glyph_report_data.file);
+  }
 
   exit(error ? EXIT_FAILURE : EXIT_SUCCESS);
 
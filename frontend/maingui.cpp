@@ -78,6 +78,36 @@ const Tag_Names feature_names[] =
 };
 
 
+// The hinting itself runs in a separate thread so that the GUI stays
+// responsive.  `gui_progress' (called by `TTF_autohint' in this thread)
+// only stores the current state; the GUI thread polls it with a timer
+// and updates the progress dialog.  Cancellation works in the opposite
+// direction: `update_progress' sets a flag that `gui_progress' returns.
+
+struct GUI_Progress_Data
+{
+  QMutex mutex;
+
+  // written by the hinting thread
+  long curr_idx;
+  long num_glyphs;
+  long curr_sfnt;
+  long num_sfnts;
+
+  // written by the GUI thread
+  bool canceled;
+
+  // only used by the GUI thread
+  long last_sfnt;
+  bool begin;
+  QProgressDialog* dialog;
+};
+
+
+// progress updates per second
+#define GUI_PROGRESS_RATE 20
+
+
 // used hotkeys:
 //   a: Add ttf&autohint Info
 //   b: Add TTFA info ta&ble
@@ -177,6 +207,8 @@ Main_GUI::Main_GUI(bool horizontal_layout,
 
   x_height_snapping_exceptions = NULL;
 
+  progress_data = NULL;
+
   // if the current input files have been updated
   // we wait a given time interval, then we reload the files
   file_watcher = new QFileSystemWatcher(this);
@@ -222,6 +254,13 @@ Main_GUI::~Main_GUI()
 void
 Main_GUI::closeEvent(QCloseEvent* event)
 {
+  // stop a running hinting thread as soon as possible
+  if (progress_data)
+  {
+    QMutexLocker locker(&progress_data->mutex);
+    progress_data->canceled = true;
+  }
+
   write_settings();
   event->accept();
 }
@@ -908,18 +947,46 @@ void
 Main_GUI::stop_watching()
 {
   check = DoCheck;
-  if (!fileinfo_input_file.fileName().isEmpty())
-    file_watcher->removePath(fileinfo_input_file.fileName());
-  if (!fileinfo_control_file.fileName().isEmpty())
-    file_watcher->removePath(fileinfo_control_file.fileName());
-  if (!fileinfo_reference_file.fileName().isEmpty())
-    file_watcher->removePath(fileinfo_reference_file.fileName());
+
+  QStringList files = file_watcher->files();
+  if (!files.isEmpty())
+    file_watcher->removePaths(files);
+}
+
+
+void
+Main_GUI::watch_paths()
+{
+  // Qt's file watcher doesn't handle symlinks;
+  // we thus watch the files they point to;
+  // note that the watcher drops files that get replaced by renaming
+  // (as many editors do while saving), so we call this function
+  // after every change notification to add them again
+  QFileInfo* fileinfos[] = {&fileinfo_input_file,
+                            &fileinfo_control_file,
+                            &fileinfo_reference_file};
+  QStringList files = file_watcher->files();
+
+  for (size_t i = 0; i < sizeof (fileinfos) / sizeof (fileinfos[0]); i++)
+  {
+    if (fileinfos[i]->fileName().isEmpty())
+      continue;
+
+    fileinfos[i]->refresh();
+    QString path = fileinfos[i]->canonicalFilePath();
+    if (!path.isEmpty() && !files.contains(path))
+      file_watcher->addPath(path);
+  }
 }
 
 
 void
 Main_GUI::watch_files()
 {
+  fileinfo_input_file.refresh();
+  fileinfo_control_file.refresh();
+  fileinfo_reference_file.refresh();
+
   if (fileinfo_input_file.exists()
       && fileinfo_input_file.isReadable()
       && (fileinfo_control_file.fileName().isEmpty()
@@ -934,25 +1001,17 @@ Main_GUI::watch_files()
     QDateTime modified_input = fileinfo_input_file.lastModified();
     QDateTime modified_control = fileinfo_control_file.lastModified();
     QDateTime modified_reference = fileinfo_reference_file.lastModified();
-    // XXX make this configurable
-    if (datetime_input_file.msecsTo(modified_input) > 1000
-        || datetime_control_file.msecsTo(modified_control) > 1000
-        || datetime_reference_file.msecsTo(modified_reference) > 1000)
+    // we are notified by the file watcher,
+    // so any change of the time stamps counts
+    if (datetime_input_file != modified_input
+        || datetime_control_file != modified_control
+        || datetime_reference_file != modified_reference)
     {
       check = CheckNow;
       run(); // this function sets `datetime_XXX'
     }
-    else
-    {
-      // restart timer for symlinks
-      if (watch_box->isChecked())
-      {
-        if (fileinfo_input_file.isSymLink()
-            || fileinfo_control_file.isSymLink()
-            || fileinfo_reference_file.isSymLink())
-          timer->start();
-      }
-    }
+    else if (watch_box->isChecked())
+      watch_paths();
   }
   else
   {
@@ -968,17 +1027,6 @@ Main_GUI::watch_files()
 
 extern "C" {
 
-struct GUI_Progress_Data
-{
-  long last_sfnt;
-  bool begin;
-  QProgressDialog* dialog;
-};
-
-
-#undef TRDOMAIN
-#define TRDOMAIN "GuiProgress"
-
 static int
 gui_progress(long curr_idx,
              long num_glyphs,
@@ -987,6 +1035,44 @@ gui_progress(long curr_idx,
              void* user)
 {
   GUI_Progress_Data* data = static_cast<GUI_Progress_Data*>(user);
+  QMutexLocker locker(&data->mutex);
+
+  data->curr_idx = curr_idx;
+  data->num_glyphs = num_glyphs;
+  data->curr_sfnt = curr_sfnt;
+  data->num_sfnts = num_sfnts;
+
+  return data->canceled ? 1 : 0;
+}
+
+} // extern "C"
+
+
+#undef TRDOMAIN
+#define TRDOMAIN "GuiProgress"
+
+void
+Main_GUI::update_progress()
+{
+  GUI_Progress_Data* data = progress_data;
+  if (!data)
+    return;
+
+  long curr_idx;
+  long num_glyphs;
+  long curr_sfnt;
+  long num_sfnts;
+
+  data->mutex.lock();
+  curr_idx = data->curr_idx;
+  num_glyphs = data->num_glyphs;
+  curr_sfnt = data->curr_sfnt;
+  num_sfnts = data->num_sfnts;
+  data->mutex.unlock();
+
+  // no glyph processed yet
+  if (curr_idx < 0)
+    return;
 
   if (num_sfnts > 1 && curr_sfnt != data->last_sfnt)
   {
@@ -1024,12 +1110,15 @@ gui_progress(long curr_idx,
   data->dialog->setValue(int(curr_idx));
 
   if (data->dialog->wasCanceled())
-    return 1;
-
-  return 0;
+  {
+    QMutexLocker locker(&data->mutex);
+    data->canceled = true;
+  }
 }
 
 
+extern "C" {
+
 struct GUI_Error_Data
 {
   Main_GUI* gui;
@@ -1188,12 +1277,149 @@ gui_error(TA_Error error,
   }
 }
 
+
+
+// Message boxes can only be shown by the GUI thread; the hinting thread
+// thus stores the data of an error, to be passed to `gui_error' later on.
+
+struct GUI_Error_Record
+{
+  TA_Error error;
+  QByteArray error_string;
+  unsigned int errlinenum;
+  QByteArray errline;
+  long errpos; // offset into `errline', or -1
+};
+
+
+static void
+gui_error_record(TA_Error error,
+                 const char* error_string,
+                 unsigned int errlinenum,
+                 const char* errline,
+                 const char* errpos,
+                 void* user)
+{
+  GUI_Error_Record* record = static_cast<GUI_Error_Record*>(user);
+
+  record->error = error;
+  record->error_string = error_string;
+  record->errlinenum = errlinenum;
+  record->errline = errline;
+  record->errpos = (errline && errpos) ? long(errpos - errline) : -1;
+}
+
 } // extern "C"
 
 
+// all data `TTF_autohint' needs, collected by `Main_GUI::run'
+struct GUI_Hinting_Data
+{
+  FILE* input;
+  FILE* output;
+  FILE* reference;
+
+  const char* control_buf;
+  size_t control_len;
+  const char* previous_buf;
+  size_t previous_len;
+  const char* previous_control_buf;
+  size_t previous_control_len;
+
+  Info_Data* info_data;
+  TA_Info_Func info_func;
+  TA_Info_Post_Func info_post_func;
+  const char* snapping_string;
+  int ignore_restrictions;
+
+  GUI_Progress_Data* progress_data;
+  GUI_Error_Record* error_record;
+
+  TA_Error error;
+};
+
+
+class GUI_Hinting_Thread
+: public QThread
+{
+public:
+  GUI_Hinting_Thread(GUI_Hinting_Data* d)
+  : data(d)
+  {
+  }
+
+protected:
+  void run();
+
+private:
+  GUI_Hinting_Data* data;
+};
+
+
+void
+GUI_Hinting_Thread::run()
+{
+  Info_Data* info_data = data->info_data;
+
+  data->error =
+    TTF_autohint("in-file, out-file, reference-file,"
+                 "control-buffer, control-buffer-len,"
+                 "previous-buffer, previous-buffer-len,"
+                 "previous-control-buffer, previous-control-buffer-len,"
+                 "reference-index, reference-name,"
+                 "hinting-range-min, hinting-range-max,"
+                 "hinting-limit,"
+                 "gray-stem-width-mode,"
+                 "gdi-cleartype-stem-width-mode,"
+                 "dw-cleartype-stem-width-mode,"
+                 "progress-callback, progress-callback-data,"
+                 "error-callback, error-callback-data,"
+                 "info-callback, info-post-callback, info-callback-data,"
+                 "ignore-restrictions,"
+                 "windows-compatibility,"
+                 "adjust-subglyphs,"
+                 "hint-composites,"
+                 "increase-x-height,"
+                 "x-height-snapping-exceptions, fallback-stem-width,"
+                 "default-script,"
+                 "fallback-script, fallback-scaling,"
+                 "symbol, dehint, TTFA-info",
+                 data->input, data->output, data->reference,
+                 data->control_buf, data->control_len,
+                 data->previous_buf, data->previous_len,
+                 data->previous_control_buf, data->previous_control_len,
+                 info_data->reference_index, info_data->reference_name,
+                 info_data->hinting_range_min, info_data->hinting_range_max,
+                 info_data->hinting_limit,
+                 info_data->gray_stem_width_mode,
+                 info_data->gdi_cleartype_stem_width_mode,
+                 info_data->dw_cleartype_stem_width_mode,
+                 gui_progress, data->progress_data,
+                 gui_error_record, data->error_record,
+                 data->info_func, data->info_post_func, info_data,
+                 data->ignore_restrictions,
+                 info_data->windows_compatibility,
+                 info_data->adjust_subglyphs,
+                 info_data->hint_composites,
+                 info_data->increase_x_height,
+                 data->snapping_string, info_data->fallback_stem_width,
+                 info_data->default_script,
+                 info_data->fallback_script, info_data->fallback_scaling,
+                 info_data->symbol, info_data->dehint, info_data->TTFA_info);
+}
+
+
 void
 Main_GUI::run()
 {
+  // we are still hinting (and processing events while doing so);
+  // this can happen if the file watcher triggers -- try again later
+  if (progress_data)
+  {
+    timer->start();
+    return;
+  }
+
   clear_status_bar();
 
   if (check == CheckLater)
@@ -1235,7 +1461,16 @@ again:
 
   TA_Info_Func info_func = info;
   TA_Info_Post_Func info_post_func = info_post;
-  GUI_Progress_Data gui_progress_data = {-1, true, &dialog};
+
+  GUI_Progress_Data gui_progress_data;
+  gui_progress_data.curr_idx = -1;
+  gui_progress_data.num_glyphs = 0;
+  gui_progress_data.curr_sfnt = 0;
+  gui_progress_data.num_sfnts = 0;
+  gui_progress_data.canceled = false;
+  gui_progress_data.last_sfnt = -1;
+  gui_progress_data.begin = true;
+  gui_progress_data.dialog = &dialog;
   GUI_Error_Data gui_error_data = {this, locale,
                                    output_name, control_name, reference_name,
                                    &ignore_restrictions, false};
@@ -1295,6 +1530,7 @@ again:
   info_data.detailed_info = info_box->currentIndex() == 2;
   info_data.dehint = dehint_box->isChecked();
   info_data.TTFA_info = TTFA_box->isChecked();
+  info_data.adaptive_sweep = false;
 
   strncpy(info_data.default_script,
           script_names[default_box->currentIndex()].tag,
@@ -1344,45 +1580,98 @@ again:
 
   QByteArray snapping_string = snapping_line->text().toLocal8Bit();
 
-  TA_Error error =
-    TTF_autohint("in-file, out-file, control-file, reference-file,"
-                 "reference-index, reference-name,"
-                 "hinting-range-min, hinting-range-max,"
-                 "hinting-limit,"
-                 "gray-stem-width-mode,"
-                 "gdi-cleartype-stem-width-mode,"
-                 "dw-cleartype-stem-width-mode,"
-                 "progress-callback, progress-callback-data,"
-                 "error-callback, error-callback-data,"
-                 "info-callback, info-post-callback, info-callback-data,"
-                 "ignore-restrictions,"
-                 "windows-compatibility,"
-                 "adjust-subglyphs,"
-                 "hint-composites,"
-                 "increase-x-height,"
-                 "x-height-snapping-exceptions, fallback-stem-width,"
-                 "default-script,"
-                 "fallback-script, fallback-scaling,"
-                 "symbol, dehint, TTFA-info",
-                 input, output, control, reference,
-                 info_data.reference_index, info_data.reference_name,
-                 info_data.hinting_range_min, info_data.hinting_range_max,
-                 info_data.hinting_limit,
-                 info_data.gray_stem_width_mode,
-                 info_data.gdi_cleartype_stem_width_mode,
-                 info_data.dw_cleartype_stem_width_mode,
-                 gui_progress, &gui_progress_data,
-                 gui_error, &gui_error_data,
-                 info_func, info_post_func, &info_data,
-                 ignore_restrictions,
-                 info_data.windows_compatibility,
-                 info_data.adjust_subglyphs,
-                 info_data.hint_composites,
-                 info_data.increase_x_height,
-                 snapping_string.constData(), info_data.fallback_stem_width,
-                 info_data.default_script,
-                 info_data.fallback_script, info_data.fallback_scaling,
-                 info_data.symbol, info_data.dehint, info_data.TTFA_info);
+  // we pass the control instructions as a buffer
+  // so that we know exactly which data has been used
+  QByteArray control_contents;
+  if (control)
+  {
+    QFile control_file;
+    if (control_file.open(control, QIODevice::ReadOnly))
+      control_contents = control_file.readAll();
+  }
+
+  // all settings that influence the hinting result
+  // (except the contents of the files);
+  // if they are the same as in the last successful run,
+  // `TTF_autohint' can reuse the bytecode of unchanged glyphs
+  QStringList settings_list;
+  settings_list << input_name << output_name << reference_name
+                << QString::number(info_data.reference_index)
+                << QString::number(info_data.hinting_range_min)
+                << QString::number(info_data.hinting_range_max)
+                << QString::number(info_data.hinting_limit)
+                << QString::number(info_data.gray_stem_width_mode)
+                << QString::number(info_data.gdi_cleartype_stem_width_mode)
+                << QString::number(info_data.dw_cleartype_stem_width_mode)
+                << QString::number(info_data.increase_x_height)
+                << x_height_snapping_exceptions_string
+                << snapping_line->text()
+                << QString::number(info_data.fallback_stem_width)
+                << QString::number(info_data.windows_compatibility)
+                << QString::number(info_data.adjust_subglyphs)
+                << QString::number(info_data.hint_composites)
+                << QString::number(info_data.symbol)
+                << QString::number(info_data.fallback_scaling)
+                << QString::number(info_data.dehint)
+                << QString::number(info_data.TTFA_info)
+                << QString::number(info_box->currentIndex())
+                << QString::number(ignore_restrictions)
+                << family_suffix_line->text()
+                << info_data.default_script
+                << info_data.fallback_script;
+  QString settings = settings_list.join("\n");
+
+  bool use_previous = !previous_output.isEmpty()
+                      && settings == previous_settings;
+
+  GUI_Error_Record error_record;
+  error_record.error = TA_Err_Ok;
+
+  GUI_Hinting_Data hinting_data;
+  hinting_data.input = input;
+  hinting_data.output = output;
+  hinting_data.reference = reference;
+  hinting_data.control_buf = control ? control_contents.constData() : NULL;
+  hinting_data.control_len = (size_t)control_contents.size();
+  hinting_data.previous_buf = use_previous ? previous_output.constData()
+                                           : NULL;
+  hinting_data.previous_len = (size_t)previous_output.size();
+  hinting_data.previous_control_buf =
+    (use_previous && !previous_control.isEmpty())
+      ? previous_control.constData()
+      : NULL;
+  hinting_data.previous_control_len = (size_t)previous_control.size();
+  hinting_data.info_data = &info_data;
+  hinting_data.info_func = info_func;
+  hinting_data.info_post_func = info_post_func;
+  hinting_data.snapping_string = snapping_string.constData();
+  hinting_data.ignore_restrictions = ignore_restrictions;
+  hinting_data.progress_data = &gui_progress_data;
+  hinting_data.error_record = &error_record;
+  hinting_data.error = TA_Err_Ok;
+
+  // run the hinting thread and keep processing events until it is done;
+  // the progress dialog gets updated at a fixed rate
+  GUI_Hinting_Thread thread(&hinting_data);
+  QEventLoop loop;
+  QTimer progress_timer;
+
+  connect(&thread, SIGNAL(finished()), &loop, SLOT(quit()));
+  connect(&progress_timer, SIGNAL(timeout()), this, SLOT(update_progress()));
+
+  progress_data = &gui_progress_data;
+  run_button->setEnabled(false);
+
+  progress_timer.start(1000 / GUI_PROGRESS_RATE);
+  thread.start();
+  loop.exec();
+  thread.wait();
+  progress_timer.stop();
+
+  run_button->setEnabled(true);
+  progress_data = NULL;
+
+  TA_Error error = hinting_data.error;
 
   if (info_box->currentIndex())
   {
@@ -1397,8 +1686,28 @@ again:
   if (reference)
     fclose(reference);
 
+  if (error_record.error)
+  {
+    const char* errline = error_record.errline.isNull()
+                          ? NULL
+                          : error_record.errline.constData();
+
+    gui_error(error_record.error,
+              error_record.error_string.isNull()
+                ? NULL
+                : error_record.error_string.constData(),
+              error_record.errlinenum,
+              errline,
+              (errline && error_record.errpos >= 0)
+                ? errline + error_record.errpos
+                : NULL,
+              &gui_error_data);
+  }
+
   if (error)
   {
+    previous_output.clear();
+
     // retry if there is a user request to do so (handled in `gui_error')
     if (gui_error_data.retry)
       goto again;
@@ -1407,6 +1716,19 @@ again:
   }
   else
   {
+    // keep the result for the next run; the library can reuse
+    // its bytecode only if it has a `TTFA' table
+    QFile output_file(output_name);
+    if (info_data.TTFA_info
+        && output_file.open(QIODevice::ReadOnly))
+    {
+      previous_output = output_file.readAll();
+      previous_control = control_contents;
+      previous_settings = settings;
+    }
+    else
+      previous_output.clear();
+
     statusBar()->showMessage(tr("Auto-hinting finished")
                              + " ("
                              + QDateTime::currentDateTime()
@@ -1418,19 +1740,7 @@ again:
     if (watch_box->isChecked())
     {
       check = DoCheck;
-
-      // Qt's file watcher doesn't handle symlinks;
-      // we thus fall back to polling
-      if (fileinfo_input_file.isSymLink()
-          || fileinfo_control_file.isSymLink()
-          || fileinfo_reference_file.isSymLink())
-        timer->start();
-      else
-      {
-        file_watcher->addPath(input_name);
-        file_watcher->addPath(control_name);
-        file_watcher->addPath(reference_name);
-      }
+      watch_paths();
     }
   }
 }
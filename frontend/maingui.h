@@ -30,10 +30,12 @@
 #include <QMainWindow>
 #include <QMenuBar>
 #include <QMessageBox>
+#include <QMutex>
 #include <QProgressDialog>
 #include <QPushButton>
 #include <QSpinBox>
 #include <QStatusBar>
+#include <QThread>
 
 #include "ddlineedit.h"
 #include "ttlineedit.h"
@@ -56,6 +58,8 @@ class QSpinBox;
 class Drag_Drop_Line_Edit;
 class Tooltip_Line_Edit;
 
+struct GUI_Progress_Data;
+
 class Main_GUI
 : public QMainWindow
 {
@@ -102,6 +106,7 @@ private slots:
   void watch_files();
   void check_run();
   void run();
+  void update_progress();
 
 private:
   int hinting_range_min;
@@ -155,6 +160,15 @@ private:
   QDateTime datetime_reference_file;
   CheckState check;
 
+  // non-NULL while a font gets hinted
+  GUI_Progress_Data* progress_data;
+
+  // the data of the last successful run, used to reuse the bytecode
+  // of unchanged glyphs if the settings are the same
+  QByteArray previous_output;
+  QByteArray previous_control;
+  QString previous_settings;
+
   void create_connections();
   void create_actions();
   void create_menus();
@@ -174,6 +188,7 @@ private:
   int handle_error(TA_Error, const unsigned char*, QString);
 
   void stop_watching();
+  void watch_paths();
 
   QMenu* file_menu;
   QMenu* help_menu;
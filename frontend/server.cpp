@@ -0,0 +1,888 @@
+// server.cpp
+
+// Copyright (C) 2022 by Werner Lemberg.
+//
+// This file is part of the ttfautohint library, and may only be used,
+// modified, and distributed under the terms given in `COPYING'.  By
+// continuing to use, modify, or distribute this file you indicate that you
+// have read `COPYING' and understand and accept it fully.
+//
+// The file `COPYING' mentioned in the previous paragraph is distributed
+// with the ttfautohint library.
+
+
+// A long-running process that hints fonts sent over a Unix domain socket.
+//
+// This avoids the start-up costs of the `ttfautohint' binary (together
+// with reading control instructions and reference fonts) for every font.
+// The main thread watches all idle connections with `poll'; as soon as a
+// complete request has arrived on a connection, the request gets queued
+// and is served by the next free thread of a worker pool.  Idle or slow
+// clients thus never block a worker.  See `server.h' for the protocol.
+
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#if defined(HAVE_SYS_SOCKET_H) && defined(HAVE_SYS_UN_H)
+#  define HAVE_UNIX_SOCKETS
+#endif
+
+#ifdef HAVE_UNIX_SOCKETS
+#  include <sys/types.h>
+#  include <sys/socket.h>
+#  include <sys/un.h>
+#  include <fcntl.h>
+#  include <poll.h>
+#  include <signal.h>
+#  include <unistd.h>
+#endif
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+#include <deque>
+#include <string>
+#include <vector>
+
+// the next header files are from gnulib
+#include "glthread/cond.h"
+#include "glthread/lock.h"
+#include "glthread/thread.h"
+#include "nproc.h"
+#include "timespec.h"
+
+#include "server.h"
+
+
+#ifdef HAVE_UNIX_SOCKETS
+
+using namespace std;
+
+
+// how long we wait for a slow client to accept a response, in ms
+#define SERVER_SEND_TIMEOUT 30000
+
+
+// A connection is either idle (owned by the main thread, which collects
+// incoming data in `in') or busy (owned by a worker, which serves the
+// request at the start of `in').
+
+struct Server_Connection
+{
+  int fd;
+  File_Buffer in;
+  bool eof; // the client doesn't send more data
+  bool close; // the worker wants the connection to be closed
+  struct timespec queued;
+};
+
+
+struct Server_Data
+{
+  Batch_Settings defaults;
+  File_Buffer control_buf;
+  File_Buffer reference_buf;
+
+  // connections with a complete request, waiting for a worker
+  deque<Server_Connection*> queue;
+  // connections handed back by the workers to the main thread
+  vector<Server_Connection*> done;
+  // a pipe to wake up the main thread
+  int wake_fds[2];
+
+  // statistics
+  unsigned long num_connections;
+  unsigned long num_active;
+  unsigned long num_requests;
+  unsigned long num_failed;
+  double wait_sum;
+  double latency_sum;
+  double latency_max;
+};
+
+
+// serializes access to `Server_Data'
+gl_lock_define_initialized(static, server_lock)
+// signals a new entry in the request queue
+gl_cond_define_initialized(static, server_cond)
+
+
+extern "C" {
+
+// Collect error messages for the client.
+
+static void
+server_err(TA_Error error,
+           const char* error_string,
+           unsigned int errlinenum,
+           const char* errline,
+           const char* errpos,
+           void* user)
+{
+  string* message = static_cast<string*>(user);
+  char buf[64];
+
+  if (!error)
+    return;
+
+  if (error >= 0x200 && error < 0x300)
+  {
+    if (errpos && errline)
+      sprintf(buf, "control instructions:%u:%d:",
+                   errlinenum, int(errpos - errline + 1));
+    else
+      sprintf(buf, "control instructions:%u:", errlinenum);
+    *message += buf;
+  }
+  else if (error >= 0x300 && error < 0x400)
+    *message += "reference font:";
+
+  sprintf(buf, " error 0x%02X", error);
+  *message += buf;
+
+  if (error_string)
+  {
+    *message += ": ";
+    *message += error_string;
+  }
+  if (errline)
+  {
+    *message += "\n  ";
+    *message += errline;
+  }
+  *message += "\n";
+}
+
+} // extern "C"
+
+
+static double
+elapsed(const struct timespec& start,
+        const struct timespec& end)
+{
+  return double(end.tv_sec - start.tv_sec)
+         + double(end.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+
+static bool
+write_all(int fd,
+          const void* buf,
+          size_t len)
+{
+  const char* p = static_cast<const char*>(buf);
+
+  while (len)
+  {
+    ssize_t n = write(fd, p, len);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+    {
+      // the socket is non-blocking; wait for a slow client
+      struct pollfd pfd;
+
+      pfd.fd = fd;
+      pfd.events = POLLOUT;
+      if (poll(&pfd, 1, SERVER_SEND_TIMEOUT) <= 0)
+        return false;
+      continue;
+    }
+    if (n <= 0)
+      return false;
+
+    p += n;
+    len -= size_t(n);
+  }
+
+  return true;
+}
+
+
+static unsigned long
+get_ulong(const char* p)
+{
+  const unsigned char* buf = reinterpret_cast<const unsigned char*>(p);
+
+  return (unsigned long)buf[0] << 24
+         | (unsigned long)buf[1] << 16
+         | (unsigned long)buf[2] << 8
+         | (unsigned long)buf[3];
+}
+
+
+static bool
+send_response(int fd,
+              unsigned long status,
+              const char* data,
+              size_t len)
+{
+  unsigned char buf[8];
+
+  buf[0] = (unsigned char)(status >> 24);
+  buf[1] = (unsigned char)(status >> 16);
+  buf[2] = (unsigned char)(status >> 8);
+  buf[3] = (unsigned char)status;
+  buf[4] = (unsigned char)(len >> 24);
+  buf[5] = (unsigned char)(len >> 16);
+  buf[6] = (unsigned char)(len >> 8);
+  buf[7] = (unsigned char)len;
+
+  return write_all(fd, buf, 8) && write_all(fd, data, len);
+}
+
+
+static bool
+send_message(int fd,
+             unsigned long status,
+             const string& message)
+{
+  return send_response(fd, status, message.data(), message.size());
+}
+
+
+static string
+statistics(Server_Data* data)
+{
+  char buf[512];
+
+  gl_lock_lock(server_lock);
+  sprintf(buf,
+          "connections %lu\n"
+          "connections-active %lu\n"
+          "requests %lu\n"
+          "requests-queued %lu\n"
+          "requests-failed %lu\n"
+          "queue-wait-avg-ms %.3f\n"
+          "latency-avg-ms %.3f\n"
+          "latency-max-ms %.3f\n",
+          data->num_connections,
+          data->num_active,
+          data->num_requests,
+          (unsigned long)data->queue.size(),
+          data->num_failed,
+          data->num_requests
+            ? data->wait_sum * 1000 / double(data->num_requests)
+            : 0.0,
+          data->num_requests
+            ? data->latency_sum * 1000 / double(data->num_requests)
+            : 0.0,
+          data->latency_max * 1000);
+  gl_lock_unlock(server_lock);
+
+  return buf;
+}
+
+
+// Hint a font with the options given in `options'.
+
+static TA_Error
+hint(Server_Data* data,
+     const string& options,
+     const char* font,
+     size_t font_len,
+     char** out_bufp,
+     size_t* out_lenp,
+     string& message)
+{
+  Batch_Settings s = data->defaults;
+  vector<string> tokens;
+
+  if (!batch_tokenize(options, tokens))
+  {
+    message = "unterminated quote in option string\n";
+    return TA_Err_Unknown_Argument;
+  }
+
+  for (size_t i = 0; i < tokens.size(); i++)
+  {
+    // files are only read at startup
+    if (!batch_parse_option(tokens[i], s)
+        || s.control_name != data->defaults.control_name
+        || s.reference_name != data->defaults.reference_name
+        || s.previous_name != data->defaults.previous_name)
+    {
+      message = "invalid option `" + tokens[i] + "'\n";
+      return TA_Err_Unknown_Argument;
+    }
+  }
+
+  const File_Buffer& control = data->control_buf;
+  const File_Buffer& reference = data->reference_buf;
+
+  Info_Data info_data;
+  int ret = batch_info_data(s, info_data);
+  if (ret)
+  {
+    if (ret == 1)
+    {
+      message = "can't allocate memory"
+                " for ttfautohint options string in `name' table\n";
+      return FT_Err_Out_Of_Memory;
+    }
+
+    message = "ttfautohint options string in `name' table too long\n";
+    return FT_Err_Invalid_Argument;
+  }
+
+  TA_Error error =
+    TTF_autohint("in-buffer, in-buffer-len, out-buffer, out-buffer-len,"
+                 "control-buffer, control-buffer-len,"
+                 "reference-buffer, reference-buffer-len,"
+                 "reference-index, reference-name,"
+                 "hinting-range-min, hinting-range-max, hinting-limit,"
+                 "gray-stem-width-mode, gdi-cleartype-stem-width-mode,"
+                 "dw-cleartype-stem-width-mode,"
+                 "error-callback, error-callback-data,"
+                 "info-callback, info-post-callback, info-callback-data,"
+                 "ignore-restrictions, windows-compatibility,"
+                 "adjust-subglyphs, hint-composites,"
+                 "increase-x-height, x-height-snapping-exceptions,"
+                 "fallback-stem-width, default-script,"
+                 "fallback-script, fallback-scaling,"
+                 "symbol, dehint, TTFA-info, epoch, threads,"
+                 "adaptive-sweep",
+                 font_len ? font : NULL, font_len,
+                 out_bufp, out_lenp,
+                 control.empty() ? NULL : &control[0], control.size(),
+                 reference.empty() ? NULL : &reference[0],
+                 reference.size(),
+                 s.reference_index, info_data.reference_name,
+                 s.hinting_range_min, s.hinting_range_max, s.hinting_limit,
+                 s.gray_stem_width_mode, s.gdi_cleartype_stem_width_mode,
+                 s.dw_cleartype_stem_width_mode,
+                 server_err, &message,
+                 info, s.family_suffix.empty() ? NULL : info_post,
+                 &info_data,
+                 s.ignore_restrictions, s.windows_compatibility,
+                 s.adjust_subglyphs, s.hint_composites,
+                 s.increase_x_height,
+                 info_data.x_height_snapping_exceptions_string,
+                 s.fallback_stem_width, s.default_script.c_str(),
+                 s.fallback_script.c_str(), s.fallback_scaling,
+                 s.symbol, s.dehint, s.TTFA_info, s.epoch,
+                 s.num_threads, s.adaptive_sweep);
+
+  if (!s.no_info)
+  {
+    free(info_data.info_string);
+    free(info_data.info_string_wide);
+  }
+
+  return error;
+}
+
+
+// Check whether `in' starts with a complete request.  Return its length,
+// or zero if more data is needed or if the request is malformed; in the
+// latter case, `error' gets set.
+
+static size_t
+request_length(const File_Buffer& in,
+               string& error)
+{
+  if (in.size() < 4)
+    return 0;
+
+  if (!memcmp(&in[0], "STAT", 4))
+    return 4;
+
+  if (memcmp(&in[0], "HINT", 4))
+  {
+    error = "unknown request\n";
+    return 0;
+  }
+
+  if (in.size() < 8)
+    return 0;
+
+  unsigned long options_len = get_ulong(&in[4]);
+  if (options_len > SERVER_MAX_OPTIONS_LEN)
+  {
+    error = "option string too long\n";
+    return 0;
+  }
+
+  size_t font_pos = 8 + options_len + 4;
+  if (in.size() < font_pos)
+    return 0;
+
+  unsigned long font_len = get_ulong(&in[font_pos - 4]);
+  if (font_len > SERVER_MAX_FONT_LEN)
+  {
+    error = "font too large\n";
+    return 0;
+  }
+
+  if (in.size() < font_pos + font_len)
+    return 0;
+
+  return font_pos + font_len;
+}
+
+
+// Serve the request at the start of the input data of `connection'.
+// Return false if the connection should be closed.
+
+static bool
+serve_request(Server_Data* data,
+              Server_Connection* connection)
+{
+  int fd = connection->fd;
+  File_Buffer& in = connection->in;
+  string message;
+
+  struct timespec start = current_timespec();
+  double wait = elapsed(connection->queued, start);
+
+  size_t len = request_length(in, message);
+  if (!len)
+  {
+    send_message(fd, SERVER_PROTOCOL_ERROR, message);
+    return false;
+  }
+
+  if (!memcmp(&in[0], "STAT", 4))
+  {
+    in.erase(in.begin(), in.begin() + len);
+    return send_message(fd, 0, statistics(data));
+  }
+
+  unsigned long options_len = get_ulong(&in[4]);
+  string options(&in[8], options_len);
+  const char* font = &in[8 + options_len + 4];
+  size_t font_len = len - (8 + options_len + 4);
+
+  char* out_buf = NULL;
+  size_t out_len = 0;
+
+  TA_Error error = hint(data, options, font, font_len,
+                        &out_buf, &out_len, message);
+
+  in.erase(in.begin(), in.begin() + len);
+
+  bool ok;
+  if (error)
+  {
+    if (message.empty())
+      server_err(error, NULL, 0, NULL, NULL, &message);
+    ok = send_message(fd, (unsigned long)error, message);
+  }
+  else
+    ok = send_response(fd, 0, out_buf, out_len);
+
+  free(out_buf);
+
+  double latency = elapsed(start, current_timespec());
+
+  gl_lock_lock(server_lock);
+  data->num_requests++;
+  if (error)
+    data->num_failed++;
+  data->wait_sum += wait;
+  data->latency_sum += latency;
+  if (latency > data->latency_max)
+    data->latency_max = latency;
+  gl_lock_unlock(server_lock);
+
+  return ok;
+}
+
+
+extern "C" {
+
+static void*
+worker(void* user)
+{
+  Server_Data* data = static_cast<Server_Data*>(user);
+
+  for (;;)
+  {
+    gl_lock_lock(server_lock);
+    while (data->queue.empty())
+      gl_cond_wait(server_cond, server_lock);
+
+    Server_Connection* connection = data->queue.front();
+    data->queue.pop_front();
+    gl_lock_unlock(server_lock);
+
+    connection->close = !serve_request(data, connection);
+
+    // hand the connection back to the main thread
+    gl_lock_lock(server_lock);
+    data->done.push_back(connection);
+    gl_lock_unlock(server_lock);
+
+    // if the pipe is full, the main thread gets woken up anyway
+    char c = 0;
+    while (write(data->wake_fds[1], &c, 1) < 0 && errno == EINTR)
+      ;
+  }
+
+  return NULL;
+}
+
+} // extern "C"
+
+
+// Append the data available on `connection' to its input buffer.
+
+static void
+receive(Server_Connection* connection)
+{
+  char buf[0x10000];
+
+  for (;;)
+  {
+    ssize_t n = read(connection->fd, buf, sizeof (buf));
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+      return;
+
+    if (n <= 0)
+      connection->eof = true;
+    else
+      connection->in.insert(connection->in.end(), buf, buf + n);
+
+    return;
+  }
+}
+
+
+static void
+close_connection(Server_Data* data,
+                 Server_Connection* connection)
+{
+  close(connection->fd);
+  delete connection;
+
+  gl_lock_lock(server_lock);
+  data->num_active--;
+  gl_lock_unlock(server_lock);
+}
+
+
+// Queue the request on idle connection `connection' if it is complete
+// (or malformed), otherwise add the connection to `idle'.  Without
+// worker threads, requests are served directly.
+
+static void
+schedule(Server_Data* data,
+         Server_Connection* connection,
+         bool have_workers,
+         vector<Server_Connection*>& idle)
+{
+  while (!connection->close)
+  {
+    string error;
+
+    if (!request_length(connection->in, error) && error.empty())
+    {
+      if (connection->eof)
+        break;
+
+      idle.push_back(connection);
+      return;
+    }
+
+    connection->queued = current_timespec();
+
+    if (have_workers)
+    {
+      gl_lock_lock(server_lock);
+      data->queue.push_back(connection);
+      gl_cond_signal(server_cond);
+      gl_lock_unlock(server_lock);
+      return;
+    }
+
+    connection->close = !serve_request(data, connection);
+  }
+
+  close_connection(data, connection);
+}
+
+
+static bool
+set_nonblocking(int fd)
+{
+  int flags = fcntl(fd, F_GETFL);
+
+  return flags >= 0 && !fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+
+// Bind to `socket_name', removing a stale socket file if necessary.
+
+static int
+open_socket(const char* socket_name)
+{
+  struct sockaddr_un addr;
+  int fd, test_fd, ret;
+
+  if (strlen(socket_name) >= sizeof (addr.sun_path))
+  {
+    fprintf(stderr, "Socket name `%s' too long\n", socket_name);
+    return -1;
+  }
+
+  memset(&addr, 0, sizeof (addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, socket_name);
+
+  fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (fd < 0)
+    goto Err;
+
+  if (bind(fd, (struct sockaddr*)&addr, sizeof (addr)))
+  {
+    if (errno != EADDRINUSE)
+      goto Err;
+
+    // if nobody is listening, the socket is a leftover of a previous run
+    test_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (test_fd < 0)
+      goto Err;
+
+    ret = connect(test_fd, (struct sockaddr*)&addr, sizeof (addr));
+    close(test_fd);
+    if (!ret || errno != ECONNREFUSED)
+    {
+      errno = EADDRINUSE;
+      goto Err;
+    }
+
+    unlink(socket_name);
+    if (bind(fd, (struct sockaddr*)&addr, sizeof (addr)))
+      goto Err;
+  }
+
+  if (listen(fd, SOMAXCONN))
+    goto Err;
+
+  return fd;
+
+Err:
+  fprintf(stderr,
+          "The following error occurred while opening socket `%s':\n"
+          "\n"
+          "  %s\n",
+          socket_name, strerror(errno));
+  if (fd >= 0)
+    close(fd);
+
+  return -1;
+}
+
+
+int
+server(const char* socket_name,
+       int num_jobs,
+       const Batch_Settings& defaults)
+{
+  Server_Data data;
+
+  data.defaults = defaults;
+  data.num_connections = 0;
+  data.num_active = 0;
+  data.num_requests = 0;
+  data.num_failed = 0;
+  data.wait_sum = 0;
+  data.latency_sum = 0;
+  data.latency_max = 0;
+
+  if (!defaults.control_name.empty()
+      && !batch_read_control_file(defaults.control_name, data.control_buf))
+  {
+    fprintf(stderr,
+            "The following error occurred"
+              " while reading control file `%s':\n"
+            "\n"
+            "  %s\n",
+            defaults.control_name.c_str(), strerror(errno));
+    return -1;
+  }
+
+  if (!defaults.reference_name.empty()
+      && !batch_read_file(defaults.reference_name, false,
+                          data.reference_buf))
+  {
+    fprintf(stderr,
+            "The following error occurred"
+              " while reading reference font `%s':\n"
+            "\n"
+            "  %s\n",
+            defaults.reference_name.c_str(), strerror(errno));
+    return -1;
+  }
+
+  int fd = open_socket(socket_name);
+  if (fd < 0)
+    return -1;
+
+  if (pipe(data.wake_fds)
+      || !set_nonblocking(data.wake_fds[0])
+      || !set_nonblocking(data.wake_fds[1])
+      || !set_nonblocking(fd))
+  {
+    fprintf(stderr,
+            "The following error occurred while setting up the server:\n"
+            "\n"
+            "  %s\n",
+            strerror(errno));
+    close(fd);
+    return -1;
+  }
+
+  // a client closing its connection early must not kill the server
+  signal(SIGPIPE, SIG_IGN);
+
+  size_t num_threads = num_jobs > 0
+                         ? size_t(num_jobs)
+                         : size_t(num_processors(NPROC_CURRENT));
+  size_t num_workers = 0;
+
+  for (size_t i = 0; i < num_threads; i++)
+  {
+    gl_thread_t thread;
+
+    if (glthread_create(&thread, worker, &data))
+      break;
+    num_workers++;
+  }
+
+  fprintf(stderr, "Listening on `%s' with %lu threads\n",
+                  socket_name,
+                  (unsigned long)(num_workers ? num_workers : 1));
+
+  vector<Server_Connection*> idle;
+  vector<Server_Connection*> connections;
+  vector<struct pollfd> fds;
+
+  for (;;)
+  {
+    fds.resize(2 + idle.size());
+
+    fds[0].fd = fd;
+    fds[0].events = POLLIN;
+    fds[1].fd = data.wake_fds[0];
+    fds[1].events = POLLIN;
+    for (size_t i = 0; i < idle.size(); i++)
+    {
+      fds[2 + i].fd = idle[i]->fd;
+      fds[2 + i].events = POLLIN;
+    }
+
+    if (poll(&fds[0], nfds_t(fds.size()), -1) < 0)
+    {
+      if (errno == EINTR)
+        continue;
+
+      fprintf(stderr,
+              "The following error occurred while waiting for requests:\n"
+              "\n"
+              "  %s\n",
+              strerror(errno));
+      close(fd);
+      return -1;
+    }
+
+    // collect data from idle connections
+    connections.swap(idle);
+    idle.clear();
+    for (size_t i = 0; i < connections.size(); i++)
+    {
+      if (!fds[2 + i].revents)
+      {
+        idle.push_back(connections[i]);
+        continue;
+      }
+
+      receive(connections[i]);
+      schedule(&data, connections[i], num_workers > 0, idle);
+    }
+
+    // take back connections from the workers
+    if (fds[1].revents)
+    {
+      char buf[64];
+
+      while (read(data.wake_fds[0], buf, sizeof (buf)) > 0)
+        ;
+
+      gl_lock_lock(server_lock);
+      connections.swap(data.done);
+      data.done.clear();
+      gl_lock_unlock(server_lock);
+
+      for (size_t i = 0; i < connections.size(); i++)
+        schedule(&data, connections[i], num_workers > 0, idle);
+    }
+
+    if (fds[0].revents)
+    {
+      int client_fd = accept(fd, NULL, NULL);
+      if (client_fd < 0)
+      {
+        if (errno == EINTR
+            || errno == ECONNABORTED
+            || errno == EAGAIN
+            || errno == EWOULDBLOCK)
+          continue;
+
+        fprintf(stderr,
+                "The following error occurred"
+                  " while accepting a connection:\n"
+                "\n"
+                "  %s\n",
+                strerror(errno));
+        close(fd);
+        return -1;
+      }
+
+      if (!set_nonblocking(client_fd))
+      {
+        close(client_fd);
+        continue;
+      }
+
+      Server_Connection* connection = new Server_Connection;
+      connection->fd = client_fd;
+      connection->eof = false;
+      connection->close = false;
+
+      gl_lock_lock(server_lock);
+      data.num_connections++;
+      data.num_active++;
+      gl_lock_unlock(server_lock);
+
+      idle.push_back(connection);
+    }
+  }
+
+  return 0; // never reached
+}
+
+#else // !HAVE_UNIX_SOCKETS
+
+int
+server(const char* socket_name,
+       int,
+       const Batch_Settings&)
+{
+  fprintf(stderr, "Can't listen on `%s':"
+                  " Unix domain sockets are not supported"
+                  " on this platform\n",
+                  socket_name);
+
+  return -1;
+}
+
+#endif // !HAVE_UNIX_SOCKETS
+
+// end of server.cpp
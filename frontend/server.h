@@ -0,0 +1,70 @@
+// server.h
+
+// Copyright (C) 2022 by Werner Lemberg.
+//
+// This file is part of the ttfautohint library, and may only be used,
+// modified, and distributed under the terms given in `COPYING'.  By
+// continuing to use, modify, or distribute this file you indicate that you
+// have read `COPYING' and understand and accept it fully.
+//
+// The file `COPYING' mentioned in the previous paragraph is distributed
+// with the ttfautohint library.
+
+
+#ifndef SERVER_H_
+#define SERVER_H_
+
+#include "batch.h"
+
+
+// The protocol used on the socket.  All numbers are 32-bit unsigned
+// integers in big-endian byte order.  A client can send any number of
+// requests on a connection; they are answered in order.
+//
+//   request `HINT':  tag `HINT'
+//                    length of option string
+//                    option string (long options separated by spaces
+//                      like `--symbol --hinting-limit=50')
+//                    length of font
+//                    font data (TTF or TTC)
+//
+//   request `STAT':  tag `STAT'
+//
+//   response:        status
+//                    length of data
+//                    data
+//
+// For `HINT', a zero status means success and the data is the hinted
+// font.  Otherwise the status is a ttfautohint error code, and the data
+// is an error message.  For `STAT', the data consists of lines
+// `<counter> <value>' with the server statistics.
+//
+// A status value of SERVER_PROTOCOL_ERROR signals a malformed request;
+// the server closes the connection after sending this response.
+
+#define SERVER_PROTOCOL_ERROR 0xFFFFFFFFUL
+
+// upper limits for the data of a request
+#define SERVER_MAX_OPTIONS_LEN 0x10000UL
+#define SERVER_MAX_FONT_LEN 0x10000000UL
+
+
+// Listen on Unix domain socket `socket_name' and hint fonts sent by
+// clients, using `num_jobs' worker threads (0 means the number of
+// available processors).  Complete requests get queued and are served by
+// the next free worker; a worker never waits for a client to send data.
+//
+// Option values in `defaults' are used for all requests; a request can
+// override them except for the control instructions file and the
+// reference font, which get loaded only once at startup.
+//
+// This function only returns in case of an error (with value -1).
+
+int
+server(const char* socket_name,
+       int num_jobs,
+       const Batch_Settings& defaults);
+
+#endif // SERVER_H_
+
+// end of server.h
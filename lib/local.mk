@@ -43,12 +43,14 @@ lib_libnumberset_la_SOURCES = \
 lib_libttfautohint_la_SOURCES = \
   lib/llrb.h \
   lib/ta.h \
+  lib/taanalyze.c \
   lib/tablue.c lib/tablue.h \
   lib/tabytecode.c lib/tabytecode.h \
   lib/tacontrol.c lib/tacontrol.h \
   lib/tacontrol-flex.c lib/tacontrol-flex.h \
   lib/tacontrol-bison.c lib/tacontrol-bison.h \
   lib/tacvt.c \
+  lib/tadehint.c \
   lib/tadsig.c \
   lib/tadummy.c lib/tadummy.h \
   lib/tadump.c \
@@ -71,14 +73,22 @@ lib_libttfautohint_la_SOURCES = \
   lib/taname.c \
   lib/tapost.c \
   lib/taprep.c \
+  lib/taprevious.c \
+  lib/taprof.c lib/taprof.h \
   lib/taranges.c lib/taranges.h \
   lib/tascript.c \
   lib/tasfnt.c \
   lib/tashaper.c lib/tashaper.h \
+  lib/tasimd.c lib/tasimd.h \
   lib/tasort.c lib/tasort.h \
   lib/tastyles.h \
+  lib/tasubfont.c \
+  lib/tasubset.c \
+  lib/tasweep.c lib/tasweep.h \
   lib/tatables.c lib/tatables.h \
+  lib/tathread.c lib/tathread.h \
   lib/tatime.c \
+  lib/tatrace.c lib/tatrace.h \
   lib/tattc.c \
   lib/tattf.c \
   lib/tattfa.c \
@@ -101,7 +111,33 @@ lib_libttfautohint_la_LIBADD = \
   $(noinst_LTLIBRARIES) \
   $(LIBM) \
   $(FREETYPE_LIBS) \
-  $(HARFBUZZ_LIBS)
+  $(HARFBUZZ_LIBS) \
+  $(LTLIBMULTITHREAD)
+
+# The micro-benchmark `tabench' is built on demand only (with `make
+# lib/tabench').  It needs access to the library's profiling data, which
+# is compiled in only if `TA_PROFILE' is defined; for this reason it gets
+# its own copy of the library objects.
+EXTRA_PROGRAMS = lib/tabench
+
+lib_tabench_SOURCES = \
+  $(lib_libttfautohint_la_SOURCES) \
+  lib/tabench.c
+
+lib_tabench_CPPFLAGS = \
+  $(lib_libttfautohint_la_CPPFLAGS) \
+  -DTA_PROFILE
+
+lib_tabench_LDADD = \
+  lib/libsds.la \
+  lib/libnumberset.la \
+  gnulib/src/libgnu.la \
+  $(LIBM) \
+  $(FREETYPE_LIBS) \
+  $(HARFBUZZ_LIBS) \
+  $(LTLIBMULTITHREAD)
+
+CLEANFILES += $(EXTRA_PROGRAMS)
 
 BUILT_SOURCES += \
   lib/tablue.c lib/tablue.h \
@@ -117,6 +153,10 @@ EXTRA_DIST += \
   lib/tacontrol.flex lib/tacontrol.bison \
   lib/ttfautohint.pc.in \
   lib/numberset-test.c \
+  lib/taanalyze-test.c \
+  lib/tadehint-test.c \
+  lib/tasubset-test.c \
+  lib/tasweep-test.c \
   lib/ttfautohint.h.in
 
 pkgconfigdir = $(libdir)/pkgconfig
@@ -31,6 +31,7 @@
 #include "taglobal.h"
 #include "tadummy.h"
 #include "talatin.h"
+#include "tatrace.h"
 
 
 #define TTFAUTOHINT_GLYPH ".ttfautohint"
@@ -76,6 +77,8 @@
 /* the offset to the loca table format in the `head' table */
 #define LOCA_FORMAT_OFFSET 51
 
+#define HEAD_LEN 54
+
 /* various offsets within the `maxp' table */
 #define MAXP_NUM_GLYPHS 4
 #define MAXP_MAX_COMPOSITE_POINTS 10
@@ -120,6 +123,8 @@ typedef struct GLYPH_
   FT_ULong len2; /* number of bytes after instruction related data; */
                  /* if zero, this indicates a composite glyph */
   FT_Byte* buf; /* extracted glyph data (without instruction related data) */
+  FT_Byte* buf2; /* the `len2' bytes after instruction related data */
+  FT_Bool is_view; /* `buf' and `buf2' point into the `glyf' table */
   FT_ULong flags_offset; /* offset to last flag in a composite glyph */
 
   FT_Byte ins_extra_len; /* number of extra instructions */
@@ -140,6 +145,18 @@ typedef struct GLYPH_
   FT_UShort num_composite_contours; /* after recursion */
 } GLYPH;
 
+
+/* data collected by `TA_sfnt_build_glyph_instructions' */
+typedef struct Glyph_Stats_
+{
+  FT_UInt style;
+  FT_UInt num_points; /* as seen by the auto-hinter */
+  FT_UInt num_segments; /* both dimensions */
+  FT_UInt num_edges; /* both dimensions */
+  FT_UInt num_action_hints_records;
+  FT_UInt num_point_hints_records;
+} Glyph_Stats;
+
 /* a representation of the data in the `glyf' table */
 typedef struct glyf_Data_
 {
@@ -182,8 +199,13 @@ typedef struct SFNT_Table_
   FT_ULong checksum;
   void* data; /* used e.g. for `glyf' table data */
   FT_Bool processed;
+  FT_Bool is_view; /* `buf' points into the input font */
 } SFNT_Table;
 
+/* data of a previous run, used to reuse glyph bytecode; */
+/* the structure is defined in `taprevious.c' */
+typedef struct Previous_ Previous;
+
 /* we use indices into the SFNT table array to */
 /* represent table info records of the TTF header */
 typedef FT_ULong SFNT_Table_Info;
@@ -215,6 +237,9 @@ typedef struct SFNT_
   FT_UShort max_twilight_points;
   FT_UShort max_instructions;
   FT_UShort max_components;
+
+  /* NULL if there is no (usable) previous run */
+  Previous* previous;
 } SFNT;
 
 typedef struct Control_ Control;
@@ -232,10 +257,17 @@ struct FONT_
 
   char* control_buf;
   size_t control_len;
+  FT_Bool control_mapped; /* compiled control instructions via `mmap' */
 
   FT_Byte* reference_buf;
   size_t reference_len;
 
+  /* the output of a previous run and its control instructions */
+  const FT_Byte* previous_buf;
+  size_t previous_len;
+  const char* previous_control_buf;
+  size_t previous_control_len;
+
   FT_Face reference;
   FT_Long reference_index;
   const char* reference_name;
@@ -265,9 +297,13 @@ struct FONT_
 
   TA_LoaderRec loader[1]; /* the interface to the autohinter */
 
+  TA_Trace trace; /* NULL if tracing is off */
+
   /* configuration options */
   TA_Progress_Func progress;
   void* progress_data;
+  TA_Glyph_Report_Func glyph_report;
+  void* glyph_report_data;
   TA_Info_Func info;
   TA_Info_Post_Func info_post;
   void* info_data;
@@ -278,12 +314,14 @@ struct FONT_
   FT_UInt hinting_limit;
   FT_UInt increase_x_height;
   number_range* x_height_snapping_exceptions;
+  number_range* hint_glyphs; /* NULL means all glyphs */
   FT_UInt fallback_stem_width;
   FT_Int gray_stem_width_mode;
   FT_Int gdi_cleartype_stem_width_mode;
   FT_Int dw_cleartype_stem_width_mode;
   FT_Bool windows_compatibility;
   FT_Bool adjust_subglyphs;
+  FT_Bool adaptive_sweep;
   FT_Bool hint_composites;
   FT_Bool ignore_restrictions;
   TA_Style fallback_style;
@@ -294,6 +332,8 @@ struct FONT_
   FT_Bool debug;
   FT_Bool TTFA_info;
   unsigned long long epoch;
+  FT_UInt num_threads;
+  FT_Int simd_level;
 };
 
 
@@ -319,6 +359,10 @@ TA_get_current_time(FONT* font,
                     FT_ULong* high,
                     FT_ULong* low);
 
+/* a monotonic clock in nanoseconds, for measuring durations */
+unsigned long long
+TA_get_monotonic_time(void);
+
 FT_Byte*
 TA_build_push(FT_Byte* bufp,
               FT_UInt* args,
@@ -328,6 +372,8 @@ TA_build_push(FT_Byte* bufp,
 
 FT_Error
 TA_font_init(FONT* font);
+FT_Error
+TA_font_dehint(FONT* font);
 void
 TA_font_unload(FONT* font,
                const char* in_buf,
@@ -345,6 +391,11 @@ TA_font_file_write(FONT* font,
 FT_Error
 TA_control_file_read(FONT* font,
                      FILE* control_file);
+void
+TA_control_file_unmap(FONT* font);
+FT_Error
+TA_control_binary_file_write(FONT* font,
+                             FILE* control_binary_file);
 
 FT_Error
 TA_sfnt_compute_composite_pointsums(SFNT* sfnt,
@@ -353,7 +404,8 @@ TA_sfnt_compute_composite_pointsums(SFNT* sfnt,
 FT_Error
 TA_sfnt_build_glyph_instructions(SFNT* sfnt,
                                  FONT* font,
-                                 FT_Long idx);
+                                 FT_Long idx,
+                                 Glyph_Stats* stats);
 
 FT_Error
 TA_sfnt_split_into_SFNT_tables(SFNT* sfnt,
@@ -379,6 +431,16 @@ FT_Error
 TA_sfnt_build_gasp_table(SFNT* sfnt,
                          FONT* font);
 
+FT_Error
+TA_font_init_previous(FONT* font);
+FT_Error
+TA_sfnt_reuse_glyph_instructions(SFNT* sfnt,
+                                 FONT* font,
+                                 FT_Long idx,
+                                 FT_Bool* reused);
+void
+TA_previous_free(Previous* previous);
+
 FT_Error
 TA_sfnt_split_glyf_table(SFNT* sfnt,
                          FONT* font);
@@ -416,6 +478,20 @@ FT_Error
 TA_sfnt_update_maxp_table(SFNT* sfnt,
                           FONT* font);
 
+/* `maxp' values computed by analyzing the bytecode; */
+/* zero if the analysis has failed */
+typedef struct Bytecode_Limits_
+{
+  FT_UShort max_stack_elements;
+  FT_UShort max_function_defs;
+  FT_UShort max_instructions;
+} Bytecode_Limits;
+
+FT_Error
+TA_sfnt_compute_bytecode_limits(SFNT* sfnt,
+                                FONT* font,
+                                Bytecode_Limits* limits);
+
 FT_Error
 TA_sfnt_update_post_table(SFNT* sfnt,
                           FONT* font);
@@ -428,6 +504,9 @@ FT_Error
 TA_sfnt_build_prep_table(SFNT* sfnt,
                          FONT* font);
 
+FT_Error
+TA_font_hint_sfnts(FONT* font);
+
 FT_Error
 TA_sfnt_build_TTF_header(SFNT* sfnt,
                          FONT* font,
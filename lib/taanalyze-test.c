@@ -0,0 +1,346 @@
+/* taanalyze-test.c */
+
+/*
+ * Copyright (C) 2022 by Werner Lemberg.
+ *
+ * This file is part of the ttfautohint library, and may only be used,
+ * modified, and distributed under the terms given in `COPYING'.  By
+ * continuing to use, modify, or distribute this file you indicate that you
+ * have read `COPYING' and understand and accept it fully.
+ *
+ * The file `COPYING' mentioned in the previous paragraph is distributed
+ * with the ttfautohint library.
+ */
+
+/*
+ * Compile with
+ *
+ *   $(CC) $(CFLAGS) $(FREETYPE_CFLAGS) \
+ *         -I.. -I. \
+ *         -o taanalyze-test taanalyze-test.c \
+ *         .libs/libttfautohint.a $(FREETYPE_LIBS) $(HARFBUZZ_LIBS)
+ *
+ * after building the library, then call
+ *
+ *   ./taanalyze-test FONT
+ *
+ * with a TrueType font (not a collection), for example `DejaVuSans.ttf'.
+ * The program hints FONT and checks the values computed by `taanalyze.c'
+ * for the `maxp' table of the result.
+ *
+ * o `maxFunctionDefs' must be the largest function number defined in the
+ *   `fpgm' table plus one.
+ *
+ * o `maxStackElements' must be an upper bound, and it should be tight.
+ *   FreeType allocates 32 more stack elements than requested (to cope
+ *   with broken fonts), so loading all glyphs in pedantic mode for all
+ *   PPEM values of the hinting range must succeed, while it must fail
+ *   with a stack overflow for at least one glyph if `maxStackElements'
+ *   gets reduced by 33.  The latter check fails without a bug in the
+ *   analysis if the deepest path it sees can't be taken at runtime; this
+ *   doesn't happen with fonts like `DejaVuSans.ttf'.
+ *
+ * The program aborts with an assertion message in case of an error,
+ * otherwise it produces no output.
+ */
+
+
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#include FT_TRUETYPE_TABLES_H
+#include FT_TRUETYPE_TAGS_H
+
+#include <ttfautohint.h>
+
+
+/* the stack elements FreeType adds to `maxStackElements' */
+#define STACK_SLACK 32
+
+#define MAXP_MAX_STACK_ELEMENTS_OFFSET 24
+
+
+static char*
+read_file(const char* name,
+          size_t* len)
+{
+  FILE* f;
+  char* buf;
+  long size;
+
+
+  f = fopen(name, "rb");
+  assert(f);
+
+  assert(!fseek(f, 0, SEEK_END));
+  size = ftell(f);
+  assert(size > 0);
+  rewind(f);
+
+  buf = (char*)malloc((size_t)size);
+  assert(buf);
+  assert(fread(buf, 1, (size_t)size, f) == (size_t)size);
+
+  fclose(f);
+
+  *len = (size_t)size;
+  return buf;
+}
+
+
+/* return the largest function number defined in `fpgm', or -1; */
+/* we expect that `fpgm' only consists of push instructions and */
+/* function definitions at its top level */
+
+static long
+max_function_number(const FT_Byte* fpgm,
+                    FT_ULong len)
+{
+  long stack[256];
+  int top = 0;
+  int in_function = 0;
+  long max = -1;
+
+  FT_ULong i = 0;
+
+
+  while (i < len)
+  {
+    FT_Byte opcode = fpgm[i++];
+    FT_ULong n = 0;
+    int words = 0;
+
+
+    if (opcode == 0x40 || opcode == 0x41) /* NPUSHB, NPUSHW */
+    {
+      assert(i < len);
+      n = fpgm[i++];
+      words = opcode == 0x41;
+    }
+    else if (opcode >= 0xB0 && opcode <= 0xB7) /* PUSHB[n] */
+      n = (FT_ULong)(opcode - 0xB0 + 1);
+    else if (opcode >= 0xB8) /* PUSHW[n] */
+    {
+      n = (FT_ULong)(opcode - 0xB8 + 1);
+      words = 1;
+    }
+    else if (opcode == 0x2C) /* FDEF */
+    {
+      assert(!in_function && top > 0);
+      top--;
+      if (stack[top] > max)
+        max = stack[top];
+      in_function = 1;
+      continue;
+    }
+    else if (opcode == 0x2D) /* ENDF */
+    {
+      assert(in_function);
+      in_function = 0;
+      continue;
+    }
+    else
+    {
+      assert(in_function);
+      continue;
+    }
+
+    assert(i + n * (words ? 2 : 1) <= len);
+    for (; n; n--)
+    {
+      long value;
+
+
+      if (words)
+      {
+        value = (short)((fpgm[i] << 8) | fpgm[i + 1]);
+        i += 2;
+      }
+      else
+        value = fpgm[i++];
+
+      if (!in_function)
+      {
+        assert(top < 256);
+        stack[top++] = value;
+      }
+    }
+  }
+
+  assert(!in_function);
+
+  return max;
+}
+
+
+/* return the offset of the `maxp' table in `buf' */
+
+static size_t
+maxp_offset(const FT_Byte* buf,
+            size_t len)
+{
+  FT_UInt num_tables;
+  FT_UInt i;
+
+
+  assert(len >= 12);
+  num_tables = (FT_UInt)((buf[4] << 8) | buf[5]);
+  assert(len >= 12 + 16 * (size_t)num_tables);
+
+  for (i = 0; i < num_tables; i++)
+  {
+    const FT_Byte* record = buf + 12 + 16 * i;
+
+
+    if (!memcmp(record, "maxp", 4))
+      return ((size_t)record[8] << 24) | ((size_t)record[9] << 16)
+             | ((size_t)record[10] << 8) | record[11];
+  }
+
+  assert(0);
+  return 0;
+}
+
+
+/* load all glyphs for all PPEM values of the hinting range in pedantic */
+/* mode and return the number of stack overflows; other errors (for */
+/* example, too few arguments) are ignored */
+
+static long
+count_stack_overflows(FT_Library library,
+                      const char* buf,
+                      size_t len)
+{
+  FT_Face face;
+  FT_UInt ppem;
+  long count = 0;
+
+
+  assert(!FT_New_Memory_Face(library,
+                             (const FT_Byte*)buf,
+                             (FT_Long)len,
+                             0,
+                             &face));
+
+  for (ppem = TA_HINTING_RANGE_MIN; ppem <= TA_HINTING_RANGE_MAX; ppem++)
+  {
+    FT_Long idx;
+    FT_Error error;
+
+
+    /* this executes the `prep' table */
+    error = FT_Set_Pixel_Sizes(face, 0, ppem);
+    if (error == FT_Err_Stack_Overflow)
+    {
+      count++;
+      continue;
+    }
+
+    for (idx = 0; idx < face->num_glyphs; idx++)
+    {
+      error = FT_Load_Glyph(face, (FT_UInt)idx,
+                            FT_LOAD_NO_AUTOHINT
+                            | FT_LOAD_NO_BITMAP
+                            | FT_LOAD_PEDANTIC);
+      if (error == FT_Err_Stack_Overflow)
+        count++;
+    }
+  }
+
+  FT_Done_Face(face);
+
+  return count;
+}
+
+
+int
+main(int argc,
+     char** argv)
+{
+  FT_Library library;
+  FT_Face face;
+
+  char* in_buf;
+  size_t in_len;
+  char* out_buf;
+  size_t out_len;
+
+  TA_Error error;
+
+  TT_MaxProfile* maxp;
+  FT_UShort max_function_defs;
+  FT_UShort max_stack_elements;
+  FT_Byte* fpgm;
+  FT_ULong fpgm_len = 0;
+  size_t offset;
+  FT_UShort reduced;
+
+
+  if (argc != 2)
+  {
+    fprintf(stderr, "usage: %s FONT\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  in_buf = read_file(argv[1], &in_len);
+
+  error = TTF_autohint("in-buffer, in-buffer-len,"
+                       " out-buffer, out-buffer-len",
+                       in_buf, in_len,
+                       &out_buf, &out_len);
+  assert(!error);
+
+  assert(!FT_Init_FreeType(&library));
+  assert(!FT_New_Memory_Face(library,
+                             (const FT_Byte*)out_buf,
+                             (FT_Long)out_len,
+                             0,
+                             &face));
+
+  maxp = (TT_MaxProfile*)FT_Get_Sfnt_Table(face, FT_SFNT_MAXP);
+  assert(maxp);
+  max_function_defs = maxp->maxFunctionDefs;
+  max_stack_elements = maxp->maxStackElements;
+
+  /* `maxFunctionDefs' */
+  assert(!FT_Load_Sfnt_Table(face, TTAG_fpgm, 0, NULL, &fpgm_len));
+  fpgm = (FT_Byte*)malloc(fpgm_len);
+  assert(fpgm);
+  assert(!FT_Load_Sfnt_Table(face, TTAG_fpgm, 0, fpgm, &fpgm_len));
+
+  assert(max_function_defs == max_function_number(fpgm, fpgm_len) + 1);
+
+  free(fpgm);
+  FT_Done_Face(face);
+
+  /* `maxStackElements' */
+  assert(max_stack_elements > STACK_SLACK);
+
+  assert(count_stack_overflows(library, out_buf, out_len) == 0);
+
+  offset = maxp_offset((const FT_Byte*)out_buf, out_len)
+           + MAXP_MAX_STACK_ELEMENTS_OFFSET;
+  assert(offset + 2 <= out_len);
+
+  /* FreeType doesn't validate the table checksum */
+  reduced = (FT_UShort)(max_stack_elements - STACK_SLACK - 1);
+  out_buf[offset] = (char)(reduced >> 8);
+  out_buf[offset + 1] = (char)(reduced & 0xFF);
+
+  assert(count_stack_overflows(library, out_buf, out_len) > 0);
+
+  FT_Done_FreeType(library);
+
+  free(out_buf);
+  free(in_buf);
+
+  return EXIT_SUCCESS;
+}
+
+/* end of taanalyze-test.c */
@@ -0,0 +1,2535 @@
+/* taanalyze.c */
+
+/*
+ * Copyright (C) 2022 by Werner Lemberg.
+ *
+ * This file is part of the ttfautohint library, and may only be used,
+ * modified, and distributed under the terms given in `COPYING'.  By
+ * continuing to use, modify, or distribute this file you indicate that you
+ * have read `COPYING' and understand and accept it fully.
+ *
+ * The file `COPYING' mentioned in the previous paragraph is distributed
+ * with the ttfautohint library.
+ */
+
+
+/*
+ * Compute limits for the `maxp' table by abstract interpretation of the
+ * bytecode in the `fpgm' and `prep' tables and the glyph instructions.
+ *
+ * For every program point we track the stack depth (or an upper bound of
+ * it if it depends on data we don't know), the stack elements (either a
+ * constant, a small set of alternative constants, or unknown), the known
+ * values in the storage area, and the graphics state variable `loop'.
+ * Everything else (CVT values, point coordinates, the current ppem
+ * value, etc.) is unknown; if a condition depends on it, both branches
+ * get followed.
+ *
+ * Functions are analyzed in the context of each call.  This is necessary
+ * because ttfautohint's glyph instructions are mainly data for the
+ * functions in the `fpgm' table: the numbers of the functions to call,
+ * loop counters, and the number of arguments to consume are all pushed
+ * by the glyph program.  While a function gets analyzed, the state of
+ * the caller is frozen and serves as a base; the states within the
+ * function only hold the stack elements pushed and the storage area
+ * values written by the function itself.
+ *
+ * States that meet at a jump target or an `EIF' instruction are merged
+ * only if they have the same stack depth; this effectively unrolls loops
+ * that are controlled by the stack depth.  Other loops converge since
+ * the set of possible values is finite.  In top-level programs, the
+ * stack elements must be equal, too, so that alternative sets of glyph
+ * hints don't get mixed.
+ *
+ * Since all paths that might be taken get followed, the resulting peak
+ * stack depth is a sound upper bound; it is larger than the actual one
+ * if the deepest path can't be taken at runtime.
+ *
+ * If something can't be handled (a jump to an unknown offset, a call of
+ * an unknown function, unbounded stack growth in a loop, undefined
+ * opcodes, too many steps, etc.) the analysis gives up; the caller then
+ * uses its own estimates.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+
+#include "ta.h"
+
+
+/* an arbitrary error code to signal that we can't analyze the bytecode */
+#define TA_Err_Cannot_Analyze FT_Err_Invalid_Opcode
+
+/* upper limits to avoid endless iterations */
+#define MAX_STEPS 20000000L /* per program */
+#define MAX_STEPS_PER_GLYPH 50000UL /* on average, for all programs */
+#define MAX_INCREASES 16
+#define MAX_PARTITIONS 256
+#define MAX_LOOPCALL_ITERATIONS 1024
+
+/* the maximum number of alternatives for a value */
+#define MAX_ALTERNATIVES 3
+
+
+/* a stack element or a value in the storage area: either one of `num' */
+/* alternative constants or, if `num' is zero, unknown; in the latter */
+/* case we might still know a lower bound (this is sufficient to see */
+/* that a storage area index doesn't hit the fixed `sal_XXX' entries) */
+
+typedef struct Value_
+{
+  FT_Int num;
+  FT_Long values[MAX_ALTERNATIVES];
+
+  FT_Bool has_min;
+  FT_Long min;
+} Value;
+
+/* a storage area value; an unknown value hides the value of the base */
+
+typedef struct Cell_
+{
+  FT_Long idx;
+  Value value;
+} Cell;
+
+/* the frozen state of a caller, as seen by the called function */
+
+typedef struct Base_
+{
+  /* the stack elements on top of the visible elements of `below' */
+  const Value* values;
+  FT_Long num_values;
+
+  /* the storage area values, overriding `below' */
+  const Cell* cells;
+  FT_Long num_cells;
+  /* if set, the storage area values of `below' */
+  /* from index `clear_min' upwards are unknown */
+  FT_Bool cleared;
+  FT_Long clear_min;
+
+  const struct Base_* below;
+  FT_Long num_below; /* the number of visible stack elements of `below' */
+} Base;
+
+typedef struct State_
+{
+  /* the stack depth, or an upper bound if not `exact' */
+  FT_Long depth;
+  FT_Bool exact;
+
+  /* the graphics state variable `loop'; -1 if unknown */
+  FT_Long loop;
+
+  /* the known topmost stack elements: the lowest `num_base' */
+  /* elements of the base, followed by `values' (bottom to top) */
+  FT_Long num_base;
+  Value* values;
+  FT_Long num_values;
+  FT_Long max_values;
+
+  /* the storage area values, sorted by index and overriding */
+  /* the base, which is partially unknown if `cleared' is set */
+  Cell* cells;
+  FT_Long num_cells;
+  FT_Long max_cells;
+  FT_Bool cleared;
+  FT_Long clear_min;
+
+  /* for states at join points */
+  FT_Long pc;
+  FT_Bool queued;
+  FT_UInt increases; /* of `depth' */
+  struct State_* next; /* the next partition */
+} State;
+
+typedef struct Program_
+{
+  const FT_Byte* code;
+  FT_Long len;
+
+  /* for `IF' the position of the matching `ELSE' or `EIF', */
+  /* for `ELSE' the position of the matching `EIF', */
+  /* for all other instructions their own position; */
+  /* -1 for non-instruction bytes */
+  FT_Long* match;
+} Program;
+
+/* the states at join points of an instruction range, */
+/* indexed by the position relative to the range start */
+
+typedef struct Join_Points_
+{
+  State** in;
+  FT_Long* used; /* the indices of non-empty `in' elements */
+  FT_Long num_used;
+} Join_Points;
+
+typedef struct Function_
+{
+  FT_Bool defined;
+  FT_Bool active; /* to catch recursion */
+
+  FT_Long start; /* first instruction after `FDEF' */
+  FT_Long end; /* position of `ENDF' */
+
+  Join_Points join_points; /* allocated on demand */
+} Function;
+
+/* the instruction range [start;end[ currently analyzed, */
+/* where `end' is either the end of the program or `ENDF' */
+
+typedef struct Frame_
+{
+  const Program* program;
+  FT_Long start;
+  FT_Long end;
+  FT_Bool is_function;
+
+  const Base* base; /* NULL for top-level programs */
+
+  /* the states at `end' are the exit states */
+  Join_Points* join_points;
+
+  FT_Long num_work; /* size of the worklist at the start */
+} Frame;
+
+typedef struct Analysis_
+{
+  Program fpgm;
+
+  Function* functions;
+  FT_Long num_functions;
+  FT_Bool collect; /* record function definitions */
+
+  /* shared by all frames */
+  State** worklist;
+  FT_Long num_work;
+  FT_Long max_work;
+
+  State* unused_states;
+
+  Cell* cells; /* scratch buffer */
+  FT_Long max_cells;
+
+  FT_Long steps;
+  FT_Long max_steps; /* for the current program */
+  FT_ULong budget; /* the steps left for all programs */
+  FT_Long peak; /* the maximum stack depth */
+} Analysis;
+
+
+/* stack effects: number of popped and pushed elements */
+/* (without the arguments of loop-controlled instructions) */
+
+#define PACK(pops, pushes) (FT_Byte)(((pops) << 4) | (pushes))
+
+static const FT_Byte stack_effects[256] =
+{
+  /* SVTCA[y], SVTCA[x], SPVTCA[y], SPVTCA[x] */
+  PACK(0, 0), PACK(0, 0), PACK(0, 0), PACK(0, 0),
+  /* SFVTCA[y], SFVTCA[x], SPVTL[||], SPVTL[+] */
+  PACK(0, 0), PACK(0, 0), PACK(2, 0), PACK(2, 0),
+  /* SFVTL[||], SFVTL[+], SPVFS, SFVFS */
+  PACK(2, 0), PACK(2, 0), PACK(2, 0), PACK(2, 0),
+  /* GPV, GFV, SFVTPV, ISECT */
+  PACK(0, 2), PACK(0, 2), PACK(0, 0), PACK(5, 0),
+
+  /* SRP0, SRP1, SRP2, SZP0 */
+  PACK(1, 0), PACK(1, 0), PACK(1, 0), PACK(1, 0),
+  /* SZP1, SZP2, SZPS, SLOOP */
+  PACK(1, 0), PACK(1, 0), PACK(1, 0), PACK(1, 0),
+  /* RTG, RTHG, SMD, ELSE */
+  PACK(0, 0), PACK(0, 0), PACK(1, 0), PACK(0, 0),
+  /* JMPR, SCVTCI, SSWCI, SSW */
+  PACK(1, 0), PACK(1, 0), PACK(1, 0), PACK(1, 0),
+
+  /* DUP, POP, CLEAR, SWAP */
+  PACK(1, 2), PACK(1, 0), PACK(0, 0), PACK(2, 2),
+  /* DEPTH, CINDEX, MINDEX, ALIGNPTS */
+  PACK(0, 1), PACK(1, 1), PACK(1, 0), PACK(2, 0),
+  /* INS_$28, UTP, LOOPCALL, CALL */
+  PACK(0, 0), PACK(1, 0), PACK(2, 0), PACK(1, 0),
+  /* FDEF, ENDF, MDAP[0], MDAP[1] */
+  PACK(1, 0), PACK(0, 0), PACK(1, 0), PACK(1, 0),
+
+  /* IUP[y], IUP[x], SHP[0], SHP[1] */
+  PACK(0, 0), PACK(0, 0), PACK(0, 0), PACK(0, 0),
+  /* SHC[0], SHC[1], SHZ[0], SHZ[1] */
+  PACK(1, 0), PACK(1, 0), PACK(1, 0), PACK(1, 0),
+  /* SHPIX, IP, MSIRP[0], MSIRP[1] */
+  PACK(1, 0), PACK(0, 0), PACK(2, 0), PACK(2, 0),
+  /* ALIGNRP, RTDG, MIAP[0], MIAP[1] */
+  PACK(0, 0), PACK(0, 0), PACK(2, 0), PACK(2, 0),
+
+  /* NPUSHB, NPUSHW, WS, RS */
+  PACK(0, 0), PACK(0, 0), PACK(2, 0), PACK(1, 1),
+  /* WCVTP, RCVT, GC[0], GC[1] */
+  PACK(2, 0), PACK(1, 1), PACK(1, 1), PACK(1, 1),
+  /* SCFS, MD[0], MD[1], MPPEM */
+  PACK(2, 0), PACK(2, 1), PACK(2, 1), PACK(0, 1),
+  /* MPS, FLIPON, FLIPOFF, DEBUG */
+  PACK(0, 1), PACK(0, 0), PACK(0, 0), PACK(1, 0),
+
+  /* LT, LTEQ, GT, GTEQ */
+  PACK(2, 1), PACK(2, 1), PACK(2, 1), PACK(2, 1),
+  /* EQ, NEQ, ODD, EVEN */
+  PACK(2, 1), PACK(2, 1), PACK(1, 1), PACK(1, 1),
+  /* IF, EIF, AND, OR */
+  PACK(1, 0), PACK(0, 0), PACK(2, 1), PACK(2, 1),
+  /* NOT, DELTAP1, SDB, SDS */
+  PACK(1, 1), PACK(1, 0), PACK(1, 0), PACK(1, 0),
+
+  /* ADD, SUB, DIV, MUL */
+  PACK(2, 1), PACK(2, 1), PACK(2, 1), PACK(2, 1),
+  /* ABS, NEG, FLOOR, CEILING */
+  PACK(1, 1), PACK(1, 1), PACK(1, 1), PACK(1, 1),
+  /* ROUND[0], ROUND[1], ROUND[2], ROUND[3] */
+  PACK(1, 1), PACK(1, 1), PACK(1, 1), PACK(1, 1),
+  /* NROUND[0], NROUND[1], NROUND[2], NROUND[3] */
+  PACK(1, 1), PACK(1, 1), PACK(1, 1), PACK(1, 1),
+
+  /* WCVTF, DELTAP2, DELTAP3, DELTAC1 */
+  PACK(2, 0), PACK(1, 0), PACK(1, 0), PACK(1, 0),
+  /* DELTAC2, DELTAC3, SROUND, S45ROUND */
+  PACK(1, 0), PACK(1, 0), PACK(1, 0), PACK(1, 0),
+  /* JROT, JROF, ROFF, INS_$7B */
+  PACK(2, 0), PACK(2, 0), PACK(0, 0), PACK(0, 0),
+  /* RUTG, RDTG, SANGW, AA */
+  PACK(0, 0), PACK(0, 0), PACK(1, 0), PACK(1, 0),
+
+  /* FLIPPT, FLIPRGON, FLIPRGOFF, INS_$83 */
+  PACK(0, 0), PACK(2, 0), PACK(2, 0), PACK(0, 0),
+  /* INS_$84, SCANCTRL, SDPVTL[0], SDPVTL[1] */
+  PACK(0, 0), PACK(1, 0), PACK(2, 0), PACK(2, 0),
+  /* GETINFO, IDEF, ROLL, MAX */
+  PACK(1, 1), PACK(1, 0), PACK(3, 3), PACK(2, 1),
+  /* MIN, SCANTYPE, INSTCTRL, INS_$8F */
+  PACK(2, 1), PACK(1, 0), PACK(2, 0), PACK(0, 0),
+
+  /* INS_$90, GETVARIATION, GETDATA, INS_$93 */
+  PACK(0, 0), PACK(0, 0), PACK(0, 1), PACK(0, 0),
+  /* INS_$94 - INS_$9F */
+  PACK(0, 0), PACK(0, 0), PACK(0, 0), PACK(0, 0),
+  PACK(0, 0), PACK(0, 0), PACK(0, 0), PACK(0, 0),
+  PACK(0, 0), PACK(0, 0), PACK(0, 0), PACK(0, 0),
+
+  /* INS_$A0 - INS_$AF */
+  PACK(0, 0), PACK(0, 0), PACK(0, 0), PACK(0, 0),
+  PACK(0, 0), PACK(0, 0), PACK(0, 0), PACK(0, 0),
+  PACK(0, 0), PACK(0, 0), PACK(0, 0), PACK(0, 0),
+  PACK(0, 0), PACK(0, 0), PACK(0, 0), PACK(0, 0),
+
+  /* PUSHB[0] - PUSHB[7] */
+  PACK(0, 1), PACK(0, 2), PACK(0, 3), PACK(0, 4),
+  PACK(0, 5), PACK(0, 6), PACK(0, 7), PACK(0, 8),
+  /* PUSHW[0] - PUSHW[7] */
+  PACK(0, 1), PACK(0, 2), PACK(0, 3), PACK(0, 4),
+  PACK(0, 5), PACK(0, 6), PACK(0, 7), PACK(0, 8),
+
+  /* MDRP[00000] - MDRP[11111] */
+  PACK(1, 0), PACK(1, 0), PACK(1, 0), PACK(1, 0),
+  PACK(1, 0), PACK(1, 0), PACK(1, 0), PACK(1, 0),
+  PACK(1, 0), PACK(1, 0), PACK(1, 0), PACK(1, 0),
+  PACK(1, 0), PACK(1, 0), PACK(1, 0), PACK(1, 0),
+  PACK(1, 0), PACK(1, 0), PACK(1, 0), PACK(1, 0),
+  PACK(1, 0), PACK(1, 0), PACK(1, 0), PACK(1, 0),
+  PACK(1, 0), PACK(1, 0), PACK(1, 0), PACK(1, 0),
+  PACK(1, 0), PACK(1, 0), PACK(1, 0), PACK(1, 0),
+
+  /* MIRP[00000] - MIRP[11111] */
+  PACK(2, 0), PACK(2, 0), PACK(2, 0), PACK(2, 0),
+  PACK(2, 0), PACK(2, 0), PACK(2, 0), PACK(2, 0),
+  PACK(2, 0), PACK(2, 0), PACK(2, 0), PACK(2, 0),
+  PACK(2, 0), PACK(2, 0), PACK(2, 0), PACK(2, 0),
+  PACK(2, 0), PACK(2, 0), PACK(2, 0), PACK(2, 0),
+  PACK(2, 0), PACK(2, 0), PACK(2, 0), PACK(2, 0),
+  PACK(2, 0), PACK(2, 0), PACK(2, 0), PACK(2, 0),
+  PACK(2, 0), PACK(2, 0), PACK(2, 0), PACK(2, 0)
+};
+
+
+/* opcodes that have no defined meaning (or which we don't handle) */
+
+static FT_Bool
+TA_opcode_is_undefined(FT_Byte opcode)
+{
+  return opcode == 0x28
+         || opcode == 0x7B
+         || opcode == 0x83
+         || opcode == 0x84
+         || opcode == 0x89 /* IDEF */
+         || (opcode >= 0x8F && opcode <= 0x91) /* GETVARIATION */
+         || (opcode >= 0x93 && opcode <= 0xAF);
+}
+
+
+/* return the size of the instruction at position `pc', */
+/* or zero if it is truncated */
+
+static FT_Long
+TA_instruction_size(const FT_Byte* code,
+                    FT_Long len,
+                    FT_Long pc)
+{
+  FT_Byte opcode = code[pc];
+  FT_Long size;
+
+
+  if (opcode == NPUSHB || opcode == NPUSHW)
+  {
+    if (pc + 1 >= len)
+      return 0;
+    size = 2 + (opcode == NPUSHW ? 2 : 1) * (FT_Long)code[pc + 1];
+  }
+  else if (opcode >= PUSHB_1 && opcode <= PUSHB_8)
+    size = 1 + (opcode - PUSHB_1 + 1);
+  else if (opcode >= PUSHW_1 && opcode <= PUSHW_8)
+    size = 1 + 2 * (opcode - PUSHW_1 + 1);
+  else
+    size = 1;
+
+  return (pc + size > len) ? 0 : size;
+}
+
+
+
+/* find the matching `ELSE' and `EIF' instructions */
+
+static FT_Error
+TA_program_init(Program* program,
+                const FT_Byte* code,
+                FT_Long len)
+{
+  FT_Long* ifs;
+  FT_Long num_ifs = 0;
+  FT_Long pc;
+
+
+  program->code = code;
+  program->len = len;
+
+  program->match = (FT_Long*)malloc((size_t)(len + 1) * sizeof (FT_Long));
+  if (!program->match)
+    return FT_Err_Out_Of_Memory;
+  ifs = (FT_Long*)malloc((size_t)(len + 1) * sizeof (FT_Long));
+  if (!ifs)
+    return FT_Err_Out_Of_Memory;
+
+  for (pc = 0; pc <= len; pc++)
+    program->match[pc] = -1;
+
+  pc = 0;
+  while (pc < len)
+  {
+    FT_Long size = TA_instruction_size(code, len, pc);
+
+
+    if (!size)
+      goto Fail;
+
+    /* mark the start of an instruction */
+    program->match[pc] = pc;
+
+    switch (code[pc])
+    {
+    case IF:
+      ifs[num_ifs++] = pc;
+      break;
+
+    case ELSE:
+      if (!num_ifs)
+        goto Fail;
+      program->match[ifs[num_ifs - 1]] = pc;
+      ifs[num_ifs - 1] = pc;
+      break;
+
+    case EIF:
+      if (!num_ifs)
+        goto Fail;
+      program->match[ifs[--num_ifs]] = pc;
+      break;
+    }
+
+    pc += size;
+  }
+
+  /* the end of the program is a valid jump target */
+  program->match[len] = len;
+
+  free(ifs);
+  return num_ifs ? TA_Err_Cannot_Analyze : TA_Err_Ok;
+
+Fail:
+  free(ifs);
+  return TA_Err_Cannot_Analyze;
+}
+
+
+static void
+TA_program_done(Program* program)
+{
+  free(program->match);
+  program->match = NULL;
+}
+
+
+static Value
+TA_value_unknown(void)
+{
+  Value v;
+
+
+  memset(&v, 0, sizeof (Value));
+
+  return v;
+}
+
+
+static Value
+TA_value_constant(FT_Long value)
+{
+  Value v = TA_value_unknown();
+
+
+  v.num = 1;
+  v.values[0] = value;
+
+  return v;
+}
+
+
+static FT_Bool
+TA_value_min(const Value* v,
+             FT_Long* min)
+{
+  FT_Int i;
+
+
+  if (!v->num)
+  {
+    *min = v->min;
+    return v->has_min;
+  }
+
+  *min = v->values[0];
+  for (i = 1; i < v->num; i++)
+    if (v->values[i] < *min)
+      *min = v->values[i];
+
+  return 1;
+}
+
+
+/* return 1 if all alternatives are non-zero, 0 if all are zero, */
+/* and -1 otherwise */
+
+static FT_Int
+TA_value_truth(Value v)
+{
+  FT_Int i;
+  FT_Int num_true = 0;
+
+
+  if (!v.num)
+    return -1;
+
+  for (i = 0; i < v.num; i++)
+    if (v.values[i])
+      num_true++;
+
+  if (num_true == v.num)
+    return 1;
+  if (!num_true)
+    return 0;
+  return -1;
+}
+
+
+/* merge `src' into `dst'; return true if `dst' has changed */
+
+static FT_Bool
+TA_value_join(Value* dst,
+              const Value* src)
+{
+  FT_Bool changed = 0;
+  FT_Long dst_min, src_min;
+  FT_Bool have_src_min;
+  FT_Int i, j;
+
+
+  have_src_min = TA_value_min(src, &src_min);
+
+  if (!dst->num)
+  {
+    if (!dst->has_min)
+      return 0;
+
+    /* to ensure convergence we don't lower the bound */
+    if (!have_src_min || src_min < dst->min)
+    {
+      dst->has_min = 0;
+      return 1;
+    }
+
+    return 0;
+  }
+
+  if (src->num)
+  {
+    for (i = 0; i < src->num; i++)
+    {
+      for (j = 0; j < dst->num; j++)
+        if (dst->values[j] == src->values[i])
+          break;
+      if (j < dst->num)
+        continue;
+
+      if (dst->num == MAX_ALTERNATIVES)
+        break;
+
+      dst->values[dst->num++] = src->values[i];
+      changed = 1;
+    }
+
+    if (i == src->num)
+      return changed;
+  }
+
+  /* too many alternatives; keep the lower bound only */
+  (void)TA_value_min(dst, &dst_min);
+
+  dst->num = 0;
+  dst->has_min = have_src_min;
+  dst->min = TA_MIN(dst_min, src_min);
+
+  return 1;
+}
+
+
+static FT_Bool
+TA_value_equal(const Value* v1,
+               const Value* v2)
+{
+  FT_Int i, j;
+
+
+  if (v1->num != v2->num)
+    return 0;
+
+  if (!v1->num)
+    return v1->has_min == v2->has_min
+           && (!v1->has_min || v1->min == v2->min);
+
+  for (i = 0; i < v1->num; i++)
+  {
+    for (j = 0; j < v2->num; j++)
+      if (v1->values[i] == v2->values[j])
+        break;
+    if (j == v2->num)
+      return 0;
+  }
+
+  return 1;
+}
+
+
+
+
+/* return the visible stack element `i' of `base', counted from bottom */
+
+static Value
+TA_base_value(const Base* base,
+              FT_Long i)
+{
+  while (i < base->num_below)
+    base = base->below;
+
+  return base->values[i - base->num_below];
+}
+
+
+static State*
+TA_state_new(Analysis* a)
+{
+  State* s = a->unused_states;
+
+
+  if (s)
+  {
+    a->unused_states = s->next;
+
+    s->num_values = 0;
+    s->num_cells = 0;
+    s->queued = 0;
+    s->increases = 0;
+    s->next = NULL;
+  }
+  else
+    s = (State*)calloc(1, sizeof (State));
+
+  return s;
+}
+
+
+static void
+TA_states_release(Analysis* a,
+                  State* list)
+{
+  while (list)
+  {
+    State* next = list->next;
+
+
+    list->next = a->unused_states;
+    a->unused_states = list;
+
+    list = next;
+  }
+}
+
+
+static FT_Error
+TA_state_reserve(State* s,
+                 FT_Long n)
+{
+  if (s->num_values + n > s->max_values)
+  {
+    FT_Long max_values = s->num_values + n + 32;
+    Value* values_new;
+
+
+    values_new = (Value*)realloc(s->values,
+                                 (size_t)max_values * sizeof (Value));
+    if (!values_new)
+      return FT_Err_Out_Of_Memory;
+
+    s->values = values_new;
+    s->max_values = max_values;
+  }
+
+  return TA_Err_Ok;
+}
+
+
+static FT_Error
+TA_state_reserve_cells(State* s,
+                       FT_Long n)
+{
+  if (s->num_cells + n > s->max_cells)
+  {
+    FT_Long max_cells = s->num_cells + n + 16;
+    Cell* cells_new;
+
+
+    cells_new = (Cell*)realloc(s->cells,
+                               (size_t)max_cells * sizeof (Cell));
+    if (!cells_new)
+      return FT_Err_Out_Of_Memory;
+
+    s->cells = cells_new;
+    s->max_cells = max_cells;
+  }
+
+  return TA_Err_Ok;
+}
+
+
+static FT_Error
+TA_analysis_reserve_cells(Analysis* a,
+                          FT_Long n)
+{
+  if (n > a->max_cells)
+  {
+    FT_Long max_cells = n + 64;
+    Cell* cells_new;
+
+
+    cells_new = (Cell*)realloc(a->cells,
+                               (size_t)max_cells * sizeof (Cell));
+    if (!cells_new)
+      return FT_Err_Out_Of_Memory;
+
+    a->cells = cells_new;
+    a->max_cells = max_cells;
+  }
+
+  return TA_Err_Ok;
+}
+
+
+static FT_Error
+TA_state_copy(State* dst,
+              const State* src)
+{
+  FT_Error error;
+
+
+  dst->num_values = 0;
+  error = TA_state_reserve(dst, src->num_values);
+  if (error)
+    return error;
+
+  dst->num_cells = 0;
+  error = TA_state_reserve_cells(dst, src->num_cells);
+  if (error)
+    return error;
+
+  dst->depth = src->depth;
+  dst->exact = src->exact;
+  dst->loop = src->loop;
+
+  dst->num_base = src->num_base;
+  dst->num_values = src->num_values;
+  if (src->num_values)
+    memcpy(dst->values, src->values,
+           (size_t)src->num_values * sizeof (Value));
+
+  dst->num_cells = src->num_cells;
+  if (src->num_cells)
+    memcpy(dst->cells, src->cells,
+           (size_t)src->num_cells * sizeof (Cell));
+  dst->cleared = src->cleared;
+  dst->clear_min = src->clear_min;
+
+  return TA_Err_Ok;
+}
+
+
+/* return the known stack element `t', counted from the top; */
+/* `t' must be smaller than `num_base + num_values' */
+
+static Value
+TA_state_value(const Frame* frame,
+               const State* s,
+               FT_Long t)
+{
+  if (t < s->num_values)
+    return s->values[s->num_values - 1 - t];
+
+  return TA_base_value(frame->base, s->num_base - 1 - (t - s->num_values));
+}
+
+
+/* move the topmost `n' elements of the base to `values' */
+
+static FT_Error
+TA_state_materialize(const Frame* frame,
+                     State* s,
+                     FT_Long n)
+{
+  FT_Error error;
+  FT_Long i;
+
+
+  if (n <= 0)
+    return TA_Err_Ok;
+
+  error = TA_state_reserve(s, n);
+  if (error)
+    return error;
+
+  memmove(s->values + n, s->values, (size_t)s->num_values * sizeof (Value));
+  for (i = 0; i < n; i++)
+    s->values[i] = TA_base_value(frame->base, s->num_base - n + i);
+
+  s->num_values += n;
+  s->num_base -= n;
+
+  return TA_Err_Ok;
+}
+
+
+/* find the position of storage area index `idx' in `cells' */
+
+static FT_Bool
+TA_cells_find(const Cell* cells,
+              FT_Long num_cells,
+              FT_Long idx,
+              FT_Long* pos)
+{
+  FT_Long min = 0;
+  FT_Long max = num_cells;
+
+
+  while (min < max)
+  {
+    FT_Long mid = (min + max) / 2;
+
+
+    if (cells[mid].idx < idx)
+      min = mid + 1;
+    else if (cells[mid].idx > idx)
+      max = mid;
+    else
+    {
+      *pos = mid;
+      return 1;
+    }
+  }
+
+  *pos = min;
+  return 0;
+}
+
+
+static Value
+TA_state_lookup(const Frame* frame,
+                const State* s,
+                FT_Long idx)
+{
+  const Base* base;
+  FT_Long pos;
+
+
+  if (TA_cells_find(s->cells, s->num_cells, idx, &pos))
+    return s->cells[pos].value;
+  if (s->cleared && idx >= s->clear_min)
+    return TA_value_unknown();
+
+  for (base = frame->base; base; base = base->below)
+  {
+    if (TA_cells_find(base->cells, base->num_cells, idx, &pos))
+      return base->cells[pos].value;
+    if (base->cleared && idx >= base->clear_min)
+      break;
+  }
+
+  return TA_value_unknown();
+}
+
+
+static FT_Error
+TA_state_set_cell(State* s,
+                  FT_Long idx,
+                  Value v)
+{
+  FT_Error error;
+  FT_Long pos;
+
+
+  if (!TA_cells_find(s->cells, s->num_cells, idx, &pos))
+  {
+    error = TA_state_reserve_cells(s, 1);
+    if (error)
+      return error;
+
+    memmove(s->cells + pos + 1, s->cells + pos,
+            (size_t)(s->num_cells - pos) * sizeof (Cell));
+    s->num_cells++;
+
+    s->cells[pos].idx = idx;
+  }
+
+  s->cells[pos].value = v;
+
+  return TA_Err_Ok;
+}
+
+
+/* check whether the known stack elements of `s1' and `s2' are equal */
+
+static FT_Bool
+TA_state_values_equal(const Frame* frame,
+                      const State* s1,
+                      const State* s2)
+{
+  FT_Long len = s1->num_base + s1->num_values;
+  FT_Long t;
+
+
+  if (s2->num_base + s2->num_values != len)
+    return 0;
+
+  for (t = 0; t < len; t++)
+  {
+    Value v1 = TA_state_value(frame, s1, t);
+    Value v2 = TA_state_value(frame, s2, t);
+
+
+    if (!TA_value_equal(&v1, &v2))
+      return 0;
+  }
+
+  return 1;
+}
+
+
+/* merge `src' into `dst' */
+
+static FT_Error
+TA_state_join(Analysis* a,
+              const Frame* frame,
+              State* dst,
+              const State* src,
+              FT_Bool* changed)
+{
+  FT_Error error;
+  FT_Long len1 = dst->num_base + dst->num_values;
+  FT_Long len2 = src->num_base + src->num_values;
+  FT_Long n, i, j, k;
+
+
+  *changed = 0;
+
+  if (dst->exact
+      && (!src->exact || src->depth != dst->depth))
+  {
+    dst->exact = 0;
+    *changed = 1;
+  }
+  if (src->depth > dst->depth)
+  {
+    dst->depth = src->depth;
+    dst->increases++;
+    *changed = 1;
+  }
+  if (dst->loop != src->loop && dst->loop != -1)
+  {
+    dst->loop = -1;
+    *changed = 1;
+  }
+
+  /* stack elements */
+  if (len1 == len2)
+  {
+    /* the base elements known in both states are identical */
+    error = TA_state_materialize(frame, dst,
+                                 dst->num_base
+                                   - TA_MIN(dst->num_base, src->num_base));
+    if (error)
+      return error;
+  }
+  else
+  {
+    /* only the topmost elements known in both states can be kept */
+    n = TA_MIN(len1, len2);
+
+    error = TA_state_materialize(frame, dst, n - dst->num_values);
+    if (error)
+      return error;
+
+    if (dst->num_values > n)
+    {
+      memmove(dst->values,
+              dst->values + dst->num_values - n,
+              (size_t)n * sizeof (Value));
+      dst->num_values = n;
+    }
+    dst->num_base = 0;
+
+    if (len1 > n)
+      *changed = 1;
+  }
+
+  for (i = 0; i < dst->num_values; i++)
+  {
+    Value v = TA_state_value(frame, src, i);
+
+
+    if (TA_value_join(dst->values + dst->num_values - 1 - i, &v))
+      *changed = 1;
+  }
+
+  /* storage area values */
+  if (dst->num_cells == src->num_cells
+      && dst->cleared == src->cleared
+      && dst->clear_min == src->clear_min
+      && (!src->num_cells
+          || !memcmp(dst->cells, src->cells,
+                     (size_t)src->num_cells * sizeof (Cell))))
+    return TA_Err_Ok;
+
+  error = TA_analysis_reserve_cells(a, dst->num_cells + src->num_cells);
+  if (error)
+    return error;
+
+  i = 0;
+  j = 0;
+  k = 0;
+  while (i < dst->num_cells || j < src->num_cells)
+  {
+    Value v1, v2;
+    FT_Long idx;
+
+
+    if (j == src->num_cells
+        || (i < dst->num_cells && dst->cells[i].idx < src->cells[j].idx))
+    {
+      idx = dst->cells[i].idx;
+      v1 = dst->cells[i++].value;
+      v2 = TA_state_lookup(frame, src, idx);
+    }
+    else if (i == dst->num_cells
+             || src->cells[j].idx < dst->cells[i].idx)
+    {
+      idx = src->cells[j].idx;
+      v1 = TA_state_lookup(frame, dst, idx);
+      v2 = src->cells[j++].value;
+    }
+    else
+    {
+      idx = dst->cells[i].idx;
+      v1 = dst->cells[i++].value;
+      v2 = src->cells[j++].value;
+    }
+
+    if (TA_value_join(&v1, &v2))
+      *changed = 1;
+
+    a->cells[k].idx = idx;
+    a->cells[k].value = v1;
+    k++;
+  }
+
+  dst->num_cells = 0;
+  error = TA_state_reserve_cells(dst, k);
+  if (error)
+    return error;
+
+  if (k)
+    memcpy(dst->cells, a->cells, (size_t)k * sizeof (Cell));
+  dst->num_cells = k;
+
+  if (src->cleared
+      && (!dst->cleared || src->clear_min < dst->clear_min))
+  {
+    dst->cleared = 1;
+    dst->clear_min = src->clear_min;
+    *changed = 1;
+  }
+
+  return TA_Err_Ok;
+}
+
+
+static FT_Error
+TA_state_push(Analysis* a,
+              State* s,
+              Value v)
+{
+  FT_Error error;
+
+
+  error = TA_state_reserve(s, 1);
+  if (error)
+    return error;
+
+  s->values[s->num_values++] = v;
+
+  s->depth++;
+  if (s->depth > a->peak)
+    a->peak = s->depth;
+
+  return TA_Err_Ok;
+}
+
+
+static Value
+TA_state_pop(const Frame* frame,
+             State* s)
+{
+  /* the bytecode interpreter substitutes zero for missing */
+  /* arguments if not in pedantic mode */
+  if (s->depth > 0)
+    s->depth--;
+  else if (s->exact)
+    return TA_value_constant(0);
+
+  if (s->num_values)
+    return s->values[--s->num_values];
+
+  if (s->num_base)
+    return TA_base_value(frame->base, --s->num_base);
+
+  return TA_value_unknown();
+}
+
+
+/* an unknown number of elements gets popped */
+
+static void
+TA_state_forget(State* s)
+{
+  s->exact = 0;
+  s->num_base = 0;
+  s->num_values = 0;
+}
+
+
+static Value
+TA_state_read(const Frame* frame,
+              const State* s,
+              Value idx)
+{
+  if (idx.num == 1)
+    return TA_state_lookup(frame, s, idx.values[0]);
+
+  return TA_value_unknown();
+}
+
+
+static FT_Error
+TA_state_write(const Frame* frame,
+               State* s,
+               Value idx,
+               Value v)
+{
+  FT_Error error;
+  FT_Long min, pos;
+  FT_Int i;
+
+
+  if (idx.num == 1)
+    return TA_state_set_cell(s, idx.values[0], v);
+
+  if (idx.num)
+  {
+    /* we don't know which of the alternatives gets written */
+    for (i = 0; i < idx.num; i++)
+    {
+      Value old = TA_state_lookup(frame, s, idx.values[i]);
+
+
+      (void)TA_value_join(&old, &v);
+      error = TA_state_set_cell(s, idx.values[i], old);
+      if (error)
+        return error;
+    }
+
+    return TA_Err_Ok;
+  }
+
+  /* this can overwrite anything (above the lower bound); */
+  /* note that storage area indices are never negative */
+  min = idx.has_min ? TA_MAX(idx.min, 0) : 0;
+
+  (void)TA_cells_find(s->cells, s->num_cells, min, &pos);
+  s->num_cells = pos;
+
+  if (!s->cleared || min < s->clear_min)
+  {
+    s->cleared = 1;
+    s->clear_min = min;
+  }
+
+  return TA_Err_Ok;
+}
+
+
+/* add state `s' to the partitions in `*list'; */
+/* `*changed' is set to the partition if it has changed; */
+/* in top-level programs, states with different stack elements */
+/* are kept apart since glyph programs select one of several sets */
+/* of hints with `MPPEM', pushing the same number of elements */
+
+static FT_Error
+TA_states_add(Analysis* a,
+              const Frame* frame,
+              State** list,
+              const State* s,
+              State** changed)
+{
+  FT_Error error;
+  FT_Bool exact = s->exact;
+
+  State* p;
+  FT_Long n;
+
+
+  *changed = NULL;
+
+Again:
+  for (p = *list, n = 0; p; p = p->next, n++)
+    if (exact ? (p->exact
+                 && p->depth == s->depth
+                 && (frame->is_function
+                     || TA_state_values_equal(frame, p, s)))
+              : !p->exact)
+      break;
+
+  if (p)
+  {
+    FT_Bool has_changed;
+
+
+    error = TA_state_join(a, frame, p, s, &has_changed);
+    if (error || !has_changed)
+      return error;
+
+    /* the stack must not grow in loops */
+    if (p->increases > MAX_INCREASES)
+      return TA_Err_Cannot_Analyze;
+
+    *changed = p;
+    return TA_Err_Ok;
+  }
+
+  if (exact && n >= MAX_PARTITIONS)
+  {
+    exact = 0;
+    goto Again;
+  }
+
+  p = TA_state_new(a);
+  if (!p)
+    return FT_Err_Out_Of_Memory;
+
+  error = TA_state_copy(p, s);
+  if (error)
+  {
+    TA_states_release(a, p);
+    return error;
+  }
+
+  p->exact = exact;
+  p->next = *list;
+  *list = p;
+
+  *changed = p;
+  return TA_Err_Ok;
+}
+
+
+static FT_Error
+TA_join_points_init(Join_Points* join_points,
+                    FT_Long num)
+{
+  join_points->in = (State**)calloc((size_t)num, sizeof (State*));
+  join_points->used = (FT_Long*)malloc((size_t)num * sizeof (FT_Long));
+  join_points->num_used = 0;
+
+  if (!join_points->in || !join_points->used)
+    return FT_Err_Out_Of_Memory;
+
+  return TA_Err_Ok;
+}
+
+
+static void
+TA_join_points_done(Join_Points* join_points)
+{
+  free(join_points->in);
+  free(join_points->used);
+
+  join_points->in = NULL;
+  join_points->used = NULL;
+}
+
+
+/* pass state `s' to position `pc' */
+
+static FT_Error
+TA_frame_propagate(Analysis* a,
+                   Frame* frame,
+                   const State* s,
+                   FT_Long pc)
+{
+  FT_Error error;
+  Join_Points* join_points = frame->join_points;
+  FT_Long idx;
+  State* p;
+
+
+  /* jumps must not leave the program or function */
+  /* and must hit the start of an instruction */
+  if (pc < frame->start
+      || pc > frame->end
+      || frame->program->match[pc] < 0)
+    return TA_Err_Cannot_Analyze;
+
+  idx = pc - frame->start;
+  if (!join_points->in[idx])
+    join_points->used[join_points->num_used++] = idx;
+
+  error = TA_states_add(a, frame, &join_points->in[idx], s, &p);
+  if (error)
+    return error;
+
+  /* the exit states are collected only */
+  if (!p || p->queued || pc == frame->end)
+    return TA_Err_Ok;
+
+  if (a->num_work == a->max_work)
+  {
+    FT_Long max_work = a->max_work + 64;
+    State** worklist_new;
+
+
+    worklist_new = (State**)realloc(a->worklist,
+                                    (size_t)max_work * sizeof (State*));
+    if (!worklist_new)
+      return FT_Err_Out_Of_Memory;
+
+    a->worklist = worklist_new;
+    a->max_work = max_work;
+  }
+
+  p->pc = pc;
+  p->queued = 1;
+  a->worklist[a->num_work++] = p;
+
+  return TA_Err_Ok;
+}
+
+
+/* continue at position `*next' with the states in `list', */
+/* which gets released; `*next' is set to -1 if `s' is no */
+/* longer valid */
+
+static FT_Error
+TA_frame_continue(Analysis* a,
+                  Frame* frame,
+                  State* s,
+                  State* list,
+                  FT_Long* next)
+{
+  FT_Error error = TA_Err_Ok;
+  State* p;
+
+
+  if (list && !list->next)
+  {
+    /* the common case: just take the only state */
+    State tmp = *s;
+
+
+    *s = *list;
+    *list = tmp;
+
+    s->next = NULL;
+    list->next = NULL;
+    TA_states_release(a, list);
+
+    return TA_Err_Ok;
+  }
+
+  for (p = list; p; p = p->next)
+  {
+    error = TA_frame_propagate(a, frame, p, *next);
+    if (error)
+      break;
+  }
+
+  TA_states_release(a, list);
+  *next = -1;
+
+  return error;
+}
+
+
+/* convert the exit state `p' of a function called with */
+/* state `s' into a state of the caller */
+
+static FT_Error
+TA_state_return(Analysis* a,
+                const State* s,
+                State* p)
+{
+  FT_Error error;
+  FT_Long i, j, k;
+
+
+  /* stack elements */
+  if (p->num_base >= s->num_base)
+  {
+    FT_Long n = p->num_base - s->num_base;
+
+
+    error = TA_state_reserve(p, n);
+    if (error)
+      return error;
+
+    memmove(p->values + n, p->values, (size_t)p->num_values * sizeof (Value));
+    memcpy(p->values, s->values, (size_t)n * sizeof (Value));
+
+    p->num_values += n;
+    p->num_base = s->num_base;
+  }
+
+  /* storage area values: the function's values override ours */
+  error = TA_analysis_reserve_cells(a, s->num_cells + p->num_cells);
+  if (error)
+    return error;
+
+  i = 0;
+  j = 0;
+  k = 0;
+  while (i < s->num_cells || j < p->num_cells)
+  {
+    if (j == p->num_cells
+        || (i < s->num_cells && s->cells[i].idx < p->cells[j].idx))
+    {
+      if (!p->cleared || s->cells[i].idx < p->clear_min)
+        a->cells[k++] = s->cells[i];
+      i++;
+    }
+    else
+    {
+      if (i < s->num_cells && s->cells[i].idx == p->cells[j].idx)
+        i++;
+      a->cells[k++] = p->cells[j++];
+    }
+  }
+
+  p->num_cells = 0;
+  error = TA_state_reserve_cells(p, k);
+  if (error)
+    return error;
+
+  if (k)
+    memcpy(p->cells, a->cells, (size_t)k * sizeof (Cell));
+  p->num_cells = k;
+
+  if (s->cleared
+      && (!p->cleared || s->clear_min < p->clear_min))
+  {
+    p->cleared = 1;
+    p->clear_min = s->clear_min;
+  }
+
+  return TA_Err_Ok;
+}
+
+
+static FT_Error
+TA_analysis_run(Analysis* a,
+                const Program* program,
+                FT_Long start,
+                FT_Long end,
+                const Base* base,
+                Join_Points* join_points,
+                const State* entry,
+                State** exits);
+
+
+/* call the function(s) given by `f' with state `s'; */
+/* the exit states are added to `*exits' */
+
+static FT_Error
+TA_analysis_call(Analysis* a,
+                 const Frame* frame,
+                 const State* s,
+                 Value f,
+                 State** exits)
+{
+  FT_Error error;
+  FT_Int i;
+
+  Base base;
+  State entry;
+
+
+  /* we can't follow calls of unknown functions */
+  if (!f.num)
+    return TA_Err_Cannot_Analyze;
+
+  base.values = s->values;
+  base.num_values = s->num_values;
+  base.cells = s->cells;
+  base.num_cells = s->num_cells;
+  base.cleared = s->cleared;
+  base.clear_min = s->clear_min;
+  base.below = frame->base;
+  base.num_below = s->num_base;
+
+  memset(&entry, 0, sizeof (State));
+  entry.depth = s->depth;
+  entry.exact = s->exact;
+  entry.loop = s->loop;
+  entry.num_base = s->num_base + s->num_values;
+
+  for (i = 0; i < f.num; i++)
+  {
+    FT_Long n = f.values[i];
+    Function* func;
+    State* out;
+    State* p;
+
+
+    if (n < 0
+        || n >= a->num_functions
+        || !a->functions[n].defined
+        || a->functions[n].active)
+      return TA_Err_Cannot_Analyze;
+
+    func = &a->functions[n];
+
+    if (!func->join_points.in)
+    {
+      error = TA_join_points_init(&func->join_points,
+                                  func->end - func->start + 1);
+      if (error)
+        return error;
+    }
+
+    func->active = 1;
+    error = TA_analysis_run(a, &a->fpgm, func->start, func->end, &base,
+                            &func->join_points, &entry, &out);
+    func->active = 0;
+    if (error)
+      return error;
+
+    for (p = out; p; p = p->next)
+    {
+      error = TA_state_return(a, s, p);
+      if (error)
+        break;
+    }
+
+    if (!error && !*exits)
+    {
+      *exits = out;
+      continue;
+    }
+
+    for (p = out; !error && p; p = p->next)
+    {
+      State* changed;
+
+
+      error = TA_states_add(a, frame, exits, p, &changed);
+    }
+
+    TA_states_release(a, out);
+    if (error)
+      return error;
+  }
+
+  return TA_Err_Ok;
+}
+
+
+/* call the function(s) given by `f' `count' times; */
+/* the exit states are stored in `*exits' */
+
+static FT_Error
+TA_analysis_loopcall(Analysis* a,
+                     const Frame* frame,
+                     const State* s,
+                     Value f,
+                     Value count,
+                     State** exits)
+{
+  FT_Error error;
+
+  State* current = NULL;
+  State* p;
+  State* changed;
+
+
+  *exits = NULL;
+
+  error = TA_states_add(a, frame, &current, s, &changed);
+  if (error)
+    return error;
+
+  if (count.num == 1 && count.values[0] <= MAX_LOOPCALL_ITERATIONS)
+  {
+    FT_Long i;
+
+
+    for (i = 0; i < count.values[0]; i++)
+    {
+      State* out = NULL;
+
+
+      for (p = current; p; p = p->next)
+      {
+        error = TA_analysis_call(a, frame, p, f, &out);
+        if (error)
+          break;
+      }
+
+      TA_states_release(a, current);
+      current = out;
+      if (error)
+        break;
+    }
+
+    if (error)
+      TA_states_release(a, current);
+    else
+      *exits = current;
+
+    return error;
+  }
+
+  /* an unknown number of iterations (possibly none); */
+  /* we iterate until the exit states no longer change */
+  error = TA_states_add(a, frame, exits, s, &changed);
+
+  while (!error && current)
+  {
+    State* out = NULL;
+    State* next = NULL;
+
+
+    if (++a->steps > a->max_steps)
+    {
+      error = TA_Err_Cannot_Analyze;
+      break;
+    }
+
+    for (p = current; p; p = p->next)
+    {
+      error = TA_analysis_call(a, frame, p, f, &out);
+      if (error)
+        break;
+    }
+
+    for (p = out; !error && p; p = p->next)
+    {
+      State* dummy;
+
+
+      error = TA_states_add(a, frame, exits, p, &changed);
+      if (!error && changed)
+        error = TA_states_add(a, frame, &next, changed, &dummy);
+    }
+
+    TA_states_release(a, out);
+    TA_states_release(a, current);
+    current = next;
+  }
+
+  TA_states_release(a, current);
+  if (error)
+  {
+    TA_states_release(a, *exits);
+    *exits = NULL;
+  }
+
+  return error;
+}
+
+
+static FT_Error
+TA_analysis_record_function(Analysis* a,
+                            const Program* program,
+                            Value f,
+                            FT_Long start,
+                            FT_Long* end)
+{
+  FT_Long n;
+
+
+  if (f.num != 1 || f.values[0] < 0 || f.values[0] > 0xFFFF)
+    return TA_Err_Cannot_Analyze;
+  n = f.values[0];
+
+  /* find `ENDF' */
+  for (*end = start; *end < program->len; (*end)++)
+    if (program->match[*end] >= 0 && program->code[*end] == ENDF)
+      break;
+  if (*end == program->len)
+    return TA_Err_Cannot_Analyze;
+
+  if (!a->collect)
+    return TA_Err_Ok;
+
+  if (n >= a->num_functions)
+  {
+    FT_Long num_functions = n + 1;
+    Function* functions_new;
+
+
+    functions_new = (Function*)realloc(a->functions,
+                                       (size_t)num_functions
+                                         * sizeof (Function));
+    if (!functions_new)
+      return FT_Err_Out_Of_Memory;
+
+    memset(functions_new + a->num_functions,
+           0,
+           (size_t)(num_functions - a->num_functions) * sizeof (Function));
+
+    a->functions = functions_new;
+    a->num_functions = num_functions;
+  }
+
+  /* a redefinition replaces the function */
+  TA_join_points_done(&a->functions[n].join_points);
+
+  a->functions[n].defined = 1;
+  a->functions[n].start = start;
+  a->functions[n].end = *end;
+
+  return TA_Err_Ok;
+}
+
+
+/* fold arithmetic instructions with known operands */
+
+static Value
+TA_analysis_compute(FT_Byte opcode,
+                    Value v1,
+                    Value v2)
+{
+  FT_Long x, y;
+
+
+  if (v1.num != 1 || v2.num != 1)
+  {
+    Value v = TA_value_unknown();
+    FT_Long min1, min2;
+    FT_Bool have_min1 = TA_value_min(&v1, &min1);
+    FT_Bool have_min2 = TA_value_min(&v2, &min2);
+
+
+    /* we need lower bounds of storage area indices only */
+    if (opcode == ADD && have_min1 && have_min2)
+    {
+      v.has_min = 1;
+      v.min = min1 + min2;
+    }
+    else if (opcode == SUB && have_min1 && v2.num == 1)
+    {
+      v.has_min = 1;
+      v.min = min1 - v2.values[0];
+    }
+    else if (opcode == MAX && (have_min1 || have_min2))
+    {
+      v.has_min = 1;
+      v.min = have_min1 ? (have_min2 ? TA_MAX(min1, min2) : min1)
+                        : min2;
+    }
+
+    return v;
+  }
+
+  x = v1.values[0];
+  y = v2.values[0];
+
+  switch (opcode)
+  {
+  case ADD:
+    return TA_value_constant(x + y);
+  case SUB:
+    return TA_value_constant(x - y);
+  case MUL:
+    return TA_value_constant(FT_MulDiv(x, y, 64));
+  case DIV:
+    /* avoid overflow */
+    if (!y || x >= 0x2000000L || x <= -0x2000000L)
+      return TA_value_unknown();
+    return TA_value_constant((x * 64) / y);
+  case MAX:
+    return TA_value_constant(TA_MAX(x, y));
+  case MIN:
+    return TA_value_constant(TA_MIN(x, y));
+  case LT:
+    return TA_value_constant(x < y);
+  case LTEQ:
+    return TA_value_constant(x <= y);
+  case GT:
+    return TA_value_constant(x > y);
+  case GTEQ:
+    return TA_value_constant(x >= y);
+  case EQ:
+    return TA_value_constant(x == y);
+  case NEQ:
+    return TA_value_constant(x != y);
+  case AND:
+    return TA_value_constant(x && y);
+  default: /* OR */
+    return TA_value_constant(x || y);
+  }
+}
+
+
+/* execute one instruction; `*next' is set to -1 */
+/* if the control flow doesn't simply continue */
+
+static FT_Error
+TA_analysis_step(Analysis* a,
+                 Frame* frame,
+                 State* s,
+                 FT_Long pc,
+                 FT_Long* next)
+{
+  FT_Error error = TA_Err_Ok;
+
+  const Program* program = frame->program;
+  FT_Byte opcode = program->code[pc];
+  FT_Long size = TA_instruction_size(program->code, program->len, pc);
+
+  Value v1, v2, v3;
+  State* exits;
+  FT_Long i, n;
+  FT_Int truth;
+
+
+  *next = pc + size;
+
+  if (TA_opcode_is_undefined(opcode))
+    return TA_Err_Cannot_Analyze;
+
+  switch (opcode)
+  {
+  case NPUSHB:
+  case NPUSHW:
+  case PUSHB_1: case PUSHB_2: case PUSHB_3: case PUSHB_4:
+  case PUSHB_5: case PUSHB_6: case PUSHB_7: case PUSHB_8:
+  case PUSHW_1: case PUSHW_2: case PUSHW_3: case PUSHW_4:
+  case PUSHW_5: case PUSHW_6: case PUSHW_7: case PUSHW_8:
+    {
+      const FT_Byte* p = program->code + pc + 1;
+      FT_Bool words;
+
+
+      if (opcode == NPUSHB || opcode == NPUSHW)
+      {
+        n = *(p++);
+        words = (opcode == NPUSHW);
+      }
+      else if (opcode <= PUSHB_8)
+      {
+        n = opcode - PUSHB_1 + 1;
+        words = 0;
+      }
+      else
+      {
+        n = opcode - PUSHW_1 + 1;
+        words = 1;
+      }
+
+      for (i = 0; i < n; i++)
+      {
+        FT_Long value;
+
+
+        if (words)
+        {
+          value = (FT_Short)((p[0] << 8) | p[1]);
+          p += 2;
+        }
+        else
+          value = *(p++);
+
+        error = TA_state_push(a, s, TA_value_constant(value));
+        if (error)
+          return error;
+      }
+    }
+    break;
+
+  case DUP:
+    v1 = TA_state_pop(frame, s);
+    error = TA_state_push(a, s, v1);
+    if (!error)
+      error = TA_state_push(a, s, v1);
+    break;
+
+  case SWAP:
+    v1 = TA_state_pop(frame, s);
+    v2 = TA_state_pop(frame, s);
+    error = TA_state_push(a, s, v1);
+    if (!error)
+      error = TA_state_push(a, s, v2);
+    break;
+
+  case ROLL:
+    v1 = TA_state_pop(frame, s);
+    v2 = TA_state_pop(frame, s);
+    v3 = TA_state_pop(frame, s);
+    error = TA_state_push(a, s, v2);
+    if (!error)
+      error = TA_state_push(a, s, v1);
+    if (!error)
+      error = TA_state_push(a, s, v3);
+    break;
+
+  case DEPTH:
+    error = TA_state_push(a, s, s->exact ? TA_value_constant(s->depth)
+                                         : TA_value_unknown());
+    break;
+
+  case CLEAR:
+    s->depth = 0;
+    s->exact = 1;
+    s->num_base = 0;
+    s->num_values = 0;
+    break;
+
+  case CINDEX:
+    v1 = TA_state_pop(frame, s);
+    if (v1.num == 1
+        && v1.values[0] >= 1
+        && v1.values[0] <= s->num_base + s->num_values)
+      v2 = TA_state_value(frame, s, v1.values[0] - 1);
+    else
+      v2 = TA_value_unknown();
+    error = TA_state_push(a, s, v2);
+    break;
+
+  case MINDEX:
+    v1 = TA_state_pop(frame, s);
+    if (v1.num == 1
+        && v1.values[0] >= 1
+        && v1.values[0] <= s->num_base + s->num_values)
+    {
+      Value* p;
+
+
+      error = TA_state_materialize(frame, s, v1.values[0] - s->num_values);
+      if (error)
+        return error;
+
+      p = s->values + s->num_values - v1.values[0];
+      v2 = *p;
+      memmove(p, p + 1, (size_t)(v1.values[0] - 1) * sizeof (Value));
+      s->values[s->num_values - 1] = v2;
+    }
+    else
+    {
+      /* an unknown element moves to the top; if we don't */
+      /* know its position, the other elements are unknown also */
+      if (v1.num != 1)
+      {
+        s->num_base = 0;
+        s->num_values = 0;
+      }
+
+      if (s->depth > 0)
+        s->depth--;
+      if (s->num_base + s->num_values > s->depth)
+      {
+        n = s->num_base + s->num_values - s->depth;
+
+        error = TA_state_materialize(frame, s, s->num_base);
+        if (error)
+          return error;
+
+        s->num_values -= n;
+        memmove(s->values, s->values + n,
+                (size_t)s->num_values * sizeof (Value));
+      }
+      error = TA_state_push(a, s, TA_value_unknown());
+    }
+    break;
+
+  case SLOOP:
+    v1 = TA_state_pop(frame, s);
+    s->loop = (v1.num == 1) ? v1.values[0] : -1;
+    break;
+
+  case SHPIX:
+  case SHP_rp2:
+  case SHP_rp1:
+  case IP:
+  case ALIGNRP:
+  case FLIPPT:
+    if (opcode == SHPIX)
+      (void)TA_state_pop(frame, s);
+
+    if (s->loop >= 0)
+    {
+      for (i = 0; i < s->loop; i++)
+        (void)TA_state_pop(frame, s);
+    }
+    else
+      TA_state_forget(s);
+
+    s->loop = 1;
+    break;
+
+  case DELTAP1:
+  case DELTAP2:
+  case DELTAP3:
+  case DELTAC1:
+  case DELTAC2:
+  case DELTAC3:
+    v1 = TA_state_pop(frame, s);
+    if (v1.num == 1 && v1.values[0] >= 0)
+    {
+      for (i = 0; i < 2 * v1.values[0]; i++)
+        (void)TA_state_pop(frame, s);
+    }
+    else
+      TA_state_forget(s);
+    break;
+
+  case RS:
+    v1 = TA_state_pop(frame, s);
+    error = TA_state_push(a, s, TA_state_read(frame, s, v1));
+    break;
+
+  case WS:
+    v1 = TA_state_pop(frame, s);
+    v2 = TA_state_pop(frame, s);
+    error = TA_state_write(frame, s, v2, v1);
+    break;
+
+  case IF:
+    v1 = TA_state_pop(frame, s);
+
+    n = program->match[pc];
+    if (n < 0 || n == pc)
+      return TA_Err_Cannot_Analyze;
+    if (program->code[n] == ELSE)
+      n++;
+
+    truth = TA_value_truth(v1);
+    if (truth < 0)
+      error = TA_frame_propagate(a, frame, s, n);
+    else if (!truth)
+      *next = n;
+    break;
+
+  case ELSE:
+    /* we come from the `then' branch */
+    if (program->match[pc] < 0 || program->match[pc] == pc)
+      return TA_Err_Cannot_Analyze;
+
+    *next = program->match[pc];
+    break;
+
+  case JMPR:
+    v1 = TA_state_pop(frame, s);
+    if (v1.num != 1 || !v1.values[0])
+      return TA_Err_Cannot_Analyze;
+
+    error = TA_frame_propagate(a, frame, s, pc + v1.values[0]);
+    *next = -1;
+    break;
+
+  case JROT:
+  case JROF:
+    v1 = TA_state_pop(frame, s);
+    v2 = TA_state_pop(frame, s);
+
+    truth = TA_value_truth(v1);
+    if (truth >= 0 && opcode == JROF)
+      truth = !truth;
+
+    if (truth)
+    {
+      if (v2.num != 1 || !v2.values[0])
+        return TA_Err_Cannot_Analyze;
+
+      error = TA_frame_propagate(a, frame, s, pc + v2.values[0]);
+    }
+    if (!error && truth != 1)
+      error = TA_frame_propagate(a, frame, s, pc + size);
+
+    *next = -1;
+    break;
+
+  case CALL:
+    v1 = TA_state_pop(frame, s);
+
+    exits = NULL;
+    error = TA_analysis_call(a, frame, s, v1, &exits);
+    if (error)
+    {
+      TA_states_release(a, exits);
+      return error;
+    }
+
+    error = TA_frame_continue(a, frame, s, exits, next);
+    break;
+
+  case LOOPCALL:
+    v1 = TA_state_pop(frame, s);
+    v2 = TA_state_pop(frame, s);
+
+    /* all counts not positive? */
+    if (v2.num)
+    {
+      for (i = 0; i < v2.num; i++)
+        if (v2.values[i] > 0)
+          break;
+      if (i == v2.num)
+        break;
+    }
+
+    error = TA_analysis_loopcall(a, frame, s, v1, v2, &exits);
+    if (error)
+      return error;
+
+    error = TA_frame_continue(a, frame, s, exits, next);
+    break;
+
+  case FDEF:
+    v1 = TA_state_pop(frame, s);
+
+    /* only the `fpgm' table can define functions */
+    if (frame->is_function || program != &a->fpgm)
+      return TA_Err_Cannot_Analyze;
+
+    error = TA_analysis_record_function(a, program, v1, *next, next);
+    if (error)
+      return error;
+
+    /* skip the function body */
+    (*next)++;
+    break;
+
+  case ENDF:
+    /* this is handled by the caller */
+    return TA_Err_Cannot_Analyze;
+
+  /* jump offsets and loop counters are sometimes computed */
+  case NEG:
+  case ABS:
+  case NOT:
+  case FLOOR:
+  case CEILING:
+    v1 = TA_state_pop(frame, s);
+    if (v1.num == 1)
+    {
+      FT_Long x = v1.values[0];
+
+
+      if (opcode == NEG)
+        x = -x;
+      else if (opcode == ABS)
+        x = x < 0 ? -x : x;
+      else if (opcode == NOT)
+        x = !x;
+      else if (opcode == FLOOR)
+        x = x & -64;
+      else
+        x = (x + 63) & -64;
+
+      v1 = TA_value_constant(x);
+    }
+    else
+      v1 = TA_value_unknown();
+    error = TA_state_push(a, s, v1);
+    break;
+
+  case ADD:
+  case SUB:
+  case MUL:
+  case DIV:
+  case MAX:
+  case MIN:
+  case LT:
+  case LTEQ:
+  case GT:
+  case GTEQ:
+  case EQ:
+  case NEQ:
+  case AND:
+  case OR:
+    v2 = TA_state_pop(frame, s);
+    v1 = TA_state_pop(frame, s);
+    error = TA_state_push(a, s, TA_analysis_compute(opcode, v1, v2));
+    break;
+
+  default:
+    {
+      FT_Byte effect = stack_effects[opcode];
+
+
+      for (i = 0; i < effect >> 4; i++)
+        (void)TA_state_pop(frame, s);
+      for (i = 0; i < (effect & 0x0F); i++)
+      {
+        error = TA_state_push(a, s, TA_value_unknown());
+        if (error)
+          return error;
+      }
+    }
+  }
+
+  return error;
+}
+
+
+/* analyze the instructions in the range [start;end[ of `program', */
+/* starting with state `entry'; the list of exit states is returned */
+/* in `*exits' */
+
+static FT_Error
+TA_analysis_run(Analysis* a,
+                const Program* program,
+                FT_Long start,
+                FT_Long end,
+                const Base* base,
+                Join_Points* join_points,
+                const State* entry,
+                State** exits)
+{
+  FT_Error error;
+
+  Frame frame;
+  State* s;
+  FT_Long i;
+
+
+  *exits = NULL;
+
+  frame.program = program;
+  frame.start = start;
+  frame.end = end;
+  frame.is_function = (base != NULL);
+  frame.base = base;
+  frame.join_points = join_points;
+  frame.num_work = a->num_work;
+
+  s = TA_state_new(a);
+  if (!s)
+    return FT_Err_Out_Of_Memory;
+
+  error = TA_frame_propagate(a, &frame, entry, start);
+  if (error)
+    goto Exit;
+
+  while (a->num_work > frame.num_work)
+  {
+    State* p = a->worklist[--a->num_work];
+    FT_Long pc = p->pc;
+
+
+    p->queued = 0;
+
+    error = TA_state_copy(s, p);
+    if (error)
+      goto Exit;
+
+    for (;;)
+    {
+      FT_Long next;
+
+
+      if (++a->steps > a->max_steps)
+      {
+        error = TA_Err_Cannot_Analyze;
+        goto Exit;
+      }
+
+      error = TA_analysis_step(a, &frame, s, pc, &next);
+      if (error)
+        goto Exit;
+
+      if (next < 0)
+        break;
+
+      /* join points are the targets of jumps, `EIF', and the exit */
+      if (next > end)
+      {
+        error = TA_Err_Cannot_Analyze;
+        goto Exit;
+      }
+      if (next == end
+          || join_points->in[next - start]
+          || program->code[next] == EIF)
+      {
+        error = TA_frame_propagate(a, &frame, s, next);
+        if (error)
+          goto Exit;
+        break;
+      }
+
+      pc = next;
+    }
+  }
+
+  *exits = join_points->in[end - start];
+  join_points->in[end - start] = NULL;
+
+Exit:
+  a->num_work = frame.num_work;
+  TA_states_release(a, s);
+
+  for (i = 0; i < join_points->num_used; i++)
+  {
+    TA_states_release(a, join_points->in[join_points->used[i]]);
+    join_points->in[join_points->used[i]] = NULL;
+  }
+  join_points->num_used = 0;
+
+  return error;
+}
+
+
+/* analyze a top-level program and update `a->peak' */
+
+static FT_Error
+TA_analysis_run_program(Analysis* a,
+                        const Program* program)
+{
+  FT_Error error;
+
+  Join_Points join_points;
+  State entry;
+  State* exits = NULL;
+
+
+  /* the stack is empty, `loop' is reset, */
+  /* and the storage area is unknown */
+  memset(&entry, 0, sizeof (State));
+  entry.exact = 1;
+  entry.loop = 1;
+  entry.cleared = 1;
+  entry.clear_min = 0;
+
+  a->steps = 0;
+  a->max_steps = (a->budget < MAX_STEPS) ? (FT_Long)a->budget : MAX_STEPS;
+
+  error = TA_join_points_init(&join_points, program->len + 1);
+  if (!error)
+    error = TA_analysis_run(a, program, 0, program->len, NULL,
+                            &join_points, &entry, &exits);
+
+  /* `steps' exceeds `max_steps' by one if we give up */
+  a->budget -= (FT_ULong)TA_MIN(a->steps, a->max_steps);
+
+  TA_states_release(a, exits);
+  TA_join_points_done(&join_points);
+
+  return error;
+}
+
+
+static void
+TA_analysis_done(Analysis* a)
+{
+  FT_Long i;
+
+
+  for (i = 0; i < a->num_functions; i++)
+    TA_join_points_done(&a->functions[i].join_points);
+  free(a->functions);
+
+  while (a->unused_states)
+  {
+    State* s = a->unused_states;
+
+
+    a->unused_states = s->next;
+
+    free(s->values);
+    free(s->cells);
+    free(s);
+  }
+
+  free(a->worklist);
+  free(a->cells);
+
+  TA_program_done(&a->fpgm);
+}
+
+
+FT_Error
+TA_sfnt_compute_bytecode_limits(SFNT* sfnt,
+                                FONT* font,
+                                Bytecode_Limits* limits)
+{
+  FT_Error error;
+
+  SFNT_Table* glyf_table = &font->tables[sfnt->glyf_idx];
+  glyf_Data* data = (glyf_Data*)glyf_table->data;
+  SFNT_Table* fpgm_table;
+  SFNT_Table* prep_table;
+
+  Analysis a;
+  Program program;
+
+  FT_Byte* buf = NULL;
+  FT_ULong max_instructions;
+  FT_Long i;
+
+
+  memset(limits, 0, sizeof (Bytecode_Limits));
+  memset(&a, 0, sizeof (Analysis));
+  memset(&program, 0, sizeof (Program));
+
+  if (data->fpgm_idx == MISSING || data->prep_idx == MISSING)
+    return TA_Err_Ok;
+
+  fpgm_table = &font->tables[data->fpgm_idx];
+  prep_table = &font->tables[data->prep_idx];
+
+  max_instructions = TA_MAX(fpgm_table->len, prep_table->len);
+
+  /* this limits the time spent on the analysis of all programs; */
+  /* `num_glyphs' is at most 0xFFFF, so the budget fits 32 bits */
+  a.budget = MAX_STEPS + MAX_STEPS_PER_GLYPH * data->num_glyphs;
+
+  /* collect the function definitions */
+  error = TA_program_init(&a.fpgm, fpgm_table->buf, (FT_Long)fpgm_table->len);
+  if (error)
+    goto Exit;
+
+  a.collect = 1;
+  error = TA_analysis_run_program(&a, &a.fpgm);
+  if (error)
+    goto Exit;
+  a.collect = 0;
+
+  error = TA_program_init(&program, prep_table->buf, (FT_Long)prep_table->len);
+  if (!error)
+    error = TA_analysis_run_program(&a, &program);
+  TA_program_done(&program);
+  if (error)
+    goto Exit;
+
+  for (i = 0; i < data->num_glyphs; i++)
+  {
+    GLYPH* glyph = &data->glyphs[i];
+    FT_ULong len = glyph->ins_extra_len + glyph->ins_len;
+
+
+    if (!len)
+      continue;
+
+    if (len > max_instructions)
+      max_instructions = len;
+
+    /* the two parts are executed as a single program */
+    if (glyph->ins_extra_len)
+    {
+      FT_Byte* buf_new = (FT_Byte*)realloc(buf, len);
+
+
+      if (!buf_new)
+      {
+        error = FT_Err_Out_Of_Memory;
+        goto Exit;
+      }
+      buf = buf_new;
+
+      memcpy(buf, glyph->ins_extra_buf, glyph->ins_extra_len);
+      memcpy(buf + glyph->ins_extra_len, glyph->ins_buf, glyph->ins_len);
+
+      error = TA_program_init(&program, buf, (FT_Long)len);
+    }
+    else
+      error = TA_program_init(&program, glyph->ins_buf, (FT_Long)len);
+    if (!error)
+      error = TA_analysis_run_program(&a, &program);
+    TA_program_done(&program);
+    if (error)
+      goto Exit;
+  }
+
+  if (a.peak > 0xFFFF || max_instructions > 0xFFFF)
+  {
+    error = TA_Err_Cannot_Analyze;
+    goto Exit;
+  }
+
+  limits->max_stack_elements = (FT_UShort)a.peak;
+  limits->max_function_defs = (FT_UShort)a.num_functions;
+  limits->max_instructions = (FT_UShort)max_instructions;
+
+Exit:
+  free(buf);
+  TA_analysis_done(&a);
+
+  /* a failed analysis is not an error */
+  if (error == TA_Err_Cannot_Analyze)
+  {
+    memset(limits, 0, sizeof (Bytecode_Limits));
+    error = TA_Err_Ok;
+  }
+
+  return error;
+}
+
+/* end of taanalyze.c */
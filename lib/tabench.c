@@ -0,0 +1,660 @@
+/* tabench.c */
+
+/*
+ * Copyright (C) 2022 by Werner Lemberg.
+ *
+ * This file is part of the ttfautohint library, and may only be used,
+ * modified, and distributed under the terms given in `COPYING'.  By
+ * continuing to use, modify, or distribute this file you indicate that you
+ * have read `COPYING' and understand and accept it fully.
+ *
+ * The file `COPYING' mentioned in the previous paragraph is distributed
+ * with the ttfautohint library.
+ */
+
+
+/*
+ * A micro-benchmark for the glyph analysis and hinting stages.
+ *
+ * This program gets linked with the library sources compiled with
+ * `TA_PROFILE' defined (see `taprof.h').  It hints a font repeatedly and
+ * reports, for various sets of glyphs, percentiles of the time spent in
+ * each stage across the runs.
+ *
+ * With option `--json', a summary suitable for comparing runs gets
+ * emitted instead (see `bench/bench.pl').
+ */
+
+#include <config.h>
+
+#include <errno.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#  include <sys/resource.h>
+#endif
+
+#include <ttfautohint.h>
+
+#include "taprof.h"
+
+
+#ifndef TA_PROFILE
+#  error "tabench needs the library compiled with `TA_PROFILE'"
+#endif
+
+
+typedef enum Glyph_Set_
+{
+  SET_ALL,
+  SET_LARGEST,
+  SET_STYLES,
+
+  SET_MAX
+} Glyph_Set;
+
+static const char* set_names[SET_MAX] =
+{
+  "all glyphs",
+  "largest glyphs",
+  "one glyph per style"
+};
+
+
+/* we collect one sample per run for each set and stage, */
+/* plus the total time of each stage and the whole call */
+#define NUM_SAMPLES (TA_PROF_MAX + 1)
+#define SAMPLE_TOTAL TA_PROF_MAX
+
+
+static void
+usage(const char* program_name,
+      int status)
+{
+  FILE* handle = status ? stderr : stdout;
+
+
+  fprintf(handle,
+"Usage: %s [OPTION]... IN-FILE\n"
+"\n"
+"Hint IN-FILE repeatedly and report the time spent in the glyph\n"
+"analysis and hinting stages for several glyph sets (all glyphs,\n"
+"the glyphs with the most points, and the largest glyph of each style).\n"
+"\n"
+"Options:\n"
+"  -c, --control-file=FILE    use control instructions from FILE\n"
+"  -g, --largest=N            use N glyphs in the `largest' set\n"
+"                             (default: 20)\n"
+"  -h, --help                 display this help and exit\n"
+"  -j, --json                 output a summary in JSON format\n"
+"  -l, --hinting-range-min=N  the minimum PPEM value for hint sets\n"
+"  -n, --runs=N               hint the font N times (default: 10)\n"
+"  -r, --hinting-range-max=N  the maximum PPEM value for hint sets\n"
+"  -R, --reference=FILE       derive blue zones from reference font FILE\n"
+"  -s, --simd=SET             use vector instructions up to SET\n"
+"                             (`none', `sse2', `sse4.2', or `avx2')\n"
+"  -w, --warmup=N             do N extra runs first, which don't\n"
+"                             get measured (default: 1)\n"
+"\n"
+"Times are given in milliseconds; glyphs appearing in more than one\n"
+"subfont of a TrueType collection are accounted together.\n",
+          program_name);
+
+  exit(status);
+}
+
+
+static char*
+read_file(const char* name,
+          size_t* len)
+{
+  FILE* in;
+  char* buf = NULL;
+  size_t size = 0;
+
+
+  in = fopen(name, "rb");
+  if (!in)
+    return NULL;
+
+  for (;;)
+  {
+    char* buf_new = (char*)realloc(buf, size + 65536);
+    size_t n;
+
+
+    if (!buf_new)
+    {
+      free(buf);
+      fclose(in);
+      errno = ENOMEM;
+      return NULL;
+    }
+    buf = buf_new;
+
+    n = fread(buf + size, 1, 65536, in);
+    size += n;
+    if (n < 65536)
+      break;
+  }
+
+  if (ferror(in))
+  {
+    free(buf);
+    buf = NULL;
+  }
+  else
+    *len = size;
+
+  fclose(in);
+
+  return buf;
+}
+
+
+static int
+compare_ull(const void* a,
+            const void* b)
+{
+  unsigned long long x = *(const unsigned long long*)a;
+  unsigned long long y = *(const unsigned long long*)b;
+
+
+  return (x > y) - (x < y);
+}
+
+
+/* nearest-rank percentile of a sorted array */
+
+static unsigned long long
+percentile(const unsigned long long* values,
+           int num_values,
+           int p)
+{
+  int rank = (p * num_values + 99) / 100;
+
+
+  if (rank < 1)
+    rank = 1;
+
+  return values[rank - 1];
+}
+
+
+/* the maximum resident set size of the process in kByte, */
+/* or 0 if not available */
+
+static long
+peak_rss(void)
+{
+#ifdef _WIN32
+  return 0;
+#else
+  struct rusage usage;
+
+
+  if (getrusage(RUSAGE_SELF, &usage))
+    return 0;
+
+#  ifdef __APPLE__
+  /* macOS reports bytes */
+  return usage.ru_maxrss / 1024;
+#  else
+  return usage.ru_maxrss;
+#  endif
+#endif
+}
+
+
+static void
+print_json(const char* in_name,
+           int num_runs,
+           int hinting_range_min,
+           int hinting_range_max,
+           FT_Long num_hinted,
+           size_t out_len,
+           unsigned long long* totals,
+           unsigned long long* sample)
+{
+  unsigned long long total_p50;
+  unsigned long long glyphs_p50;
+  int k;
+
+
+  qsort(totals, (size_t)num_runs, sizeof (unsigned long long),
+        compare_ull);
+  total_p50 = percentile(totals, num_runs, 50);
+
+  printf("{\n"
+         "  \"font\": \"");
+  /* escape the characters JSON doesn't allow verbatim */
+  for (; *in_name; in_name++)
+  {
+    if (*in_name == '"' || *in_name == '\\')
+      printf("\\%c", *in_name);
+    else if ((unsigned char)*in_name < 0x20)
+      printf("\\u%04x", *in_name);
+    else
+      putchar(*in_name);
+  }
+  printf("\",\n"
+         "  \"runs\": %d,\n"
+         "  \"hinting_range\": [%d, %d],\n"
+         "  \"glyphs\": %ld,\n"
+         "  \"glyphs_per_second\": %.1f,\n"
+         "  \"time_ms\": {\"min\": %.3f, \"p50\": %.3f, \"max\": %.3f},\n"
+         "  \"peak_rss_kb\": %ld,\n"
+         "  \"output_size\": %lu,\n",
+         num_runs,
+         hinting_range_min, hinting_range_max,
+         num_hinted,
+         total_p50 ? (double)num_hinted * 1e9 / (double)total_p50 : 0.0,
+         (double)totals[0] / 1e6,
+         (double)total_p50 / 1e6,
+         (double)totals[num_runs - 1] / 1e6,
+         peak_rss(),
+         (unsigned long)out_len);
+
+  /* the median time of each stage for all glyphs; */
+  /* `outside_glyphs' is the remaining time of `TTF_autohint' */
+  printf("  \"phases_ms\": {\n");
+  for (k = 0; k < NUM_SAMPLES; k++)
+  {
+    unsigned long long* values = sample + k * num_runs;
+
+
+    qsort(values, (size_t)num_runs, sizeof (unsigned long long),
+          compare_ull);
+
+    printf("    \"%s\": %.3f,\n",
+           k == SAMPLE_TOTAL ? "glyphs" : ta_prof_stage_names[k],
+           (double)percentile(values, num_runs, 50) / 1e6);
+  }
+
+  glyphs_p50 = percentile(sample + SAMPLE_TOTAL * num_runs, num_runs, 50);
+  printf("    \"outside_glyphs\": %.3f\n"
+         "  }\n"
+         "}\n",
+         total_p50 > glyphs_p50 ? (double)(total_p50 - glyphs_p50) / 1e6
+                                : 0.0);
+}
+
+
+/* select the glyphs of all sets, using the data of the first run */
+
+static int
+select_glyphs(TA_ProfGlyph glyphs,
+              FT_Long num_glyphs,
+              int num_largest,
+              unsigned char* sets)
+{
+  FT_Long* order;
+  FT_Long num_hinted = 0;
+  FT_Long i, j;
+
+
+  order = (FT_Long*)malloc((size_t)num_glyphs * sizeof (FT_Long));
+  if (!order)
+    return 1;
+
+  for (i = 0; i < num_glyphs; i++)
+  {
+    sets[i] = 0;
+
+    if (!glyphs[i].hinted)
+      continue;
+
+    sets[i] |= 1 << SET_ALL;
+    order[num_hinted++] = i;
+  }
+
+  /* sort the hinted glyphs by point count (descending), */
+  /* using a stable insertion sort to keep ties in glyph order */
+  for (i = 1; i < num_hinted; i++)
+  {
+    FT_Long idx = order[i];
+
+
+    for (j = i; j > 0; j--)
+    {
+      if (glyphs[order[j - 1]].num_points >= glyphs[idx].num_points)
+        break;
+      order[j] = order[j - 1];
+    }
+    order[j] = idx;
+  }
+
+  for (i = 0; i < num_hinted && i < num_largest; i++)
+    sets[order[i]] |= 1 << SET_LARGEST;
+
+  /* the first glyph of a style in this order is its largest one */
+  for (i = 0; i < num_hinted; i++)
+  {
+    FT_UInt style = glyphs[order[i]].style;
+
+
+    for (j = 0; j < i; j++)
+      if (glyphs[order[j]].style == style)
+        break;
+
+    if (j == i)
+      sets[order[i]] |= 1 << SET_STYLES;
+  }
+
+  free(order);
+
+  return 0;
+}
+
+
+int
+main(int argc,
+     char** argv)
+{
+  const char* program_name = argv[0];
+  const char* in_name;
+  const char* control_name = NULL;
+  const char* reference_name = NULL;
+  const char* simd = NULL;
+  int json = 0;
+
+  int hinting_range_min = TA_HINTING_RANGE_MIN;
+  int hinting_range_max = TA_HINTING_RANGE_MAX;
+  int num_runs = 10;
+  int num_warmup = 1;
+  int num_largest = 20;
+
+  char* in_buf;
+  size_t in_len;
+  char* reference_buf = NULL;
+  size_t reference_len = 0;
+  FILE* control = NULL;
+  size_t out_len = 0;
+
+  unsigned char* sets = NULL;
+  FT_Long num_sets_glyphs = 0;
+  FT_Long set_count[SET_MAX] = { 0 };
+  unsigned long long* samples;
+  unsigned long long* totals;
+
+  int run, s, k;
+
+
+  for (;;)
+  {
+    static struct option long_options[] =
+    {
+      {"control-file", required_argument, NULL, 'c'},
+      {"help", no_argument, NULL, 'h'},
+      {"hinting-range-max", required_argument, NULL, 'r'},
+      {"hinting-range-min", required_argument, NULL, 'l'},
+      {"json", no_argument, NULL, 'j'},
+      {"largest", required_argument, NULL, 'g'},
+      {"reference", required_argument, NULL, 'R'},
+      {"runs", required_argument, NULL, 'n'},
+      {"simd", required_argument, NULL, 's'},
+      {"warmup", required_argument, NULL, 'w'},
+
+      {NULL, 0, NULL, 0}
+    };
+
+    int option_index;
+    int c = getopt_long(argc, argv, "c:g:hjl:n:r:R:s:w:",
+                        long_options, &option_index);
+
+
+    if (c == -1)
+      break;
+
+    switch (c)
+    {
+    case 'c':
+      control_name = optarg;
+      break;
+
+    case 'g':
+      num_largest = atoi(optarg);
+      break;
+
+    case 'h':
+      usage(program_name, EXIT_SUCCESS);
+      break;
+
+    case 'j':
+      json = 1;
+      break;
+
+    case 'l':
+      hinting_range_min = atoi(optarg);
+      break;
+
+    case 'n':
+      num_runs = atoi(optarg);
+      break;
+
+    case 'r':
+      hinting_range_max = atoi(optarg);
+      break;
+
+    case 'R':
+      reference_name = optarg;
+      break;
+
+    case 's':
+      simd = optarg;
+      break;
+
+    case 'w':
+      num_warmup = atoi(optarg);
+      break;
+
+    default:
+      usage(program_name, EXIT_FAILURE);
+    }
+  }
+
+  if (optind != argc - 1)
+    usage(program_name, EXIT_FAILURE);
+  in_name = argv[optind];
+
+  if (num_runs < 1 || num_warmup < 0 || num_largest < 1)
+  {
+    fprintf(stderr, "%s: invalid number of runs or glyphs\n",
+            program_name);
+    exit(EXIT_FAILURE);
+  }
+
+  in_buf = read_file(in_name, &in_len);
+  if (!in_buf)
+  {
+    fprintf(stderr, "%s: can't read input file `%s': %s\n",
+            program_name, in_name, strerror(errno));
+    exit(EXIT_FAILURE);
+  }
+
+  if (reference_name)
+  {
+    reference_buf = read_file(reference_name, &reference_len);
+    if (!reference_buf)
+    {
+      fprintf(stderr, "%s: can't read reference font `%s': %s\n",
+              program_name, reference_name, strerror(errno));
+      exit(EXIT_FAILURE);
+    }
+  }
+
+  samples = (unsigned long long*)calloc((size_t)(SET_MAX * NUM_SAMPLES
+                                                 * num_runs),
+                                        sizeof (unsigned long long));
+  totals = (unsigned long long*)calloc((size_t)num_runs,
+                                       sizeof (unsigned long long));
+  if (!samples || !totals)
+  {
+    fprintf(stderr, "%s: out of memory\n", program_name);
+    exit(EXIT_FAILURE);
+  }
+
+  for (run = -num_warmup; run < num_runs; run++)
+  {
+    char* out_buf = NULL;
+    unsigned long long start, total;
+
+    TA_ProfGlyph glyphs;
+    FT_Long num_glyphs;
+    FT_Long i;
+    TA_Error error;
+
+
+    if (control_name)
+    {
+      control = fopen(control_name, "r");
+      if (!control)
+      {
+        fprintf(stderr, "%s: can't open control instructions file"
+                        " `%s': %s\n",
+                program_name, control_name, strerror(errno));
+        exit(EXIT_FAILURE);
+      }
+    }
+
+    ta_prof_reset();
+
+    start = ta_prof_now();
+    error = TTF_autohint("in-buffer, in-buffer-len,"
+                         " out-buffer, out-buffer-len,"
+                         " control-file,"
+                         " reference-buffer, reference-buffer-len,"
+                         " reference-name,"
+                         " hinting-range-min, hinting-range-max,"
+                         " simd",
+                         in_buf, in_len,
+                         &out_buf, &out_len,
+                         control,
+                         reference_buf, reference_len,
+                         reference_name,
+                         hinting_range_min, hinting_range_max,
+                         simd);
+    total = ta_prof_now() - start;
+
+    free(out_buf);
+    if (control)
+      fclose(control);
+
+    if (error)
+    {
+      fprintf(stderr, "%s: hinting failed with error 0x%02X\n",
+              program_name, error);
+      exit(EXIT_FAILURE);
+    }
+
+    if (run < 0)
+      continue;
+
+    glyphs = ta_prof_get_glyphs(&num_glyphs);
+
+    if (!sets)
+    {
+      sets = (unsigned char*)malloc((size_t)num_glyphs + 1);
+      if (!sets
+          || select_glyphs(glyphs, num_glyphs, num_largest, sets))
+      {
+        fprintf(stderr, "%s: out of memory\n", program_name);
+        exit(EXIT_FAILURE);
+      }
+      num_sets_glyphs = num_glyphs;
+
+      for (i = 0; i < num_sets_glyphs; i++)
+        for (s = 0; s < SET_MAX; s++)
+          if (sets[i] & (1 << s))
+            set_count[s]++;
+    }
+
+    for (i = 0; i < num_glyphs && i < num_sets_glyphs; i++)
+    {
+      for (s = 0; s < SET_MAX; s++)
+      {
+        unsigned long long* sample;
+
+
+        if (!(sets[i] & (1 << s)))
+          continue;
+
+        sample = samples + (s * NUM_SAMPLES) * num_runs;
+        for (k = 0; k < TA_PROF_MAX; k++)
+        {
+          sample[k * num_runs + run] += glyphs[i].ns[k];
+          sample[SAMPLE_TOTAL * num_runs + run] += glyphs[i].ns[k];
+        }
+      }
+    }
+
+    /* the time of the whole `TTF_autohint' call */
+    totals[run] = total;
+    if (json)
+      continue;
+
+    if (run == 0)
+      printf("run   TTF_autohint (ms)\n");
+    printf("%3d   %10.3f\n", run + 1, (double)total / 1e6);
+  }
+
+  ta_prof_reset();
+
+  if (json)
+  {
+    print_json(in_name, num_runs,
+               hinting_range_min, hinting_range_max,
+               set_count[SET_ALL], out_len,
+               totals, samples + (SET_ALL * NUM_SAMPLES) * num_runs);
+    goto Exit;
+  }
+
+  printf("\n"
+         "%s: %d run%s, hinting range %d-%d\n",
+         in_name, num_runs, num_runs == 1 ? "" : "s",
+         hinting_range_min, hinting_range_max);
+
+  for (s = 0; s < SET_MAX; s++)
+  {
+    unsigned long long* sample = samples + (s * NUM_SAMPLES) * num_runs;
+
+
+    printf("\n"
+           "%s (%ld glyph%s)\n"
+           "  %-20s %10s %10s %10s %10s %10s\n",
+           set_names[s],
+           set_count[s], set_count[s] == 1 ? "" : "s",
+           "stage", "min", "p50", "p90", "p99", "max");
+
+    for (k = 0; k < NUM_SAMPLES; k++)
+    {
+      unsigned long long* values = sample + k * num_runs;
+
+
+      qsort(values, (size_t)num_runs, sizeof (unsigned long long),
+            compare_ull);
+
+      printf("  %-20s %10.3f %10.3f %10.3f %10.3f %10.3f\n",
+             k == SAMPLE_TOTAL ? "total" : ta_prof_stage_names[k],
+             (double)values[0] / 1e6,
+             (double)percentile(values, num_runs, 50) / 1e6,
+             (double)percentile(values, num_runs, 90) / 1e6,
+             (double)percentile(values, num_runs, 99) / 1e6,
+             (double)values[num_runs - 1] / 1e6);
+    }
+  }
+
+Exit:
+  free(samples);
+  free(totals);
+  free(sets);
+  free(reference_buf);
+  free(in_buf);
+
+  return EXIT_SUCCESS;
+}
+
+/* end of tabench.c */
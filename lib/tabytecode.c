@@ -19,6 +19,8 @@
 
 #include "llrb.h" /* a red-black tree implementation */
 #include "tahints.h"
+#include "taprof.h"
+#include "tasweep.h"
 
 
 #define DEBUGGING
@@ -30,7 +32,6 @@ int _ta_debug_global = 0;
 int _ta_debug_disable_horz_hints;
 int _ta_debug_disable_vert_hints;
 int _ta_debug_disable_blue_hints;
-void* _ta_debug_hints;
 #endif
 
 
@@ -2470,6 +2471,27 @@ TA_hints_recorder(TA_Action action,
 }
 
 
+#ifdef TA_PROFILE
+
+static void
+TA_hints_recorder_profiled(TA_Action action,
+                           TA_GlyphHints hints,
+                           TA_Dimension dim,
+                           void* arg1,
+                           TA_Edge arg2,
+                           TA_Edge arg3,
+                           TA_Edge lower_bound,
+                           TA_Edge upper_bound)
+{
+  TA_PROF_ENTER(TA_PROF_RECORDER);
+  TA_hints_recorder(action, hints, dim, arg1, arg2, arg3,
+                    lower_bound, upper_bound);
+  TA_PROF_LEAVE(TA_PROF_RECORDER);
+}
+
+#endif /* TA_PROFILE */
+
+
 static FT_Error
 TA_init_recorder(Recorder* recorder,
                  SFNT* sfnt,
@@ -2628,10 +2650,251 @@ TA_free_recorder(Recorder* recorder)
 }
 
 
+/* the state of the PPEM loop in `TA_sfnt_build_glyph_instructions' */
+typedef struct Sweep_
+{
+  FONT* font;
+  FT_Face face;
+  FT_Long idx;
+  FT_Int32 load_flags;
+
+  Recorder* recorder;
+  FT_Byte* ins_buf;
+
+  Hints_Record** action_hints_records;
+  FT_UInt* num_action_hints_records;
+  Hints_Record** point_hints_records;
+  FT_UInt* num_point_hints_records;
+} Sweep;
+
+
+/*
+ * Hint the glyph at PPEM value `size' and compare the resulting action
+ * and point hints records with the last ones, setting `is_different'
+ * accordingly.  If `add' is set, new records get appended to the arrays;
+ * otherwise, nothing changes (this is used for probing).
+ */
+
+static FT_Error
+TA_sweep_size(void* data,
+              FT_UInt size,
+              FT_Bool add,
+              FT_Bool* is_different)
+{
+  Sweep* sweep = (Sweep*)data;
+  FONT* font = sweep->font;
+  Recorder* recorder = sweep->recorder;
+  FT_Byte* ins_buf = sweep->ins_buf;
+  TA_GlyphHints hints = &font->loader->hints;
+
+  FT_Error error;
+
+#ifdef DEBUGGING
+  FT_Byte* p;
+  int have_dumps = 0;
+#endif
+  unsigned long long ppem_start =
+    (font->trace && font->trace->ppem) ? ta_trace_now() : 0;
+
+
+  *is_different = 0;
+
+  TA_rewind_recorder(recorder, ins_buf, size);
+
+  error = FT_Set_Pixel_Sizes(sweep->face, size, size);
+  if (error)
+    return error;
+
+#ifdef DEBUGGING
+  if (font->debug && add)
+  {
+    int num_chars, i;
+
+
+    num_chars = fprintf(stderr, "size %d\n", size);
+    for (i = 0; i < num_chars - 1; i++)
+      putc('-', stderr);
+    fprintf(stderr, "\n\n");
+  }
+#endif
+
+  /* calling `ta_loader_load_glyph' uses the */
+  /* `TA_hints_recorder' function as a callback, */
+  /* modifying `hints_record' */
+  error = ta_loader_load_glyph(font, sweep->face,
+                               (FT_UInt)sweep->idx, sweep->load_flags);
+  if (error)
+    return error;
+
+  if (TA_hints_record_is_different(*sweep->action_hints_records,
+                                   *sweep->num_action_hints_records,
+                                   ins_buf, recorder->hints_record.buf))
+  {
+    *is_different = 1;
+
+    if (add)
+    {
+#ifdef DEBUGGING
+      if (font->debug)
+      {
+        have_dumps = 1;
+
+        ta_glyph_hints_dump_edges(hints);
+        ta_glyph_hints_dump_segments(hints);
+        ta_glyph_hints_dump_points(hints);
+
+        fprintf(stderr, "action hints record:\n");
+        if (ins_buf == recorder->hints_record.buf)
+          fprintf(stderr, "  (none)");
+        else
+        {
+          fprintf(stderr, "  ");
+          for (p = ins_buf; p < recorder->hints_record.buf; p += 2)
+            fprintf(stderr, " %2d", *p * 256 + *(p + 1));
+        }
+        fprintf(stderr, "\n");
+      }
+#endif
+
+      error = TA_add_hints_record(sweep->action_hints_records,
+                                  sweep->num_action_hints_records,
+                                  ins_buf, recorder->hints_record);
+      if (error)
+        return error;
+    }
+  }
+
+  /* now handle point records */
+
+  TA_reset_recorder(recorder, ins_buf);
+
+  /* use the point hints data collected in `TA_hints_recorder' */
+  TA_build_point_hints(recorder, hints);
+
+  if (TA_hints_record_is_different(*sweep->point_hints_records,
+                                   *sweep->num_point_hints_records,
+                                   ins_buf, recorder->hints_record.buf))
+  {
+    *is_different = 1;
+
+    if (add)
+    {
+#ifdef DEBUGGING
+      if (font->debug)
+      {
+        if (!have_dumps)
+        {
+          int num_chars, i;
+
+
+          num_chars = fprintf(stderr, "size %d\n", size);
+          for (i = 0; i < num_chars - 1; i++)
+            putc('-', stderr);
+          fprintf(stderr, "\n\n");
+
+          ta_glyph_hints_dump_edges(hints);
+          ta_glyph_hints_dump_segments(hints);
+          ta_glyph_hints_dump_points(hints);
+        }
+
+        fprintf(stderr, "point hints record:\n");
+        if (ins_buf == recorder->hints_record.buf)
+          fprintf(stderr, "  (none)");
+        else
+        {
+          fprintf(stderr, "  ");
+          for (p = ins_buf; p < recorder->hints_record.buf; p += 2)
+            fprintf(stderr, " %2d", *p * 256 + *(p + 1));
+        }
+        fprintf(stderr, "\n\n");
+      }
+#endif
+
+      error = TA_add_hints_record(sweep->point_hints_records,
+                                  sweep->num_point_hints_records,
+                                  ins_buf, recorder->hints_record);
+      if (error)
+        return error;
+    }
+  }
+
+  if (ppem_start)
+    ta_trace_span(font->trace, "ppem", "ppem", ppem_start,
+                  "\"glyph\": %ld, \"ppem\": %u%s",
+                  sweep->idx, size, add ? "" : ", \"probe\": true");
+
+  return FT_Err_Ok;
+}
+
+
+/*
+ * Return the smallest PPEM value where all standard stems of the glyph's
+ * style are at least three pixels wide (narrower stems get special
+ * treatment in `ta_latin_compute_stem_width') and all blue zones with a
+ * non-zero height are taller than 3/4 pixels (which deactivates them in
+ * `ta_latin_metrics_scale_dim').  Above this value, the hints records
+ * usually change only sporadically.  Zero means that no such value
+ * exists.
+ */
+
+static FT_UInt
+TA_sweep_stable_size(FONT* font)
+{
+  TA_StyleMetrics metrics = font->loader->metrics;
+  TA_LatinMetrics latin_metrics;
+
+  FT_ULong upem;
+  FT_ULong stable_size = 0;
+  FT_Int dim;
+
+
+  if (!metrics
+      || metrics->style_class->writing_system != TA_WRITING_SYSTEM_LATIN)
+    return 0;
+
+  latin_metrics = (TA_LatinMetrics)metrics;
+  upem = latin_metrics->units_per_em;
+
+  for (dim = 0; dim < TA_DIMENSION_MAX; dim++)
+  {
+    TA_LatinAxis axis = &latin_metrics->axis[dim];
+    FT_UInt nn;
+
+
+    for (nn = 0; nn < axis->width_count; nn++)
+    {
+      FT_Pos width = axis->widths[nn].org;
+
+
+      if (width > 0 && 3 * upem / (FT_ULong)width + 1 > stable_size)
+        stable_size = 3 * upem / (FT_ULong)width + 1;
+    }
+
+    if (dim == TA_DIMENSION_HORZ)
+      continue;
+
+    for (nn = 0; nn < axis->blue_count; nn++)
+    {
+      TA_LatinBlue blue = &axis->blues[nn];
+      FT_Pos height = blue->ref.org - blue->shoot.org;
+
+
+      if (height < 0)
+        height = -height;
+      if (height > 0 && 3 * upem / (4 * (FT_ULong)height) + 1 > stable_size)
+        stable_size = 3 * upem / (4 * (FT_ULong)height) + 1;
+    }
+  }
+
+  return (stable_size > 0xFFFF) ? 0 : (FT_UInt)stable_size;
+}
+
+
 FT_Error
 TA_sfnt_build_glyph_instructions(SFNT* sfnt,
                                  FONT* font,
-                                 FT_Long idx)
+                                 FT_Long idx,
+                                 Glyph_Stats* stats)
 {
   FT_Face face = sfnt->face;
   FT_Error error;
@@ -2639,7 +2902,6 @@ TA_sfnt_build_glyph_instructions(SFNT* sfnt,
   FT_Byte* ins_buf;
   FT_UInt ins_len;
   FT_Byte* bufp;
-  FT_Byte* p;
 
   SFNT_Table* glyf_table = &font->tables[sfnt->glyf_idx];
   glyf_Data* data = (glyf_Data*)glyf_table->data;
@@ -2651,6 +2913,7 @@ TA_sfnt_build_glyph_instructions(SFNT* sfnt,
   FT_Bool use_gstyle_data = 1;
 
   TA_GlyphHints hints;
+  FT_Int dim;
 
   FT_UInt num_action_hints_records = 0;
   FT_UInt num_point_hints_records = 0;
@@ -2661,15 +2924,16 @@ TA_sfnt_build_glyph_instructions(SFNT* sfnt,
   FT_UShort num_stack_elements;
   FT_Bool optimize = 0;
 
+  Sweep sweep;
+
   FT_Int32 load_flags;
-  FT_UInt size;
 
   /* we store only three positions, but it simplifies the algorithm in */
   /* `TA_optimize_push' if we have one additional element */
   FT_Byte* pos[4];
 
 #ifdef TA_DEBUG
-  int _ta_debug_save;
+  int _ta_debug_save = 0;
 #endif
 
 
@@ -2703,21 +2967,29 @@ TA_sfnt_build_glyph_instructions(SFNT* sfnt,
 
 #ifdef TA_DEBUG
   /* temporarily disable some debugging output */
-  /* to avoid getting the information twice */
-  _ta_debug_save = _ta_debug;
-  _ta_debug = 0;
+  /* to avoid getting the information twice; */
+  /* we don't touch the global flag otherwise */
+  /* since subfonts might be hinted in parallel */
+  if (font->debug)
+  {
+    _ta_debug_save = _ta_debug;
+    _ta_debug = 0;
+  }
 #endif
 
   ta_loader_register_hints_recorder(font->loader, NULL, NULL);
   error = ta_loader_load_glyph(font, face, (FT_UInt)idx, load_flags);
 
 #ifdef TA_DEBUG
-  _ta_debug = _ta_debug_save;
+  if (font->debug)
+    _ta_debug = _ta_debug_save;
 #endif
 
   if (error)
     return error;
 
+  stats->style = gstyles[idx] & TA_STYLE_MASK;
+
   /* do nothing if we have an empty glyph */
   if (!(font->loader->gloader->current.num_subglyphs
         || face->glyph->outline.n_contours))
@@ -2725,6 +2997,15 @@ TA_sfnt_build_glyph_instructions(SFNT* sfnt,
 
   hints = &font->loader->hints;
 
+  stats->num_points = hints->num_points;
+  for (dim = 0; dim < TA_DIMENSION_MAX; dim++)
+  {
+    stats->num_segments += (FT_UInt)hints->axis[dim].num_segments;
+    stats->num_edges += (FT_UInt)hints->axis[dim].num_edges;
+  }
+
+  TA_PROF_SET_GLYPH_INFO(gstyles[idx] & TA_STYLE_MASK, hints->num_points);
+
   /*
    * We allocate a buffer which is certainly large enough
    * to hold all of the created bytecode instructions;
@@ -2831,7 +3112,11 @@ TA_sfnt_build_glyph_instructions(SFNT* sfnt,
 
   /* we temporarily use `ins_buf' to record the current glyph hints */
   ta_loader_register_hints_recorder(font->loader,
+#ifdef TA_PROFILE
+                                    TA_hints_recorder_profiled,
+#else
                                     TA_hints_recorder,
+#endif
                                     (void*)&recorder);
 
   /*
@@ -2840,124 +3125,32 @@ TA_sfnt_build_glyph_instructions(SFNT* sfnt,
    * become smaller for larger PPEM values.  For efficiency, we skip
    * non-edge one-point segments, and `TA_get_segment_index' would return
    * wrong indices otherwise.
+   *
+   * The glyph's unscaled outline is the same for all sizes; we thus let
+   * the loader cache it instead of decoding the glyph again and again.
    */
-  for (size = font->hinting_range_min;
-       size <= font->hinting_range_max;
-       size++)
-  {
-#ifdef DEBUGGING
-    int have_dumps = 0;
-#endif
-
-
-    TA_rewind_recorder(&recorder, ins_buf, size);
-
-    error = FT_Set_Pixel_Sizes(face, size, size);
-    if (error)
-      goto Err;
-
-#ifdef DEBUGGING
-    if (font->debug)
-    {
-      int num_chars, i;
-
-
-      num_chars = fprintf(stderr, "size %d\n", size);
-      for (i = 0; i < num_chars - 1; i++)
-        putc('-', stderr);
-      fprintf(stderr, "\n\n");
-    }
-#endif
-
-    /* calling `ta_loader_load_glyph' uses the */
-    /* `TA_hints_recorder' function as a callback, */
-    /* modifying `hints_record' */
-    error = ta_loader_load_glyph(font, face, (FT_UInt)idx, load_flags);
-    if (error)
-      goto Err;
-
-    if (TA_hints_record_is_different(action_hints_records,
-                                     num_action_hints_records,
-                                     ins_buf, recorder.hints_record.buf))
-    {
-#ifdef DEBUGGING
-      if (font->debug)
-      {
-        have_dumps = 1;
-
-        ta_glyph_hints_dump_edges((TA_GlyphHints)_ta_debug_hints);
-        ta_glyph_hints_dump_segments((TA_GlyphHints)_ta_debug_hints);
-        ta_glyph_hints_dump_points((TA_GlyphHints)_ta_debug_hints);
-
-        fprintf(stderr, "action hints record:\n");
-        if (ins_buf == recorder.hints_record.buf)
-          fprintf(stderr, "  (none)");
-        else
-        {
-          fprintf(stderr, "  ");
-          for (p = ins_buf; p < recorder.hints_record.buf; p += 2)
-            fprintf(stderr, " %2d", *p * 256 + *(p + 1));
-        }
-        fprintf(stderr, "\n");
-      }
-#endif
-
-      error = TA_add_hints_record(&action_hints_records,
-                                  &num_action_hints_records,
-                                  ins_buf, recorder.hints_record);
-      if (error)
-        goto Err;
-    }
-
-    /* now handle point records */
-
-    TA_reset_recorder(&recorder, ins_buf);
-
-    /* use the point hints data collected in `TA_hints_recorder' */
-    TA_build_point_hints(&recorder, hints);
-
-    if (TA_hints_record_is_different(point_hints_records,
-                                     num_point_hints_records,
-                                     ins_buf, recorder.hints_record.buf))
-    {
-#ifdef DEBUGGING
-      if (font->debug)
-      {
-        if (!have_dumps)
-        {
-          int num_chars, i;
-
-
-          num_chars = fprintf(stderr, "size %d\n", size);
-          for (i = 0; i < num_chars - 1; i++)
-            putc('-', stderr);
-          fprintf(stderr, "\n\n");
-
-          ta_glyph_hints_dump_edges((TA_GlyphHints)_ta_debug_hints);
-          ta_glyph_hints_dump_segments((TA_GlyphHints)_ta_debug_hints);
-          ta_glyph_hints_dump_points((TA_GlyphHints)_ta_debug_hints);
-        }
-
-        fprintf(stderr, "point hints record:\n");
-        if (ins_buf == recorder.hints_record.buf)
-          fprintf(stderr, "  (none)");
-        else
-        {
-          fprintf(stderr, "  ");
-          for (p = ins_buf; p < recorder.hints_record.buf; p += 2)
-            fprintf(stderr, " %2d", *p * 256 + *(p + 1));
-        }
-        fprintf(stderr, "\n\n");
-      }
-#endif
+  ta_loader_cache_glyph(font->loader, 1);
+
+  sweep.font = font;
+  sweep.face = face;
+  sweep.idx = idx;
+  sweep.load_flags = load_flags;
+  sweep.recorder = &recorder;
+  sweep.ins_buf = ins_buf;
+  sweep.action_hints_records = &action_hints_records;
+  sweep.num_action_hints_records = &num_action_hints_records;
+  sweep.point_hints_records = &point_hints_records;
+  sweep.num_point_hints_records = &num_point_hints_records;
+
+  error = TA_sweep(font->hinting_range_min,
+                   font->hinting_range_max,
+                   font->adaptive_sweep ? TA_sweep_stable_size(font) : 0,
+                   TA_sweep_size,
+                   &sweep);
+  if (error)
+    goto Err;
 
-      error = TA_add_hints_record(&point_hints_records,
-                                  &num_point_hints_records,
-                                  ins_buf, recorder.hints_record);
-      if (error)
-        goto Err;
-    }
-  }
+  ta_loader_cache_glyph(font->loader, 0);
 
   if (num_action_hints_records == 1 && !action_hints_records[0].num_actions)
   {
@@ -2981,6 +3174,7 @@ TA_sfnt_build_glyph_instructions(SFNT* sfnt,
 
   /* store the hints records and handle stack depth */
   pos[0] = ins_buf;
+  TA_PROF_ENTER(TA_PROF_EMIT);
   bufp = TA_emit_hints_records(&recorder,
                                point_hints_records,
                                num_point_hints_records,
@@ -2996,6 +3190,7 @@ TA_sfnt_build_glyph_instructions(SFNT* sfnt,
                                num_action_hints_records,
                                bufp,
                                optimize);
+  TA_PROF_LEAVE(TA_PROF_EMIT);
 
   recorder.num_stack_elements += num_stack_elements;
 
@@ -3011,6 +3206,9 @@ TA_sfnt_build_glyph_instructions(SFNT* sfnt,
     bufp = TA_optimize_push(ins_buf, pos);
 
 Done:
+  stats->num_action_hints_records = num_action_hints_records;
+  stats->num_point_hints_records = num_point_hints_records;
+
   TA_free_hints_records(action_hints_records, num_action_hints_records);
   TA_free_hints_records(point_hints_records, num_point_hints_records);
   TA_free_recorder(&recorder);
@@ -3072,6 +3270,8 @@ Done1:
   return FT_Err_Ok;
 
 Err:
+  ta_loader_cache_glyph(font->loader, 0);
+
   TA_free_hints_records(action_hints_records, num_action_hints_records);
   TA_free_hints_records(point_hints_records, num_point_hints_records);
   TA_free_recorder(&recorder);
@@ -345,6 +345,362 @@ TA_control_show(FONT* font)
 }
 
 
+/* compiled control instructions use 32bit big-endian values only */
+
+static FT_Byte*
+control_binary_put(FT_Byte* p,
+                   FT_ULong val)
+{
+  *(p++) = (FT_Byte)((val >> 24) & 0xFF);
+  *(p++) = (FT_Byte)((val >> 16) & 0xFF);
+  *(p++) = (FT_Byte)((val >> 8) & 0xFF);
+  *(p++) = (FT_Byte)(val & 0xFF);
+
+  return p;
+}
+
+
+static FT_Byte*
+control_binary_put_ranges(FT_Byte* p,
+                          number_range* range)
+{
+  FT_ULong num_ranges = 0;
+  number_range* r;
+
+
+  for (r = range; r; r = r->next)
+    num_ranges++;
+
+  p = control_binary_put(p, num_ranges);
+  for (r = range; r; r = r->next)
+  {
+    p = control_binary_put(p, (FT_ULong)r->start);
+    p = control_binary_put(p, (FT_ULong)r->end);
+    p = control_binary_put(p, (FT_ULong)r->base);
+    p = control_binary_put(p, (FT_ULong)r->wrap);
+  }
+
+  return p;
+}
+
+
+int
+TA_control_is_binary(const char* buf,
+                     size_t len)
+{
+  const FT_Byte* p = (const FT_Byte*)buf;
+
+
+  if (!buf || len < 8)
+    return 0;
+
+  return NEXT_ULONG(p) == CONTROL_BINARY_TAG;
+}
+
+
+TA_Error
+TA_control_build_binary(FONT* font,
+                        FT_Byte** buf,
+                        FT_ULong* len)
+{
+  Control* control;
+  FT_ULong size;
+  FT_Long i;
+
+  FT_Byte* p;
+
+
+  /* compute buffer size */
+  size = 4 * (4 + (FT_ULong)font->num_sfnts);
+
+  for (control = font->control; control; control = control->next)
+  {
+    number_range* r;
+
+
+    size += 4 * (6 + 2);
+    for (r = control->points; r; r = r->next)
+      size += 4 * 4;
+    for (r = control->ppems; r; r = r->next)
+      size += 4 * 4;
+  }
+
+  *buf = (FT_Byte*)malloc(size);
+  if (!*buf)
+    return FT_Err_Out_Of_Memory;
+
+  p = *buf;
+
+  p = control_binary_put(p, CONTROL_BINARY_TAG);
+  p = control_binary_put(p, CONTROL_BINARY_VERSION);
+  p = control_binary_put(p, (FT_ULong)font->num_sfnts);
+  for (i = 0; i < font->num_sfnts; i++)
+    p = control_binary_put(p, (FT_ULong)font->sfnts[i].face->num_glyphs);
+
+  p = control_binary_put(p, 0); /* `num_controls', set below */
+
+  i = 0;
+  for (control = font->control; control; control = control->next)
+  {
+    p = control_binary_put(p, (FT_ULong)control->type);
+    p = control_binary_put(p, (FT_ULong)control->font_idx);
+    p = control_binary_put(p, (FT_ULong)control->glyph_idx);
+    p = control_binary_put(p, (FT_ULong)control->x_shift);
+    p = control_binary_put(p, (FT_ULong)control->y_shift);
+    p = control_binary_put(p, (FT_ULong)control->line_number);
+
+    p = control_binary_put_ranges(p, control->points);
+    p = control_binary_put_ranges(p, control->ppems);
+
+    i++;
+  }
+
+  control_binary_put(*buf + 4 * (3 + (FT_ULong)font->num_sfnts),
+                     (FT_ULong)i);
+
+  *len = size;
+
+  return TA_Err_Ok;
+}
+
+
+/* read `num' 32bit values from `*pp', checking buffer limits */
+#define CONTROL_BINARY_CHECK(num) \
+          do \
+          { \
+            if ((size_t)(endp - p) < 4 * (size_t)(num)) \
+              goto Invalid; \
+          } while (0)
+#define CONTROL_BINARY_GET() \
+          ((FT_Int32)NEXT_ULONG(p))
+
+
+static TA_Error
+control_binary_get_ranges(FT_Byte** pp,
+                          FT_Byte* endp,
+                          number_range** range)
+{
+  FT_Byte* p = *pp;
+  number_range* list = NULL;
+  number_range** lastp = &list;
+  FT_ULong num_ranges;
+
+
+  CONTROL_BINARY_CHECK(1);
+  num_ranges = (FT_ULong)CONTROL_BINARY_GET();
+  if (num_ranges > (FT_ULong)(endp - p) / 16)
+    goto Invalid;
+
+  while (num_ranges--)
+  {
+    number_range* r;
+
+
+    r = (number_range*)malloc(sizeof (number_range));
+    if (!r)
+    {
+      number_set_free(list);
+      return TA_Err_Control_Allocation_Error;
+    }
+
+    r->start = CONTROL_BINARY_GET();
+    r->end = CONTROL_BINARY_GET();
+    r->base = CONTROL_BINARY_GET();
+    r->wrap = CONTROL_BINARY_GET();
+    r->next = NULL;
+
+    *lastp = r;
+    lastp = &r->next;
+
+    if (r->start < 0 || r->end < 0 || r->base < 0 || r->wrap < 0)
+    {
+      number_set_free(list);
+      goto Invalid;
+    }
+  }
+
+  *pp = p;
+  *range = list;
+
+  return TA_Err_Ok;
+
+Invalid:
+  return TA_Err_Control_Invalid_Binary;
+}
+
+
+/* check that `set' is a list of normal ranges within [min;max] */
+/* holding at most `max_elems' elements (if not negative) */
+
+static TA_Error
+control_binary_check_set(number_range* set,
+                         int min,
+                         int max,
+                         long max_elems)
+{
+  long num_elems = 0;
+
+
+  for (; set; set = set->next)
+  {
+    if (set->base != set->wrap
+        || set->start > set->end
+        || set->start < min
+        || set->end > max)
+      return TA_Err_Control_Invalid_Binary;
+
+    num_elems += (long)set->end - set->start + 1;
+    if (max_elems >= 0 && num_elems > max_elems)
+      return TA_Err_Control_Too_Much_Widths;
+  }
+
+  return TA_Err_Ok;
+}
+
+
+/* parse compiled control instructions in `font->control_buf' */
+
+static TA_Error
+control_parse_binary(FONT* font)
+{
+  TA_Error error = TA_Err_Control_Invalid_Binary;
+
+  FT_Byte* p = (FT_Byte*)font->control_buf;
+  FT_Byte* endp = p + font->control_len;
+
+  Control* list = NULL;
+  FT_ULong num_controls;
+  FT_Long i;
+
+
+  CONTROL_BINARY_CHECK(3);
+
+  (void)CONTROL_BINARY_GET(); /* tag */
+  if (CONTROL_BINARY_GET() != CONTROL_BINARY_VERSION)
+    goto Invalid;
+
+  if (CONTROL_BINARY_GET() != font->num_sfnts)
+    goto Mismatch;
+
+  CONTROL_BINARY_CHECK(font->num_sfnts + 1);
+  for (i = 0; i < font->num_sfnts; i++)
+    if (CONTROL_BINARY_GET() != font->sfnts[i].face->num_glyphs)
+      goto Mismatch;
+
+  num_controls = (FT_ULong)CONTROL_BINARY_GET();
+
+  while (num_controls--)
+  {
+    Control* control;
+
+
+    CONTROL_BINARY_CHECK(6);
+
+    control = (Control*)calloc(1, sizeof (Control));
+    if (!control)
+    {
+      error = TA_Err_Control_Allocation_Error;
+      goto Fail;
+    }
+    list = TA_control_prepend(list, control);
+
+    control->type = (Control_Type)CONTROL_BINARY_GET();
+    control->font_idx = CONTROL_BINARY_GET();
+    control->glyph_idx = CONTROL_BINARY_GET();
+    control->x_shift = CONTROL_BINARY_GET();
+    control->y_shift = CONTROL_BINARY_GET();
+    control->line_number = CONTROL_BINARY_GET();
+
+    error = control_binary_get_ranges(&p, endp, &control->points);
+    if (error)
+      goto Fail;
+    error = control_binary_get_ranges(&p, endp, &control->ppems);
+    if (error)
+      goto Fail;
+
+    error = TA_Err_Control_Invalid_Binary;
+
+    if (control->type > Control_Script_Feature_Widths
+        || control->font_idx < 0
+        || control->font_idx >= font->num_sfnts)
+      goto Invalid;
+
+    /* apply the same limits as the parser for the textual form */
+    switch (control->type)
+    {
+    case Control_Script_Feature_Glyphs:
+      if (control->glyph_idx < 0 || control->glyph_idx >= TA_STYLE_MAX)
+        goto Invalid;
+      break;
+
+    case Control_Script_Feature_Widths:
+      if (control->glyph_idx >= TA_STYLE_MAX
+          || -control->glyph_idx > TA_COVERAGE_DEFAULT)
+        goto Invalid;
+
+      /* `points' holds the width set */
+      error = control_binary_check_set(control->points,
+                                       1, 65535, TA_LATIN_MAX_WIDTHS);
+      if (error)
+        goto Fail;
+      break;
+
+    default:
+      if (control->glyph_idx < 0
+          || control->glyph_idx
+               >= font->sfnts[control->font_idx].face->num_glyphs)
+        goto Mismatch;
+
+      if (control->type == Control_Delta_before_IUP
+          || control->type == Control_Delta_after_IUP)
+      {
+        int shift_max = (int)(CONTROL_DELTA_SHIFT_MAX * CONTROL_DELTA_FACTOR);
+
+
+        if (control->x_shift < -shift_max || control->x_shift > shift_max
+            || control->y_shift < -shift_max || control->y_shift > shift_max)
+          goto Invalid;
+
+        error = control_binary_check_set(control->ppems,
+                                         CONTROL_DELTA_PPEM_MIN,
+                                         CONTROL_DELTA_PPEM_MAX,
+                                         -1);
+        if (error)
+          goto Fail;
+      }
+      else if (control->x_shift < SHRT_MIN || control->x_shift > SHRT_MAX
+               || control->y_shift < SHRT_MIN || control->y_shift > SHRT_MAX)
+        goto Invalid;
+      break;
+    }
+
+    error = TA_Err_Control_Invalid_Binary;
+  }
+
+  if (p != endp)
+    goto Invalid;
+
+  font->control = TA_control_reverse(list);
+
+  return TA_Err_Ok;
+
+Mismatch:
+  error = TA_Err_Control_Binary_Mismatch;
+  goto Fail;
+
+Invalid:
+  error = TA_Err_Control_Invalid_Binary;
+
+Fail:
+  TA_control_free(list);
+
+  return error;
+}
+
+#undef CONTROL_BINARY_CHECK
+#undef CONTROL_BINARY_GET
+
+
 /* Parse control instructions in `font->control_buf'. */
 
 TA_Error
@@ -366,6 +722,22 @@ TA_control_parse_buffer(FONT* font,
     return TA_Err_Ok;
   }
 
+  if (TA_control_is_binary(font->control_buf, font->control_len))
+  {
+    context.error = control_parse_binary(font);
+    if (context.error)
+    {
+      font->control = NULL;
+
+      *errlinenum_p = 0;
+      *errline_p = NULL;
+      *errpos_p = NULL;
+      *error_string_p = strdup(TA_get_error_message(context.error));
+    }
+
+    return context.error;
+  }
+
   TA_control_scanner_init(&context, font);
   if (context.error)
     goto Fail;
@@ -526,7 +898,7 @@ TA_control_set_stem_widths(TA_LatinMetrics metrics,
                            FONT* font)
 {
   Control* control = font->control;
-  FT_Face face = font->loader->face;
+  FT_Face face = metrics->root.globals->face;
   TA_WidthRec* widths = metrics->axis[TA_DIMENSION_VERT].widths;
 
 
@@ -554,7 +926,7 @@ TA_control_set_stem_widths(TA_LatinMetrics metrics,
     width = number_set_get_first(&width_iter);
 
     i = 0;
-    while (width >= 0)
+    while (width >= 0 && i < TA_LATIN_MAX_WIDTHS)
     {
       widths[i++].org = width;
       width = number_set_get_next(&width_iter);
@@ -820,6 +1192,38 @@ TA_control_get_next(FONT* font)
 }
 
 
+void
+TA_control_seek(FONT* font,
+                long font_idx)
+{
+  control_data* control_data_head = (control_data*)font->control_data_head;
+  Node* node;
+  Node* found = NULL;
+
+
+  if (!control_data_head)
+  {
+    font->control_data_cur = NULL;
+    return;
+  }
+
+  /* find the leftmost node with a large enough font index */
+  node = LLRB_ROOT(control_data_head);
+  while (node)
+  {
+    if (node->ctrl.font_idx >= font_idx)
+    {
+      found = node;
+      node = LLRB_LEFT(node, entry);
+    }
+    else
+      node = LLRB_RIGHT(node, entry);
+  }
+
+  font->control_data_cur = found;
+}
+
+
 const Ctrl*
 TA_control_get_ctrl(FONT* font)
 {
@@ -51,6 +51,37 @@ extern "C" {
 #define CONTROL_DELTA_PPEM_MAX 53
 
 
+/*
+ * Compiled control instructions.
+ *
+ * Instead of a text buffer, `TA_control_parse_buffer' also accepts a
+ * binary representation of already parsed control instructions (as created
+ * by `TA_control_build_binary'); this avoids the overhead of the lexer and
+ * the parser, in particular the lookup of glyph names.  All values are
+ * stored as 32bit big-endian integers in the following order.
+ *
+ *   tag           CONTROL_BINARY_TAG
+ *   version       CONTROL_BINARY_VERSION
+ *   num_sfnts     number of subfonts
+ *   num_glyphs    number of glyphs (`num_sfnts' times)
+ *   num_controls  number of `Control' objects
+ *
+ * Then follow `num_controls' records, one for each `Control' object.
+ *
+ *   type, font_idx, glyph_idx, x_shift, y_shift, line_number
+ *   num_points    number of `number_range' objects
+ *   points        start, end, base, wrap (`num_points' times)
+ *   num_ppems     number of `number_range' objects
+ *   ppems         start, end, base, wrap (`num_ppems' times)
+ *
+ * Since glyph names are already resolved to glyph indices, the number of
+ * subfonts and glyphs must match the font to be processed.
+ */
+
+#define CONTROL_BINARY_TAG FT_MAKE_TAG('T', 'A', 'C', 'B')
+#define CONTROL_BINARY_VERSION 1
+
+
 /*
  * The control type.
  */
@@ -254,6 +285,11 @@ TA_control_scanner_done(Control_Context* context);
  * The returned error codes are 0 (TA_Err_Ok) or in the range 0x200-0x2FF;
  * see `ttfautohint-errors.h' for all possible values.
  *
+ * If the buffer starts with CONTROL_BINARY_TAG, it is handled as compiled
+ * control instructions; the returned error codes are then either 0
+ * (TA_Err_Ok), `TA_Err_Control_Invalid_Binary', or
+ * `TA_Err_Control_Binary_Mismatch'.
+ *
  * `TA_control_parse_buffer' stores the parsed result in `font->control', to
  * be freed with `TA_control_free' after use.  If there is no control
  * instructions data (for example, an empty string or whitespace only)
@@ -276,6 +312,28 @@ TA_control_parse_buffer(FONT* font,
                         char** errpos_p);
 
 
+/*
+ * Return 1 if `buf' (with length `len') holds compiled control
+ * instructions, 0 otherwise.
+ */
+
+int
+TA_control_is_binary(const char* buf,
+                     size_t len);
+
+
+/*
+ * Build a binary representation of `font->control', to be read by
+ * `TA_control_parse_buffer'.  After use, `*buf' should be deallocated with
+ * a call to `free'.
+ */
+
+TA_Error
+TA_control_build_binary(FONT* font,
+                        FT_Byte** buf,
+                        FT_ULong* len);
+
+
 /*
  * Apply coverage data from the control instructions file.
  */
@@ -338,6 +396,17 @@ void
 TA_control_get_next(FONT* font);
 
 
+/*
+ * Set `font->control_data_cur' to the first control instruction with a
+ * font index not smaller than `font_idx'.  This is needed if subfonts
+ * are not processed in sequential order.
+ */
+
+void
+TA_control_seek(FONT* font,
+                long font_idx);
+
+
 /*
  * Access control instruction.  Return NULL if there is no more data.
  */
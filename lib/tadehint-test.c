@@ -0,0 +1,223 @@
+/* tadehint-test.c */
+
+/*
+ * Copyright (C) 2022 by Werner Lemberg.
+ *
+ * This file is part of the ttfautohint library, and may only be used,
+ * modified, and distributed under the terms given in `COPYING'.  By
+ * continuing to use, modify, or distribute this file you indicate that you
+ * have read `COPYING' and understand and accept it fully.
+ *
+ * The file `COPYING' mentioned in the previous paragraph is distributed
+ * with the ttfautohint library.
+ */
+
+/*
+ * Compile with
+ *
+ *   $(CC) $(CFLAGS) $(FREETYPE_CFLAGS) \
+ *         -I.. -I. \
+ *         -o tadehint-test tadehint-test.c \
+ *         .libs/libttfautohint.a $(FREETYPE_LIBS) $(HARFBUZZ_LIBS)
+ *
+ * after building the library, then call
+ *
+ *   ./tadehint-test FONT
+ *
+ * with a TrueType font (not a collection), for example `DejaVuSans.ttf'.
+ * The program dehints FONT and checks that the number of glyphs doesn't
+ * change.  It then dehints two damaged copies of FONT, one with a
+ * truncated `head' table and one with a `loca' table that has fewer
+ * entries than the number of glyphs given in the `maxp' table; both must
+ * be rejected.  Run it with a memory checker like `valgrind' to catch
+ * out-of-bounds accesses.
+ *
+ * The program aborts with an assertion message in case of an error,
+ * otherwise it produces no output.
+ */
+
+
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+#include <ttfautohint.h>
+
+
+static char*
+read_file(const char* name,
+          size_t* len)
+{
+  FILE* f;
+  char* buf;
+  long size;
+
+
+  f = fopen(name, "rb");
+  assert(f);
+
+  assert(!fseek(f, 0, SEEK_END));
+  size = ftell(f);
+  assert(size > 0);
+  rewind(f);
+
+  buf = (char*)malloc((size_t)size);
+  assert(buf);
+  assert(fread(buf, 1, (size_t)size, f) == (size_t)size);
+
+  fclose(f);
+
+  *len = (size_t)size;
+  return buf;
+}
+
+
+/* return the table directory entry of table `tag' in `buf' */
+
+static unsigned char*
+find_table(char* buf,
+           size_t len,
+           const char* tag)
+{
+  unsigned char* p = (unsigned char*)buf;
+  unsigned int num_tables;
+  unsigned int i;
+
+
+  assert(len >= 12);
+  num_tables = (p[4] << 8) | p[5];
+  assert(len >= 12 + 16 * (size_t)num_tables);
+
+  for (i = 0; i < num_tables; i++)
+  {
+    unsigned char* record = p + 12 + 16 * i;
+
+
+    if (!memcmp(record, tag, 4))
+      return record;
+  }
+
+  assert(0);
+  return NULL;
+}
+
+
+static unsigned long
+get_ulong(const unsigned char* p)
+{
+  return ((unsigned long)p[0] << 24) | ((unsigned long)p[1] << 16)
+         | ((unsigned long)p[2] << 8) | p[3];
+}
+
+
+static void
+set_ulong(unsigned char* p,
+          unsigned long value)
+{
+  p[0] = (unsigned char)(value >> 24);
+  p[1] = (unsigned char)(value >> 16);
+  p[2] = (unsigned char)(value >> 8);
+  p[3] = (unsigned char)value;
+}
+
+
+static TA_Error
+dehint(const char* in_buf,
+       size_t in_len,
+       char** out_bufp,
+       size_t* out_lenp)
+{
+  return TTF_autohint("in-buffer, in-buffer-len,"
+                      " out-buffer, out-buffer-len,"
+                      " dehint",
+                      in_buf, in_len,
+                      out_bufp, out_lenp,
+                      1);
+}
+
+
+int
+main(int argc,
+     char** argv)
+{
+  FT_Library library;
+  FT_Face face;
+
+  char* in_buf;
+  size_t in_len;
+  char* buf;
+  char* out_buf;
+  size_t out_len;
+
+  TA_Error error;
+
+  unsigned char* record;
+  unsigned char* head;
+  unsigned char* maxp;
+  unsigned long loca_len;
+  unsigned int num_glyphs;
+
+
+  if (argc != 2)
+  {
+    fprintf(stderr, "usage: %s FONT\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  in_buf = read_file(argv[1], &in_len);
+  buf = (char*)malloc(in_len);
+  assert(buf);
+
+  /* an intact font */
+  error = dehint(in_buf, in_len, &out_buf, &out_len);
+  assert(!error);
+
+  assert(!FT_Init_FreeType(&library));
+  assert(!FT_New_Memory_Face(library,
+                             (const FT_Byte*)out_buf,
+                             (FT_Long)out_len,
+                             0,
+                             &face));
+
+  record = find_table(in_buf, in_len, "maxp");
+  maxp = (unsigned char*)in_buf + get_ulong(record + 8);
+  num_glyphs = (maxp[4] << 8) | maxp[5];
+  assert(face->num_glyphs == (FT_Long)num_glyphs);
+
+  FT_Done_Face(face);
+  FT_Done_FreeType(library);
+  free(out_buf);
+
+  /* a `head' table that ends before the `indexToLocFormat' field */
+  memcpy(buf, in_buf, in_len);
+  record = find_table(buf, in_len, "head");
+  set_ulong(record + 12, 36);
+
+  error = dehint(buf, in_len, &out_buf, &out_len);
+  assert(error == FT_Err_Invalid_Table);
+
+  /* a `loca' table with one entry less than necessary */
+  memcpy(buf, in_buf, in_len);
+  record = find_table(buf, in_len, "head");
+  head = (unsigned char*)buf + get_ulong(record + 8);
+  record = find_table(buf, in_len, "loca");
+  loca_len = get_ulong(record + 12);
+  assert(loca_len == (num_glyphs + 1) * (head[51] ? 4U : 2U));
+  set_ulong(record + 12, loca_len - (head[51] ? 4 : 2));
+
+  error = dehint(buf, in_len, &out_buf, &out_len);
+  assert(error == FT_Err_Invalid_Table);
+
+  free(buf);
+  free(in_buf);
+
+  return EXIT_SUCCESS;
+}
+
+/* end of tadehint-test.c */
@@ -0,0 +1,606 @@
+/* tadehint.c */
+
+/*
+ * Copyright (C) 2011-2022 by Werner Lemberg.
+ *
+ * This file is part of the ttfautohint library, and may only be used,
+ * modified, and distributed under the terms given in `COPYING'.  By
+ * continuing to use, modify, or distribute this file you indicate that you
+ * have read `COPYING' and understand and accept it fully.
+ *
+ * The file `COPYING' mentioned in the previous paragraph is distributed
+ * with the ttfautohint library.
+ */
+
+
+/*
+ * Removing all hints from a font is a pure byte transformation, so we
+ * neither need FreeType faces nor the split of `glyf' tables into glyph
+ * records: `glyf' and `loca' get rewritten in a single pass.  The result
+ * is identical to the output of the generic code path.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+
+#include "ta.h"
+#include "tasimd.h"
+
+
+static FT_Error
+TA_font_count_sfnts(FONT* font)
+{
+  FT_Byte* p = font->in_buf;
+  FT_ULong num_sfnts;
+
+
+  if (font->in_len < 12)
+    return TA_Err_Invalid_Font_Type;
+
+  if (NEXT_ULONG(p) == TTAG_ttcf)
+  {
+    p += 4; /* skip version */
+    num_sfnts = NEXT_ULONG(p);
+
+    if (!num_sfnts
+        || num_sfnts > (font->in_len - 12) / 4)
+      return FT_Err_Invalid_Table;
+  }
+  else
+    num_sfnts = 1;
+
+  font->sfnts = (SFNT*)calloc(1, num_sfnts * sizeof (SFNT));
+  if (!font->sfnts)
+    return FT_Err_Out_Of_Memory;
+  font->num_sfnts = (FT_Long)num_sfnts;
+
+  return TA_Err_Ok;
+}
+
+
+/* copy a simple glyph record without its instructions to `q'; */
+/* this follows `TA_glyph_parse_simple' */
+
+static FT_Error
+TA_glyph_dehint_simple(FT_Byte* buf,
+                       FT_ULong len,
+                       FT_Byte* q,
+                       FT_ULong* new_lenp)
+{
+  FT_UShort num_contours;
+  FT_UShort num_points;
+  FT_UShort num_ins;
+
+  FT_ULong off;
+  FT_ULong ins_offset;
+  FT_Byte* flags_start;
+
+  FT_ULong flags_size; /* size of the flags array */
+  FT_ULong xy_size; /* size of x and y coordinate arrays together */
+
+  FT_Byte* p;
+  FT_Byte* endp;
+
+  FT_UShort i;
+
+
+  p = buf;
+  endp = buf + len;
+
+  num_contours = (FT_UShort)((buf[0] << 8) + buf[1]);
+
+  /* use the last contour's end point to compute number of points */
+  off = 10 + ((FT_ULong)num_contours - 1) * 2;
+  if (off >= len - 1)
+    return FT_Err_Invalid_Table;
+
+  num_points = (FT_UShort)((buf[off] << 8) + buf[off + 1] + 1);
+
+  ins_offset = 10 + (FT_ULong)num_contours * 2;
+
+  p += ins_offset;
+
+  if (p + 2 > endp)
+    return FT_Err_Invalid_Table;
+
+  num_ins = NEXT_USHORT(p);
+  p += num_ins;
+
+  if (p > endp)
+    return FT_Err_Invalid_Table;
+
+  flags_start = p;
+  xy_size = 0;
+  i = 0;
+
+  while (i < num_points)
+  {
+    FT_Byte flags;
+    FT_Byte x_short;
+    FT_Byte y_short;
+    FT_Byte have_x;
+    FT_Byte have_y;
+    FT_UInt count;
+
+
+    if (p + 1 > endp)
+      return FT_Err_Invalid_Table;
+
+    flags = *(p++);
+
+    x_short = (flags & X_SHORT_VECTOR) ? 1 : 2;
+    y_short = (flags & Y_SHORT_VECTOR) ? 1 : 2;
+
+    have_x = ((flags & SAME_X) && !(flags & X_SHORT_VECTOR)) ? 0 : 1;
+    have_y = ((flags & SAME_Y) && !(flags & Y_SHORT_VECTOR)) ? 0 : 1;
+
+    count = 1;
+
+    if (flags & REPEAT)
+    {
+      if (p + 1 > endp)
+        return FT_Err_Invalid_Table;
+
+      count += *(p++);
+
+      if (i + count > num_points)
+        return FT_Err_Invalid_Table;
+    }
+
+    xy_size += count * x_short * have_x;
+    xy_size += count * y_short * have_y;
+
+    i += count;
+  }
+
+  if (p + xy_size > endp)
+    return FT_Err_Invalid_Table;
+
+  flags_size = (FT_ULong)(p - flags_start);
+
+  /* copy everything but the instructions */
+  memcpy(q, buf, ins_offset);
+  *new_lenp = ins_offset;
+
+  if (flags_size + xy_size)
+  {
+    q += ins_offset;
+    *(q++) = 0;
+    *(q++) = 0;
+    memcpy(q, flags_start, flags_size + xy_size);
+
+    *new_lenp += 2 + flags_size + xy_size;
+  }
+
+  return TA_Err_Ok;
+}
+
+
+/* copy a composite glyph record without its instructions to `q'; */
+/* this follows `TA_glyph_parse_composite' */
+
+static FT_Error
+TA_glyph_dehint_composite(FT_Byte* buf,
+                          FT_ULong len,
+                          FT_Byte* q,
+                          FT_ULong* new_lenp)
+{
+  FT_Byte* flags_q = NULL;
+  FT_UShort flags;
+
+  FT_Byte* p;
+  FT_Byte* endp;
+  FT_Byte* q_start = q;
+
+
+  p = buf;
+  endp = buf + len;
+
+  /* copy header */
+  memcpy(q, p, 10);
+  p += 10;
+  q += 10;
+
+  /* walk over component records */
+  do
+  {
+    FT_ULong args_len;
+    FT_ULong scale_len;
+
+
+    if (p + 4 > endp)
+      return FT_Err_Invalid_Table;
+
+    flags = (FT_UShort)((p[0] << 8) + p[1]);
+
+    args_len = (flags & ARGS_ARE_WORDS) ? 4 : 2;
+
+    if (flags & WE_HAVE_A_SCALE)
+      scale_len = 2;
+    else if (flags & WE_HAVE_AN_XY_SCALE)
+      scale_len = 4;
+    else if (flags & WE_HAVE_A_2X2)
+      scale_len = 8;
+    else
+      scale_len = 0;
+
+    if (p + 4 + args_len + scale_len > endp)
+      return FT_Err_Invalid_Table;
+
+    /* copy flags and component */
+    flags_q = q;
+    memcpy(q, p, 4);
+    p += 4;
+    q += 4;
+
+    if (flags & ARGS_ARE_XY_VALUES)
+    {
+      /* copy offsets */
+      memcpy(q, p, args_len);
+      p += args_len;
+      q += args_len;
+    }
+    else
+    {
+      /* point numbers use the smallest possible size */
+      FT_UShort arg1;
+      FT_UShort arg2;
+
+
+      if (flags & ARGS_ARE_WORDS)
+      {
+        arg1 = (FT_UShort)((p[0] << 8) + p[1]);
+        arg2 = (FT_UShort)((p[2] << 8) + p[3]);
+      }
+      else
+      {
+        arg1 = p[0];
+        arg2 = p[1];
+      }
+      p += args_len;
+
+      if (arg1 <= 0xFF && arg2 <= 0xFF)
+      {
+        flags_q[1] &= ~ARGS_ARE_WORDS;
+
+        *(q++) = (FT_Byte)arg1;
+        *(q++) = (FT_Byte)arg2;
+      }
+      else
+      {
+        *(q++) = HIGH(arg1);
+        *(q++) = LOW(arg1);
+        *(q++) = HIGH(arg2);
+        *(q++) = LOW(arg2);
+      }
+    }
+
+    /* copy scaling arguments */
+    memcpy(q, p, scale_len);
+    p += scale_len;
+    q += scale_len;
+  } while (flags & MORE_COMPONENTS);
+
+  /* we discard instructions (if any) */
+  flags_q[0] &= ~(WE_HAVE_INSTR >> 8);
+
+  *new_lenp = (FT_ULong)(q - q_start);
+
+  return TA_Err_Ok;
+}
+
+
+/* build new `glyf' and `loca' tables, */
+/* equivalent to `TA_sfnt_split_glyf_table', */
+/* `TA_sfnt_build_glyf_table', and `TA_sfnt_build_loca_table' */
+
+static FT_Error
+TA_sfnt_dehint_glyf_table(SFNT* sfnt,
+                          FONT* font)
+{
+  SFNT_Table* glyf_table = &font->tables[sfnt->glyf_idx];
+  SFNT_Table* loca_table = &font->tables[sfnt->loca_idx];
+  SFNT_Table* head_table = &font->tables[sfnt->head_idx];
+  SFNT_Table* maxp_table = &font->tables[sfnt->maxp_idx];
+
+  FT_Byte loca_format;
+  FT_UShort num_glyphs;
+  FT_UShort maxp_num_glyphs;
+
+  FT_Byte* glyf_buf = NULL;
+  FT_Byte* loca_buf = NULL;
+
+  FT_ULong offset;
+  FT_ULong offset_next;
+  FT_ULong len;
+  FT_ULong end; /* of the last glyph record, without padding */
+
+  FT_ULong glyf_checksum;
+  FT_ULong loca_checksum; /* for long offsets */
+
+  FT_Byte* p;
+  FT_Byte* q;
+  FT_Byte* r;
+  FT_UShort i;
+
+  FT_Error error;
+
+
+  /* nothing to do if table has already been processed */
+  if (glyf_table->processed)
+    return TA_Err_Ok;
+
+  /* in the generic code path, FreeType validates these tables */
+  if (head_table->len < HEAD_LEN
+      || maxp_table->len < MAXP_NUM_GLYPHS + 2)
+    return FT_Err_Invalid_Table;
+
+  loca_format = head_table->buf[LOCA_FORMAT_OFFSET];
+
+  num_glyphs = (FT_UShort)(loca_format ? loca_table->len / 4
+                                       : loca_table->len / 2);
+  if (!num_glyphs)
+    return FT_Err_Invalid_Table;
+  num_glyphs -= 1;
+
+  maxp_num_glyphs = (FT_UShort)((maxp_table->buf[MAXP_NUM_GLYPHS] << 8)
+                                | maxp_table->buf[MAXP_NUM_GLYPHS + 1]);
+  if (num_glyphs < maxp_num_glyphs)
+    return FT_Err_Invalid_Table;
+
+  /* the stripped glyph records never get larger, */
+  /* but we might need up to three more bytes for padding each */
+  glyf_buf = (FT_Byte*)malloc(glyf_table->len + 3 * (FT_ULong)num_glyphs + 4);
+  if (!glyf_buf)
+    return FT_Err_Out_Of_Memory;
+
+  /* we first store long offsets, compressing them later if possible */
+  loca_buf = (FT_Byte*)malloc(((FT_ULong)num_glyphs + 1) * 4);
+  if (!loca_buf)
+  {
+    error = FT_Err_Out_Of_Memory;
+    goto Err;
+  }
+
+  p = loca_table->buf;
+
+  if (loca_format)
+    offset_next = NEXT_ULONG(p);
+  else
+  {
+    offset_next = NEXT_USHORT(p);
+    offset_next <<= 1;
+  }
+
+  q = glyf_buf;
+  r = loca_buf;
+  end = 0;
+
+  glyf_checksum = 0;
+  loca_checksum = 0;
+
+  for (i = 0; i < num_glyphs; i++)
+  {
+    offset = offset_next;
+
+    if (loca_format)
+      offset_next = NEXT_ULONG(p);
+    else
+    {
+      offset_next = NEXT_USHORT(p);
+      offset_next <<= 1;
+    }
+
+    if (offset_next < offset
+        || offset_next > glyf_table->len)
+    {
+      error = FT_Err_Invalid_Table;
+      goto Err;
+    }
+
+    /* glyph records should have offsets which are multiples of 4 */
+    end = (FT_ULong)(q - glyf_buf);
+
+    *(r++) = BYTE1(end);
+    *(r++) = BYTE2(end);
+    *(r++) = BYTE3(end);
+    *(r++) = BYTE4(end);
+    loca_checksum += end;
+
+    len = offset_next - offset;
+    if (!len)
+      continue; /* empty glyph */
+    else
+    {
+      FT_Byte* buf;
+      FT_Byte* record = q;
+
+
+      /* check header size */
+      if (len < 10)
+      {
+        error = FT_Err_Invalid_Table;
+        goto Err;
+      }
+
+      buf = glyf_table->buf + offset;
+
+      if (buf[0] & 0x80)
+        error = TA_glyph_dehint_composite(buf, len, q, &len);
+      else
+        error = TA_glyph_dehint_simple(buf, len, q, &len);
+      if (error)
+        goto Err;
+
+      q += len;
+      end += len;
+
+      /* pad with zero bytes to have an offset which is a multiple of 4; */
+      /* this works even for the last glyph record since the allocated */
+      /* `glyf' buffer length is a multiple of 4 also */
+      switch (len % 4)
+      {
+      case 1:
+        *(q++) = 0;
+        /* fall through */
+      case 2:
+        *(q++) = 0;
+        /* fall through */
+      case 3:
+        *(q++) = 0;
+        /* fall through */
+      default:
+        break;
+      }
+
+      /* the padding bytes don't change the checksum */
+      glyf_checksum += ta_simd_checksum(record,
+                                        (FT_ULong)(q - record) / 4);
+    }
+  }
+
+  /* to make the short format of the `loca' table always work, */
+  /* assure an even length of the `glyf' table */
+  len = (end + 1) & ~1U;
+
+  *(r++) = BYTE1(len);
+  *(r++) = BYTE2(len);
+  *(r++) = BYTE3(len);
+  *(r++) = BYTE4(len);
+  loca_checksum += len;
+
+  if (!glyf_table->is_view)
+    free(glyf_table->buf);
+  glyf_table->buf = glyf_buf;
+  glyf_table->is_view = 0;
+  glyf_table->len = len;
+  glyf_table->checksum = glyf_checksum;
+  glyf_table->processed = 1;
+
+  if (loca_table->processed)
+  {
+    free(loca_buf);
+    return TA_Err_Ok;
+  }
+
+  if (len > 0xFFFF * 2)
+  {
+    loca_format = 1;
+    loca_table->len = ((FT_ULong)num_glyphs + 1) * 4;
+  }
+  else
+  {
+    /* convert to short offsets in place */
+    loca_format = 0;
+    loca_table->len = ((FT_ULong)num_glyphs + 1) * 2;
+
+    p = loca_buf;
+    r = loca_buf;
+    loca_checksum = 0;
+
+    /* two short offsets form a 32-bit value for the checksum */
+    for (i = 0; i <= num_glyphs; i++)
+    {
+      offset = NEXT_ULONG(p) >> 1;
+
+      *(r++) = HIGH(offset);
+      *(r++) = LOW(offset);
+      loca_checksum += (i & 1) ? offset : offset << 16;
+    }
+
+    /* pad `loca' table to make its length a multiple of 4 */
+    if (loca_table->len % 4 == 2)
+    {
+      *(r++) = 0;
+      *(r++) = 0;
+    }
+  }
+
+  free(loca_table->buf);
+  loca_table->buf = loca_buf;
+  loca_table->checksum = loca_checksum;
+  loca_table->processed = 1;
+
+  head_table->buf[LOCA_FORMAT_OFFSET] = loca_format;
+
+  return TA_Err_Ok;
+
+Err:
+  free(glyf_buf);
+  free(loca_buf);
+
+  return error;
+}
+
+
+FT_Error
+TA_font_dehint(FONT* font)
+{
+  FT_Long i;
+  FT_Error error;
+
+
+  error = TA_font_count_sfnts(font);
+  if (error)
+    return error;
+
+  for (i = 0; i < font->num_sfnts; i++)
+  {
+    SFNT* sfnt = &font->sfnts[i];
+
+
+    error = TA_sfnt_split_into_SFNT_tables(sfnt, font);
+    if (error)
+      return error;
+
+    /* check permission */
+    if (sfnt->OS2_idx != MISSING)
+    {
+      SFNT_Table* OS2_table = &font->tables[sfnt->OS2_idx];
+
+
+      /* check lower byte of the `fsType' field */
+      if (OS2_table->len > OS2_FSTYPE_OFFSET + 1
+          && OS2_table->buf[OS2_FSTYPE_OFFSET + 1] == 0x02
+          && !font->ignore_restrictions)
+        return TA_Err_Missing_Legal_Permission;
+    }
+  }
+
+  /* we must not modify tables before all subfonts are split */
+  /* since shared tables are identified by comparing their data */
+  for (i = 0; i < font->num_sfnts; i++)
+  {
+    SFNT* sfnt = &font->sfnts[i];
+
+
+    error = TA_sfnt_build_gasp_table(sfnt, font);
+    if (error)
+      return error;
+    error = TA_sfnt_dehint_glyf_table(sfnt, font);
+    if (error)
+      return error;
+  }
+
+  for (i = 0; i < font->num_sfnts; i++)
+  {
+    SFNT* sfnt = &font->sfnts[i];
+
+
+    error = TA_sfnt_update_maxp_table(sfnt, font);
+    if (error)
+      return error;
+
+    if (font->info)
+    {
+      /* add info about ttfautohint to the version string */
+      error = TA_sfnt_update_name_table(sfnt, font);
+      if (error)
+        return error;
+    }
+  }
+
+  return TA_Err_Ok;
+}
+
+/* end of tadehint.c */
@@ -83,6 +83,10 @@ TA_font_dump_parameters(FONT* font,
     goto Exit;
   }
 
+  /* only shown if set to keep the `TTFA' table of other fonts unchanged */
+  if (font->adaptive_sweep)
+    DUMPVAL("adaptive-sweep",
+            font->adaptive_sweep);
   DUMPVAL("adjust-subglyphs",
           font->adjust_subglyphs);
   DUMPSTR("default-script",
@@ -15,6 +15,12 @@
 
 #include "ta.h"
 
+#ifdef HAVE_MMAP
+#  include <sys/types.h>
+#  include <sys/stat.h>
+#  include <sys/mman.h>
+#endif
+
 
 #define BUF_SIZE 0x10000
 
@@ -81,6 +87,41 @@ TA_control_file_read(FONT* font,
   size_t read_bytes;
 
 
+#ifdef HAVE_MMAP
+  /* compiled control instructions are used as-is, */
+  /* so we map them into memory instead of copying */
+  if (ftell(control_file) == 0)
+  {
+    int fd = fileno(control_file);
+    struct stat st;
+
+
+    if (fd >= 0
+        && !fstat(fd, &st)
+        && S_ISREG(st.st_mode)
+        && st.st_size > 0)
+    {
+      void* map = mmap(NULL, (size_t)st.st_size,
+                       PROT_READ, MAP_PRIVATE, fd, 0);
+
+
+      if (map != MAP_FAILED)
+      {
+        if (TA_control_is_binary((const char*)map, (size_t)st.st_size))
+        {
+          font->control_buf = (char*)map;
+          font->control_len = (size_t)st.st_size;
+          font->control_mapped = 1;
+
+          return TA_Err_Ok;
+        }
+
+        munmap(map, (size_t)st.st_size);
+      }
+    }
+  }
+#endif
+
   font->control_buf = (char*)malloc(BUF_SIZE);
   if (!font->control_buf)
     return FT_Err_Out_Of_Memory;
@@ -112,4 +153,39 @@ TA_control_file_read(FONT* font,
   return TA_Err_Ok;
 }
 
+void
+TA_control_file_unmap(FONT* font)
+{
+#ifdef HAVE_MMAP
+  if (font->control_mapped)
+    munmap(font->control_buf, font->control_len);
+#endif
+
+  font->control_buf = NULL;
+  font->control_len = 0;
+  font->control_mapped = 0;
+}
+
+
+FT_Error
+TA_control_binary_file_write(FONT* font,
+                             FILE* control_binary_file)
+{
+  FT_Error error;
+  FT_Byte* buf;
+  FT_ULong len;
+
+
+  error = TA_control_build_binary(font, &buf, &len);
+  if (error)
+    return error;
+
+  if (fwrite(buf, 1, len, control_binary_file) != len)
+    error = TA_Err_Invalid_Stream_Write;
+
+  free(buf);
+
+  return error;
+}
+
 /* end of tafile.c */
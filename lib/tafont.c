@@ -86,7 +86,8 @@ TA_font_unload(FONT* font,
 
     for (i = 0; i < font->num_tables; i++)
     {
-      free(font->tables[i].buf);
+      if (!font->tables[i].is_view)
+        free(font->tables[i].buf);
       if (font->tables[i].data)
       {
         if (font->tables[i].tag == TTAG_glyf)
@@ -97,7 +98,8 @@ TA_font_unload(FONT* font,
 
           for (j = 0; j < data->num_glyphs; j++)
           {
-            free(data->glyphs[j].buf);
+            if (!data->glyphs[j].is_view)
+              free(data->glyphs[j].buf);
             free(data->glyphs[j].ins_buf);
             free(data->glyphs[j].ins_extra_buf);
             free(data->glyphs[j].components);
@@ -120,6 +122,7 @@ TA_font_unload(FONT* font,
     {
       FT_Done_Face(font->sfnts[i].face);
       free(font->sfnts[i].table_infos);
+      TA_previous_free(font->sfnts[i].previous);
     }
     free(font->sfnts);
   }
@@ -127,6 +130,7 @@ TA_font_unload(FONT* font,
   FT_Done_Face(font->reference);
 
   number_set_free(font->x_height_snapping_exceptions);
+  number_set_free(font->hint_glyphs);
 
   FT_Done_FreeType(font->lib);
 
@@ -136,7 +140,9 @@ TA_font_unload(FONT* font,
     free(font->in_buf);
   if (!out_bufp)
     font->deallocate(font->out_buf);
-  if (!control_buf)
+  if (font->control_mapped)
+    TA_control_file_unmap(font);
+  else if (!control_buf)
     free(font->control_buf);
   if (!reference_buf)
     free(font->reference_buf);
@@ -19,6 +19,7 @@
 
 #include <config.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "taglobal.h"
 #include "taranges.h"
@@ -97,8 +98,6 @@ TA_StyleClass const ta_style_classes[] =
 };
 
 
-#ifdef TA_DEBUG
-
 #undef STYLE
 #define STYLE(s, S, d, ws, sc, ss, c) #s,
 
@@ -109,8 +108,6 @@ const char* ta_style_names[] =
 
 };
 
-#endif /* TA_DEBUG */
-
 
 /* Recursively assign a style to all components of a composite glyph. */
 
@@ -489,6 +486,17 @@ ta_face_globals_new(FT_Face face,
   globals->hb_font = hb_ft_font_create(face, NULL);
   globals->hb_buf = hb_buffer_create();
 
+  globals->outline_cache =
+    (TA_OutlineCache)calloc(1, sizeof (TA_OutlineCacheRec));
+  if (!globals->outline_cache)
+  {
+    ta_face_globals_free(globals);
+    globals = NULL;
+    error = FT_Err_Out_Of_Memory;
+    goto Err;
+  }
+  ta_mutex_init(&globals->outline_cache->mutex);
+
   error = ta_face_globals_compute_style_coverage(globals);
   if (error)
   {
@@ -532,6 +540,25 @@ ta_face_globals_free(TA_FaceGlobals globals)
     hb_font_destroy(globals->hb_font);
     hb_buffer_destroy(globals->hb_buf);
 
+    if (globals->outline_cache)
+    {
+      TA_OutlineCache cache = globals->outline_cache;
+
+
+      if (cache->outlines)
+      {
+        FT_Long idx;
+
+
+        for (idx = 0; idx < globals->glyph_count; idx++)
+          free(cache->outlines[idx]);
+        free(cache->outlines);
+      }
+
+      ta_mutex_done(&cache->mutex);
+      free(cache);
+    }
+
     /* no need to free `globals->glyph_styles'; */
     /* it is part of the `globals' array */
     free(globals);
@@ -539,6 +566,60 @@ ta_face_globals_free(TA_FaceGlobals globals)
 }
 
 
+static FT_Error
+ta_style_metrics_new(TA_FaceGlobals globals,
+                     TA_Style style,
+                     FT_Face reference,
+                     TA_StyleMetrics *ametrics)
+{
+  TA_StyleClass style_class =
+    ta_style_classes[style];
+  TA_WritingSystemClass writing_system_class =
+    ta_writing_system_classes[style_class->writing_system];
+
+  TA_StyleMetrics metrics;
+  FT_Error error = FT_Err_Ok;
+
+  TA_Trace trace = globals->font->trace;
+  unsigned long long start = TA_TRACE_START(trace);
+
+
+  metrics = (TA_StyleMetrics)
+              calloc(1, writing_system_class->style_metrics_size);
+  if (!metrics)
+  {
+    error = FT_Err_Out_Of_Memory;
+    goto Exit;
+  }
+
+  metrics->style_class = style_class;
+  metrics->globals = globals;
+
+  if (writing_system_class->style_metrics_init)
+  {
+    error = writing_system_class->style_metrics_init(metrics,
+                                                     globals->face,
+                                                     reference);
+    if (error)
+    {
+      if (writing_system_class->style_metrics_done)
+        writing_system_class->style_metrics_done(metrics);
+
+      free(metrics);
+      metrics = NULL;
+    }
+  }
+
+  ta_trace_span(trace, "metrics", ta_style_names[style], start,
+                "\"face_index\": %ld", globals->face->face_index);
+
+Exit:
+  *ametrics = metrics;
+
+  return error;
+}
+
+
 FT_Error
 ta_face_globals_get_metrics(TA_FaceGlobals globals,
                             FT_UInt gindex,
@@ -547,8 +628,6 @@ ta_face_globals_get_metrics(TA_FaceGlobals globals,
 {
   TA_StyleMetrics metrics = NULL;
   TA_Style style = (TA_Style)options;
-  TA_WritingSystemClass writing_system_class;
-  TA_StyleClass style_class;
   FT_Error error = FT_Err_Ok;
 
 
@@ -564,42 +643,16 @@ ta_face_globals_get_metrics(TA_FaceGlobals globals,
     style = (TA_Style)(globals->glyph_styles[gindex]
                        & TA_STYLE_UNASSIGNED);
 
-  style_class =
-    ta_style_classes[style];
-  writing_system_class =
-    ta_writing_system_classes[style_class->writing_system];
-
   metrics = globals->metrics[style];
   if (!metrics)
   {
     /* create the global metrics object if necessary */
-    metrics = (TA_StyleMetrics)
-                calloc(1, writing_system_class->style_metrics_size);
-    if (!metrics)
-    {
-      error = FT_Err_Out_Of_Memory;
+    error = ta_style_metrics_new(globals,
+                                 style,
+                                 globals->font->reference,
+                                 &metrics);
+    if (error)
       goto Exit;
-    }
-
-    metrics->style_class = style_class;
-    metrics->globals = globals;
-
-    if (writing_system_class->style_metrics_init)
-    {
-      error = writing_system_class->style_metrics_init(
-                                      metrics,
-                                      globals->face,
-                                      globals->font->reference);
-      if (error)
-      {
-        if (writing_system_class->style_metrics_done)
-          writing_system_class->style_metrics_done(metrics);
-
-        free(metrics);
-        metrics = NULL;
-        goto Exit;
-      }
-    }
 
     globals->metrics[style] = metrics;
   }
@@ -621,4 +674,269 @@ ta_face_globals_is_digit(TA_FaceGlobals globals,
   return (FT_Bool)0;
 }
 
+
+FT_Error
+ta_face_globals_get_outline(TA_FaceGlobals globals,
+                            FT_UInt gindex,
+                            FT_Outline** aoutline)
+{
+  TA_OutlineCache cache = globals->outline_cache;
+  FT_Face face = globals->face;
+
+  FT_Outline** outlines;
+  FT_Outline* outline;
+  FT_Outline* src;
+  FT_Int n_points = 0;
+  FT_Int n_contours = 0;
+  size_t points_size, contours_size, tags_size;
+
+
+  *aoutline = NULL;
+
+  if (gindex >= (FT_ULong)globals->glyph_count)
+    return FT_Err_Invalid_Argument;
+
+  ta_mutex_lock(&cache->mutex);
+  if (!cache->outlines)
+    cache->outlines = (FT_Outline**)calloc((size_t)globals->glyph_count,
+                                           sizeof (FT_Outline*));
+  outlines = cache->outlines;
+  outline = outlines ? outlines[gindex] : NULL;
+  ta_mutex_unlock(&cache->mutex);
+
+  if (!outlines)
+    return FT_Err_Out_Of_Memory;
+
+  if (outline)
+  {
+    *aoutline = outline;
+    return FT_Err_Ok;
+  }
+
+  /* a glyph that can't be loaded is stored as an empty outline */
+  src = NULL;
+  if (!FT_Load_Glyph(face, gindex, FT_LOAD_NO_SCALE))
+  {
+    src = &face->glyph->outline;
+    n_points = src->n_points;
+    n_contours = src->n_contours;
+  }
+
+  /* allocate the outline and its arrays in a single block */
+  points_size = (size_t)n_points * sizeof (*outline->points);
+  contours_size = (size_t)n_contours * sizeof (*outline->contours);
+  tags_size = (size_t)n_points * sizeof (*outline->tags);
+
+  outline = (FT_Outline*)malloc(sizeof (FT_Outline)
+                                + points_size
+                                + contours_size
+                                + tags_size);
+  if (!outline)
+    return FT_Err_Out_Of_Memory;
+
+  memset(outline, 0, sizeof (FT_Outline));
+  outline->points = (FT_Vector*)(outline + 1);
+  outline->contours = (void*)((char*)outline->points + points_size);
+  outline->tags = (void*)((char*)outline->contours + contours_size);
+
+  if (src)
+  {
+    outline->n_points = src->n_points;
+    outline->n_contours = src->n_contours;
+    outline->flags = src->flags;
+
+    memcpy(outline->points, src->points, points_size);
+    memcpy(outline->contours, src->contours, contours_size);
+    memcpy(outline->tags, src->tags, tags_size);
+  }
+
+  /* another thread might have been faster */
+  ta_mutex_lock(&cache->mutex);
+  if (outlines[gindex])
+  {
+    free(outline);
+    outline = outlines[gindex];
+  }
+  else
+    outlines[gindex] = outline;
+  ta_mutex_unlock(&cache->mutex);
+
+  *aoutline = outline;
+
+  return FT_Err_Ok;
+}
+
+
+/* the data for initializing a single style */
+typedef struct Metrics_Job_
+{
+  TA_FaceGlobals globals;
+  TA_Style style;
+  TA_StyleMetrics metrics;
+} Metrics_Job;
+
+typedef struct Metrics_Jobs_
+{
+  FONT* font;
+  Metrics_Job* jobs;
+
+  /* creating and destroying FreeType faces */
+  /* must be serialized for a given library object */
+  TA_MutexRec face_mutex;
+} Metrics_Jobs;
+
+
+/*
+ * FreeType faces and HarfBuzz fonts can't be used in more than one
+ * thread, thus a job uses private copies of them (together with the
+ * reference font, if any) in a copy of the face globals, mimicking the
+ * state of the original face while computing the global hints.
+ */
+
+static void
+ta_init_metrics_job(FT_Long idx,
+                    void* data)
+{
+  Metrics_Jobs* jobs = (Metrics_Jobs*)data;
+  Metrics_Job* job = &jobs->jobs[idx];
+  FONT* font = jobs->font;
+  TA_FaceGlobals globals = job->globals;
+
+  TA_FaceGlobalsRec private_globals;
+  FT_Face face = NULL;
+  FT_Face reference = NULL;
+  FT_Error error;
+
+
+  ta_mutex_lock(&jobs->face_mutex);
+  error = FT_New_Memory_Face(font->lib,
+                             font->in_buf,
+                             (FT_Long)font->in_len,
+                             globals->face->face_index,
+                             &face);
+  if (!error && font->reference)
+    error = FT_New_Memory_Face(font->lib,
+                               font->reference_buf,
+                               (FT_Long)font->reference_len,
+                               font->reference_index,
+                               &reference);
+  ta_mutex_unlock(&jobs->face_mutex);
+  if (error)
+    goto Exit;
+
+  /* see `TA_sfnt_compute_global_hints' */
+  if (FT_Select_Charmap(face, FT_ENCODING_UNICODE))
+  {
+    if (!font->symbol
+        || FT_Select_Charmap(face, FT_ENCODING_MS_SYMBOL))
+      goto Exit;
+  }
+  if (globals->face->size->metrics.x_ppem)
+  {
+    error = FT_Set_Pixel_Sizes(face,
+                               globals->face->size->metrics.x_ppem,
+                               globals->face->size->metrics.y_ppem);
+    if (error)
+      goto Exit;
+  }
+
+  private_globals = *globals;
+  private_globals.face = face;
+  private_globals.hb_font = hb_ft_font_create(face, NULL);
+  private_globals.hb_buf = hb_buffer_create();
+
+  error = ta_style_metrics_new(&private_globals,
+                               job->style,
+                               reference,
+                               &job->metrics);
+  if (!error)
+    job->metrics->globals = globals;
+
+  hb_font_destroy(private_globals.hb_font);
+  hb_buffer_destroy(private_globals.hb_buf);
+
+Exit:
+  ta_mutex_lock(&jobs->face_mutex);
+  FT_Done_Face(reference);
+  FT_Done_Face(face);
+  ta_mutex_unlock(&jobs->face_mutex);
+}
+
+
+void
+ta_font_init_metrics(FONT* font)
+{
+  Metrics_Jobs jobs;
+  FT_Long num_jobs = 0;
+  FT_Long i, j;
+
+
+  jobs.font = font;
+  jobs.jobs = (Metrics_Job*)malloc((size_t)font->num_sfnts * TA_STYLE_MAX
+                                   * sizeof (Metrics_Job));
+  if (!jobs.jobs)
+    return;
+
+  for (i = 0; i < font->num_sfnts; i++)
+  {
+    SFNT* sfnt = &font->sfnts[i];
+    TA_FaceGlobals globals = (TA_FaceGlobals)sfnt->face->autohint.data;
+
+    FT_Byte seen[TA_STYLE_MAX];
+    FT_UInt nn;
+
+
+    if (!globals)
+      continue;
+
+    /* subfonts sharing a `glyf' table are hinted only once */
+    for (j = 0; j < i; j++)
+      if (font->sfnts[j].glyf_idx == sfnt->glyf_idx)
+        break;
+    if (j < i)
+      continue;
+
+    /* these are the styles `TA_sfnt_build_cvt_table' asks for */
+    memset(seen, 0, sizeof (seen));
+    for (nn = 0; nn < TA_STYLE_MAX; nn++)
+    {
+      FT_UInt gindex = globals->sample_glyphs[nn];
+      FT_UInt style;
+
+
+      if (!gindex || gindex >= (FT_ULong)globals->glyph_count)
+        continue;
+
+      style = globals->glyph_styles[gindex] & TA_STYLE_UNASSIGNED;
+      if (style >= TA_STYLE_MAX
+          || seen[style]
+          || globals->metrics[style])
+        continue;
+
+      seen[style] = 1;
+
+      jobs.jobs[num_jobs].globals = globals;
+      jobs.jobs[num_jobs].style = (TA_Style)style;
+      jobs.jobs[num_jobs].metrics = NULL;
+      num_jobs++;
+    }
+  }
+
+  ta_mutex_init(&jobs.face_mutex);
+  ta_thread_run_jobs(font->num_threads, num_jobs,
+                     ta_init_metrics_job, &jobs);
+  ta_mutex_done(&jobs.face_mutex);
+
+  for (i = 0; i < num_jobs; i++)
+  {
+    Metrics_Job* job = &jobs.jobs[i];
+
+
+    if (job->metrics)
+      job->globals->metrics[job->style] = job->metrics;
+  }
+
+  free(jobs.jobs);
+}
+
 /* end of taglobal.c */
@@ -23,6 +23,7 @@
 #include "ta.h"
 #include "tatypes.h"
 #include "tashaper.h"
+#include "tathread.h"
 
 
 extern TA_WritingSystemClass const ta_writing_system_classes[];
@@ -46,9 +47,7 @@ extern TA_ScriptClass const ta_script_classes[];
 extern TA_StyleClass const ta_style_classes[];
 
 
-#ifdef TA_DEBUG
 extern const char* ta_style_names[];
-#endif
 
 
 /* Default values and flags for both autofitter globals */
@@ -75,6 +74,16 @@ extern const char* ta_style_names[];
 #define TA_PROP_INCREASE_X_HEIGHT_MAX 0
 
 
+/* unscaled glyph outlines, loaded on demand; */
+/* the blue zone and standard width computations of */
+/* different styles often need the same glyphs */
+typedef struct TA_OutlineCacheRec_
+{
+  TA_MutexRec mutex;
+  FT_Outline** outlines; /* indexed by glyph index */
+} TA_OutlineCacheRec, *TA_OutlineCache;
+
+
 /* note that glyph_styles[] maps each glyph to an index into the */
 /* `ta_style_classes' array. */
 typedef struct TA_FaceGlobalsRec_
@@ -92,6 +101,8 @@ typedef struct TA_FaceGlobalsRec_
   TA_StyleMetrics metrics[TA_STYLE_MAX];
   FT_UInt sample_glyphs[TA_STYLE_MAX]; /* per-style sample glyph indices */
 
+  TA_OutlineCache outline_cache;
+
   FONT* font; /* to access global properties */
 } TA_FaceGlobalsRec;
 
@@ -117,6 +128,19 @@ FT_Bool
 ta_face_globals_is_digit(TA_FaceGlobals globals,
                          FT_UInt gindex);
 
+/* get the unscaled outline of glyph `gindex' from the cache; */
+/* the returned outline must not be modified */
+FT_Error
+ta_face_globals_get_outline(TA_FaceGlobals globals,
+                            FT_UInt gindex,
+                            FT_Outline** aoutline);
+
+/* compute the metrics of all styles used in the font in advance, */
+/* using `font->num_threads' threads; */
+/* styles that fail are left to `ta_face_globals_get_metrics' */
+void
+ta_font_init_metrics(FONT* font);
+
 #endif /* TAGLOBAL_H_ */
 
 /* end of taglobal.h */
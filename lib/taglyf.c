@@ -14,6 +14,50 @@
 
 
 #include "ta.h"
+#include "taprof.h"
+#include "tasimd.h"
+
+
+static void
+TA_sfnt_report_glyph(SFNT* sfnt,
+                     FONT* font,
+                     FT_Long idx,
+                     Glyph_Stats* stats,
+                     unsigned long long time)
+{
+  SFNT_Table* glyf_table = &font->tables[sfnt->glyf_idx];
+  glyf_Data* data = (glyf_Data*)glyf_table->data;
+  GLYPH* glyph = &data->glyphs[idx];
+
+  TA_Glyph_Report report;
+  char glyph_name[256];
+
+
+  report.curr_sfnt = sfnt - font->sfnts;
+  report.glyph_idx = idx;
+
+  report.glyph_name = NULL;
+  if (FT_HAS_GLYPH_NAMES(sfnt->face)
+      && !FT_Get_Glyph_Name(sfnt->face, (FT_UInt)idx,
+                            glyph_name, sizeof (glyph_name)))
+    report.glyph_name = glyph_name;
+
+  report.style = ta_style_names[stats->style];
+
+  report.num_points = stats->num_points;
+  report.num_segments = stats->num_segments;
+  report.num_edges = stats->num_edges;
+  report.num_action_hints_records = stats->num_action_hints_records;
+  report.num_point_hints_records = stats->num_point_hints_records;
+
+  report.ins_len = glyph->ins_len;
+  report.ins_extra_len = glyph->ins_extra_len;
+
+  /* convert nanoseconds to milliseconds */
+  report.time = (double)time / 1e6;
+
+  font->glyph_report(&report, font->glyph_report_data);
+}
 
 
 static FT_Error
@@ -27,6 +71,7 @@ TA_sfnt_build_glyf_hints(SFNT* sfnt,
   FT_Error error;
 
   FT_UShort loop_count;
+  TA_Trace trace = font->trace;
 
 
   /* this loop doesn't include the artificial `.ttfautohint' glyph */
@@ -36,9 +81,49 @@ TA_sfnt_build_glyf_hints(SFNT* sfnt,
 
   for (idx = 0; idx < loop_count; idx++)
   {
-    error = TA_sfnt_build_glyph_instructions(sfnt, font, idx);
+    Glyph_Stats stats;
+    unsigned long long start = TA_TRACE_START(trace);
+    unsigned long long report_start = 0;
+    FT_Bool reused;
+
+
+    memset(&stats, 0, sizeof (Glyph_Stats));
+
+    /* copy the bytecode of an unchanged glyph from a previous run */
+    error = TA_sfnt_reuse_glyph_instructions(sfnt, font, idx, &reused);
     if (error)
       return error;
+    if (reused)
+      goto Progress;
+
+    if (font->glyph_report)
+      report_start = TA_get_monotonic_time();
+
+    TA_PROF_SET_GLYPH(idx);
+    error = TA_sfnt_build_glyph_instructions(sfnt, font, idx, &stats);
+    TA_PROF_SET_GLYPH(-1);
+    if (error)
+      return error;
+
+    if (font->glyph_report)
+      TA_sfnt_report_glyph(sfnt, font, idx, &stats,
+                           TA_get_monotonic_time() - report_start);
+
+    if (trace)
+    {
+      GLYPH* glyph = &data->glyphs[idx];
+
+
+      ta_trace_span(trace, "glyph", "glyph", start,
+                    "\"index\": %ld, \"points\": %u,"
+                    " \"hints_records\": %u, \"bytecode_size\": %lu",
+                    idx, stats.num_points,
+                    stats.num_action_hints_records
+                      + stats.num_point_hints_records,
+                    glyph->ins_len + glyph->ins_extra_len);
+    }
+
+  Progress:
     if (font->progress)
     {
       FT_Int ret;
@@ -144,6 +229,7 @@ TA_glyph_parse_composite(GLYPH* glyphs,
   /* and possible argument size changes for shifted point indices) */
   /* and reallocate it later to its real size */
   glyph->buf = (FT_Byte*)malloc(len + 8 + glyph->num_components * 2);
+  glyph->is_view = 0;
   if (!glyph->buf)
     return FT_Err_Out_Of_Memory;
 
@@ -256,9 +342,9 @@ TA_glyph_parse_composite(GLYPH* glyphs,
 
       if (flags & ARGS_ARE_WORDS)
       {
-        arg1 = *(p++) >> 8;
+        arg1 = (FT_UShort)(*(p++) << 8);
         arg1 += *(p++);
-        arg2 = *(p++) >> 8;
+        arg2 = (FT_UShort)(*(p++) << 8);
         arg2 += *(p++);
       }
       else
@@ -326,6 +412,7 @@ TA_glyph_parse_composite(GLYPH* glyphs,
   /* glyph->len2 = 0; */
   glyph->flags_offset = flags_offset;
   glyph->buf = (FT_Byte*)realloc(glyph->buf, glyph->len1);
+  glyph->buf2 = glyph->buf + glyph->len1;
 
   /* we discard instructions (if any) */
   glyph->buf[glyph->flags_offset] &= ~(WE_HAVE_INSTR >> 8);
@@ -434,17 +521,13 @@ TA_glyph_parse_simple(GLYPH* glyph,
 
   flags_size = (FT_ULong)(p - flags_start);
 
-  /* store the data before and after the bytecode instructions */
-  /* in the same array */
+  /* the data before and after the bytecode instructions */
+  /* gets copied only while building the new `glyf' table */
   glyph->len1 = ins_offset;
   glyph->len2 = flags_size + xy_size;
-  glyph->buf = (FT_Byte*)malloc(glyph->len1 + glyph->len2);
-  if (!glyph->buf)
-    return FT_Err_Out_Of_Memory;
-
-  /* now copy everything but the instructions */
-  memcpy(glyph->buf, buf, glyph->len1);
-  memcpy(glyph->buf + glyph->len1, flags_start, glyph->len2);
+  glyph->buf = buf;
+  glyph->buf2 = flags_start;
+  glyph->is_view = 1;
 
   return TA_Err_Ok;
 }
@@ -632,7 +715,9 @@ TA_sfnt_split_glyf_table(SFNT* sfnt,
   data->fpgm_idx = MISSING;
   data->prep_idx = MISSING;
 
-  /* first loop over `loca' and `glyf' data */
+  /* loop over `loca' and `glyf' data; */
+  /* simple glyphs are parsed right away, */
+  /* referring to the `glyf' table data instead of copying it */
 
   p = loca_table->buf;
 
@@ -686,6 +771,11 @@ TA_sfnt_split_glyf_table(SFNT* sfnt,
         error = TA_glyph_get_components(glyph, buf, len);
         if (error)
           return error;
+
+        /* remember the glyph record until all glyphs are split */
+        glyph->buf = buf;
+        glyph->len1 = len;
+        glyph->is_view = 1;
       }
       else
       {
@@ -698,61 +788,33 @@ TA_sfnt_split_glyf_table(SFNT* sfnt,
           return FT_Err_Invalid_Table;
 
         glyph->num_points = (FT_UShort)((buf[off] << 8) + buf[off + 1] + 1);
+
+        /* We must parse the rest of the glyph record to get the exact */
+        /* record length.  Since the `loca' table rounds record lengths */
+        /* up to multiples of 4 (or 2 for older fonts), and we must round */
+        /* up again after stripping off the instructions, it would be */
+        /* possible otherwise to have more than 4 bytes of padding which */
+        /* is more or less invalid. */
+        error = TA_glyph_parse_simple(glyph, buf, len, font->dehint);
+        if (error)
+          return error;
       }
     }
   }
 
-  /* second loop over `loca' and `glyf' data */
-
-  p = loca_table->buf;
-
-  if (loca_format)
-    offset_next = NEXT_ULONG(p);
-  else
-  {
-    offset_next = NEXT_USHORT(p);
-    offset_next <<= 1;
-  }
-
+  /* composite glyphs need the number of points of their components, */
+  /* so we can parse them only now */
   for (i = 0; i < loop_count; i++)
   {
     GLYPH* glyph = &data->glyphs[i];
-    FT_ULong len;
-
 
-    offset = offset_next;
 
-    if (loca_format)
-      offset_next = NEXT_ULONG(p);
-    else
+    if (glyph->num_contours < 0)
     {
-      offset_next = NEXT_USHORT(p);
-      offset_next <<= 1;
-    }
-
-    len = offset_next - offset;
-    if (!len)
-      continue; /* empty glyph */
-    else
-    {
-      FT_Byte* buf;
-
-
-      buf = glyf_table->buf + offset;
-
-      /* We must parse the rest of the glyph record to get the exact */
-      /* record length.  Since the `loca' table rounds record lengths */
-      /* up to multiples of 4 (or 2 for older fonts), and we must round */
-      /* up again after stripping off the instructions, it would be */
-      /* possible otherwise to have more than 4 bytes of padding which */
-      /* is more or less invalid. */
-
-      if (glyph->num_contours < 0)
-        error = TA_glyph_parse_composite(data->glyphs, i, buf, len,
-                                         data->num_glyphs,
-                                         font->hint_composites);
-      else
-        error = TA_glyph_parse_simple(glyph, buf, len, font->dehint);
+      error = TA_glyph_parse_composite(data->glyphs, i,
+                                       glyph->buf, glyph->len1,
+                                       data->num_glyphs,
+                                       font->hint_composites);
       if (error)
         return error;
     }
@@ -769,6 +831,7 @@ TA_sfnt_split_glyf_table(SFNT* sfnt,
     glyph->buf = (FT_Byte*)malloc(glyph->len1 + glyph->len2);
     if (!glyph->buf)
       return FT_Err_Out_Of_Memory;
+    glyph->buf2 = glyph->buf + glyph->len1;
 
     buf = glyph->buf;
 
@@ -815,6 +878,7 @@ TA_sfnt_build_glyf_table(SFNT* sfnt,
   GLYPH* glyph;
 
   FT_ULong len;
+  FT_ULong checksum;
   FT_Byte* buf_new;
   FT_Byte* p;
   FT_UShort i;
@@ -848,13 +912,13 @@ TA_sfnt_build_glyf_table(SFNT* sfnt,
   /* assure an even length of the `glyf' table */
   glyf_table->len = (len + 1) & ~1U;
 
-  buf_new = (FT_Byte*)realloc(glyf_table->buf, (len + 3) & ~3U);
+  /* the glyph data might still refer to the old table */
+  buf_new = (FT_Byte*)malloc((len + 3) & ~3U);
   if (!buf_new)
     return FT_Err_Out_Of_Memory;
-  else
-    glyf_table->buf = buf_new;
 
-  p = glyf_table->buf;
+  p = buf_new;
+  checksum = 0;
   glyph = data->glyphs;
   for (i = 0; i < data->num_glyphs; i++, glyph++)
   {
@@ -865,6 +929,9 @@ TA_sfnt_build_glyf_table(SFNT* sfnt,
 
     if (len)
     {
+      FT_Byte* record = p;
+
+
       /* copy glyph data and insert new instructions */
       memcpy(p, glyph->buf, glyph->len1);
 
@@ -884,7 +951,7 @@ TA_sfnt_build_glyf_table(SFNT* sfnt,
           memcpy(p, glyph->ins_buf, glyph->ins_len);
           p += glyph->ins_len;
         }
-        memcpy(p, glyph->buf + glyph->len1, glyph->len2);
+        memcpy(p, glyph->buf2, glyph->len2);
         p += glyph->len2;
       }
       else
@@ -925,11 +992,20 @@ TA_sfnt_build_glyf_table(SFNT* sfnt,
       default:
         break;
       }
+
+      /* the padded record is still in the cache, and the padding */
+      /* bytes don't change the checksum */
+      checksum += ta_simd_checksum(record, (FT_ULong)(p - record) / 4);
     }
   }
 
-  glyf_table->checksum = TA_table_compute_checksum(glyf_table->buf,
-                                                   glyf_table->len);
+  /* the old table data is not accessed after this point */
+  if (!glyf_table->is_view)
+    free(glyf_table->buf);
+  glyf_table->buf = buf_new;
+  glyf_table->is_view = 0;
+
+  glyf_table->checksum = checksum;
   glyf_table->processed = 1;
 
   return TA_Err_Ok;
@@ -1127,6 +1203,7 @@ TA_create_glyph_data(FT_Outline* outline,
     error = FT_Err_Out_Of_Memory;
     goto Exit;
   }
+  glyph->buf2 = glyph->buf + glyph->len1;
 
   p = glyph->buf;
   memcpy(p, header, 10);
@@ -22,6 +22,7 @@
 #include <string.h>
 #include <stdlib.h>
 #include "tahints.h"
+#include "tasimd.h"
 
 
 /* get new segment for given axis */
@@ -378,10 +379,10 @@ ta_glyph_hints_dump_points(TA_GlyphHints hints)
 
             point->fx,
             point->fy,
-            point->ox / 64.0,
-            point->oy / 64.0,
-            point->x / 64.0,
-            point->y / 64.0,
+            hints->ox[point_idx] / 64.0,
+            hints->oy[point_idx] / 64.0,
+            hints->x[point_idx] / 64.0,
+            hints->y[point_idx] / 64.0,
 
             ta_print_idx(buf5, ta_get_strong_edge_index(hints,
                                                         point->before,
@@ -601,6 +602,8 @@ ta_glyph_hints_init(TA_GlyphHints hints)
 {
   /* no need to initialize the embedded items */
   memset(hints, 0, sizeof (*hints) - sizeof (hints->embedded));
+
+  hints->simd_level = TA_SIMD_MAX;
 }
 
 
@@ -645,11 +648,13 @@ ta_glyph_hints_done(TA_GlyphHints hints)
   hints->max_contours = 0;
   hints->num_contours = 0;
 
+  /* this also frees the coordinate arrays */
   if (hints->points != hints->embedded.points)
   {
     free(hints->points);
     hints->points = NULL;
   }
+  hints->coords = NULL;
   hints->max_points = 0;
   hints->num_points = 0;
 }
@@ -706,23 +711,12 @@ ta_corner_is_flat(FT_Pos in_x,
 }
 
 
-/* recompute all TA_Point in TA_GlyphHints */
-/* from the definitions in a source outline */
+/* reset the hints for a new glyph without releasing memory; */
+/* this keeps the array capacities reached so far */
 
-FT_Error
-ta_glyph_hints_reload(TA_GlyphHints hints,
-                      FT_Outline* outline)
+void
+ta_glyph_hints_reset(TA_GlyphHints hints)
 {
-  FT_Error error = FT_Err_Ok;
-  TA_Point points;
-  FT_UInt old_max, new_max;
-
-  FT_Fixed x_scale = hints->x_scale;
-  FT_Fixed y_scale = hints->y_scale;
-  FT_Pos x_delta = hints->x_delta;
-  FT_Pos y_delta = hints->y_delta;
-
-
   hints->num_points = 0;
   hints->num_contours = 0;
 
@@ -730,9 +724,22 @@ ta_glyph_hints_reload(TA_GlyphHints hints,
   hints->axis[0].num_edges = 0;
   hints->axis[1].num_segments = 0;
   hints->axis[1].num_edges = 0;
+}
+
+
+/* make the points and contours arrays large enough */
+/* for a glyph with `num_points' points and `num_contours' contours */
+
+FT_Error
+ta_glyph_hints_reserve(TA_GlyphHints hints,
+                       FT_UInt num_points,
+                       FT_UInt num_contours)
+{
+  FT_UInt old_max, new_max;
 
-  /* first of all, reallocate the contours array if necessary */
-  new_max = (FT_UInt)outline->n_contours;
+
+  /* reallocate the contours array if necessary */
+  new_max = num_contours;
   old_max = (FT_UInt)hints->max_contours;
 
   if (new_max <= TA_CONTOURS_EMBEDDED)
@@ -763,8 +770,9 @@ ta_glyph_hints_reload(TA_GlyphHints hints,
   }
 
   /* reallocate the points arrays if necessary -- we reserve */
-  /* two additional point positions, used to hint metrics appropriately */
-  new_max = (FT_UInt)(outline->n_points + 2);
+  /* two additional point positions, used to hint metrics appropriately; */
+  /* the coordinate arrays are allocated together with the points */
+  new_max = num_points + 2;
   old_max = (FT_UInt)hints->max_points;
 
   if (new_max <= TA_POINTS_EMBEDDED)
@@ -772,6 +780,7 @@ ta_glyph_hints_reload(TA_GlyphHints hints,
     if (!hints->points)
     {
       hints->points = hints->embedded.points;
+      hints->coords = hints->embedded.coords;
       hints->max_points = TA_POINTS_EMBEDDED;
     }
   }
@@ -786,14 +795,49 @@ ta_glyph_hints_reload(TA_GlyphHints hints,
     new_max = (new_max + 2 + 7) & ~7U; /* round up to a multiple of 8 */
 
     points_new = (TA_Point)realloc(hints->points,
-                                   new_max * sizeof (TA_PointRec));
+                                   new_max * (sizeof (TA_PointRec)
+                                              + 4 * sizeof (FT_Pos)));
     if (!points_new)
       return FT_Err_Out_Of_Memory;
 
     hints->points = points_new;
+    hints->coords = (FT_Pos*)(points_new + new_max);
     hints->max_points = (FT_Int)new_max;
   }
 
+  return FT_Err_Ok;
+}
+
+
+/* recompute all TA_Point in TA_GlyphHints */
+/* from the definitions in a source outline */
+
+FT_Error
+ta_glyph_hints_reload(TA_GlyphHints hints,
+                      FT_Outline* outline)
+{
+  FT_Error error;
+  TA_Point points;
+
+  FT_Fixed x_scale = hints->x_scale;
+  FT_Fixed y_scale = hints->y_scale;
+  FT_Pos x_delta = hints->x_delta;
+  FT_Pos y_delta = hints->y_delta;
+
+
+  ta_glyph_hints_reset(hints);
+
+  error = ta_glyph_hints_reserve(hints,
+                                 (FT_UInt)outline->n_points,
+                                 (FT_UInt)outline->n_contours);
+  if (error)
+    return error;
+
+  hints->ox = hints->coords;
+  hints->oy = hints->ox + hints->max_points;
+  hints->x = hints->oy + hints->max_points;
+  hints->y = hints->x + hints->max_points;
+
   hints->num_points = outline->n_points;
   hints->num_contours = outline->n_contours;
 
@@ -827,7 +871,15 @@ ta_glyph_hints_reload(TA_GlyphHints hints,
     TA_Point point_limit = points + hints->num_points;
 
 
-    /* compute coordinates & Bezier flags, next and prev */
+    /* compute coordinates */
+    ta_simd_scale_vectors(hints->simd_level,
+                          outline->points, (FT_UInt)hints->num_points,
+                          x_scale, x_delta, y_scale, y_delta,
+                          hints->ox, hints->oy);
+    memcpy(hints->x, hints->ox, (size_t)hints->num_points * sizeof (FT_Pos));
+    memcpy(hints->y, hints->oy, (size_t)hints->num_points * sizeof (FT_Pos));
+
+    /* compute Bezier flags, next and prev */
     {
       FT_Vector* vec = outline->points;
       char* tag = outline->tags;
@@ -845,8 +897,6 @@ ta_glyph_hints_reload(TA_GlyphHints hints,
 
         point->fx = (FT_Short)vec->x;
         point->fy = (FT_Short)vec->y;
-        point->ox = point->x = FT_MulFix(vec->x, x_scale) + x_delta;
-        point->oy = point->y = FT_MulFix(vec->y, y_scale) + y_delta;
 
         switch (FT_CURVE_TAG(*tag))
         {
@@ -1167,15 +1217,15 @@ ta_glyph_hints_save(TA_GlyphHints hints,
   TA_Point point = hints->points;
   TA_Point limit = point + hints->num_points;
 
-  FT_Vector* vec = outline->points;
   char* tag = outline->tags;
 
 
-  for (; point < limit; point++, vec++, tag++)
-  {
-    vec->x = point->x;
-    vec->y = point->y;
+  ta_simd_store_vectors(hints->simd_level,
+                        outline->points, (FT_UInt)hints->num_points,
+                        hints->x, hints->y);
 
+  for (; point < limit; point++, tag++)
+  {
     if (point->flags & TA_FLAG_CONIC)
       tag[0] = FT_CURVE_TAG_CONIC;
     else if (point->flags & TA_FLAG_CUBIC)
@@ -1222,7 +1272,7 @@ ta_glyph_hints_align_edge_points(TA_GlyphHints hints,
       point = first;
       for (;;)
       {
-        point->x = edge->pos;
+        hints->x[point - hints->points] = edge->pos;
         point->flags |= TA_FLAG_TOUCH_X;
 
         if (point == last)
@@ -1248,7 +1298,7 @@ ta_glyph_hints_align_edge_points(TA_GlyphHints hints,
       point = first;
       for (;;)
       {
-        point->y = edge->pos;
+        hints->y[point - hints->points] = edge->pos;
         point->flags |= TA_FLAG_TOUCH_Y;
 
         if (point == last)
@@ -1284,12 +1334,22 @@ ta_glyph_hints_align_strong_points(TA_GlyphHints hints,
   TA_Edge edge_limit = edges + axis->num_edges;
 
   FT_UShort touch_flag;
+  FT_Pos* org;
+  FT_Pos* cur;
 
 
   if (dim == TA_DIMENSION_HORZ)
+  {
     touch_flag = TA_FLAG_TOUCH_X;
+    org = hints->ox;
+    cur = hints->x;
+  }
   else
+  {
     touch_flag = TA_FLAG_TOUCH_Y;
+    org = hints->oy;
+    cur = hints->y;
+  }
 
   if (edges < edge_limit)
   {
@@ -1313,15 +1373,10 @@ ta_glyph_hints_align_strong_points(TA_GlyphHints hints,
         continue;
 
       if (dim == TA_DIMENSION_VERT)
-      {
         u = point->fy;
-        ou = point->oy;
-      }
       else
-      {
         u = point->fx;
-        ou = point->ox;
-      }
+      ou = org[point - points];
 
       fu = u;
 
@@ -1450,10 +1505,7 @@ ta_glyph_hints_align_strong_points(TA_GlyphHints hints,
 
     Store_Point:
       /* save the point position */
-      if (dim == TA_DIMENSION_HORZ)
-        point->x = u;
-      else
-        point->y = u;
+      cur[point - points] = u;
 
       point->flags |= touch_flag;
     }
@@ -1470,97 +1522,80 @@ ta_glyph_hints_align_strong_points(TA_GlyphHints hints,
 
 /* shift the original coordinates of all points between `p1' and */
 /* `p2' to get hinted coordinates, using the same difference as */
-/* given by `ref' */
+/* given by `ref'; `cur' and `org' hold the current and original */
+/* coordinate values, respectively */
 
 static void
-ta_iup_shift(TA_Point p1,
-             TA_Point p2,
-             TA_Point ref)
+ta_iup_shift(FT_Int simd_level,
+             FT_Pos* cur,
+             const FT_Pos* org,
+             FT_Int p1,
+             FT_Int p2,
+             FT_Int ref)
 {
-  TA_Point p;
-  FT_Pos delta = ref->u - ref->v;
+  FT_Pos delta = cur[ref] - org[ref];
 
 
   if (delta == 0)
     return;
 
-  for (p = p1; p < ref; p++)
-    p->u = p->v + delta;
+  if (p1 < ref)
+    ta_simd_iup_shift(simd_level,
+                      cur + p1, org + p1, (FT_UInt)(ref - p1), delta);
 
-  for (p = ref + 1; p <= p2; p++)
-    p->u = p->v + delta;
+  if (ref < p2)
+    ta_simd_iup_shift(simd_level,
+                      cur + ref + 1, org + ref + 1,
+                      (FT_UInt)(p2 - ref), delta);
 }
 
 
 /* interpolate the original coordinates of all points between `p1' and */
 /* `p2' to get hinted coordinates, using `ref1' and `ref2' as the */
-/* reference points; the `u' and `v' members are the current and */
-/* original coordinate values, respectively. */
+/* reference points; `cur' and `org' hold the current and original */
+/* coordinate values, respectively */
 
 /* details can be found in the TrueType bytecode specification */
 
 static void
-ta_iup_interp(TA_Point p1,
-              TA_Point p2,
-              TA_Point ref1,
-              TA_Point ref2)
+ta_iup_interp(FT_Int simd_level,
+              FT_Pos* cur,
+              const FT_Pos* org,
+              FT_Int p1,
+              FT_Int p2,
+              FT_Int ref1,
+              FT_Int ref2)
 {
-  TA_Point p;
-  FT_Pos u, v1, v2, u1, u2, d1, d2;
+  FT_Int p;
+  FT_Pos v1, v2, u1, u2;
+  FT_Fixed scale;
 
 
   if (p1 > p2)
     return;
 
-  if (ref1->v > ref2->v)
+  if (org[ref1] > org[ref2])
   {
     p = ref1;
     ref1 = ref2;
     ref2 = p;
   }
 
-  v1 = ref1->v;
-  v2 = ref2->v;
-  u1 = ref1->u;
-  u2 = ref2->u;
-  d1 = u1 - v1;
-  d2 = u2 - v2;
+  v1 = org[ref1];
+  v2 = org[ref2];
+  u1 = cur[ref1];
+  u2 = cur[ref2];
 
+  /* with a zero scaling value, all points */
+  /* between `v1' and `v2' are set to `u1' */
   if (u1 == u2 || v1 == v2)
-  {
-    for (p = p1; p <= p2; p++)
-    {
-      u = p->v;
-
-      if (u <= v1)
-        u += d1;
-      else if (u >= v2)
-        u += d2;
-      else
-        u = u1;
-
-      p->u = u;
-    }
-  }
+    scale = 0;
   else
-  {
-    FT_Fixed scale = FT_DivFix(u2 - u1, v2 - v1);
-
-
-    for (p = p1; p <= p2; p++)
-    {
-      u = p->v;
-
-      if (u <= v1)
-        u += d1;
-      else if (u >= v2)
-        u += d2;
-      else
-        u = u1 + FT_MulFix(u - v1, scale);
+    scale = FT_DivFix(u2 - u1, v2 - v1);
 
-      p->u = u;
-    }
-  }
+  ta_simd_iup_interp(simd_level,
+                     cur + p1, org + p1, (FT_UInt)(p2 - p1 + 1),
+                     v1, v2, u1, u2, scale);
 }
 
 
@@ -1572,47 +1607,42 @@ ta_glyph_hints_align_weak_points(TA_GlyphHints hints,
                                  TA_Dimension dim)
 {
   TA_Point points = hints->points;
-  TA_Point point_limit = points + hints->num_points;
 
   TA_Point* contour = hints->contours;
   TA_Point* contour_limit = contour + hints->num_contours;
 
   FT_UShort touch_flag;
-  TA_Point point;
-  TA_Point end_point;
-  TA_Point first_point;
+  FT_Pos* org;
+  FT_Pos* cur;
+
+  FT_Int point;
+  FT_Int end_point;
+  FT_Int first_point;
 
 
-  /* pass 1: move segment points to edge positions */
+  /* since the coordinates of all points are stored in arrays, */
+  /* we can directly interpolate the current coordinates */
 
   if (dim == TA_DIMENSION_HORZ)
   {
     touch_flag = TA_FLAG_TOUCH_X;
-
-    for (point = points; point < point_limit; point++)
-    {
-      point->u = point->x;
-      point->v = point->ox;
-    }
+    org = hints->ox;
+    cur = hints->x;
   }
   else
   {
     touch_flag = TA_FLAG_TOUCH_Y;
-
-    for (point = points; point < point_limit; point++)
-    {
-      point->u = point->y;
-      point->v = point->oy;
-    }
+    org = hints->oy;
+    cur = hints->y;
   }
 
   for (; contour < contour_limit; contour++)
   {
-    TA_Point first_touched, last_touched;
+    FT_Int first_touched, last_touched;
 
 
-    point = *contour;
-    end_point = point->prev;
+    point = (FT_Int)(*contour - points);
+    end_point = (FT_Int)((*contour)->prev - points);
     first_point = point;
 
     /* find first touched point */
@@ -1621,7 +1651,7 @@ ta_glyph_hints_align_weak_points(TA_GlyphHints hints,
       if (point > end_point) /* no touched point in contour */
         goto NextContour;
 
-      if (point->flags & touch_flag)
+      if (points[point].flags & touch_flag)
         break;
 
       point++;
@@ -1633,7 +1663,7 @@ ta_glyph_hints_align_weak_points(TA_GlyphHints hints,
     {
       /* skip any touched neighbours */
       while (point < end_point
-             && (point[1].flags & touch_flag) != 0)
+             && (points[point + 1].flags & touch_flag) != 0)
         point++;
 
       last_touched = point;
@@ -1645,48 +1675,40 @@ ta_glyph_hints_align_weak_points(TA_GlyphHints hints,
         if (point > end_point)
           goto EndContour;
 
-        if ((point->flags & touch_flag) != 0)
+        if ((points[point].flags & touch_flag) != 0)
           break;
 
         point++;
       }
 
       /* interpolate between last_touched and point */
-      ta_iup_interp(last_touched + 1, point - 1,
+      ta_iup_interp(hints->simd_level, cur, org,
+                    last_touched + 1, point - 1,
                     last_touched, point);
     }
 
   EndContour:
     /* special case: only one point was touched */
     if (last_touched == first_touched)
-      ta_iup_shift(first_point, end_point, first_touched);
+      ta_iup_shift(hints->simd_level, cur, org,
+                   first_point, end_point, first_touched);
 
     else /* interpolate the last part */
     {
       if (last_touched < end_point)
-        ta_iup_interp(last_touched + 1, end_point,
+        ta_iup_interp(hints->simd_level, cur, org,
+                      last_touched + 1, end_point,
                       last_touched, first_touched);
 
-      if (first_touched > points)
-        ta_iup_interp(first_point, first_touched - 1,
+      if (first_touched > 0)
+        ta_iup_interp(hints->simd_level, cur, org,
+                      first_point, first_touched - 1,
                       last_touched, first_touched);
     }
 
   NextContour:
     ;
   }
-
-  /* now save the interpolated values back to x/y */
-  if (dim == TA_DIMENSION_HORZ)
-  {
-    for (point = points; point < point_limit; point++)
-      point->x = point->u;
-  }
-  else
-  {
-    for (point = points; point < point_limit; point++)
-      point->y = point->u;
-  }
 }
 
 
@@ -1708,12 +1730,12 @@ ta_glyph_hints_scale_dim(TA_GlyphHints hints,
   if (dim == TA_DIMENSION_HORZ)
   {
     for (point = points; point < points_limit; point++)
-      point->x = FT_MulFix(point->fx, scale) + delta;
+      hints->x[point - points] = FT_MulFix(point->fx, scale) + delta;
   }
   else
   {
     for (point = points; point < points_limit; point++)
-      point->y = FT_MulFix(point->fy, scale) + delta;
+      hints->y[point - points] = FT_MulFix(point->fy, scale) + delta;
   }
 }
 
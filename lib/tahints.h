@@ -239,9 +239,10 @@ typedef struct TA_PointRec_
   FT_Char in_dir; /* direction of inwards vector */
   FT_Char out_dir; /* direction of outwards vector */
 
-  FT_Pos ox, oy; /* original, scaled position */
+  /* the scaled and the current position are stored */
+  /* in the arrays `ox', `oy', `x', and `y' of `TA_GlyphHintsRec' */
+
   FT_Short fx, fy; /* original, unscaled position (in font units) */
-  FT_Pos x, y; /* current position */
   FT_Pos u, v; /* current (x,y) or (y,x) depending on context */
 
   FT_Short left_offset; /* left offset in one-point segments */
@@ -443,6 +444,16 @@ typedef struct TA_GlyphHintsRec_
   FT_Int num_points; /* number of used points */
   TA_Point points; /* points array */
 
+  /* the coordinates of `points', stored as a structure of arrays */
+  /* (with the same index) to make them accessible to SIMD kernels */
+  FT_Pos* coords; /* holds the following four arrays */
+  FT_Pos* ox; /* original, scaled position */
+  FT_Pos* oy;
+  FT_Pos* x; /* current position */
+  FT_Pos* y;
+
+  FT_Int simd_level; /* the best instruction set we may use */
+
   FT_Int max_contours; /* number of allocated contours */
   FT_Int num_contours; /* number of used contours */
   TA_Point* contours; /* contours array */
@@ -465,6 +476,7 @@ typedef struct TA_GlyphHintsRec_
   {
     TA_Point contours[TA_CONTOURS_EMBEDDED];
     TA_PointRec points[TA_POINTS_EMBEDDED];
+    FT_Pos coords[4 * TA_POINTS_EMBEDDED];
   } embedded;
 } TA_GlyphHintsRec;
 
@@ -543,6 +555,14 @@ void
 ta_glyph_hints_rescale(TA_GlyphHints hints,
                        TA_StyleMetrics metrics);
 
+void
+ta_glyph_hints_reset(TA_GlyphHints hints);
+
+FT_Error
+ta_glyph_hints_reserve(TA_GlyphHints hints,
+                       FT_UInt num_points,
+                       FT_UInt num_contours);
+
 FT_Error
 ta_glyph_hints_reload(TA_GlyphHints hints,
                       FT_Outline* outline);
@@ -18,6 +18,8 @@
 /* heavily modified 2011 by Werner Lemberg <wl@gnu.org> */
 
 #include <config.h>
+#include <limits.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include <ft2build.h>
@@ -26,6 +28,7 @@
 
 #include "taglobal.h"
 #include "talatin.h"
+#include "taprof.h"
 #include "tasort.h"
 
 
@@ -40,6 +43,40 @@
 #define FLAT_THRESHOLD(x)  (x / 14)
 
 
+/* load the unscaled outline of a glyph; */
+/* glyphs of the font itself come from the outline cache */
+/* of the face globals, shared by all styles */
+
+static FT_Error
+ta_latin_metrics_load_outline(TA_LatinMetrics metrics,
+                              FT_Face face,
+                              FT_ULong glyph_index,
+                              FT_Outline* outline)
+{
+  TA_FaceGlobals globals = metrics->root.globals;
+  FT_Outline* cached;
+  FT_Error error;
+
+
+  if (face == globals->face)
+  {
+    error = ta_face_globals_get_outline(globals,
+                                        (FT_UInt)glyph_index,
+                                        &cached);
+    if (!error)
+      *outline = *cached;
+  }
+  else
+  {
+    /* a reference font */
+    error = FT_Load_Glyph(face, glyph_index, FT_LOAD_NO_SCALE);
+    *outline = face->glyph->outline;
+  }
+
+  return error;
+}
+
+
 /* find segments and links, compute all stem widths, and initialize */
 /* standard width and height for the glyph with given charcode */
 
@@ -59,6 +96,7 @@ ta_latin_metrics_init_widths(TA_LatinMetrics metrics,
                  ta_style_names[metrics->root.style_class->style]));
 
   ta_glyph_hints_init(hints);
+  hints->simd_level = metrics->root.globals->font->simd_level;
 
   metrics->axis[TA_DIMENSION_HORZ].width_count = 0;
   metrics->axis[TA_DIMENSION_VERT].width_count = 0;
@@ -69,6 +107,7 @@ ta_latin_metrics_init_widths(TA_LatinMetrics metrics,
     int dim, dim_max;
     TA_LatinMetricsRec dummy[1];
     TA_Scaler scaler = &dummy->root.scaler;
+    FT_Outline outline;
 
     TA_StyleClass style_class = metrics->root.style_class;
     TA_ScriptClass script_class = ta_script_classes[style_class->script];
@@ -173,8 +212,9 @@ ta_latin_metrics_init_widths(TA_LatinMetrics metrics,
     TA_LOG_GLOBAL(("standard character: U+%04lX (glyph index %d)\n",
                    ch, glyph_index));
 
-    error = FT_Load_Glyph(face, glyph_index, FT_LOAD_NO_SCALE);
-    if (error || face->glyph->outline.n_points <= 0)
+    error = ta_latin_metrics_load_outline(metrics, face,
+                                          glyph_index, &outline);
+    if (error || outline.n_points <= 0)
       goto Exit;
 
     memset(dummy, 0, sizeof (TA_LatinMetricsRec));
@@ -192,7 +232,7 @@ ta_latin_metrics_init_widths(TA_LatinMetrics metrics,
 
     ta_glyph_hints_rescale(hints, (TA_StyleMetrics)dummy);
 
-    error = ta_glyph_hints_reload(hints, &face->glyph->outline);
+    error = ta_glyph_hints_reload(hints, &outline);
     if (error)
       goto Exit;
 
@@ -510,8 +550,8 @@ ta_latin_metrics_init_blues(TA_LatinMetrics metrics,
           continue;
         }
 
-        error = FT_Load_Glyph(face, glyph_index, FT_LOAD_NO_SCALE);
-        outline = face->glyph->outline;
+        error = ta_latin_metrics_load_outline(metrics, face,
+                                              glyph_index, &outline);
         /* reject glyphs that don't produce any rendering */
         if (error || outline.n_points <= 2)
         {
@@ -2028,6 +2068,395 @@ Exit:
 }
 
 
+/* the parameters of the scoring function for linking segments */
+
+typedef struct TA_LatinLinkParams_
+{
+  FT_Pos len_threshold; /* minimum overlap */
+  FT_Pos len_score; /* weight of the overlap */
+  FT_Pos dist_score; /* weight of the distance */
+  FT_Pos max_width; /* the largest stem width or zero */
+} TA_LatinLinkParams;
+
+
+/* the number of segments below which we don't sort */
+#define TA_LATIN_LINK_SORT_MIN 32
+
+/* scores of this value or larger never link segments */
+#define TA_LATIN_LINK_MAX_SCORE 32000
+
+
+/* return the overlap of `seg1' and `seg2'; */
+/* a value less than `len_threshold' means no overlap */
+
+static FT_Pos
+ta_latin_link_overlap(const TA_LatinLinkParams* params,
+                      TA_Segment seg1,
+                      TA_Segment seg2)
+{
+  FT_Pos min = seg1->min_coord;
+  FT_Pos max = seg1->max_coord;
+  FT_Pos len;
+
+
+  if (min < seg2->min_coord)
+    min = seg2->min_coord;
+  if (max > seg2->max_coord)
+    max = seg2->max_coord;
+
+  /* compute maximum coordinate difference of the two segments */
+  /* (this is, how much they overlap) */
+  len = max - min;
+
+  /* for one-point segments, `len' is zero if there is an overlap */
+  /* (and negative otherwise); we have to correct this */
+  if (len == 0
+      && (seg1->min_coord == seg1->max_coord
+          || seg2->min_coord == seg2->max_coord))
+    len = params->len_threshold;
+
+  return len;
+}
+
+
+/*
+ * The score is the sum of two demerits indicating the `badness' of a
+ * fit, measured along the segments' main axis and orthogonal to it,
+ * respectively.
+ *
+ * o The less overlapping along the main axis, the worse it is, causing
+ *   a larger demerit.
+ *
+ * o The nearer the orthogonal distance to a stem width, the better it
+ *   is, causing a smaller demerit.  For simplicity, however, we only
+ *   increase the demerit for values that exceed the largest stem width.
+ *
+ * This function computes the latter; for a given distance `dist', the
+ * value of `min(dist_demerit(dist), TA_LATIN_LINK_MAX_SCORE)' is a lower
+ * bound of the demerits of all larger distances.
+ */
+
+static FT_Pos
+ta_latin_link_dist_demerit(const TA_LatinLinkParams* params,
+                           FT_Pos dist)
+{
+  FT_Pos dist_demerit;
+
+
+  if (params->max_width)
+  {
+    /* distance demerits are based on multiples of `max_width'; */
+    /* we scale by 1024 for getting more precision */
+    FT_Pos delta = (dist << 10) / params->max_width - (1 << 10);
+
+
+    if (delta > 10000)
+      dist_demerit = 32000;
+    else if (delta > 0)
+      dist_demerit = delta * delta / params->dist_score;
+    else
+      dist_demerit = 0;
+  }
+  else
+    dist_demerit = dist; /* default if no widths available */
+
+  return dist_demerit;
+}
+
+
+static int
+ta_latin_link_compare(const void* a,
+                      const void* b)
+{
+  TA_Segment seg_a = *(const TA_Segment*)a;
+  TA_Segment seg_b = *(const TA_Segment*)b;
+
+
+  if (seg_a->pos < seg_b->pos)
+    return -1;
+  if (seg_a->pos > seg_b->pos)
+    return 1;
+  return 0;
+}
+
+
+/* return the maximum score of the candidates in the range [idx;count) */
+
+static FT_Pos
+ta_latin_link_max_score(FT_Pos* tree,
+                        FT_UInt size,
+                        FT_UInt idx,
+                        FT_UInt count)
+{
+  FT_Pos max = LONG_MIN;
+  FT_UInt lo = idx + size;
+  FT_UInt hi = count + size;
+
+
+  while (lo < hi)
+  {
+    if (lo & 1)
+    {
+      if (tree[lo] > max)
+        max = tree[lo];
+      lo++;
+    }
+    if (hi & 1)
+    {
+      hi--;
+      if (tree[hi] > max)
+        max = tree[hi];
+    }
+
+    lo >>= 1;
+    hi >>= 1;
+  }
+
+  return max;
+}
+
+
+static void
+ta_latin_link_set_score(FT_Pos* tree,
+                        FT_UInt size,
+                        FT_UInt idx,
+                        FT_Pos score)
+{
+  idx += size;
+  tree[idx] = score;
+
+  for (idx >>= 1; idx; idx >>= 1)
+    tree[idx] = tree[2 * idx] > tree[2 * idx + 1] ? tree[2 * idx]
+                                                  : tree[2 * idx + 1];
+}
+
+
+/* return the first candidate index not smaller than `idx' in the */
+/* subtree `node' (covering [node_lo;node_hi)) whose coordinate range */
+/* might overlap [min;max]; return value `size' means none */
+
+static FT_UInt
+ta_latin_link_next_overlap(FT_Pos* mins,
+                           FT_Pos* maxs,
+                           FT_UInt size,
+                           FT_UInt node,
+                           FT_UInt node_lo,
+                           FT_UInt node_hi,
+                           FT_UInt idx,
+                           FT_Pos min,
+                           FT_Pos max)
+{
+  FT_UInt node_mid;
+  FT_UInt found;
+
+
+  /* overlapping segments (including one-point segments) */
+  /* have a non-negative overlap length */
+  if (node_hi <= idx
+      || mins[node] > max
+      || maxs[node] < min)
+    return size;
+
+  if (node >= size)
+    return node - size;
+
+  node_mid = (node_lo + node_hi) / 2;
+
+  found = ta_latin_link_next_overlap(mins, maxs, size,
+                                     2 * node, node_lo, node_mid,
+                                     idx, min, max);
+  if (found < size)
+    return found;
+
+  return ta_latin_link_next_overlap(mins, maxs, size,
+                                    2 * node + 1, node_mid, node_hi,
+                                    idx, min, max);
+}
+
+
+/*
+ * Link segments like the quadratic loop in `ta_latin_hints_link_segments'
+ * but without looking at all pairs, giving exactly the same result.
+ *
+ * The candidates for `seg2' (all segments with direction opposite to
+ * `major_dir') get sorted by position; for a given `seg1' we start with
+ * the first candidate to its `right' and stop as soon as the distance
+ * demerit is so large that neither `seg1' nor any of the remaining
+ * candidates can get a better score.  To know the latter, a segment tree
+ * holds the current scores of the candidates.  Since a score of
+ * TA_LATIN_LINK_MAX_SCORE never links, the scan never leaves the window of
+ * positions derived from `max_width'.  Within that window, two more
+ * segment trees holding the coordinate ranges of the candidates let us
+ * jump directly to the next candidate that can overlap `seg1'.
+ *
+ * The worst case is still quadratic: many candidates within the window
+ * whose coordinate ranges all overlap `seg1' (or, more rarely, whose
+ * ranges are interleaved so that the tree nodes overlap `seg1' while the
+ * single candidates don't).  Such glyphs don't occur in practice, and
+ * for small numbers of segments we use the original loop anyway.
+ *
+ * With the original loop, `seg1' links to the first candidate (in
+ * segment order) having the minimal score; since we visit candidates in
+ * position order, equal scores are resolved by comparing the segment
+ * addresses.  All other updates happen in the same order as before.
+ *
+ * Return value is 1 if we run out of memory.
+ */
+
+static FT_Bool
+ta_latin_link_segments_sorted(TA_AxisHints axis,
+                              const TA_LatinLinkParams* params)
+{
+  TA_Segment segments = axis->segments;
+  TA_Segment segment_limit = segments + axis->num_segments;
+  TA_Segment seg1, seg2;
+
+  TA_Segment* cands;
+  FT_UInt* ranks;
+  FT_Pos* tree;
+  FT_Pos* mins;
+  FT_Pos* maxs;
+  FT_UInt num_cands = 0;
+  FT_UInt size;
+  FT_UInt i;
+
+
+  for (seg2 = segments; seg2 < segment_limit; seg2++)
+    if (seg2->dir + axis->major_dir == 0)
+      num_cands++;
+
+  if (!num_cands)
+    return 0;
+
+  for (size = 1; size < num_cands; size <<= 1)
+    ;
+
+  cands = (TA_Segment*)malloc(num_cands * sizeof (TA_Segment)
+                              + axis->num_segments * sizeof (FT_UInt)
+                              + 3 * 2 * size * sizeof (FT_Pos));
+  if (!cands)
+    return 1;
+
+  tree = (FT_Pos*)(cands + num_cands);
+  mins = tree + 2 * size;
+  maxs = mins + 2 * size;
+  ranks = (FT_UInt*)(maxs + 2 * size);
+
+  i = 0;
+  for (seg2 = segments; seg2 < segment_limit; seg2++)
+    if (seg2->dir + axis->major_dir == 0)
+      cands[i++] = seg2;
+
+  qsort(cands, num_cands, sizeof (TA_Segment), ta_latin_link_compare);
+
+  for (i = 0; i < size; i++)
+  {
+    if (i < num_cands)
+    {
+      ranks[cands[i] - segments] = i;
+      tree[size + i] = cands[i]->score;
+      mins[size + i] = cands[i]->min_coord;
+      maxs[size + i] = cands[i]->max_coord;
+    }
+    else
+    {
+      tree[size + i] = LONG_MIN;
+      mins[size + i] = LONG_MAX;
+      maxs[size + i] = LONG_MIN;
+    }
+  }
+  for (i = size - 1; i > 0; i--)
+  {
+    tree[i] = tree[2 * i] > tree[2 * i + 1] ? tree[2 * i]
+                                            : tree[2 * i + 1];
+    mins[i] = mins[2 * i] < mins[2 * i + 1] ? mins[2 * i]
+                                            : mins[2 * i + 1];
+    maxs[i] = maxs[2 * i] > maxs[2 * i + 1] ? maxs[2 * i]
+                                            : maxs[2 * i + 1];
+  }
+
+  for (seg1 = segments; seg1 < segment_limit; seg1++)
+  {
+    FT_Pos pos1 = seg1->pos;
+    FT_UInt lo, hi;
+
+
+    if (seg1->dir != axis->major_dir)
+      continue;
+
+    /* find the first candidate with `pos2 > pos1' */
+    lo = 0;
+    hi = num_cands;
+    while (lo < hi)
+    {
+      FT_UInt mid = (lo + hi) / 2;
+
+
+      if (cands[mid]->pos > pos1)
+        hi = mid;
+      else
+        lo = mid + 1;
+    }
+
+    /* skip candidates that can't overlap `seg1' */
+    for (i = ta_latin_link_next_overlap(mins, maxs, size, 1, 0, size, lo,
+                                        seg1->min_coord, seg1->max_coord);
+         i < num_cands;
+         i = ta_latin_link_next_overlap(mins, maxs, size, 1, 0, size, i + 1,
+                                        seg1->min_coord, seg1->max_coord))
+    {
+      FT_Pos dist_demerit, bound, len, score;
+
+
+      seg2 = cands[i];
+
+      dist_demerit = ta_latin_link_dist_demerit(params, seg2->pos - pos1);
+
+      bound = dist_demerit;
+      if (bound > TA_LATIN_LINK_MAX_SCORE)
+        bound = TA_LATIN_LINK_MAX_SCORE;
+
+      /* no remaining pair can link */
+      if (bound >= TA_LATIN_LINK_MAX_SCORE)
+        break;
+
+      /* no remaining pair can improve a score */
+      if (bound > seg1->score
+          && bound >= ta_latin_link_max_score(tree, size, i, num_cands))
+        break;
+
+      len = ta_latin_link_overlap(params, seg1, seg2);
+      if (len < params->len_threshold)
+        continue;
+
+      score = dist_demerit + params->len_score / len;
+
+      /* and we search for the smallest score */
+      if (score < seg1->score
+          || (score == seg1->score
+              && seg1->link
+              && seg2 < seg1->link))
+      {
+        seg1->score = score;
+        seg1->link = seg2;
+      }
+
+      if (score < seg2->score)
+      {
+        seg2->score = score;
+        seg2->link = seg1;
+
+        ta_latin_link_set_score(tree, size, ranks[seg2 - segments], score);
+      }
+    }
+  }
+
+  free(cands);
+
+  return 0;
+}
+
+
 /* link segments to form stems and serifs; if `width_count' and */
 /* `widths' are non-zero, use them to fine-tune the scoring function */
 
@@ -2042,27 +2471,32 @@ ta_latin_hints_link_segments(TA_GlyphHints hints,
   TA_Segment segments = axis->segments;
   TA_Segment segment_limit = segments + axis->num_segments;
 
-  FT_Pos len_threshold, len_score, dist_score, max_width;
+  TA_LatinLinkParams params;
   TA_Segment seg1, seg2;
 
 
   if (width_count)
-    max_width = widths[width_count - 1].org;
+    params.max_width = widths[width_count - 1].org;
   else
-    max_width = 0;
+    params.max_width = 0;
 
   /* a heuristic value to set up a minimum value for overlapping */
-  len_threshold = TA_LATIN_CONSTANT(hints->metrics, 8);
-  if (len_threshold == 0)
-    len_threshold = 1;
+  params.len_threshold = TA_LATIN_CONSTANT(hints->metrics, 8);
+  if (params.len_threshold == 0)
+    params.len_threshold = 1;
 
   /* a heuristic value to weight lengths */
-  len_score = TA_LATIN_CONSTANT(hints->metrics, 6000);
+  params.len_score = TA_LATIN_CONSTANT(hints->metrics, 6000);
 
   /* a heuristic value to weight distances (no call to */
   /* TA_LATIN_CONSTANT needed, since we work on multiples */
   /* of the stem width) */
-  dist_score = 3000;
+  params.dist_score = 3000;
+
+  /* for glyphs with many segments, avoid comparing all pairs */
+  if (axis->num_segments >= TA_LATIN_LINK_SORT_MIN
+      && !ta_latin_link_segments_sorted(axis, &params))
+    goto Serifs;
 
   /* now compare each segment to the others */
   for (seg1 = segments; seg1 < segment_limit; seg1++)
@@ -2082,66 +2516,18 @@ ta_latin_hints_link_segments(TA_GlyphHints hints,
           && pos2 > pos1)
       {
         /* compute distance between the two segments */
-        FT_Pos min = seg1->min_coord;
-        FT_Pos max = seg1->max_coord;
-        FT_Pos len;
-
-
-        if (min < seg2->min_coord)
-          min = seg2->min_coord;
-        if (max > seg2->max_coord)
-          max = seg2->max_coord;
-
-        /* compute maximum coordinate difference of the two segments */
-        /* (this is, how much they overlap) */
-        len = max - min;
+        FT_Pos len = ta_latin_link_overlap(&params, seg1, seg2);
 
-        /* for one-point segments, `len' is zero if there is an overlap */
-        /* (and negative otherwise); we have to correct this */
-        if (len == 0
-            && (seg1->min_coord == seg1->max_coord
-                || seg2->min_coord == seg2->max_coord))
-          len = len_threshold;
 
-        if (len >= len_threshold)
+        if (len >= params.len_threshold)
         {
-          /*
-           * The score is the sum of two demerits indicating the
-           * `badness' of a fit, measured along the segments' main axis
-           * and orthogonal to it, respectively.
-           *
-           * o The less overlapping along the main axis, the worse it
-           *   is, causing a larger demerit.
-           *
-           * o The nearer the orthogonal distance to a stem width, the
-           *   better it is, causing a smaller demerit.  For simplicity,
-           *   however, we only increase the demerit for values that
-           *   exceed the largest stem width.
-           */
-
           FT_Pos dist = pos2 - pos1;
 
           FT_Pos dist_demerit, score;
 
 
-          if (max_width)
-          {
-            /* distance demerits are based on multiples of `max_width'; */
-            /* we scale by 1024 for getting more precision */
-            FT_Pos delta = (dist << 10) / max_width - (1 << 10);
-
-
-            if (delta > 10000)
-              dist_demerit = 32000;
-            else if (delta > 0)
-              dist_demerit = delta * delta / dist_score;
-            else
-              dist_demerit = 0;
-          }
-          else
-            dist_demerit = dist; /* default if no widths available */
-
-          score = dist_demerit + len_score / len;
+          dist_demerit = ta_latin_link_dist_demerit(&params, dist);
+          score = dist_demerit + params.len_score / len;
 
           /* and we search for the smallest score */
           if (score < seg1->score)
@@ -2160,6 +2546,7 @@ ta_latin_hints_link_segments(TA_GlyphHints hints,
     }
   }
 
+Serifs:
   /* now compute the `serif' segments, cf. explanations in `tahints.h' */
   for (seg1 = segments; seg1 < segment_limit; seg1++)
   {
@@ -2531,12 +2918,18 @@ ta_latin_hints_detect_features(TA_GlyphHints hints,
   FT_Error error;
 
 
+  TA_PROF_ENTER(TA_PROF_SEGMENTS);
   error = ta_latin_hints_compute_segments(hints, dim);
+  TA_PROF_LEAVE(TA_PROF_SEGMENTS);
   if (!error)
   {
+    TA_PROF_ENTER(TA_PROF_LINK);
     ta_latin_hints_link_segments(hints, width_count, widths, dim);
+    TA_PROF_LEAVE(TA_PROF_LINK);
 
+    TA_PROF_ENTER(TA_PROF_EDGES);
     error = ta_latin_hints_compute_edges(hints, dim);
+    TA_PROF_LEAVE(TA_PROF_EDGES);
   }
 
   return error;
@@ -3684,7 +4077,9 @@ ta_latin_hints_apply(FT_UInt glyph_index,
   TA_LatinAxis axis;
 
 
+  TA_PROF_ENTER(TA_PROF_RELOAD);
   error = ta_glyph_hints_reload(hints, outline);
+  TA_PROF_LEAVE(TA_PROF_RELOAD);
   if (error)
     goto Exit;
 
@@ -3712,7 +4107,11 @@ ta_latin_hints_apply(FT_UInt glyph_index,
 
     /* apply blue zones to base characters only */
     if (!(metrics->root.globals->glyph_styles[glyph_index] & TA_NONBASE))
+    {
+      TA_PROF_ENTER(TA_PROF_BLUE_EDGES);
       ta_latin_hints_compute_blue_edges(hints, metrics);
+      TA_PROF_LEAVE(TA_PROF_BLUE_EDGES);
+    }
   }
 
   /* grid-fit the outline */
@@ -3738,10 +4137,21 @@ ta_latin_hints_apply(FT_UInt glyph_index,
     if ((dim == TA_DIMENSION_HORZ && TA_HINTS_DO_HORIZONTAL(hints))
         || (dim == TA_DIMENSION_VERT && TA_HINTS_DO_VERTICAL(hints)))
     {
+      TA_PROF_ENTER(TA_PROF_HINT_EDGES);
       ta_latin_hint_edges(hints, (TA_Dimension)dim);
+      TA_PROF_LEAVE(TA_PROF_HINT_EDGES);
+
+      TA_PROF_ENTER(TA_PROF_ALIGN_EDGE);
       ta_glyph_hints_align_edge_points(hints, (TA_Dimension)dim);
+      TA_PROF_LEAVE(TA_PROF_ALIGN_EDGE);
+
+      TA_PROF_ENTER(TA_PROF_ALIGN_STRONG);
       ta_glyph_hints_align_strong_points(hints, (TA_Dimension)dim);
+      TA_PROF_LEAVE(TA_PROF_ALIGN_STRONG);
+
+      TA_PROF_ENTER(TA_PROF_ALIGN_WEAK);
       ta_glyph_hints_align_weak_points(hints, (TA_Dimension)dim);
+      TA_PROF_LEAVE(TA_PROF_ALIGN_WEAK);
     }
   }
 
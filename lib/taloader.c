@@ -19,13 +19,16 @@
 
 #include <config.h>
 #include <string.h>
+#include <stdlib.h>
 
 #include <ft2build.h>
 #include FT_GLYPH_H
+#include FT_TRUETYPE_TABLES_H
 
 #include "ta.h"
 #include "tahints.h"
 #include "taglobal.h"
+#include "tasimd.h"
 
 
 /* from file `ftobjs.h' (2011-Mar-28) from FreeType */
@@ -53,9 +56,8 @@ ta_loader_init(FONT* font)
   memset(loader, 0, sizeof (TA_LoaderRec));
 
   ta_glyph_hints_init(&loader->hints);
-#ifdef TA_DEBUG
-  _ta_debug_hints = &loader->hints;
-#endif
+  loader->hints.simd_level = font->simd_level;
+
   return TA_GlyphLoader_New(&loader->gloader);
 }
 
@@ -98,18 +100,88 @@ ta_loader_done(FONT* font)
 
 
   ta_glyph_hints_done(&loader->hints);
+  ta_loader_cache_glyph(loader, 0);
+
+  free(loader->cache.buf);
+  loader->cache.buf = NULL;
+  loader->cache.buf_size = 0;
 
   loader->face = NULL;
   loader->globals = NULL;
 
-#ifdef TA_DEBUG
-  _ta_debug_hints = NULL;
-#endif
   TA_GlyphLoader_Done(loader->gloader);
   loader->gloader = NULL;
 }
 
 
+/* copy the glyph in `slot' into the cache; */
+/* on allocation failure the cache simply stays invalid */
+
+static void
+ta_loader_cache_store(TA_GlyphCache cache,
+                      FT_GlyphSlot slot,
+                      FT_UInt glyph_index,
+                      FT_Int32 load_flags)
+{
+  FT_Outline* outline = &slot->outline;
+
+  size_t points_size = (size_t)outline->n_points * sizeof (FT_Vector);
+  size_t subglyphs_size = slot->num_subglyphs * sizeof (TA_SubGlyphRec);
+  size_t contours_size = (size_t)outline->n_contours * sizeof (short);
+  size_t tags_size = (size_t)outline->n_points * sizeof (char);
+  size_t size = points_size + subglyphs_size + contours_size + tags_size;
+
+  char* p;
+
+
+  cache->valid = 0;
+
+  if (size > cache->buf_size)
+  {
+    void* buf_new = realloc(cache->buf, size);
+
+
+    if (!buf_new)
+      return;
+
+    cache->buf = buf_new;
+    cache->buf_size = size;
+  }
+
+  /* order the arrays by alignment */
+  p = (char*)cache->buf;
+
+  cache->outline.points = (FT_Vector*)p;
+  memcpy(p, outline->points, points_size);
+  p += points_size;
+
+  cache->subglyphs = (TA_SubGlyph)p;
+  if (subglyphs_size)
+    memcpy(p, slot->subglyphs, subglyphs_size);
+  p += subglyphs_size;
+
+  cache->outline.contours = (short*)p;
+  memcpy(p, outline->contours, contours_size);
+  p += contours_size;
+
+  cache->outline.tags = p;
+  memcpy(p, outline->tags, tags_size);
+
+  cache->outline.n_points = outline->n_points;
+  cache->outline.n_contours = outline->n_contours;
+  cache->outline.flags = outline->flags;
+  cache->num_subglyphs = slot->num_subglyphs;
+
+  cache->format = slot->format;
+  cache->metrics = slot->metrics;
+
+  cache->face = slot->face;
+  cache->glyph_index = glyph_index;
+  cache->load_flags = load_flags;
+  cache->valid = 1;
+}
+
+
 /* load a single glyph component; this routine calls itself recursively, */
 /* if necessary, and does the main work of `ta_loader_load_glyph' */
 
@@ -129,13 +201,52 @@ ta_loader_load_g(TA_Loader loader,
 #if 0
   FT_Slot_Internal slot_internal = slot->internal;
 #endif
+  TA_GlyphCache cache = &loader->cache;
   FT_Int32 flags;
 
+  FT_Glyph_Format format;
+  FT_Outline* outline;
+  FT_UInt num_subglyphs;
+  void* subglyphs;
+
 
   flags = load_flags | FT_LOAD_LINEAR_DESIGN;
-  error = FT_Load_Glyph(face, glyph_index, flags);
-  if (error)
-    goto Exit;
+
+  /* only the top-level glyph gets cached */
+  if (depth == 0
+      && cache->valid
+      && cache->face == face
+      && cache->glyph_index == glyph_index
+      && cache->load_flags == flags)
+  {
+    /* the glyph slot still holds the data of the previous call, */
+    /* except the metrics, which we modify below */
+    slot->metrics = cache->metrics;
+  }
+  else
+  {
+    error = FT_Load_Glyph(face, glyph_index, flags);
+    if (error)
+      goto Exit;
+
+    if (depth == 0 && cache->active)
+      ta_loader_cache_store(cache, slot, glyph_index, flags);
+  }
+
+  if (depth == 0 && cache->valid)
+  {
+    format = cache->format;
+    outline = &cache->outline;
+    num_subglyphs = cache->num_subglyphs;
+    subglyphs = cache->subglyphs;
+  }
+  else
+  {
+    format = slot->format;
+    outline = &slot->outline;
+    num_subglyphs = slot->num_subglyphs;
+    subglyphs = slot->subglyphs;
+  }
 
 #if 0
   loader->transformed = slot_internal->glyph_transformed;
@@ -153,35 +264,36 @@ ta_loader_load_g(TA_Loader loader,
   }
 #endif
 
-  switch (slot->format)
+  switch (format)
   {
   case FT_GLYPH_FORMAT_OUTLINE:
-    /* translate the loaded glyph when an internal transform is needed */
-    if (loader->transformed)
-      FT_Outline_Translate(&slot->outline,
-                           loader->trans_delta.x,
-                           loader->trans_delta.y);
-
     /* copy the outline points in the loader's current extra points */
     /* which are used to keep original glyph coordinates */
     error = TA_GLYPHLOADER_CHECK_POINTS(gloader,
-                                        slot->outline.n_points + 4,
-                                        slot->outline.n_contours);
+                                        outline->n_points + 4,
+                                        outline->n_contours);
     if (error)
       goto Exit;
 
     memcpy(gloader->current.outline.points,
-           slot->outline.points,
-           (size_t)slot->outline.n_points * sizeof (FT_Vector));
+           outline->points,
+           (size_t)outline->n_points * sizeof (FT_Vector));
     memcpy(gloader->current.outline.contours,
-           slot->outline.contours,
-           (size_t)slot->outline.n_contours * sizeof (short));
+           outline->contours,
+           (size_t)outline->n_contours * sizeof (short));
     memcpy(gloader->current.outline.tags,
-           slot->outline.tags,
-           (size_t)slot->outline.n_points * sizeof (char));
+           outline->tags,
+           (size_t)outline->n_points * sizeof (char));
 
-    gloader->current.outline.n_points = slot->outline.n_points;
-    gloader->current.outline.n_contours = slot->outline.n_contours;
+    gloader->current.outline.n_points = outline->n_points;
+    gloader->current.outline.n_contours = outline->n_contours;
+
+    /* translate the loaded glyph when an internal transform is needed; */
+    /* we do this on the copy to keep the cached outline intact */
+    if (loader->transformed)
+      FT_Outline_Translate(&gloader->current.outline,
+                           loader->trans_delta.x,
+                           loader->trans_delta.y);
 
     /* compute original horizontal phantom points */
     /* (and ignore vertical ones) */
@@ -192,7 +304,7 @@ ta_loader_load_g(TA_Loader loader,
     loader->pp2.y = hints->y_delta;
 
     /* be sure to check for spacing glyphs */
-    if (slot->outline.n_points == 0)
+    if (outline->n_points == 0)
       goto Hint_Metrics;
 
     /* now load the slot image into the auto-outline */
@@ -289,7 +401,7 @@ ta_loader_load_g(TA_Loader loader,
 
   case FT_GLYPH_FORMAT_COMPOSITE:
     {
-      FT_UInt nn, num_subglyphs = slot->num_subglyphs;
+      FT_UInt nn;
       FT_UInt num_base_subgs, start_point;
       TA_SubGlyph subglyph;
 
@@ -302,7 +414,7 @@ ta_loader_load_g(TA_Loader loader,
         goto Exit;
 
       memcpy(gloader->current.subglyphs,
-             slot->subglyphs,
+             subglyphs,
              num_subglyphs * sizeof (TA_SubGlyphRec));
 
       gloader->current.num_subglyphs = num_subglyphs;
@@ -438,7 +550,10 @@ Hint_Metrics:
     if (loader->pp1.x)
       FT_Outline_Translate(&gloader->base.outline, -loader->pp1.x, 0);
 #endif
-    FT_Outline_Get_CBox(&gloader->base.outline, &bbox);
+    ta_simd_cbox(loader->hints.simd_level,
+                 gloader->base.outline.points,
+                 (FT_UInt)gloader->base.outline.n_points,
+                 &bbox);
 
     bbox.xMin = TA_PIX_FLOOR(bbox.xMin);
     bbox.yMin = TA_PIX_FLOOR(bbox.yMin);
@@ -538,6 +653,24 @@ ta_loader_load_glyph(FONT* font,
   if (load_flags & (1 << 29))
     scaler.flags |= TA_SCALER_FLAG_NO_HORIZONTAL;
 
+  /* the hints arrays are kept for all glyphs of a face; */
+  /* to avoid repeated reallocation, we size them in advance */
+  /* (before `ta_loader_reset' sets `loader->face') */
+  if (loader->face != face)
+  {
+    TT_MaxProfile* maxp = (TT_MaxProfile*)FT_Get_Sfnt_Table(face,
+                                                            FT_SFNT_MAXP);
+
+
+    /* a failure is not fatal since the arrays grow on demand */
+    if (maxp)
+      (void)ta_glyph_hints_reserve(&loader->hints,
+                                   TA_MAX(maxp->maxPoints,
+                                          maxp->maxCompositePoints),
+                                   TA_MAX(maxp->maxContours,
+                                          maxp->maxCompositeContours));
+  }
+
   /* note that the fallback style can't be changed anymore */
   /* after the first call of `ta_loader_load_glyph' */
   error = ta_loader_reset(font, face);
@@ -598,4 +731,13 @@ ta_loader_register_hints_recorder(TA_Loader loader,
   loader->hints.user = user;
 }
 
+
+void
+ta_loader_cache_glyph(TA_Loader loader,
+                      FT_Bool enable)
+{
+  loader->cache.active = enable;
+  loader->cache.valid = 0;
+}
+
 /* end of taloader.c */
@@ -26,6 +26,32 @@
 
 typedef struct FONT_ FONT;
 
+
+/* the unscaled glyph data as returned by `FT_Load_Glyph'; */
+/* while active, repeated loading of the same glyph */
+/* (at different sizes) doesn't access the font again */
+
+typedef struct TA_GlyphCacheRec_
+{
+  FT_Bool active;
+  FT_Bool valid; /* set if the fields below hold a glyph */
+
+  FT_Face face;
+  FT_UInt glyph_index;
+  FT_Int32 load_flags;
+
+  FT_Glyph_Format format;
+  FT_Glyph_Metrics metrics;
+  FT_Outline outline;
+  FT_UInt num_subglyphs;
+  TA_SubGlyph subglyphs;
+
+  /* the arrays of `outline' and `subglyphs' */
+  void* buf;
+  size_t buf_size;
+} TA_GlyphCacheRec, *TA_GlyphCache;
+
+
 typedef struct TA_LoaderRec_
 {
   /* current face data */
@@ -42,6 +68,8 @@ typedef struct TA_LoaderRec_
   FT_Vector pp1;
   FT_Vector pp2;
   /* we don't handle vertical phantom points */
+
+  TA_GlyphCacheRec cache;
 } TA_LoaderRec, *TA_Loader;
 
 
@@ -70,6 +98,13 @@ ta_loader_register_hints_recorder(TA_Loader loader,
                                   TA_Hints_Recorder hints_recorder,
                                   void* user);
 
+
+/* enable or disable (and flush) the glyph cache */
+
+void
+ta_loader_cache_glyph(TA_Loader loader,
+                      FT_Bool enable);
+
 #endif /* TALOADER_H_ */
 
 /* end of taloader.h */
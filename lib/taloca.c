@@ -28,6 +28,7 @@ TA_sfnt_build_loca_table(SFNT* sfnt,
   GLYPH* glyph;
 
   FT_ULong offset;
+  FT_ULong checksum;
   FT_Byte loca_format;
   FT_Byte* buf_new;
   FT_Byte* p;
@@ -73,6 +74,7 @@ TA_sfnt_build_loca_table(SFNT* sfnt,
 
     p = loca_table->buf;
     offset = 0;
+    checksum = 0;
     glyph = data->glyphs;
 
     for (i = 0; i < data->num_glyphs; i++, glyph++)
@@ -83,6 +85,7 @@ TA_sfnt_build_loca_table(SFNT* sfnt,
       *(p++) = BYTE2(offset);
       *(p++) = BYTE3(offset);
       *(p++) = BYTE4(offset);
+      checksum += offset;
 
       offset += glyph->len1 + glyph->len2
                 + glyph->ins_extra_len + glyph->ins_len;
@@ -96,6 +99,7 @@ TA_sfnt_build_loca_table(SFNT* sfnt,
     *(p++) = BYTE2(offset);
     *(p++) = BYTE3(offset);
     *(p++) = BYTE4(offset);
+    checksum += offset;
   }
   else
   {
@@ -109,14 +113,17 @@ TA_sfnt_build_loca_table(SFNT* sfnt,
 
     p = loca_table->buf;
     offset = 0;
+    checksum = 0;
     glyph = data->glyphs;
 
+    /* two short offsets form a 32-bit value for the checksum */
     for (i = 0; i < data->num_glyphs; i++, glyph++)
     {
       offset = (offset + 1) & ~1U;
 
       *(p++) = HIGH(offset);
       *(p++) = LOW(offset);
+      checksum += (i & 1) ? offset : offset << 16;
 
       offset += (glyph->len1 + glyph->len2
                  + glyph->ins_extra_len + glyph->ins_len + 1) >> 1;
@@ -128,6 +135,7 @@ TA_sfnt_build_loca_table(SFNT* sfnt,
     /* this value must *not* be aligned to a multiple of 4 */
     *(p++) = HIGH(offset);
     *(p++) = LOW(offset);
+    checksum += (i & 1) ? offset : offset << 16;
 
     /* pad `loca' table to make its length a multiple of 4 */
     if (loca_table->len % 4 == 2)
@@ -137,8 +145,7 @@ TA_sfnt_build_loca_table(SFNT* sfnt,
     }
   }
 
-  loca_table->checksum = TA_table_compute_checksum(loca_table->buf,
-                                                   loca_table->len);
+  loca_table->checksum = checksum;
   loca_table->processed = 1;
 
   head_table->buf[LOCA_FORMAT_OFFSET] = loca_format;
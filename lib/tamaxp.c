@@ -25,6 +25,9 @@ TA_sfnt_update_maxp_table(SFNT* sfnt,
   glyf_Data* data = (glyf_Data*)glyf_table->data;
   FT_Byte* buf = maxp_table->buf;
 
+  FT_Error error;
+  Bytecode_Limits limits;
+
 
   if (maxp_table->processed)
     return TA_Err_Ok;
@@ -51,6 +54,19 @@ TA_sfnt_update_maxp_table(SFNT* sfnt,
   }
   else
   {
+    /* the values collected while building the bytecode */
+    /* are rough upper bounds; try to get tighter ones */
+    error = TA_sfnt_compute_bytecode_limits(sfnt, font, &limits);
+    if (error)
+      return error;
+
+    if (!limits.max_stack_elements)
+    {
+      limits.max_stack_elements = sfnt->max_stack_elements;
+      limits.max_function_defs = NUM_FDEFS;
+      limits.max_instructions = sfnt->max_instructions;
+    }
+
     if (sfnt->max_components && font->hint_composites)
     {
       buf[MAXP_NUM_GLYPHS] = HIGH(data->num_glyphs);
@@ -67,14 +83,14 @@ TA_sfnt_update_maxp_table(SFNT* sfnt,
     buf[MAXP_MAX_TWILIGHT_POINTS_OFFSET + 1] = LOW(sfnt->max_twilight_points);
     buf[MAXP_MAX_STORAGE_OFFSET] = HIGH(sfnt->max_storage);
     buf[MAXP_MAX_STORAGE_OFFSET + 1] = LOW(sfnt->max_storage);
-    buf[MAXP_MAX_FUNCTION_DEFS_OFFSET] = 0;
-    buf[MAXP_MAX_FUNCTION_DEFS_OFFSET + 1] = NUM_FDEFS;
+    buf[MAXP_MAX_FUNCTION_DEFS_OFFSET] = HIGH(limits.max_function_defs);
+    buf[MAXP_MAX_FUNCTION_DEFS_OFFSET + 1] = LOW(limits.max_function_defs);
     buf[MAXP_MAX_INSTRUCTION_DEFS_OFFSET] = 0;
     buf[MAXP_MAX_INSTRUCTION_DEFS_OFFSET + 1] = 0;
-    buf[MAXP_MAX_STACK_ELEMENTS_OFFSET] = HIGH(sfnt->max_stack_elements);
-    buf[MAXP_MAX_STACK_ELEMENTS_OFFSET + 1] = LOW(sfnt->max_stack_elements);
-    buf[MAXP_MAX_INSTRUCTIONS_OFFSET] = HIGH(sfnt->max_instructions);
-    buf[MAXP_MAX_INSTRUCTIONS_OFFSET + 1] = LOW(sfnt->max_instructions);
+    buf[MAXP_MAX_STACK_ELEMENTS_OFFSET] = HIGH(limits.max_stack_elements);
+    buf[MAXP_MAX_STACK_ELEMENTS_OFFSET + 1] = LOW(limits.max_stack_elements);
+    buf[MAXP_MAX_INSTRUCTIONS_OFFSET] = HIGH(limits.max_instructions);
+    buf[MAXP_MAX_INSTRUCTIONS_OFFSET + 1] = LOW(limits.max_instructions);
     buf[MAXP_MAX_COMPONENTS_OFFSET] = HIGH(sfnt->max_components);
     buf[MAXP_MAX_COMPONENTS_OFFSET + 1] = LOW(sfnt->max_components);
   }
@@ -0,0 +1,943 @@
+/* taprevious.c */
+
+/*
+ * Copyright (C) 2022 by Werner Lemberg.
+ *
+ * This file is part of the ttfautohint library, and may only be used,
+ * modified, and distributed under the terms given in `COPYING'.  By
+ * continuing to use, modify, or distribute this file you indicate that you
+ * have read `COPYING' and understand and accept it fully.
+ *
+ * The file `COPYING' mentioned in the previous paragraph is distributed
+ * with the ttfautohint library.
+ */
+
+
+/*
+ * Reuse the glyph bytecode of a previous ttfautohint run.
+ *
+ * If the caller provides the output of a previous run (together with the
+ * control instructions used for it), we copy the bytecode of a glyph
+ * verbatim instead of hinting it again if
+ *
+ * - the `cvt', `fpgm', and `prep' tables just created for the subfont are
+ *   identical to the previous ones,
+ * - the `cmap', `GSUB', and `hmtx' tables (which influence a glyph's
+ *   style and metrics) are unchanged,
+ * - the number of glyphs is the same,
+ * - the glyph's outline data is unchanged, and
+ * - the glyph's control instructions are unchanged.
+ *
+ * A composite glyph is only reused if all its components are unchanged,
+ * too.  If global data differs, we silently hint all glyphs of the subfont
+ * as usual; the same happens if the previous font can't be loaded.
+ *
+ * If the previous font contains a `TTFA' table, its parameters must match
+ * the current ones, otherwise nothing gets reused.  If the caller doesn't
+ * provide the previous control instructions, we take them from this
+ * table, too.
+ *
+ * If the caller has selected a subset of glyphs for hinting, these glyphs
+ * are always hinted again, while the remaining unchanged ones get their
+ * bytecode from the previous font (or the input font itself if it has
+ * already been processed by ttfautohint).
+ */
+
+#include <string.h>
+#include <stdlib.h>
+
+#include "ta.h"
+
+
+/* the tables of a previous run we are interested in */
+enum
+{
+  PREVIOUS_glyf,
+  PREVIOUS_loca,
+  PREVIOUS_head,
+  PREVIOUS_maxp,
+  PREVIOUS_hmtx,
+  PREVIOUS_cmap,
+  PREVIOUS_GSUB,
+  PREVIOUS_cvt,
+  PREVIOUS_fpgm,
+  PREVIOUS_prep,
+
+  PREVIOUS_MAX
+};
+
+static const FT_ULong previous_tags[PREVIOUS_MAX] =
+{
+  TTAG_glyf,
+  TTAG_loca,
+  TTAG_head,
+  TTAG_maxp,
+  TTAG_hmtx,
+  TTAG_cmap,
+  TTAG_GSUB,
+  TTAG_cvt,
+  TTAG_fpgm,
+  TTAG_prep
+};
+
+
+struct Previous_
+{
+  FT_Byte* bufs[PREVIOUS_MAX]; /* NULL if table is missing */
+  FT_ULong lens[PREVIOUS_MAX];
+
+  FT_UShort num_glyphs;
+  FT_Byte* dirty; /* glyphs with changed control instructions */
+
+  FT_Bool checked; /* set after comparing the global tables */
+  FT_Bool usable; /* cleared if global data differs */
+};
+
+
+void
+TA_previous_free(Previous* previous)
+{
+  int i;
+
+
+  if (!previous)
+    return;
+
+  for (i = 0; i < PREVIOUS_MAX; i++)
+    free(previous->bufs[i]);
+  free(previous->dirty);
+  free(previous);
+}
+
+
+/* load the tables of subfont `idx' of the previous font; */
+/* `*previousp' is set to NULL if the data is not usable */
+
+static FT_Error
+previous_load(FONT* font,
+              FT_Long idx,
+              Previous** previousp)
+{
+  FT_Face face;
+  Previous* previous = NULL;
+  FT_Byte* p;
+  FT_ULong loca_len;
+  int i;
+
+  FT_Error error;
+
+
+  *previousp = NULL;
+
+  error = FT_New_Memory_Face(font->lib,
+                             font->previous_buf,
+                             (FT_Long)font->previous_len,
+                             idx,
+                             &face);
+  if (error)
+    return TA_Err_Ok;
+
+  previous = (Previous*)calloc(1, sizeof (Previous));
+  if (!previous)
+  {
+    error = FT_Err_Out_Of_Memory;
+    goto Exit;
+  }
+
+  for (i = 0; i < PREVIOUS_MAX; i++)
+  {
+    FT_ULong len = 0;
+    FT_Byte* buf;
+
+
+    if (FT_Load_Sfnt_Table(face, previous_tags[i], 0, NULL, &len)
+        || !len)
+      continue;
+
+    buf = (FT_Byte*)malloc(len);
+    if (!buf)
+    {
+      error = FT_Err_Out_Of_Memory;
+      goto Exit;
+    }
+
+    if (FT_Load_Sfnt_Table(face, previous_tags[i], 0, buf, &len))
+    {
+      free(buf);
+      continue;
+    }
+
+    previous->bufs[i] = buf;
+    previous->lens[i] = len;
+  }
+
+  if (!previous->bufs[PREVIOUS_glyf]
+      || !previous->bufs[PREVIOUS_loca]
+      || previous->lens[PREVIOUS_head] < LOCA_FORMAT_OFFSET + 2
+      || previous->lens[PREVIOUS_maxp] < MAXP_LEN)
+    goto Exit;
+
+  p = previous->bufs[PREVIOUS_maxp] + MAXP_NUM_GLYPHS;
+  previous->num_glyphs = NEXT_USHORT(p);
+
+  loca_len = (FT_ULong)previous->num_glyphs + 1;
+  loca_len *= previous->bufs[PREVIOUS_head][LOCA_FORMAT_OFFSET] ? 4 : 2;
+  if (!previous->num_glyphs
+      || previous->lens[PREVIOUS_loca] < loca_len)
+    goto Exit;
+
+  previous->dirty = (FT_Byte*)calloc(previous->num_glyphs, 1);
+  if (!previous->dirty)
+  {
+    error = FT_Err_Out_Of_Memory;
+    goto Exit;
+  }
+
+  previous->usable = 1;
+
+  *previousp = previous;
+  previous = NULL;
+
+Exit:
+  TA_previous_free(previous);
+  FT_Done_Face(face);
+
+  return error;
+}
+
+
+/* load the `TTFA' table of the previous font (in a TTC, it is part of */
+/* the first subfont) as a zero-terminated string; */
+/* `*TTFAp' is set to NULL if there is no such table */
+
+static FT_Error
+previous_load_TTFA(FONT* font,
+                   char** TTFAp)
+{
+  FT_Face face;
+  FT_ULong len = 0;
+  char* TTFA;
+
+  FT_Error error;
+
+
+  *TTFAp = NULL;
+
+  error = FT_New_Memory_Face(font->lib,
+                             font->previous_buf,
+                             (FT_Long)font->previous_len,
+                             0,
+                             &face);
+  if (error)
+    return TA_Err_Ok;
+
+  if (FT_Load_Sfnt_Table(face, TTAG_TTFA, 0, NULL, &len)
+      || !len)
+    goto Exit;
+
+  TTFA = (char*)malloc(len + 1);
+  if (!TTFA)
+  {
+    error = FT_Err_Out_Of_Memory;
+    goto Exit;
+  }
+
+  if (FT_Load_Sfnt_Table(face, TTAG_TTFA, 0, (FT_Byte*)TTFA, &len))
+  {
+    free(TTFA);
+    goto Exit;
+  }
+  TTFA[len] = '\0';
+
+  *TTFAp = TTFA;
+
+Exit:
+  FT_Done_Face(face);
+
+  return error;
+}
+
+
+#define PREVIOUS_TTFA_INFO "TTFA-info = "
+#define PREVIOUS_CONTROL "control-instructions = "
+
+
+/* compare the parameters of the previous run, as stored in its `TTFA' */
+/* table, with the current ones, line by line; the `TTFA-info' line */
+/* doesn't influence the bytecode, and the control instructions are */
+/* compared entry by entry later on */
+
+static FT_Bool
+previous_parameters_are_equal(const char* prev,
+                              const char* curr)
+{
+  size_t prev_len;
+  size_t curr_len;
+
+
+  for (;;)
+  {
+    prev_len = strcspn(prev, "\n");
+    curr_len = strcspn(curr, "\n");
+
+    if (!strncmp(prev, PREVIOUS_TTFA_INFO, sizeof (PREVIOUS_TTFA_INFO) - 1)
+        && prev[prev_len])
+    {
+      prev += prev_len + 1;
+      continue;
+    }
+    if (!strncmp(curr, PREVIOUS_TTFA_INFO, sizeof (PREVIOUS_TTFA_INFO) - 1)
+        && curr[curr_len])
+    {
+      curr += curr_len + 1;
+      continue;
+    }
+
+    if (!strncmp(prev, PREVIOUS_CONTROL, sizeof (PREVIOUS_CONTROL) - 1)
+        && !strncmp(curr, PREVIOUS_CONTROL, sizeof (PREVIOUS_CONTROL) - 1))
+      return 1;
+
+    if (prev_len != curr_len
+        || memcmp(prev, curr, prev_len))
+      return 0;
+
+    if (!prev[prev_len] || !curr[curr_len])
+      return !prev[prev_len] && !curr[curr_len];
+
+    prev += prev_len + 1;
+    curr += curr_len + 1;
+  }
+}
+
+
+/* parse the control instructions of the previous run */
+
+static FT_Error
+previous_parse_control(FONT* font,
+                       const char* previous_control_buf,
+                       size_t previous_control_len,
+                       Control** controlp)
+{
+  Control* control = font->control;
+  char* control_buf = font->control_buf;
+  size_t control_len = font->control_len;
+
+  char* error_string = NULL;
+  unsigned int errlinenum;
+  char* errline = NULL;
+  char* errpos;
+
+  FT_Error error;
+
+
+  *controlp = NULL;
+
+  if (!previous_control_buf)
+    return TA_Err_Ok;
+
+  font->control_buf = (char*)previous_control_buf;
+  font->control_len = previous_control_len;
+
+  error = TA_control_parse_buffer(font,
+                                  &error_string,
+                                  &errlinenum, &errline, &errpos);
+  *controlp = font->control;
+
+  font->control = control;
+  font->control_buf = control_buf;
+  font->control_len = control_len;
+
+  free(error_string);
+  free(errline);
+
+  return error;
+}
+
+
+static int
+number_set_compare(number_range* r1,
+                   number_range* r2)
+{
+  while (r1 && r2)
+  {
+    if (r1->start != r2->start)
+      return r1->start < r2->start ? -1 : 1;
+    if (r1->end != r2->end)
+      return r1->end < r2->end ? -1 : 1;
+
+    r1 = r1->next;
+    r2 = r2->next;
+  }
+
+  if (r1)
+    return 1;
+  if (r2)
+    return -1;
+
+  return 0;
+}
+
+
+static int
+control_compare(const void* a,
+                const void* b)
+{
+  const Control* c1 = *(const Control**)a;
+  const Control* c2 = *(const Control**)b;
+
+  int ret;
+
+
+  if (c1->font_idx != c2->font_idx)
+    return c1->font_idx < c2->font_idx ? -1 : 1;
+  if (c1->glyph_idx != c2->glyph_idx)
+    return c1->glyph_idx < c2->glyph_idx ? -1 : 1;
+  if (c1->type != c2->type)
+    return c1->type < c2->type ? -1 : 1;
+  if (c1->x_shift != c2->x_shift)
+    return c1->x_shift < c2->x_shift ? -1 : 1;
+  if (c1->y_shift != c2->y_shift)
+    return c1->y_shift < c2->y_shift ? -1 : 1;
+
+  ret = number_set_compare(c1->points, c2->points);
+  if (ret)
+    return ret;
+
+  return number_set_compare(c1->ppems, c2->ppems);
+}
+
+
+/* return a sorted array of all control instructions entries */
+
+static FT_Error
+control_sort(Control* control,
+             Control*** arrayp,
+             size_t* countp)
+{
+  Control* c;
+  Control** array;
+  size_t count;
+  size_t i;
+
+
+  count = 0;
+  for (c = control; c; c = c->next)
+    count++;
+
+  *arrayp = NULL;
+  *countp = count;
+
+  if (!count)
+    return TA_Err_Ok;
+
+  array = (Control**)malloc(count * sizeof (Control*));
+  if (!array)
+    return FT_Err_Out_Of_Memory;
+
+  for (i = 0, c = control; c; i++, c = c->next)
+    array[i] = c;
+
+  qsort(array, count, sizeof (Control*), control_compare);
+
+  *arrayp = array;
+
+  return TA_Err_Ok;
+}
+
+
+/* mark the glyph affected by a changed control instructions entry */
+/* in all subfonts that share its `glyf' table */
+
+static void
+previous_mark(FONT* font,
+              Control* control)
+{
+  FT_ULong glyf_idx;
+  FT_Long i;
+
+
+  if (control->font_idx < 0 || control->font_idx >= font->num_sfnts)
+    return;
+
+  glyf_idx = font->sfnts[control->font_idx].glyf_idx;
+
+  for (i = 0; i < font->num_sfnts; i++)
+  {
+    SFNT* sfnt = &font->sfnts[i];
+    Previous* previous = sfnt->previous;
+
+
+    if (!previous || sfnt->glyf_idx != glyf_idx)
+      continue;
+
+    /* these entries change the style coverage and the `cvt' table */
+    if (control->type == Control_Script_Feature_Glyphs
+        || control->type == Control_Script_Feature_Widths)
+      previous->usable = 0;
+    else if (control->glyph_idx >= 0
+             && control->glyph_idx < previous->num_glyphs)
+      previous->dirty[control->glyph_idx] = 1;
+  }
+}
+
+
+static FT_Error
+previous_diff_control(FONT* font,
+                      Control* previous_control)
+{
+  Control** curr = NULL;
+  Control** prev = NULL;
+  size_t num_curr;
+  size_t num_prev;
+  size_t i;
+  size_t j;
+
+  FT_Error error;
+
+
+  error = control_sort(font->control, &curr, &num_curr);
+  if (error)
+    goto Exit;
+  error = control_sort(previous_control, &prev, &num_prev);
+  if (error)
+    goto Exit;
+
+  /* walk over both sorted arrays in parallel */
+  i = 0;
+  j = 0;
+  while (i < num_curr && j < num_prev)
+  {
+    int ret = control_compare(&curr[i], &prev[j]);
+
+
+    if (!ret)
+    {
+      i++;
+      j++;
+    }
+    else if (ret < 0)
+      previous_mark(font, curr[i++]);
+    else
+      previous_mark(font, prev[j++]);
+  }
+
+  while (i < num_curr)
+    previous_mark(font, curr[i++]);
+  while (j < num_prev)
+    previous_mark(font, prev[j++]);
+
+Exit:
+  free(curr);
+  free(prev);
+
+  return error;
+}
+
+
+FT_Error
+TA_font_init_previous(FONT* font)
+{
+  FT_Face face;
+  FT_Long num_faces;
+  char* TTFA = NULL;
+  char* params;
+  FT_Bool is_equal;
+  const char* control_buf = font->previous_control_buf;
+  size_t control_len = font->previous_control_len;
+  Control* previous_control;
+  FT_Long i;
+
+  FT_Error error;
+
+
+  if (!font->previous_buf)
+    return TA_Err_Ok;
+
+  /* the number of subfonts must be the same */
+  error = FT_New_Memory_Face(font->lib,
+                             font->previous_buf,
+                             (FT_Long)font->previous_len,
+                             -1,
+                             &face);
+  if (error)
+    return TA_Err_Ok;
+
+  num_faces = face->num_faces;
+  FT_Done_Face(face);
+
+  if (num_faces != font->num_sfnts)
+    return TA_Err_Ok;
+
+  /* the previous font must have a `TTFA' table, showing that it was */
+  /* created with the same parameters (many of them, for example, */
+  /* `adjust-subglyphs' or the hinting range, influence the bytecode */
+  /* of a glyph); it also holds the control instructions of the */
+  /* previous run if the caller doesn't provide them */
+  error = previous_load_TTFA(font, &TTFA);
+  if (error || !TTFA)
+    return error;
+
+  params = TA_font_dump_parameters(font, 0);
+  if (!params)
+  {
+    error = FT_Err_Out_Of_Memory;
+    goto Exit;
+  }
+
+  is_equal = previous_parameters_are_equal(TTFA, params);
+  free(params);
+
+  if (!is_equal)
+    goto Exit;
+
+  if (!control_buf)
+  {
+    control_buf = strstr(TTFA, "\n" PREVIOUS_CONTROL);
+    if (control_buf)
+    {
+      control_buf += sizeof (PREVIOUS_CONTROL);
+      control_len = strlen(control_buf);
+    }
+  }
+
+  for (i = 0; i < font->num_sfnts; i++)
+  {
+    error = previous_load(font, i, &font->sfnts[i].previous);
+    if (error)
+      goto Exit;
+  }
+
+  error = previous_parse_control(font,
+                                 control_buf, control_len,
+                                 &previous_control);
+  if (!error)
+    error = previous_diff_control(font, previous_control);
+  TA_control_free(previous_control);
+
+  if (error)
+  {
+    /* invalid previous control instructions simply disable reuse */
+    for (i = 0; i < font->num_sfnts; i++)
+    {
+      TA_previous_free(font->sfnts[i].previous);
+      font->sfnts[i].previous = NULL;
+    }
+
+    if (error != FT_Err_Out_Of_Memory)
+      error = TA_Err_Ok;
+  }
+
+Exit:
+  free(TTFA);
+
+  return error;
+}
+
+
+static SFNT_Table*
+sfnt_get_table(SFNT* sfnt,
+               FONT* font,
+               FT_ULong tag)
+{
+  FT_ULong i;
+
+
+  for (i = 0; i < sfnt->num_table_infos; i++)
+  {
+    SFNT_Table_Info table_info = sfnt->table_infos[i];
+
+
+    if (table_info != MISSING && font->tables[table_info].tag == tag)
+      return &font->tables[table_info];
+  }
+
+  return NULL;
+}
+
+
+static FT_Bool
+previous_table_is_equal(Previous* previous,
+                        int which,
+                        SFNT_Table* table)
+{
+  if (!previous->bufs[which])
+    return !table;
+  if (!table)
+    return 0;
+
+  return previous->lens[which] == table->len
+         && !memcmp(previous->bufs[which], table->buf, table->len);
+}
+
+
+/* compare the global data of the current and the previous run */
+
+static FT_Bool
+previous_check_globals(SFNT* sfnt,
+                       FONT* font)
+{
+  Previous* previous = sfnt->previous;
+  glyf_Data* data = (glyf_Data*)font->tables[sfnt->glyf_idx].data;
+  SFNT_Table* hmtx_table;
+
+
+  if (previous->num_glyphs != data->num_glyphs)
+    return 0;
+
+  if (!previous_table_is_equal(previous, PREVIOUS_cvt,
+                               data->cvt_idx == MISSING
+                                 ? NULL
+                                 : &font->tables[data->cvt_idx])
+      || !previous_table_is_equal(previous, PREVIOUS_fpgm,
+                                  data->fpgm_idx == MISSING
+                                    ? NULL
+                                    : &font->tables[data->fpgm_idx])
+      || !previous_table_is_equal(previous, PREVIOUS_prep,
+                                  data->prep_idx == MISSING
+                                    ? NULL
+                                    : &font->tables[data->prep_idx]))
+    return 0;
+
+  if (!previous_table_is_equal(previous, PREVIOUS_cmap,
+                               sfnt_get_table(sfnt, font, TTAG_cmap))
+      || !previous_table_is_equal(previous, PREVIOUS_GSUB,
+                                  sfnt_get_table(sfnt, font, TTAG_GSUB)))
+    return 0;
+
+  /* we might have appended an entry for the `.ttfautohint' glyph, */
+  /* so only the data of the input font has to be the same */
+  hmtx_table = sfnt->hmtx_idx == MISSING ? NULL
+                                         : &font->tables[sfnt->hmtx_idx];
+  if (!previous->bufs[PREVIOUS_hmtx] || !hmtx_table)
+  {
+    if (previous->bufs[PREVIOUS_hmtx] || hmtx_table)
+      return 0;
+  }
+  else if (previous->lens[PREVIOUS_hmtx] < hmtx_table->len
+           || memcmp(previous->bufs[PREVIOUS_hmtx],
+                     hmtx_table->buf,
+                     hmtx_table->len))
+    return 0;
+
+  return 1;
+}
+
+
+/* get the record of glyph `idx' in the previous `glyf' table */
+
+static FT_Byte*
+previous_get_glyph(Previous* previous,
+                   FT_Long idx,
+                   FT_ULong* len)
+{
+  FT_Byte* p;
+  FT_ULong offset;
+  FT_ULong offset_next;
+
+
+  p = previous->bufs[PREVIOUS_loca];
+  if (previous->bufs[PREVIOUS_head][LOCA_FORMAT_OFFSET])
+  {
+    p += 4 * idx;
+    offset = NEXT_ULONG(p);
+    offset_next = NEXT_ULONG(p);
+  }
+  else
+  {
+    p += 2 * idx;
+    offset = NEXT_USHORT(p);
+    offset <<= 1;
+    offset_next = NEXT_USHORT(p);
+    offset_next <<= 1;
+  }
+
+  if (offset_next < offset
+      || offset_next > previous->lens[PREVIOUS_glyf])
+    return NULL;
+
+  *len = offset_next - offset;
+
+  return previous->bufs[PREVIOUS_glyf] + offset;
+}
+
+
+/* we don't follow more nested composite glyphs */
+#define PREVIOUS_MAX_DEPTH 16
+
+/*
+ * Check whether the outline of glyph `idx' (including all its components)
+ * is the same as in the previous font.  If so, return 1 and set `ins' and
+ * `ins_len' to the glyph's previous bytecode.
+ */
+
+static FT_Bool
+previous_glyph_is_unchanged(Previous* previous,
+                            glyf_Data* data,
+                            FT_Long idx,
+                            FT_UInt depth,
+                            FT_Byte** ins,
+                            FT_UShort* ins_len)
+{
+  GLYPH* glyph = &data->glyphs[idx];
+
+  FT_Byte* buf;
+  FT_Byte* p;
+  FT_ULong len;
+  FT_UShort i;
+
+
+  *ins = NULL;
+  *ins_len = 0;
+
+  buf = previous_get_glyph(previous, idx, &len);
+  if (!buf)
+    return 0;
+
+  /* empty glyph */
+  if (!glyph->len1)
+    return !len;
+
+  if (glyph->len2)
+  {
+    /* simple glyph: compare everything but the instructions */
+    if (len < glyph->len1 + 2
+        || memcmp(buf, glyph->buf, glyph->len1))
+      return 0;
+
+    p = buf + glyph->len1;
+    *ins_len = NEXT_USHORT(p);
+
+    if (len < glyph->len1 + 2 + *ins_len + glyph->len2
+        || memcmp(p + *ins_len, glyph->buf2, glyph->len2))
+      return 0;
+
+    *ins = p;
+
+    return 1;
+  }
+
+  /* composite glyph: the `WE_HAVE_INSTR' flag of the last component */
+  /* is cleared in `glyph->buf' */
+  if (len < glyph->len1
+      || memcmp(buf, glyph->buf, glyph->flags_offset)
+      || (buf[glyph->flags_offset] & ~(WE_HAVE_INSTR >> 8))
+           != glyph->buf[glyph->flags_offset]
+      || memcmp(buf + glyph->flags_offset + 1,
+                glyph->buf + glyph->flags_offset + 1,
+                glyph->len1 - glyph->flags_offset - 1))
+    return 0;
+
+  if (buf[glyph->flags_offset] & (WE_HAVE_INSTR >> 8))
+  {
+    if (len < glyph->len1 + 2)
+      return 0;
+
+    p = buf + glyph->len1;
+    *ins_len = NEXT_USHORT(p);
+
+    if (len < glyph->len1 + 2 + *ins_len)
+      return 0;
+
+    *ins = p;
+  }
+
+  /* the bytecode of a composite glyph depends on its components also */
+  if (depth >= PREVIOUS_MAX_DEPTH)
+    return 0;
+
+  for (i = 0; i < glyph->num_components; i++)
+  {
+    FT_Byte* component_ins;
+    FT_UShort component_ins_len;
+
+
+    if (glyph->components[i] >= data->num_glyphs
+        || !previous_glyph_is_unchanged(previous, data,
+                                        glyph->components[i], depth + 1,
+                                        &component_ins,
+                                        &component_ins_len))
+      return 0;
+  }
+
+  return 1;
+}
+
+
+FT_Error
+TA_sfnt_reuse_glyph_instructions(SFNT* sfnt,
+                                 FONT* font,
+                                 FT_Long idx,
+                                 FT_Bool* reused)
+{
+  Previous* previous = sfnt->previous;
+  glyf_Data* data = (glyf_Data*)font->tables[sfnt->glyf_idx].data;
+  GLYPH* glyph = &data->glyphs[idx];
+
+  FT_Byte* p;
+  FT_Byte* ins;
+  FT_UShort ins_len;
+  FT_UShort value;
+
+
+  *reused = 0;
+
+  if (!previous)
+    return TA_Err_Ok;
+
+  /* the global tables are complete as soon as we start with the glyphs */
+  if (!previous->checked)
+  {
+    previous->usable = previous->usable
+                       && previous_check_globals(sfnt, font);
+    previous->checked = 1;
+  }
+
+  if (!previous->usable || previous->dirty[idx])
+    return TA_Err_Ok;
+
+  /* glyphs selected for hinting */
+  if (font->hint_glyphs
+      && number_set_is_element(font->hint_glyphs, (int)idx))
+    return TA_Err_Ok;
+
+  /* empty glyphs get always handled as usual */
+  if (!glyph->len1)
+    return TA_Err_Ok;
+
+  if (!previous_glyph_is_unchanged(previous, data, idx, 0, &ins, &ins_len))
+    return TA_Err_Ok;
+
+  if (ins_len)
+  {
+    glyph->ins_buf = (FT_Byte*)malloc(ins_len);
+    if (!glyph->ins_buf)
+      return FT_Err_Out_Of_Memory;
+    memcpy(glyph->ins_buf, ins, ins_len);
+  }
+  glyph->ins_len = ins_len;
+
+  /* the previous `maxp' values are valid for the copied bytecode */
+  if (ins_len > sfnt->max_instructions)
+    sfnt->max_instructions = ins_len;
+
+  p = previous->bufs[PREVIOUS_maxp] + MAXP_MAX_TWILIGHT_POINTS_OFFSET;
+  value = NEXT_USHORT(p);
+  if (value > sfnt->max_twilight_points)
+    sfnt->max_twilight_points = value;
+
+  p = previous->bufs[PREVIOUS_maxp] + MAXP_MAX_STORAGE_OFFSET;
+  value = NEXT_USHORT(p);
+  if (value > sfnt->max_storage)
+    sfnt->max_storage = value;
+
+  p = previous->bufs[PREVIOUS_maxp] + MAXP_MAX_STACK_ELEMENTS_OFFSET;
+  value = NEXT_USHORT(p);
+  if (value > sfnt->max_stack_elements)
+    sfnt->max_stack_elements = value;
+
+  *reused = 1;
+
+  return TA_Err_Ok;
+}
+
+/* end of taprevious.c */
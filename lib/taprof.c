@@ -0,0 +1,197 @@
+/* taprof.c */
+
+/*
+ * Copyright (C) 2022 by Werner Lemberg.
+ *
+ * This file is part of the ttfautohint library, and may only be used,
+ * modified, and distributed under the terms given in `COPYING'.  By
+ * continuing to use, modify, or distribute this file you indicate that you
+ * have read `COPYING' and understand and accept it fully.
+ *
+ * The file `COPYING' mentioned in the previous paragraph is distributed
+ * with the ttfautohint library.
+ */
+
+
+#include <config.h>
+
+#include "ta.h"
+#include "taprof.h"
+
+#ifdef TA_PROFILE
+
+#include <stdlib.h>
+#include <string.h>
+
+
+const char* ta_prof_stage_names[TA_PROF_MAX] =
+{
+  "other",
+  "reload",
+  "segments",
+  "link_segments",
+  "edges",
+  "blue_edges",
+  "hint_edges",
+  "align_edge_points",
+  "align_strong_points",
+  "align_weak_points",
+  "recorder",
+  "emit_records"
+};
+
+
+#define TA_PROF_STACK_MAX 8
+
+static struct
+{
+  TA_ProfGlyph glyphs;
+  FT_Long num_glyphs;
+
+  FT_Long glyph; /* the current glyph index, or -1 */
+  TA_ProfStage stack[TA_PROF_STACK_MAX];
+  int depth;
+  unsigned long long start;
+} prof = { NULL, 0, -1, { TA_PROF_OTHER }, 0, 0 };
+
+
+unsigned long long
+ta_prof_now(void)
+{
+  return TA_get_monotonic_time();
+}
+
+
+void
+ta_prof_reset(void)
+{
+  free(prof.glyphs);
+
+  prof.glyphs = NULL;
+  prof.num_glyphs = 0;
+  prof.glyph = -1;
+  prof.depth = 0;
+}
+
+
+/* add the time since the last event to the innermost stage */
+
+static void
+ta_prof_account(unsigned long long now)
+{
+  /* deeper nesting is accounted to the innermost stage on the stack */
+  int top = prof.depth < TA_PROF_STACK_MAX ? prof.depth
+                                           : TA_PROF_STACK_MAX;
+
+
+  if (top > 0)
+    prof.glyphs[prof.glyph].ns[prof.stack[top - 1]] += now - prof.start;
+
+  prof.start = now;
+}
+
+
+void
+ta_prof_set_glyph(FT_Long glyph_index)
+{
+  unsigned long long now = ta_prof_now();
+
+
+  if (prof.glyph >= 0)
+    ta_prof_account(now);
+
+  prof.glyph = -1;
+  prof.depth = 0;
+
+  if (glyph_index < 0)
+    return;
+
+  if (glyph_index >= prof.num_glyphs)
+  {
+    FT_Long num_glyphs_new = glyph_index + 1;
+    TA_ProfGlyph glyphs_new;
+
+
+    if (num_glyphs_new < 2 * prof.num_glyphs)
+      num_glyphs_new = 2 * prof.num_glyphs;
+
+    glyphs_new = (TA_ProfGlyph)realloc(prof.glyphs,
+                                       (size_t)num_glyphs_new
+                                       * sizeof (TA_ProfGlyphRec));
+    /* no profiling data is better than a crash */
+    if (!glyphs_new)
+      return;
+
+    memset(glyphs_new + prof.num_glyphs, 0,
+           (size_t)(num_glyphs_new - prof.num_glyphs)
+           * sizeof (TA_ProfGlyphRec));
+
+    prof.glyphs = glyphs_new;
+    prof.num_glyphs = num_glyphs_new;
+  }
+
+  prof.glyph = glyph_index;
+  prof.glyphs[glyph_index].hinted = 1;
+
+  prof.stack[0] = TA_PROF_OTHER;
+  prof.depth = 1;
+  prof.start = ta_prof_now();
+}
+
+
+void
+ta_prof_set_glyph_info(FT_UInt style,
+                       FT_UInt num_points)
+{
+  if (prof.glyph < 0)
+    return;
+
+  prof.glyphs[prof.glyph].style = style;
+  prof.glyphs[prof.glyph].num_points = num_points;
+}
+
+
+void
+ta_prof_enter(TA_ProfStage stage)
+{
+  if (prof.glyph < 0)
+    return;
+
+  ta_prof_account(ta_prof_now());
+
+  if (prof.depth < TA_PROF_STACK_MAX)
+    prof.stack[prof.depth] = stage;
+  prof.depth++;
+}
+
+
+void
+ta_prof_leave(TA_ProfStage stage)
+{
+  /* the bottom of the stack is `TA_PROF_OTHER' */
+  if (prof.glyph < 0 || prof.depth < 2)
+    return;
+
+  ta_prof_account(ta_prof_now());
+  prof.depth--;
+
+  (void)stage;
+}
+
+
+TA_ProfGlyph
+ta_prof_get_glyphs(FT_Long* num_glyphs)
+{
+  *num_glyphs = prof.num_glyphs;
+
+  return prof.glyphs;
+}
+
+#else /* !TA_PROFILE */
+
+/* ANSI C doesn't like empty source files */
+typedef int ta_prof_dummy_;
+
+#endif /* !TA_PROFILE */
+
+/* end of taprof.c */
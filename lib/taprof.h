@@ -0,0 +1,120 @@
+/* taprof.h */
+
+/*
+ * Copyright (C) 2022 by Werner Lemberg.
+ *
+ * This file is part of the ttfautohint library, and may only be used,
+ * modified, and distributed under the terms given in `COPYING'.  By
+ * continuing to use, modify, or distribute this file you indicate that you
+ * have read `COPYING' and understand and accept it fully.
+ *
+ * The file `COPYING' mentioned in the previous paragraph is distributed
+ * with the ttfautohint library.
+ */
+
+
+/*
+ * Per-glyph timing of the hinting stages, compiled in only if
+ * `TA_PROFILE' is defined (as done for the `tabench' program).
+ *
+ * Stages can be nested; the time of a stage doesn't include the time of
+ * stages entered from it.  Everything else spent in
+ * `TA_sfnt_build_glyph_instructions' is accounted to `TA_PROF_OTHER'.
+ * The profiler uses global state and thus needs single-threaded
+ * operation.
+ */
+
+#ifndef TAPROF_H_
+#define TAPROF_H_
+
+#include "tatypes.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+typedef enum TA_ProfStage_
+{
+  TA_PROF_OTHER,
+  TA_PROF_RELOAD,
+  TA_PROF_SEGMENTS,
+  TA_PROF_LINK,
+  TA_PROF_EDGES,
+  TA_PROF_BLUE_EDGES,
+  TA_PROF_HINT_EDGES,
+  TA_PROF_ALIGN_EDGE,
+  TA_PROF_ALIGN_STRONG,
+  TA_PROF_ALIGN_WEAK,
+  TA_PROF_RECORDER,
+  TA_PROF_EMIT,
+
+  TA_PROF_MAX
+} TA_ProfStage;
+
+
+typedef struct TA_ProfGlyphRec_
+{
+  FT_Bool hinted;
+  FT_UInt style;
+  FT_UInt num_points;
+
+  /* in nanoseconds */
+  unsigned long long ns[TA_PROF_MAX];
+} TA_ProfGlyphRec, *TA_ProfGlyph;
+
+
+#ifdef TA_PROFILE
+
+extern const char* ta_prof_stage_names[TA_PROF_MAX];
+
+
+/* discard all collected data */
+void
+ta_prof_reset(void);
+
+/* attribute the following stages to `glyph_index' */
+/* (or to nothing if negative) */
+void
+ta_prof_set_glyph(FT_Long glyph_index);
+
+void
+ta_prof_set_glyph_info(FT_UInt style,
+                       FT_UInt num_points);
+
+void
+ta_prof_enter(TA_ProfStage stage);
+
+void
+ta_prof_leave(TA_ProfStage stage);
+
+/* the returned array is indexed by glyph index; */
+/* it is valid until the next call to `ta_prof_reset' */
+TA_ProfGlyph
+ta_prof_get_glyphs(FT_Long* num_glyphs);
+
+/* a monotonic clock */
+unsigned long long
+ta_prof_now(void);
+
+#  define TA_PROF_SET_GLYPH(i) ta_prof_set_glyph(i)
+#  define TA_PROF_SET_GLYPH_INFO(s, n) ta_prof_set_glyph_info(s, n)
+#  define TA_PROF_ENTER(s) ta_prof_enter(s)
+#  define TA_PROF_LEAVE(s) ta_prof_leave(s)
+
+#else /* !TA_PROFILE */
+
+#  define TA_PROF_SET_GLYPH(i) do { } while (0)
+#  define TA_PROF_SET_GLYPH_INFO(s, n) do { } while (0)
+#  define TA_PROF_ENTER(s) do { } while (0)
+#  define TA_PROF_LEAVE(s) do { } while (0)
+
+#endif /* !TA_PROFILE */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TAPROF_H_ */
+
+/* end of taprof.h */
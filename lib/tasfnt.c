@@ -16,22 +16,122 @@
 #include "ta.h"
 
 
+/* return 1 for tables we are going to create by ourselves, */
+/* or which would become invalid otherwise */
+
+static FT_Bool
+TA_font_ignore_table(FONT* font,
+                     FT_ULong tag)
+{
+  if (tag == TTAG_cvt
+      || tag == TTAG_fpgm
+      || tag == TTAG_gasp
+      || tag == TTAG_hdmx
+      || tag == TTAG_LTSH
+      || tag == TTAG_prep
+      || tag == TTAG_TTFA
+      || tag == TTAG_VDMX)
+    return 1;
+
+  if (tag == TTAG_DSIG)
+  {
+    font->have_DSIG = 1;
+    return 1;
+  }
+
+  return 0;
+}
+
+
+/* return 1 for tables we might modify in place; */
+/* all other tables are passed through unchanged */
+/* (or, in case of `glyf', completely rebuilt) */
+
+static FT_Bool
+TA_table_is_modified(FT_ULong tag)
+{
+  return tag == TTAG_GPOS
+         || tag == TTAG_head
+         || tag == TTAG_hmtx
+         || tag == TTAG_loca
+         || tag == TTAG_maxp
+         || tag == TTAG_name
+         || tag == TTAG_post;
+}
+
+
+/* get the offset of the table directory of subfont `idx' */
+
+static FT_Error
+TA_font_get_sfnt_offset(FONT* font,
+                        FT_Long idx,
+                        FT_ULong* offset)
+{
+  FT_Byte* p = font->in_buf;
+  FT_ULong num_sfnts;
+
+
+  if (font->in_len < 12)
+    return TA_Err_Invalid_Font_Type;
+
+  if (NEXT_ULONG(p) != TTAG_ttcf)
+  {
+    *offset = 0;
+    return TA_Err_Ok;
+  }
+
+  p += 4; /* skip version */
+  num_sfnts = NEXT_ULONG(p);
+
+  if ((FT_ULong)idx >= num_sfnts
+      || (FT_ULong)idx >= (font->in_len - 12) / 4)
+    return FT_Err_Invalid_Table;
+
+  p += 4 * idx;
+  *offset = NEXT_ULONG(p);
+
+  return TA_Err_Ok;
+}
+
+
+/*
+ * Tables we never modify are views into `font->in_buf'; the remaining
+ * ones get copied into buffers of their own, with a length that is a
+ * multiple of 4 and padded with zeros.
+ */
+
 FT_Error
 TA_sfnt_split_into_SFNT_tables(SFNT* sfnt,
                                FONT* font)
 {
   FT_Error error;
+  FT_ULong offset;
+  FT_Byte* p;
+  FT_ULong version;
   FT_ULong i;
 
 
-  /* basic check whether font is a TTF or TTC */
-  if (!FT_IS_SFNT(sfnt->face))
-    return TA_Err_Invalid_Font_Type;
-
-  error = FT_Sfnt_Table_Info(sfnt->face, 0, NULL, &sfnt->num_table_infos);
+  error = TA_font_get_sfnt_offset(font, sfnt - font->sfnts, &offset);
   if (error)
     return error;
 
+  if (offset > font->in_len
+      || font->in_len - offset < 12)
+    return TA_Err_Invalid_Font_Type;
+
+  p = font->in_buf + offset;
+
+  /* basic check whether font is a TTF */
+  version = NEXT_ULONG(p);
+  if (version != 0x00010000UL && version != TTAG_true)
+    return TA_Err_Invalid_Font_Type;
+
+  sfnt->num_table_infos = NEXT_USHORT(p);
+  p += 6;
+
+  if (16 * sfnt->num_table_infos > font->in_len - offset - 12)
+    return FT_Err_Invalid_Table;
+
   sfnt->table_infos = (SFNT_Table_Info*)malloc(sfnt->num_table_infos
                                                * sizeof (SFNT_Table_Info));
   if (!sfnt->table_infos)
@@ -52,61 +152,33 @@ TA_sfnt_split_into_SFNT_tables(SFNT* sfnt,
   {
     SFNT_Table_Info* table_info = &sfnt->table_infos[i];
     FT_ULong tag;
+    FT_ULong table_offset;
     FT_ULong len;
-    FT_Byte* buf;
+    FT_Byte* data;
 
-    FT_ULong buf_len;
     FT_ULong j;
 
 
     *table_info = MISSING;
 
-    error = FT_Sfnt_Table_Info(sfnt->face, (FT_UInt)i, &tag, &len);
-    if (error)
-    {
-      if (error == FT_Err_Table_Missing)
-        continue;
-      else
-        return error;
-    }
+    tag = NEXT_ULONG(p);
+    p += 4; /* skip checksum */
+    table_offset = NEXT_ULONG(p);
+    len = NEXT_ULONG(p);
 
-    /* ignore zero-length tables */
-    else if (!len)
+    /* ignore invalid entries (as FreeType does) */
+    if (table_offset > font->in_len
+        || len > font->in_len - table_offset)
       continue;
 
-    /* ignore tables which we are going to create by ourselves, */
-    /* or which would become invalid otherwise */
-    else if (tag == TTAG_cvt
-             || tag == TTAG_fpgm
-             || tag == TTAG_gasp
-             || tag == TTAG_hdmx
-             || tag == TTAG_LTSH
-             || tag == TTAG_prep
-             || tag == TTAG_TTFA
-             || tag == TTAG_VDMX)
+    /* ignore zero-length tables */
+    if (!len)
       continue;
 
-    else if (tag == TTAG_DSIG)
-    {
-      font->have_DSIG = 1;
+    if (TA_font_ignore_table(font, tag))
       continue;
-    }
-
-    /* make the allocated buffer length a multiple of 4 */
-    buf_len = (len + 3) & ~3U;
-    buf = (FT_Byte*)malloc(buf_len);
-    if (!buf)
-      return FT_Err_Out_Of_Memory;
-
-    /* pad end of buffer with zeros */
-    buf[buf_len - 1] = 0x00;
-    buf[buf_len - 2] = 0x00;
-    buf[buf_len - 3] = 0x00;
 
-    /* load table */
-    error = FT_Load_Sfnt_Table(sfnt->face, tag, 0, buf, &len);
-    if (error)
-      goto Err;
+    data = font->in_buf + table_offset;
 
     /* check whether we already have this table */
     for (j = 0; j < font->num_tables; j++)
@@ -116,7 +188,8 @@ TA_sfnt_split_into_SFNT_tables(SFNT* sfnt,
 
       if (table->tag == tag
           && table->len == len
-          && !memcmp(table->buf, buf, len))
+          && (table->buf == data
+              || !memcmp(table->buf, data, len)))
         break;
     }
 
@@ -132,8 +205,10 @@ TA_sfnt_split_into_SFNT_tables(SFNT* sfnt,
     {
       sfnt->maxp_idx = j;
 
-      sfnt->max_components = (FT_UShort)(buf[MAXP_MAX_COMPONENTS_OFFSET] << 8
-                                         | buf[MAXP_MAX_COMPONENTS_OFFSET + 1]);
+      if (len >= MAXP_MAX_COMPONENTS_OFFSET + 2)
+        sfnt->max_components =
+          (FT_UShort)(data[MAXP_MAX_COMPONENTS_OFFSET] << 8
+                      | data[MAXP_MAX_COMPONENTS_OFFSET + 1]);
     }
     else if (tag == TTAG_name)
       sfnt->name_idx = j;
@@ -144,26 +219,41 @@ TA_sfnt_split_into_SFNT_tables(SFNT* sfnt,
     else if (tag == TTAG_GPOS)
       sfnt->GPOS_idx = j;
 
-    if (j == font->num_tables)
+    if (j < font->num_tables)
     {
-      /* add element to table array if it is missing or different; */
-      /* in case of success, `buf' gets linked and is eventually */
-      /* freed in `TA_font_unload' */
+      /* reuse existing SFNT table */
+      *table_info = j;
+      continue;
+    }
+
+    /* add element to table array if it is missing or different */
+    if (TA_table_is_modified(tag))
+    {
+      FT_Byte* buf;
+
+
+      /* make the allocated buffer length a multiple of 4 */
+      buf = (FT_Byte*)calloc((len + 3) & ~3U, 1);
+      if (!buf)
+        return FT_Err_Out_Of_Memory;
+
+      memcpy(buf, data, len);
+
+      /* in case of success, `buf' gets linked */
+      /* and is eventually freed in `TA_font_unload' */
       error = TA_font_add_table(font, table_info, tag, len, buf);
       if (error)
-        goto Err;
+      {
+        free(buf);
+        return error;
+      }
     }
     else
     {
-      /* reuse existing SFNT table */
-      free(buf);
-      *table_info = j;
+      error = TA_font_add_table_view(font, table_info, tag, len, data);
+      if (error)
+        return error;
     }
-    continue;
-
-  Err:
-    free(buf);
-    return error;
   }
 
   /* no (non-empty) `glyf', `loca', `head', or `maxp' table; */
@@ -0,0 +1,863 @@
+/* tasimd.c */
+
+/*
+ * Copyright (C) 2022 by Werner Lemberg.
+ *
+ * This file is part of the ttfautohint library, and may only be used,
+ * modified, and distributed under the terms given in `COPYING'.  By
+ * continuing to use, modify, or distribute this file you indicate that you
+ * have read `COPYING' and understand and accept it fully.
+ *
+ * The file `COPYING' mentioned in the previous paragraph is distributed
+ * with the ttfautohint library.
+ */
+
+
+/*
+ * The vector versions work on 64-bit lanes, thus they are only used if
+ * `FT_Pos' is a 64-bit type.  Code for all supported instruction sets
+ * gets compiled (using function attributes); the best one is selected at
+ * runtime.  SSE2 is always available on x86_64.
+ *
+ * For testing and benchmarking, the outline kernels take an additional
+ * argument to restrict the instruction set (see `TA_SIMD_NONE' and
+ * friends); `TTF_autohint' sets it with option `simd'.
+ *
+ * The table checksum kernel works on 32-bit lanes; it also has a NEON
+ * version, which is always available if the compiler targets it.  It
+ * always uses the best instruction set.
+ */
+
+#include <string.h>
+
+#include "tasimd.h"
+
+#if FT_SIZEOF_LONG == 8 \
+    && (defined __x86_64__ || defined __amd64__) \
+    && (defined __GNUC__ || defined __clang__)
+#  define TA_SIMD_X86
+#  include <immintrin.h>
+
+#  define TA_TARGET_SSE42 __attribute__((target("sse4.2")))
+#  define TA_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+#if defined __ARM_NEON \
+    && (defined __GNUC__ || defined __clang__)
+#  define TA_SIMD_NEON
+#  include <arm_neon.h>
+#endif
+
+
+#ifdef TA_SIMD_X86
+
+static int
+ta_simd_level(void)
+{
+  static int level = -1;
+
+  int l = __atomic_load_n(&level, __ATOMIC_RELAXED);
+
+
+  if (l < 0)
+  {
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2"))
+      l = TA_SIMD_AVX2;
+    else if (__builtin_cpu_supports("sse4.2"))
+      l = TA_SIMD_SSE42;
+    else
+      l = TA_SIMD_SSE2;
+
+    /* all threads compute the same value */
+    __atomic_store_n(&level, l, __ATOMIC_RELAXED);
+  }
+
+  return l;
+}
+
+
+/*
+ * `FT_MulFix' rounds half away from zero, i.e.,
+ *
+ *   a * b / 0x10000  =  sign(a * b) * ((|a| * |b| + 0x8000) >> 16)
+ *
+ * We thus only need an unsigned 32x32 to 64 bit multiplication, which
+ * both SSE2 and AVX2 provide.  The absolute values of `a' and `b' must
+ * fit into 32 bits.
+ */
+
+/* `b_abs' is the absolute value of `b', `b_sign' its sign mask */
+static __m128i
+ta_mulfix_sse2(__m128i a,
+               __m128i b_abs,
+               __m128i b_sign)
+{
+  __m128i sign = _mm_shuffle_epi32(_mm_srai_epi32(a, 31),
+                                   _MM_SHUFFLE(3, 3, 1, 1));
+  __m128i a_abs = _mm_sub_epi64(_mm_xor_si128(a, sign), sign);
+  __m128i prod = _mm_mul_epu32(a_abs, b_abs);
+
+
+  prod = _mm_srli_epi64(_mm_add_epi64(prod, _mm_set1_epi64x(0x8000)), 16);
+  sign = _mm_xor_si128(sign, b_sign);
+
+  return _mm_sub_epi64(_mm_xor_si128(prod, sign), sign);
+}
+
+
+TA_TARGET_AVX2
+static __m256i
+ta_mulfix_avx2(__m256i a,
+               __m256i b_abs,
+               __m256i b_sign)
+{
+  __m256i sign = _mm256_shuffle_epi32(_mm256_srai_epi32(a, 31),
+                                      _MM_SHUFFLE(3, 3, 1, 1));
+  __m256i a_abs = _mm256_sub_epi64(_mm256_xor_si256(a, sign), sign);
+  __m256i prod = _mm256_mul_epu32(a_abs, b_abs);
+
+
+  prod = _mm256_srli_epi64(_mm256_add_epi64(prod,
+                                            _mm256_set1_epi64x(0x8000)),
+                           16);
+  sign = _mm256_xor_si256(sign, b_sign);
+
+  return _mm256_sub_epi64(_mm256_xor_si256(prod, sign), sign);
+}
+
+
+/* scaling values must be in the range (-2^31;2^31) */
+#define TA_SIMD_SCALE_OK(s) \
+          ((s) > -0x80000000L && (s) < 0x80000000L)
+
+
+static FT_UInt
+ta_simd_scale_vectors_sse2(const FT_Vector* vecs,
+                           FT_UInt count,
+                           FT_Fixed x_scale,
+                           FT_Pos x_delta,
+                           FT_Fixed y_scale,
+                           FT_Pos y_delta,
+                           FT_Pos* xs,
+                           FT_Pos* ys)
+{
+  FT_Pos x_sign = x_scale < 0 ? -1 : 0;
+  FT_Pos y_sign = y_scale < 0 ? -1 : 0;
+
+  /* one register holds a single vector, i.e., both an x and a y value */
+  __m128i b_abs = _mm_set_epi64x(y_sign ? -y_scale : y_scale,
+                                 x_sign ? -x_scale : x_scale);
+  __m128i b_sign = _mm_set_epi64x(y_sign, x_sign);
+  __m128i delta = _mm_set_epi64x(y_delta, x_delta);
+
+  FT_UInt i;
+
+
+  for (i = 0; i < count; i++)
+  {
+    __m128i v = _mm_loadu_si128((const __m128i*)&vecs[i]);
+
+
+    v = _mm_add_epi64(ta_mulfix_sse2(v, b_abs, b_sign), delta);
+
+    _mm_storel_epi64((__m128i*)&xs[i], v);
+    _mm_storel_epi64((__m128i*)&ys[i], _mm_unpackhi_epi64(v, v));
+  }
+
+  return i;
+}
+
+
+TA_TARGET_AVX2
+static FT_UInt
+ta_simd_scale_vectors_avx2(const FT_Vector* vecs,
+                           FT_UInt count,
+                           FT_Fixed x_scale,
+                           FT_Pos x_delta,
+                           FT_Fixed y_scale,
+                           FT_Pos y_delta,
+                           FT_Pos* xs,
+                           FT_Pos* ys)
+{
+  FT_Pos x_sign = x_scale < 0 ? -1 : 0;
+  FT_Pos y_sign = y_scale < 0 ? -1 : 0;
+
+  __m256i bx_abs = _mm256_set1_epi64x(x_sign ? -x_scale : x_scale);
+  __m256i bx_sign = _mm256_set1_epi64x(x_sign);
+  __m256i by_abs = _mm256_set1_epi64x(y_sign ? -y_scale : y_scale);
+  __m256i by_sign = _mm256_set1_epi64x(y_sign);
+  __m256i dx = _mm256_set1_epi64x(x_delta);
+  __m256i dy = _mm256_set1_epi64x(y_delta);
+
+  FT_UInt i;
+
+
+  for (i = 0; i + 4 <= count; i += 4)
+  {
+    /* x0 y0 x1 y1, x2 y2 x3 y3 */
+    __m256i v0 = _mm256_loadu_si256((const __m256i*)&vecs[i]);
+    __m256i v1 = _mm256_loadu_si256((const __m256i*)&vecs[i + 2]);
+
+    /* x0 x2 x1 x3, y0 y2 y1 y3 */
+    __m256i x = _mm256_unpacklo_epi64(v0, v1);
+    __m256i y = _mm256_unpackhi_epi64(v0, v1);
+
+
+    x = _mm256_add_epi64(ta_mulfix_avx2(x, bx_abs, bx_sign), dx);
+    y = _mm256_add_epi64(ta_mulfix_avx2(y, by_abs, by_sign), dy);
+
+    _mm256_storeu_si256((__m256i*)&xs[i],
+                        _mm256_permute4x64_epi64(x,
+                                                 _MM_SHUFFLE(3, 1, 2, 0)));
+    _mm256_storeu_si256((__m256i*)&ys[i],
+                        _mm256_permute4x64_epi64(y,
+                                                 _MM_SHUFFLE(3, 1, 2, 0)));
+  }
+
+  return i;
+}
+
+
+static FT_UInt
+ta_simd_store_vectors_sse2(FT_Vector* vecs,
+                           FT_UInt count,
+                           const FT_Pos* xs,
+                           const FT_Pos* ys)
+{
+  FT_UInt i;
+
+
+  for (i = 0; i + 2 <= count; i += 2)
+  {
+    __m128i x = _mm_loadu_si128((const __m128i*)&xs[i]);
+    __m128i y = _mm_loadu_si128((const __m128i*)&ys[i]);
+
+
+    _mm_storeu_si128((__m128i*)&vecs[i], _mm_unpacklo_epi64(x, y));
+    _mm_storeu_si128((__m128i*)&vecs[i + 1], _mm_unpackhi_epi64(x, y));
+  }
+
+  return i;
+}
+
+
+TA_TARGET_AVX2
+static FT_UInt
+ta_simd_store_vectors_avx2(FT_Vector* vecs,
+                           FT_UInt count,
+                           const FT_Pos* xs,
+                           const FT_Pos* ys)
+{
+  FT_UInt i;
+
+
+  for (i = 0; i + 4 <= count; i += 4)
+  {
+    /* x0 x2 x1 x3, y0 y2 y1 y3 */
+    __m256i x = _mm256_permute4x64_epi64(
+                  _mm256_loadu_si256((const __m256i*)&xs[i]),
+                  _MM_SHUFFLE(3, 1, 2, 0));
+    __m256i y = _mm256_permute4x64_epi64(
+                  _mm256_loadu_si256((const __m256i*)&ys[i]),
+                  _MM_SHUFFLE(3, 1, 2, 0));
+
+
+    _mm256_storeu_si256((__m256i*)&vecs[i], _mm256_unpacklo_epi64(x, y));
+    _mm256_storeu_si256((__m256i*)&vecs[i + 2], _mm256_unpackhi_epi64(x, y));
+  }
+
+  return i;
+}
+
+
+/* a register holds x and y values in alternating lanes, */
+/* so we don't have to separate them until the end; */
+/* `count' must be at least 1 */
+
+TA_TARGET_SSE42
+static FT_UInt
+ta_simd_cbox_sse42(const FT_Vector* vecs,
+                   FT_UInt count,
+                   FT_BBox* cbox)
+{
+  __m128i min = _mm_loadu_si128((const __m128i*)&vecs[0]);
+  __m128i max = min;
+
+  FT_Pos buf[2];
+  FT_UInt i;
+
+
+  for (i = 1; i < count; i++)
+  {
+    __m128i v = _mm_loadu_si128((const __m128i*)&vecs[i]);
+    __m128i lt = _mm_cmpgt_epi64(min, v);
+    __m128i gt = _mm_cmpgt_epi64(v, max);
+
+
+    min = _mm_blendv_epi8(min, v, lt);
+    max = _mm_blendv_epi8(max, v, gt);
+  }
+
+  _mm_storeu_si128((__m128i*)buf, min);
+  cbox->xMin = buf[0];
+  cbox->yMin = buf[1];
+  _mm_storeu_si128((__m128i*)buf, max);
+  cbox->xMax = buf[0];
+  cbox->yMax = buf[1];
+
+  return i;
+}
+
+
+/* `count' must be at least 2 */
+
+TA_TARGET_AVX2
+static FT_UInt
+ta_simd_cbox_avx2(const FT_Vector* vecs,
+                  FT_UInt count,
+                  FT_BBox* cbox)
+{
+  __m256i min = _mm256_loadu_si256((const __m256i*)&vecs[0]);
+  __m256i max = min;
+
+  FT_Pos buf[4];
+  FT_UInt i;
+
+
+  for (i = 2; i + 2 <= count; i += 2)
+  {
+    __m256i v = _mm256_loadu_si256((const __m256i*)&vecs[i]);
+    __m256i lt = _mm256_cmpgt_epi64(min, v);
+    __m256i gt = _mm256_cmpgt_epi64(v, max);
+
+
+    min = _mm256_blendv_epi8(min, v, lt);
+    max = _mm256_blendv_epi8(max, v, gt);
+  }
+
+  _mm256_storeu_si256((__m256i*)buf, min);
+  cbox->xMin = TA_MIN(buf[0], buf[2]);
+  cbox->yMin = TA_MIN(buf[1], buf[3]);
+  _mm256_storeu_si256((__m256i*)buf, max);
+  cbox->xMax = TA_MAX(buf[0], buf[2]);
+  cbox->yMax = TA_MAX(buf[1], buf[3]);
+
+  return i;
+}
+
+
+static FT_UInt
+ta_simd_iup_shift_sse2(FT_Pos* cur,
+                       const FT_Pos* org,
+                       FT_UInt count,
+                       FT_Pos delta)
+{
+  __m128i d = _mm_set1_epi64x(delta);
+
+  FT_UInt i;
+
+
+  for (i = 0; i + 2 <= count; i += 2)
+  {
+    __m128i u = _mm_loadu_si128((const __m128i*)&org[i]);
+
+
+    _mm_storeu_si128((__m128i*)&cur[i], _mm_add_epi64(u, d));
+  }
+
+  return i;
+}
+
+
+TA_TARGET_AVX2
+static FT_UInt
+ta_simd_iup_shift_avx2(FT_Pos* cur,
+                       const FT_Pos* org,
+                       FT_UInt count,
+                       FT_Pos delta)
+{
+  __m256i d = _mm256_set1_epi64x(delta);
+
+  FT_UInt i;
+
+
+  for (i = 0; i + 4 <= count; i += 4)
+  {
+    __m256i u = _mm256_loadu_si256((const __m256i*)&org[i]);
+
+
+    _mm256_storeu_si256((__m256i*)&cur[i], _mm256_add_epi64(u, d));
+  }
+
+  return i;
+}
+
+
+/*
+ * For the interpolation we compute all three possible results and select
+ * the right one with masks.  Note that the `u <= v1' test takes
+ * precedence (for `v1 == v2').  For lanes outside of the range (v1;v2)
+ * the multiplication gives garbage, which gets masked out.
+ */
+
+TA_TARGET_SSE42
+static FT_UInt
+ta_simd_iup_interp_sse42(FT_Pos* cur,
+                         const FT_Pos* org,
+                         FT_UInt count,
+                         FT_Pos v1,
+                         FT_Pos v2,
+                         FT_Pos u1,
+                         FT_Pos u2,
+                         FT_Fixed scale)
+{
+  FT_Pos s_sign = scale < 0 ? -1 : 0;
+
+  __m128i b_abs = _mm_set1_epi64x(s_sign ? -scale : scale);
+  __m128i b_sign = _mm_set1_epi64x(s_sign);
+  __m128i vv1 = _mm_set1_epi64x(v1);
+  __m128i vv2 = _mm_set1_epi64x(v2);
+  __m128i uu1 = _mm_set1_epi64x(u1);
+  __m128i d1 = _mm_set1_epi64x(u1 - v1);
+  __m128i d2 = _mm_set1_epi64x(u2 - v2);
+
+  FT_UInt i;
+
+
+  for (i = 0; i + 2 <= count; i += 2)
+  {
+    __m128i u = _mm_loadu_si128((const __m128i*)&org[i]);
+
+    /* masks for `u > v1' and `u < v2' */
+    __m128i gt1 = _mm_cmpgt_epi64(u, vv1);
+    __m128i lt2 = _mm_cmpgt_epi64(vv2, u);
+
+    __m128i r = _mm_add_epi64(uu1,
+                              ta_mulfix_sse2(_mm_sub_epi64(u, vv1),
+                                             b_abs, b_sign));
+
+
+    r = _mm_blendv_epi8(_mm_add_epi64(u, d2), r, lt2);
+    r = _mm_blendv_epi8(_mm_add_epi64(u, d1), r, gt1);
+
+    _mm_storeu_si128((__m128i*)&cur[i], r);
+  }
+
+  return i;
+}
+
+
+TA_TARGET_AVX2
+static FT_UInt
+ta_simd_iup_interp_avx2(FT_Pos* cur,
+                        const FT_Pos* org,
+                        FT_UInt count,
+                        FT_Pos v1,
+                        FT_Pos v2,
+                        FT_Pos u1,
+                        FT_Pos u2,
+                        FT_Fixed scale)
+{
+  FT_Pos s_sign = scale < 0 ? -1 : 0;
+
+  __m256i b_abs = _mm256_set1_epi64x(s_sign ? -scale : scale);
+  __m256i b_sign = _mm256_set1_epi64x(s_sign);
+  __m256i vv1 = _mm256_set1_epi64x(v1);
+  __m256i vv2 = _mm256_set1_epi64x(v2);
+  __m256i uu1 = _mm256_set1_epi64x(u1);
+  __m256i d1 = _mm256_set1_epi64x(u1 - v1);
+  __m256i d2 = _mm256_set1_epi64x(u2 - v2);
+
+  FT_UInt i;
+
+
+  for (i = 0; i + 4 <= count; i += 4)
+  {
+    __m256i u = _mm256_loadu_si256((const __m256i*)&org[i]);
+
+    __m256i gt1 = _mm256_cmpgt_epi64(u, vv1);
+    __m256i lt2 = _mm256_cmpgt_epi64(vv2, u);
+
+    __m256i r = _mm256_add_epi64(uu1,
+                                 ta_mulfix_avx2(_mm256_sub_epi64(u, vv1),
+                                                b_abs, b_sign));
+
+
+    r = _mm256_blendv_epi8(_mm256_add_epi64(u, d2), r, lt2);
+    r = _mm256_blendv_epi8(_mm256_add_epi64(u, d1), r, gt1);
+
+    _mm256_storeu_si256((__m256i*)&cur[i], r);
+  }
+
+  return i;
+}
+
+
+/*
+ * Sum up big-endian 32-bit values.  Since the checksum is computed
+ * modulo 2^32 we can accumulate in 32-bit lanes and ignore overflow.
+ */
+
+static FT_ULong
+ta_simd_checksum_sse2(const FT_Byte* buf,
+                      FT_ULong count,
+                      FT_UInt32* sum)
+{
+  __m128i acc = _mm_setzero_si128();
+
+  FT_ULong i;
+
+
+  for (i = 0; i + 4 <= count; i += 4)
+  {
+    __m128i u = _mm_loadu_si128((const __m128i*)(buf + 4 * i));
+
+
+    /* SSE2 lacks a byte shuffle: first swap the bytes */
+    /* of all 16-bit units, then the units themselves */
+    u = _mm_or_si128(_mm_slli_epi16(u, 8), _mm_srli_epi16(u, 8));
+    u = _mm_shufflelo_epi16(u, _MM_SHUFFLE(2, 3, 0, 1));
+    u = _mm_shufflehi_epi16(u, _MM_SHUFFLE(2, 3, 0, 1));
+
+    acc = _mm_add_epi32(acc, u);
+  }
+
+  acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(1, 0, 3, 2)));
+  acc = _mm_add_epi32(acc, _mm_shuffle_epi32(acc, _MM_SHUFFLE(2, 3, 0, 1)));
+
+  *sum = (FT_UInt32)_mm_cvtsi128_si32(acc);
+
+  return i;
+}
+
+
+TA_TARGET_AVX2
+static FT_ULong
+ta_simd_checksum_avx2(const FT_Byte* buf,
+                      FT_ULong count,
+                      FT_UInt32* sum)
+{
+  __m256i swap = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4,
+                                  11, 10, 9, 8, 15, 14, 13, 12,
+                                  3, 2, 1, 0, 7, 6, 5, 4,
+                                  11, 10, 9, 8, 15, 14, 13, 12);
+  __m256i acc = _mm256_setzero_si256();
+  __m128i acc128;
+
+  FT_ULong i;
+
+
+  for (i = 0; i + 8 <= count; i += 8)
+  {
+    __m256i u = _mm256_loadu_si256((const __m256i*)(buf + 4 * i));
+
+
+    acc = _mm256_add_epi32(acc, _mm256_shuffle_epi8(u, swap));
+  }
+
+  acc128 = _mm_add_epi32(_mm256_castsi256_si128(acc),
+                         _mm256_extracti128_si256(acc, 1));
+  acc128 = _mm_add_epi32(acc128,
+                         _mm_shuffle_epi32(acc128, _MM_SHUFFLE(1, 0, 3, 2)));
+  acc128 = _mm_add_epi32(acc128,
+                         _mm_shuffle_epi32(acc128, _MM_SHUFFLE(2, 3, 0, 1)));
+
+  *sum = (FT_UInt32)_mm_cvtsi128_si32(acc128);
+
+  return i;
+}
+
+#endif /* TA_SIMD_X86 */
+
+
+#ifdef TA_SIMD_NEON
+
+static FT_ULong
+ta_simd_checksum_neon(const FT_Byte* buf,
+                      FT_ULong count,
+                      FT_UInt32* sum)
+{
+  uint32x4_t acc = vdupq_n_u32(0);
+  uint32x2_t acc64;
+
+  FT_ULong i;
+
+
+  for (i = 0; i + 4 <= count; i += 4)
+  {
+    uint8x16_t u = vld1q_u8(buf + 4 * i);
+
+
+    acc = vaddq_u32(acc, vreinterpretq_u32_u8(vrev32q_u8(u)));
+  }
+
+  acc64 = vadd_u32(vget_low_u32(acc), vget_high_u32(acc));
+  acc64 = vpadd_u32(acc64, acc64);
+
+  *sum = (FT_UInt32)vget_lane_u32(acc64, 0);
+
+  return i;
+}
+
+#endif /* TA_SIMD_NEON */
+
+
+int
+ta_simd_parse_level(const char* name)
+{
+  if (!strcmp(name, "none"))
+    return TA_SIMD_NONE;
+  if (!strcmp(name, "sse2"))
+    return TA_SIMD_SSE2;
+  if (!strcmp(name, "sse4.2"))
+    return TA_SIMD_SSE42;
+  if (!strcmp(name, "avx2"))
+    return TA_SIMD_AVX2;
+
+  return -1;
+}
+
+
+void
+ta_simd_scale_vectors(FT_Int max_level,
+                      const FT_Vector* vecs,
+                      FT_UInt count,
+                      FT_Fixed x_scale,
+                      FT_Pos x_delta,
+                      FT_Fixed y_scale,
+                      FT_Pos y_delta,
+                      FT_Pos* xs,
+                      FT_Pos* ys)
+{
+  FT_UInt i = 0;
+
+
+#ifdef TA_SIMD_X86
+  /* the scaling values are positive in practice */
+  if (TA_SIMD_SCALE_OK(x_scale) && TA_SIMD_SCALE_OK(y_scale))
+  {
+    int level = TA_MIN(ta_simd_level(), max_level);
+
+
+    if (level >= TA_SIMD_AVX2)
+      i = ta_simd_scale_vectors_avx2(vecs, count,
+                                     x_scale, x_delta, y_scale, y_delta,
+                                     xs, ys);
+    else if (level >= TA_SIMD_SSE2)
+      i = ta_simd_scale_vectors_sse2(vecs, count,
+                                     x_scale, x_delta, y_scale, y_delta,
+                                     xs, ys);
+  }
+#else
+  FT_UNUSED(max_level);
+#endif
+
+  for (; i < count; i++)
+  {
+    xs[i] = FT_MulFix(vecs[i].x, x_scale) + x_delta;
+    ys[i] = FT_MulFix(vecs[i].y, y_scale) + y_delta;
+  }
+}
+
+
+void
+ta_simd_store_vectors(FT_Int max_level,
+                      FT_Vector* vecs,
+                      FT_UInt count,
+                      const FT_Pos* xs,
+                      const FT_Pos* ys)
+{
+  FT_UInt i = 0;
+
+
+#ifdef TA_SIMD_X86
+  {
+    int level = TA_MIN(ta_simd_level(), max_level);
+
+
+    if (level >= TA_SIMD_AVX2)
+      i = ta_simd_store_vectors_avx2(vecs, count, xs, ys);
+    else if (level >= TA_SIMD_SSE2)
+      i = ta_simd_store_vectors_sse2(vecs, count, xs, ys);
+  }
+#else
+  FT_UNUSED(max_level);
+#endif
+
+  for (; i < count; i++)
+  {
+    vecs[i].x = xs[i];
+    vecs[i].y = ys[i];
+  }
+}
+
+
+void
+ta_simd_cbox(FT_Int max_level,
+             const FT_Vector* vecs,
+             FT_UInt count,
+             FT_BBox* cbox)
+{
+  FT_UInt i = 1;
+
+
+  if (!count)
+  {
+    cbox->xMin = 0;
+    cbox->yMin = 0;
+    cbox->xMax = 0;
+    cbox->yMax = 0;
+
+    return;
+  }
+
+  cbox->xMin = cbox->xMax = vecs[0].x;
+  cbox->yMin = cbox->yMax = vecs[0].y;
+
+#ifdef TA_SIMD_X86
+  {
+    int level = TA_MIN(ta_simd_level(), max_level);
+
+
+    if (level >= TA_SIMD_AVX2 && count >= 2)
+      i = ta_simd_cbox_avx2(vecs, count, cbox);
+    else if (level >= TA_SIMD_SSE42)
+      i = ta_simd_cbox_sse42(vecs, count, cbox);
+  }
+#else
+  FT_UNUSED(max_level);
+#endif
+
+  for (; i < count; i++)
+  {
+    FT_Pos x = vecs[i].x;
+    FT_Pos y = vecs[i].y;
+
+
+    if (x < cbox->xMin)
+      cbox->xMin = x;
+    if (x > cbox->xMax)
+      cbox->xMax = x;
+    if (y < cbox->yMin)
+      cbox->yMin = y;
+    if (y > cbox->yMax)
+      cbox->yMax = y;
+  }
+}
+
+
+void
+ta_simd_iup_shift(FT_Int max_level,
+                  FT_Pos* cur,
+                  const FT_Pos* org,
+                  FT_UInt count,
+                  FT_Pos delta)
+{
+  FT_UInt i = 0;
+
+
+#ifdef TA_SIMD_X86
+  {
+    int level = TA_MIN(ta_simd_level(), max_level);
+
+
+    if (level >= TA_SIMD_AVX2)
+      i = ta_simd_iup_shift_avx2(cur, org, count, delta);
+    else if (level >= TA_SIMD_SSE2)
+      i = ta_simd_iup_shift_sse2(cur, org, count, delta);
+  }
+#else
+  FT_UNUSED(max_level);
+#endif
+
+  for (; i < count; i++)
+    cur[i] = org[i] + delta;
+}
+
+
+void
+ta_simd_iup_interp(FT_Int max_level,
+                   FT_Pos* cur,
+                   const FT_Pos* org,
+                   FT_UInt count,
+                   FT_Pos v1,
+                   FT_Pos v2,
+                   FT_Pos u1,
+                   FT_Pos u2,
+                   FT_Fixed scale)
+{
+  FT_Pos d1 = u1 - v1;
+  FT_Pos d2 = u2 - v2;
+
+  FT_UInt i = 0;
+
+
+#ifdef TA_SIMD_X86
+  /* `org[i] - v1' must fit into 32 bits also */
+  if (TA_SIMD_SCALE_OK(scale)
+      && v2 - v1 < 0x80000000L)
+  {
+    int level = TA_MIN(ta_simd_level(), max_level);
+
+
+    if (level >= TA_SIMD_AVX2)
+      i = ta_simd_iup_interp_avx2(cur, org, count, v1, v2, u1, u2, scale);
+    else if (level >= TA_SIMD_SSE42)
+      i = ta_simd_iup_interp_sse42(cur, org, count, v1, v2, u1, u2, scale);
+  }
+#else
+  FT_UNUSED(max_level);
+#endif
+
+  for (; i < count; i++)
+  {
+    FT_Pos u = org[i];
+
+
+    if (u <= v1)
+      u += d1;
+    else if (u >= v2)
+      u += d2;
+    else
+      u = u1 + FT_MulFix(u - v1, scale);
+
+    cur[i] = u;
+  }
+}
+
+
+FT_ULong
+ta_simd_checksum(const FT_Byte* buf,
+                 FT_ULong count)
+{
+  FT_UInt32 sum = 0;
+
+  FT_ULong i = 0;
+
+
+#ifdef TA_SIMD_X86
+  {
+    int level = ta_simd_level();
+
+
+    if (level >= TA_SIMD_AVX2)
+      i = ta_simd_checksum_avx2(buf, count, &sum);
+    else if (level >= TA_SIMD_SSE2)
+      i = ta_simd_checksum_sse2(buf, count, &sum);
+  }
+#elif defined TA_SIMD_NEON
+  i = ta_simd_checksum_neon(buf, count, &sum);
+#endif
+
+  for (buf += 4 * i; i < count; i++, buf += 4)
+    sum += ((FT_UInt32)buf[0] << 24)
+           | ((FT_UInt32)buf[1] << 16)
+           | ((FT_UInt32)buf[2] << 8)
+           | (FT_UInt32)buf[3];
+
+  return sum;
+}
+
+/* end of tasimd.c */
@@ -0,0 +1,135 @@
+/* tasimd.h */
+
+/*
+ * Copyright (C) 2022 by Werner Lemberg.
+ *
+ * This file is part of the ttfautohint library, and may only be used,
+ * modified, and distributed under the terms given in `COPYING'.  By
+ * continuing to use, modify, or distribute this file you indicate that you
+ * have read `COPYING' and understand and accept it fully.
+ *
+ * The file `COPYING' mentioned in the previous paragraph is distributed
+ * with the ttfautohint library.
+ */
+
+
+/* kernels for coordinate arrays and table checksums, using SSE2, */
+/* SSE4.2, AVX2, or NEON if the CPU supports it */
+
+#ifndef TASIMD_H_
+#define TASIMD_H_
+
+#include "tatypes.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*
+ * The instruction sets, in increasing order.  The outline kernels below
+ * use the best one available but not better than their `max_level'
+ * argument.
+ */
+
+#define TA_SIMD_NONE 0
+#define TA_SIMD_SSE2 1
+#define TA_SIMD_SSE42 2
+#define TA_SIMD_AVX2 3
+
+#define TA_SIMD_MAX TA_SIMD_AVX2
+
+
+/* return the instruction set named `name' (`none', `sse2', `sse4.2', */
+/* or `avx2'), or -1 if the name is unknown */
+
+int
+ta_simd_parse_level(const char* name);
+
+
+/*
+ * Compute
+ *
+ *   xs[i] = FT_MulFix(vecs[i].x, x_scale) + x_delta
+ *   ys[i] = FT_MulFix(vecs[i].y, y_scale) + y_delta
+ *
+ * for all `count' elements of `vecs'.  The results are bit-exact if the
+ * input coordinates fit into 32 bits (which is always true for font
+ * units).
+ */
+
+void
+ta_simd_scale_vectors(FT_Int max_level,
+                      const FT_Vector* vecs,
+                      FT_UInt count,
+                      FT_Fixed x_scale,
+                      FT_Pos x_delta,
+                      FT_Fixed y_scale,
+                      FT_Pos y_delta,
+                      FT_Pos* xs,
+                      FT_Pos* ys);
+
+/* the inverse of the above without scaling: */
+/* interleave `xs' and `ys' into `vecs' */
+
+void
+ta_simd_store_vectors(FT_Int max_level,
+                      FT_Vector* vecs,
+                      FT_UInt count,
+                      const FT_Pos* xs,
+                      const FT_Pos* ys);
+
+/* the same as `FT_Outline_Get_CBox' for an array of points */
+
+void
+ta_simd_cbox(FT_Int max_level,
+             const FT_Vector* vecs,
+             FT_UInt count,
+             FT_BBox* cbox);
+
+/* set `cur[i] = org[i] + delta' for all `count' elements */
+
+void
+ta_simd_iup_shift(FT_Int max_level,
+                  FT_Pos* cur,
+                  const FT_Pos* org,
+                  FT_UInt count,
+                  FT_Pos delta);
+
+/*
+ * Interpolate `count' points for the `IUP' instruction: points with
+ * original coordinates `org[i]' outside of the range [v1;v2] (with
+ * `v1 <= v2') get shifted like the nearest reference point, the others
+ * are scaled with
+ *
+ *   cur[i] = u1 + FT_MulFix(org[i] - v1, scale)
+ *
+ * Here, `v1' and `v2' are the original coordinates of the reference
+ * points, and `u1' and `u2' their current ones.
+ */
+
+void
+ta_simd_iup_interp(FT_Int max_level,
+                   FT_Pos* cur,
+                   const FT_Pos* org,
+                   FT_UInt count,
+                   FT_Pos v1,
+                   FT_Pos v2,
+                   FT_Pos u1,
+                   FT_Pos u2,
+                   FT_Fixed scale);
+
+/* return the sum of `count' big-endian 32-bit values in `buf', */
+/* modulo 2^32; this is the checksum algorithm of SFNT tables */
+
+FT_ULong
+ta_simd_checksum(const FT_Byte* buf,
+                 FT_ULong count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TASIMD_H_ */
+
+/* end of tasimd.h */
@@ -0,0 +1,475 @@
+/* tasubfont.c */
+
+/*
+ * Copyright (C) 2022 by Werner Lemberg.
+ *
+ * This file is part of the ttfautohint library, and may only be used,
+ * modified, and distributed under the terms given in `COPYING'.  By
+ * continuing to use, modify, or distribute this file you indicate that you
+ * have read `COPYING' and understand and accept it fully.
+ *
+ * The file `COPYING' mentioned in the previous paragraph is distributed
+ * with the ttfautohint library.
+ */
+
+
+/*
+ * Build the hinting tables of all subfonts, either sequentially or with
+ * a pool of threads.
+ *
+ * Subfonts of a TTC that share a `glyf' table also share `cvt', `fpgm',
+ * and `prep'; they are processed only once, namely by the first subfont
+ * referencing them (the `owner').  Owners don't have any mutable data in
+ * common, except the global table array: each worker thread gets a
+ * private copy of the `FONT' structure with its own table array, glyph
+ * loader, and control instructions cursor.  After all workers are done,
+ * the newly created tables are appended to the global table array in
+ * subfont order, thus the result is exactly the same as with sequential
+ * processing.  The remaining subfonts are then handled sequentially.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+
+#include "ta.h"
+#include "tathread.h"
+
+
+static FT_Error
+TA_sfnt_build_hints(SFNT* sfnt,
+                    FONT* font,
+                    FT_Bool do_gasp)
+{
+  FT_Error error;
+
+
+  error = ta_loader_init(font);
+  if (error)
+    goto Exit;
+
+  if (do_gasp)
+  {
+    error = TA_sfnt_build_gasp_table(sfnt, font);
+    if (error)
+      goto Exit;
+  }
+  if (!font->dehint)
+  {
+    error = TA_sfnt_build_cvt_table(sfnt, font);
+    if (error)
+      goto Exit;
+    error = TA_sfnt_build_fpgm_table(sfnt, font);
+    if (error)
+      goto Exit;
+    error = TA_sfnt_build_prep_table(sfnt, font);
+    if (error)
+      goto Exit;
+  }
+  error = TA_sfnt_build_glyf_table(sfnt, font);
+  if (error)
+    goto Exit;
+  error = TA_sfnt_build_loca_table(sfnt, font);
+
+Exit:
+  ta_loader_done(font);
+
+  return error;
+}
+
+
+/* the data of a worker thread */
+typedef struct Subfont_
+{
+  FONT* font; /* a private copy */
+  FT_Error error;
+} Subfont;
+
+/* the data shared by all worker threads */
+typedef struct Subfonts_
+{
+  FONT* font;
+  FT_ULong num_tables; /* before starting the workers */
+
+  FT_Long* owners; /* subfont indices */
+  Subfont* subfonts;
+
+  TA_MutexRec mutex;
+  FT_Bool abort;
+  FT_Error error; /* the first error that occurred */
+} Subfonts;
+
+
+/* serialize the user's progress callback and propagate errors */
+
+static FT_Int
+progress_wrapper(FT_Long curr_idx,
+                 FT_Long num_glyphs,
+                 FT_Long curr_sfnt,
+                 FT_Long num_sfnts,
+                 void* user)
+{
+  Subfonts* subfonts = (Subfonts*)user;
+  FONT* font = subfonts->font;
+  FT_Int ret = 0;
+
+
+  ta_mutex_lock(&subfonts->mutex);
+
+  if (subfonts->abort)
+    ret = 1;
+  else if (font->progress)
+  {
+    ret = font->progress(curr_idx, num_glyphs,
+                         curr_sfnt, num_sfnts,
+                         font->progress_data);
+    if (ret)
+      subfonts->abort = 1;
+  }
+
+  ta_mutex_unlock(&subfonts->mutex);
+
+  return ret;
+}
+
+
+/* serialize the user's glyph report callback */
+
+static void
+glyph_report_wrapper(const TA_Glyph_Report* report,
+                     void* user)
+{
+  Subfonts* subfonts = (Subfonts*)user;
+  FONT* font = subfonts->font;
+
+
+  ta_mutex_lock(&subfonts->mutex);
+  font->glyph_report(report, font->glyph_report_data);
+  ta_mutex_unlock(&subfonts->mutex);
+}
+
+
+static void
+hint_subfont(FT_Long idx,
+             void* data)
+{
+  Subfonts* subfonts = (Subfonts*)data;
+  FONT* font = subfonts->font;
+  Subfont* subfont = &subfonts->subfonts[idx];
+  SFNT* sfnt = &font->sfnts[subfonts->owners[idx]];
+
+  FONT* sub = NULL;
+  TA_FaceGlobals globals;
+  FT_Error error;
+  FT_Bool abort;
+
+
+  ta_mutex_lock(&subfonts->mutex);
+  abort = subfonts->abort;
+  ta_mutex_unlock(&subfonts->mutex);
+
+  if (abort)
+  {
+    error = TA_Err_Canceled;
+    goto Exit;
+  }
+
+  sub = (FONT*)malloc(sizeof (FONT));
+  if (!sub)
+  {
+    error = FT_Err_Out_Of_Memory;
+    goto Exit;
+  }
+
+  *sub = *font;
+
+  sub->tables = (SFNT_Table*)malloc(subfonts->num_tables
+                                    * sizeof (SFNT_Table));
+  if (!sub->tables)
+  {
+    free(sub);
+    sub = NULL;
+    error = FT_Err_Out_Of_Memory;
+    goto Exit;
+  }
+  memcpy(sub->tables, font->tables,
+         subfonts->num_tables * sizeof (SFNT_Table));
+
+  sub->control_segment_dirs_head = NULL;
+  sub->control_segment_dirs_cur = NULL;
+  TA_control_seek(sub, sfnt->face->face_index);
+
+  sub->progress = progress_wrapper;
+  sub->progress_data = subfonts;
+  if (font->glyph_report)
+  {
+    sub->glyph_report = glyph_report_wrapper;
+    sub->glyph_report_data = subfonts;
+  }
+
+  /* the face globals, set up while handling the coverage, */
+  /* need access to our loader and control instructions cursor */
+  globals = (TA_FaceGlobals)sfnt->face->autohint.data;
+  if (globals)
+    globals->font = sub;
+
+  error = TA_sfnt_build_hints(sfnt, sub, 0);
+
+  globals = (TA_FaceGlobals)sfnt->face->autohint.data;
+  if (globals)
+    globals->font = font;
+
+  TA_control_free((Control*)sub->control_segment_dirs_head);
+  sub->control_segment_dirs_head = NULL;
+  sub->control_segment_dirs_cur = NULL;
+
+Exit:
+  subfont->font = sub;
+  subfont->error = error;
+
+  if (error)
+  {
+    ta_mutex_lock(&subfonts->mutex);
+    if (!subfonts->error)
+      subfonts->error = error;
+    subfonts->abort = 1;
+    ta_mutex_unlock(&subfonts->mutex);
+  }
+}
+
+
+/* move the tables of a worker into `font' */
+
+static FT_Error
+merge_subfont(Subfonts* subfonts,
+              FT_Long idx)
+{
+  FONT* font = subfonts->font;
+  FONT* sub = subfonts->subfonts[idx].font;
+  SFNT* sfnt = &font->sfnts[subfonts->owners[idx]];
+  glyf_Data* data;
+
+  FT_ULong base = subfonts->num_tables;
+  FT_ULong* new_idx = NULL;
+  FT_ULong i;
+  FT_Error error = FT_Err_Ok;
+
+
+  if (!sub)
+    return FT_Err_Ok;
+
+  /* the tables modified by the worker (`glyf', `loca', `head') */
+  /* are referenced by the table infos of the subfont */
+  for (i = 0; i < sfnt->num_table_infos; i++)
+  {
+    SFNT_Table_Info table_info = sfnt->table_infos[i];
+
+
+    if (table_info < base)
+      font->tables[table_info] = sub->tables[table_info];
+  }
+
+  if (sub->num_tables > base)
+  {
+    new_idx = (FT_ULong*)malloc((sub->num_tables - base)
+                                * sizeof (FT_ULong));
+    if (!new_idx)
+    {
+      error = FT_Err_Out_Of_Memory;
+      goto Exit;
+    }
+  }
+
+  /* append the new tables (`cvt', `fpgm', `prep') */
+  for (i = base; i < sub->num_tables; i++)
+  {
+    SFNT_Table* table = &sub->tables[i];
+    SFNT_Table_Info table_info;
+
+
+    error = TA_font_add_table(font, &table_info,
+                              table->tag, table->len, table->buf);
+    if (error)
+      goto Exit;
+
+    table->buf = NULL;
+    new_idx[i - base] = table_info;
+  }
+
+  for (i = 0; i < sfnt->num_table_infos; i++)
+  {
+    if (sfnt->table_infos[i] >= base)
+      sfnt->table_infos[i] = new_idx[sfnt->table_infos[i] - base];
+  }
+
+  data = (glyf_Data*)font->tables[sfnt->glyf_idx].data;
+  if (data)
+  {
+    if (data->cvt_idx != MISSING && data->cvt_idx >= base)
+      data->cvt_idx = new_idx[data->cvt_idx - base];
+    if (data->fpgm_idx != MISSING && data->fpgm_idx >= base)
+      data->fpgm_idx = new_idx[data->fpgm_idx - base];
+    if (data->prep_idx != MISSING && data->prep_idx >= base)
+      data->prep_idx = new_idx[data->prep_idx - base];
+  }
+
+Exit:
+  /* in case of error, free tables not appended yet */
+  for (i = base; i < sub->num_tables; i++)
+    free(sub->tables[i].buf);
+
+  free(new_idx);
+  free(sub->tables);
+  free(sub);
+  subfonts->subfonts[idx].font = NULL;
+
+  return error;
+}
+
+
+static FT_Error
+TA_font_hint_sfnts_parallel(FONT* font,
+                            FT_Long* owners,
+                            FT_Long num_owners)
+{
+  Subfonts subfonts;
+  FT_Long i;
+  FT_Error error;
+
+
+  subfonts.subfonts = (Subfont*)calloc((size_t)num_owners,
+                                       sizeof (Subfont));
+  if (!subfonts.subfonts)
+    return FT_Err_Out_Of_Memory;
+
+  /* we have a single `gasp' table for all subfonts, */
+  /* which gets created first */
+  for (i = 0; i < num_owners; i++)
+  {
+    error = TA_sfnt_build_gasp_table(&font->sfnts[owners[i]], font);
+    if (error)
+    {
+      free(subfonts.subfonts);
+      return error;
+    }
+  }
+
+  subfonts.font = font;
+  subfonts.num_tables = font->num_tables;
+  subfonts.owners = owners;
+  subfonts.abort = 0;
+  subfonts.error = FT_Err_Ok;
+  ta_mutex_init(&subfonts.mutex);
+
+  ta_thread_run_jobs(font->num_threads, num_owners,
+                     hint_subfont, &subfonts);
+
+  ta_mutex_done(&subfonts.mutex);
+
+  /* always merge to keep the table array consistent */
+  error = subfonts.error;
+  for (i = 0; i < num_owners; i++)
+  {
+    FT_Error merge_error = merge_subfont(&subfonts, i);
+
+
+    if (!error)
+      error = merge_error;
+  }
+
+  free(subfonts.subfonts);
+
+  return error;
+}
+
+
+FT_Error
+TA_font_hint_sfnts(FONT* font)
+{
+  FT_Long* owners = NULL;
+  FT_Long num_owners = 0;
+  FT_Long i, j;
+  FT_Error error;
+
+
+  /* compute the style metrics in advance (in parallel) */
+  /* instead of on demand while building the `cvt' tables */
+  if (font->num_threads > 1
+      && !font->debug
+      && !font->dehint)
+    ta_font_init_metrics(font);
+
+  /*
+   * Both the debugging output and the glyph loading from a reference
+   * font (for computing the style metrics) need global state.
+   */
+  if (font->num_threads < 2
+      || font->num_sfnts < 2
+      || font->debug
+      || font->reference)
+    goto Sequential;
+
+  owners = (FT_Long*)malloc((size_t)font->num_sfnts * sizeof (FT_Long));
+  if (!owners)
+    goto Sequential;
+
+  for (i = 0; i < font->num_sfnts; i++)
+  {
+    SFNT* sfnt = &font->sfnts[i];
+    FT_Bool is_owner = 1;
+
+
+    for (j = 0; j < num_owners; j++)
+    {
+      SFNT* owner = &font->sfnts[owners[j]];
+
+
+      if (sfnt->glyf_idx == owner->glyf_idx)
+        is_owner = 0;
+      /* `loca' and `head' get modified also */
+      else if (sfnt->loca_idx == owner->loca_idx
+               || sfnt->head_idx == owner->head_idx)
+        goto Sequential;
+    }
+
+    if (is_owner)
+      owners[num_owners++] = i;
+  }
+
+  if (num_owners < 2)
+    goto Sequential;
+
+  error = TA_font_hint_sfnts_parallel(font, owners, num_owners);
+  if (error)
+    goto Exit;
+
+  /* the remaining subfonts reuse the tables created above */
+  for (i = 0, j = 0; i < font->num_sfnts; i++)
+  {
+    if (j < num_owners && owners[j] == i)
+    {
+      j++;
+      continue;
+    }
+
+    error = TA_sfnt_build_hints(&font->sfnts[i], font, 1);
+    if (error)
+      goto Exit;
+  }
+
+  goto Exit;
+
+Sequential:
+  for (i = 0; i < font->num_sfnts; i++)
+  {
+    error = TA_sfnt_build_hints(&font->sfnts[i], font, 1);
+    if (error)
+      goto Exit;
+  }
+
+Exit:
+  free(owners);
+
+  return error;
+}
+
+/* end of tasubfont.c */
@@ -0,0 +1,392 @@
+/* tasubset-test.c */
+
+/*
+ * Copyright (C) 2022 by Werner Lemberg.
+ *
+ * This file is part of the ttfautohint library, and may only be used,
+ * modified, and distributed under the terms given in `COPYING'.  By
+ * continuing to use, modify, or distribute this file you indicate that you
+ * have read `COPYING' and understand and accept it fully.
+ *
+ * The file `COPYING' mentioned in the previous paragraph is distributed
+ * with the ttfautohint library.
+ */
+
+/*
+ * Compile with
+ *
+ *   $(CC) $(CFLAGS) $(FREETYPE_CFLAGS) \
+ *         -I.. -I. \
+ *         -o tasubset-test tasubset-test.c \
+ *         .libs/libttfautohint.a $(FREETYPE_LIBS) $(HARFBUZZ_LIBS)
+ *
+ * after building the library, then call
+ *
+ *   ./tasubset-test FONT
+ *
+ * with a TrueType font that has at least one composite glyph, for example
+ * `DejaVuSans.ttf'.  The program hints FONT, creates a subset of the
+ * result, and checks the number of glyphs, the `cmap', `loca', and `glyf'
+ * tables, and the character range in the `OS/2' table of the subset.  It
+ * aborts with an assertion message in case of an error, otherwise it
+ * produces no output.
+ */
+
+
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#include FT_TRUETYPE_TABLES_H
+#include FT_TRUETYPE_TAGS_H
+
+#include <ttfautohint.h>
+
+
+#define MAX_GLYPHS 65536
+
+
+static char*
+read_file(const char* name,
+          size_t* len)
+{
+  FILE* f;
+  char* buf;
+  long size;
+
+
+  f = fopen(name, "rb");
+  assert(f);
+
+  assert(!fseek(f, 0, SEEK_END));
+  size = ftell(f);
+  assert(size > 0);
+  rewind(f);
+
+  buf = (char*)malloc((size_t)size);
+  assert(buf);
+  assert(fread(buf, 1, (size_t)size, f) == (size_t)size);
+
+  fclose(f);
+
+  *len = (size_t)size;
+  return buf;
+}
+
+
+static FT_Byte*
+load_table(FT_Face face,
+           FT_ULong tag,
+           FT_ULong* len)
+{
+  FT_Byte* buf;
+
+
+  *len = 0;
+  assert(!FT_Load_Sfnt_Table(face, tag, 0, NULL, len));
+
+  buf = (FT_Byte*)malloc(*len);
+  assert(buf);
+  assert(!FT_Load_Sfnt_Table(face, tag, 0, buf, len));
+
+  return buf;
+}
+
+
+/* return the offset of glyph `idx' in the `glyf' table */
+
+static FT_ULong
+loca_offset(const FT_Byte* loca,
+            FT_Bool long_offsets,
+            FT_UInt idx)
+{
+  const FT_Byte* p;
+
+
+  if (long_offsets)
+  {
+    p = loca + 4 * idx;
+    return ((FT_ULong)p[0] << 24) | ((FT_ULong)p[1] << 16)
+           | ((FT_ULong)p[2] << 8) | p[3];
+  }
+
+  p = loca + 2 * idx;
+  return 2 * (((FT_ULong)p[0] << 8) | p[1]);
+}
+
+
+/* add glyph `idx' and all its components to `keep' */
+
+static void
+keep_glyph(FT_Face face,
+           FT_UInt idx,
+           unsigned char* keep)
+{
+  FT_UInt i;
+
+
+  if (keep[idx])
+    return;
+  keep[idx] = 1;
+
+  assert(!FT_Load_Glyph(face, idx, FT_LOAD_NO_SCALE | FT_LOAD_NO_RECURSE));
+  if (face->glyph->format != FT_GLYPH_FORMAT_COMPOSITE)
+    return;
+
+  for (i = 0; i < face->glyph->num_subglyphs; i++)
+  {
+    FT_Int sub_idx;
+    FT_UInt flags;
+    FT_Int arg1, arg2;
+    FT_Matrix transform;
+
+
+    assert(!FT_Get_SubGlyph_Info(face->glyph, i, &sub_idx, &flags,
+                                 &arg1, &arg2, &transform));
+    keep_glyph(face, (FT_UInt)sub_idx, keep);
+
+    /* `keep_glyph' has overwritten the glyph slot */
+    assert(!FT_Load_Glyph(face, idx,
+                          FT_LOAD_NO_SCALE | FT_LOAD_NO_RECURSE));
+  }
+}
+
+
+int
+main(int argc,
+     char** argv)
+{
+  FT_Library library;
+  FT_Face master;
+  FT_Face subset;
+
+  char* in_buf;
+  size_t in_len;
+  char* master_buf;
+  size_t master_len;
+  char* subset_buf;
+  size_t subset_len;
+
+  TA_Subsetter* subsetter;
+  TA_Error error;
+
+  unsigned char* keep;
+  FT_UInt* new_indices;
+  unsigned int indices[4];
+  size_t num_indices = 0;
+  FT_UInt num_kept;
+
+  FT_ULong charcode;
+  FT_UInt gindex;
+  FT_ULong first_char = ~0UL;
+  FT_ULong last_char = 0;
+  FT_UInt i;
+
+  FT_Byte* master_loca;
+  FT_Byte* master_glyf;
+  FT_Byte* subset_loca;
+  FT_Byte* subset_glyf;
+  FT_ULong master_loca_len, master_glyf_len;
+  FT_ULong subset_loca_len, subset_glyf_len;
+  FT_Bool master_long, subset_long;
+  TT_Header* head;
+  TT_OS2* os2;
+
+
+  if (argc != 2)
+  {
+    fprintf(stderr, "usage: %s FONT\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  in_buf = read_file(argv[1], &in_len);
+
+  error = TTF_autohint("in-buffer, in-buffer-len,"
+                       " out-buffer, out-buffer-len",
+                       in_buf, in_len,
+                       &master_buf, &master_len);
+  assert(!error);
+
+  assert(!FT_Init_FreeType(&library));
+  assert(!FT_New_Memory_Face(library,
+                             (const FT_Byte*)master_buf,
+                             (FT_Long)master_len,
+                             0,
+                             &master));
+
+  /* select two BMP characters, a character outside of the BMP */
+  /* (if any), and the first composite glyph */
+  gindex = FT_Get_Char_Index(master, 'o');
+  if (gindex)
+    indices[num_indices++] = gindex;
+  gindex = FT_Get_Char_Index(master, 'A');
+  if (gindex)
+    indices[num_indices++] = gindex;
+
+  charcode = FT_Get_First_Char(master, &gindex);
+  while (gindex && charcode <= 0xFFFF)
+    charcode = FT_Get_Next_Char(master, charcode, &gindex);
+  if (gindex)
+    indices[num_indices++] = gindex;
+
+  for (i = 1; i < (FT_UInt)master->num_glyphs; i++)
+  {
+    assert(!FT_Load_Glyph(master, i, FT_LOAD_NO_SCALE | FT_LOAD_NO_RECURSE));
+    if (master->glyph->format == FT_GLYPH_FORMAT_COMPOSITE)
+    {
+      indices[num_indices++] = i;
+      break;
+    }
+  }
+  assert(i < (FT_UInt)master->num_glyphs);
+
+  /* compute the expected glyph set */
+  keep = (unsigned char*)calloc(MAX_GLYPHS, 1);
+  new_indices = (FT_UInt*)calloc(MAX_GLYPHS, sizeof (FT_UInt));
+  assert(keep && new_indices);
+
+  keep_glyph(master, 0, keep);
+  for (i = 0; i < num_indices; i++)
+    keep_glyph(master, indices[i], keep);
+
+  num_kept = 0;
+  for (i = 0; i < (FT_UInt)master->num_glyphs; i++)
+    if (keep[i])
+      new_indices[i] = num_kept++;
+
+  /* create the subset */
+  error = TTF_autohint_subsetter_new(master_buf, master_len, &subsetter);
+  assert(!error);
+
+  error = TTF_autohint_subset(subsetter, indices, num_indices, NULL,
+                              &subset_buf, &subset_len);
+  assert(!error);
+
+  assert(!FT_New_Memory_Face(library,
+                             (const FT_Byte*)subset_buf,
+                             (FT_Long)subset_len,
+                             0,
+                             &subset));
+
+  /* number of glyphs */
+  assert(subset->num_glyphs == (FT_Long)num_kept);
+
+  /* `cmap': kept glyphs must be mapped to their new indices, */
+  /* all other characters must be unmapped */
+  charcode = FT_Get_First_Char(master, &gindex);
+  while (gindex)
+  {
+    FT_UInt subset_gindex = FT_Get_Char_Index(subset, charcode);
+
+
+    if (keep[gindex])
+    {
+      assert(subset_gindex == new_indices[gindex]);
+
+      if (charcode < first_char)
+        first_char = charcode;
+      if (charcode > last_char)
+        last_char = charcode;
+    }
+    else
+      assert(subset_gindex == 0);
+
+    charcode = FT_Get_Next_Char(master, charcode, &gindex);
+  }
+
+  charcode = FT_Get_First_Char(subset, &gindex);
+  while (gindex)
+  {
+    assert(gindex < num_kept);
+    charcode = FT_Get_Next_Char(subset, charcode, &gindex);
+  }
+
+  /* `loca' and `glyf': simple glyphs must be copied verbatim; */
+  /* composite glyphs only get their component indices changed */
+  head = (TT_Header*)FT_Get_Sfnt_Table(master, FT_SFNT_HEAD);
+  master_long = head->Index_To_Loc_Format != 0;
+  head = (TT_Header*)FT_Get_Sfnt_Table(subset, FT_SFNT_HEAD);
+  subset_long = head->Index_To_Loc_Format != 0;
+
+  master_loca = load_table(master, TTAG_loca, &master_loca_len);
+  master_glyf = load_table(master, TTAG_glyf, &master_glyf_len);
+  subset_loca = load_table(subset, TTAG_loca, &subset_loca_len);
+  subset_glyf = load_table(subset, TTAG_glyf, &subset_glyf_len);
+
+  assert(subset_loca_len >= (num_kept + 1) * (subset_long ? 4 : 2));
+  assert(loca_offset(subset_loca, subset_long, 0) == 0);
+  assert(loca_offset(subset_loca, subset_long, num_kept)
+         <= subset_glyf_len);
+
+  for (i = 0; i < (FT_UInt)master->num_glyphs; i++)
+  {
+    FT_ULong master_start, master_end;
+    FT_ULong subset_start, subset_end;
+
+
+    if (!keep[i])
+      continue;
+
+    master_start = loca_offset(master_loca, master_long, i);
+    master_end = loca_offset(master_loca, master_long, i + 1);
+    subset_start = loca_offset(subset_loca, subset_long, new_indices[i]);
+    subset_end = loca_offset(subset_loca, subset_long, new_indices[i] + 1);
+
+    assert(master_start <= master_end && master_end <= master_glyf_len);
+    assert(subset_start <= subset_end);
+
+    /* the padding might differ */
+    assert(subset_end - subset_start >= master_end - master_start);
+    assert(subset_end - subset_start < master_end - master_start + 4);
+
+    assert(!FT_Load_Glyph(master, i, FT_LOAD_NO_SCALE | FT_LOAD_NO_RECURSE));
+    if (master->glyph->format != FT_GLYPH_FORMAT_COMPOSITE)
+      assert(!memcmp(master_glyf + master_start,
+                     subset_glyf + subset_start,
+                     master_end - master_start));
+
+    /* the outlines must be the same */
+    assert(!FT_Load_Glyph(subset, new_indices[i], FT_LOAD_NO_SCALE));
+    assert(!FT_Load_Glyph(master, i, FT_LOAD_NO_SCALE));
+    assert(subset->glyph->outline.n_points
+           == master->glyph->outline.n_points);
+    assert(subset->glyph->outline.n_contours
+           == master->glyph->outline.n_contours);
+  }
+
+  /* `OS/2': values outside of the BMP are clamped to 0xFFFF */
+  os2 = (TT_OS2*)FT_Get_Sfnt_Table(subset, FT_SFNT_OS2);
+  if (os2 && first_char <= last_char)
+  {
+    assert(os2->usFirstCharIndex
+           == (first_char > 0xFFFF ? 0xFFFF : first_char));
+    assert(os2->usLastCharIndex
+           == (last_char > 0xFFFF ? 0xFFFF : last_char));
+  }
+
+  free(master_loca);
+  free(master_glyf);
+  free(subset_loca);
+  free(subset_glyf);
+
+  FT_Done_Face(subset);
+  FT_Done_Face(master);
+  FT_Done_FreeType(library);
+
+  TTF_autohint_subsetter_done(subsetter);
+
+  free(keep);
+  free(new_indices);
+  free(subset_buf);
+  free(master_buf);
+  free(in_buf);
+
+  return EXIT_SUCCESS;
+}
+
+/* end of tasubset-test.c */
@@ -0,0 +1,1363 @@
+/* tasubset.c */
+
+/*
+ * Copyright (C) 2022 by Werner Lemberg.
+ *
+ * This file is part of the ttfautohint library, and may only be used,
+ * modified, and distributed under the terms given in `COPYING'.  By
+ * continuing to use, modify, or distribute this file you indicate that you
+ * have read `COPYING' and understand and accept it fully.
+ *
+ * The file `COPYING' mentioned in the previous paragraph is distributed
+ * with the ttfautohint library.
+ */
+
+
+/*
+ * Subset a font hinted by ttfautohint without hinting it again.
+ *
+ * The master font gets parsed only once; afterwards, an arbitrary number
+ * of subsets can be created from it, even in parallel.  The bytecode of
+ * all glyphs and the `cvt', `fpgm', and `prep' tables are copied
+ * verbatim.  This works because ttfautohint's glyph programs never refer
+ * to glyph indices: the bytecode of a composite glyph only uses point
+ * indices (the `pointsums' of its components, including the point of the
+ * `.ttfautohint' glyph), which stay the same as long as all components
+ * are part of the subset.
+ *
+ * We thus add all components of composite glyphs to the subset, assign
+ * new glyph indices in the order of the old ones, and rewrite the
+ * component indices.  The `cmap', `hmtx', `loca', `hhea', and `maxp'
+ * tables get adjusted accordingly, and the `post' table gets converted to
+ * format 3 (without glyph names).  Tables that refer to glyph indices in
+ * other ways (for example, `GSUB', `GPOS', `kern', or `hdmx') are
+ * dropped, as are all tables we don't know.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <limits.h>
+
+#include "ta.h"
+
+
+/* the tables of the master font we are interested in */
+enum
+{
+  SUBSET_cmap,
+  SUBSET_cvt,
+  SUBSET_fpgm,
+  SUBSET_gasp,
+  SUBSET_glyf,
+  SUBSET_head,
+  SUBSET_hhea,
+  SUBSET_hmtx,
+  SUBSET_loca,
+  SUBSET_maxp,
+  SUBSET_name,
+  SUBSET_OS2,
+  SUBSET_post,
+  SUBSET_prep,
+  SUBSET_TTFA,
+  SUBSET_VDMX,
+
+  SUBSET_MAX
+};
+
+static const FT_ULong subset_tags[SUBSET_MAX] =
+{
+  TTAG_cmap,
+  TTAG_cvt,
+  TTAG_fpgm,
+  TTAG_gasp,
+  TTAG_glyf,
+  TTAG_head,
+  TTAG_hhea,
+  TTAG_hmtx,
+  TTAG_loca,
+  TTAG_maxp,
+  TTAG_name,
+  TTAG_OS2,
+  TTAG_post,
+  TTAG_prep,
+  TTAG_TTFA,
+  TTAG_VDMX
+};
+
+/* tables copied without changes */
+static const int subset_copied[] =
+{
+  SUBSET_cvt,
+  SUBSET_fpgm,
+  SUBSET_gasp,
+  SUBSET_name,
+  SUBSET_prep,
+  SUBSET_TTFA,
+  SUBSET_VDMX
+};
+
+
+#define HHEA_NUM_HMETRICS_OFFSET 34
+#define HHEA_LEN 36
+#define HEAD_LEN 54
+#define HEAD_MODIFIED_OFFSET 28
+#define OS2_FIRST_CHAR_INDEX_OFFSET 64
+#define OS2_LAST_CHAR_INDEX_OFFSET 66
+#define POST_LEN 32
+
+#define MAXP_MAX_POINTS 6
+#define MAXP_MAX_CONTOURS 8
+#define MAXP_MAX_COMPONENT_DEPTH_OFFSET 30
+
+#define SUBSET_MAX_DEPTH 16
+
+/* there have been 24107 days between January 1st, 1904 (the epoch of */
+/* OpenType), and January 1st, 1970 (the epoch of the `time' function) */
+#define SUBSET_SECONDS_TO_1970 (24107ULL * 24 * 60 * 60)
+
+
+typedef struct Subset_Glyph_
+{
+  FT_ULong offset; /* in the `glyf' table */
+  FT_ULong len;
+
+  /* for composite glyphs, the numbers of points and contours */
+  /* are accumulated over all components */
+  FT_ULong num_points;
+  FT_ULong num_contours;
+  FT_UShort num_components; /* zero for simple glyphs */
+  FT_UShort depth; /* zero for simple glyphs */
+  FT_UShort ins_len;
+
+  FT_Byte state; /* used while analyzing the composite glyph structure */
+} Subset_Glyph;
+
+enum
+{
+  SUBSET_GLYPH_NEW,
+  SUBSET_GLYPH_ACTIVE,
+  SUBSET_GLYPH_DONE
+};
+
+
+typedef struct Subset_Mapping_
+{
+  FT_ULong charcode;
+  FT_UShort glyph_idx;
+} Subset_Mapping;
+
+
+struct TA_Subsetter_
+{
+  FT_Byte* buf; /* a copy of the master font */
+  size_t len;
+
+  const FT_Byte* tables[SUBSET_MAX]; /* NULL if table is missing */
+  FT_ULong lens[SUBSET_MAX];
+
+  FT_UShort num_glyphs;
+  FT_UShort num_hmetrics;
+  Subset_Glyph* glyphs;
+
+  /* the character map, sorted by character code; */
+  /* we use a (3,0) subtable if the master font is a symbol font */
+  FT_Bool is_symbol;
+  FT_ULong num_mappings;
+  Subset_Mapping* mappings;
+};
+
+
+static FT_Byte*
+subset_put_ushort(FT_Byte* p,
+                  FT_ULong val)
+{
+  *(p++) = HIGH(val);
+  *(p++) = LOW(val);
+
+  return p;
+}
+
+
+static FT_Byte*
+subset_put_ulong(FT_Byte* p,
+                 FT_ULong val)
+{
+  *(p++) = BYTE1(val);
+  *(p++) = BYTE2(val);
+  *(p++) = BYTE3(val);
+  *(p++) = BYTE4(val);
+
+  return p;
+}
+
+
+/* table buffers must be zero-padded to a multiple of four bytes */
+
+static FT_Byte*
+subset_alloc_table(FT_ULong len)
+{
+  return (FT_Byte*)calloc((len + 3) & ~3U, 1);
+}
+
+
+static FT_Error
+subset_parse_directory(TA_Subsetter* subsetter)
+{
+  const FT_Byte* p = subsetter->buf;
+  FT_ULong version;
+  FT_UShort num_tables;
+  FT_UShort i;
+
+
+  if (subsetter->len < 12)
+    return TA_Err_Invalid_Font_Type;
+
+  /* TTCs are not supported */
+  version = NEXT_ULONG(p);
+  if (version != 0x00010000UL && version != TTAG_true)
+    return TA_Err_Invalid_Font_Type;
+
+  num_tables = NEXT_USHORT(p);
+  p += 6;
+
+  if (12 + 16 * (size_t)num_tables > subsetter->len)
+    return FT_Err_Invalid_Table;
+
+  for (i = 0; i < num_tables; i++)
+  {
+    FT_ULong tag;
+    FT_ULong offset;
+    FT_ULong len;
+    int j;
+
+
+    tag = NEXT_ULONG(p);
+    p += 4; /* skip checksum */
+    offset = NEXT_ULONG(p);
+    len = NEXT_ULONG(p);
+
+    if (offset > subsetter->len
+        || len > subsetter->len - offset)
+      return FT_Err_Invalid_Table;
+
+    for (j = 0; j < SUBSET_MAX; j++)
+    {
+      if (tag == subset_tags[j])
+      {
+        subsetter->tables[j] = subsetter->buf + offset;
+        subsetter->lens[j] = len;
+        break;
+      }
+    }
+  }
+
+  if (!subsetter->tables[SUBSET_glyf])
+    return TA_Err_Invalid_Font_Type;
+
+  if (subsetter->lens[SUBSET_head] < HEAD_LEN
+      || subsetter->lens[SUBSET_hhea] < HHEA_LEN
+      || subsetter->lens[SUBSET_maxp] < MAXP_NUM_GLYPHS + 2
+      || !subsetter->tables[SUBSET_loca]
+      || !subsetter->tables[SUBSET_hmtx])
+    return FT_Err_Invalid_Table;
+
+  return TA_Err_Ok;
+}
+
+
+static FT_Error
+subset_parse_loca(TA_Subsetter* subsetter)
+{
+  const FT_Byte* p;
+  FT_ULong loca_len;
+  FT_Bool long_offsets;
+  FT_ULong glyf_len = subsetter->lens[SUBSET_glyf];
+  FT_ULong offset;
+  FT_ULong i;
+
+
+  p = subsetter->tables[SUBSET_maxp] + MAXP_NUM_GLYPHS;
+  subsetter->num_glyphs = NEXT_USHORT(p);
+
+  p = subsetter->tables[SUBSET_hhea] + HHEA_NUM_HMETRICS_OFFSET;
+  subsetter->num_hmetrics = NEXT_USHORT(p);
+
+  if (!subsetter->num_glyphs
+      || !subsetter->num_hmetrics
+      || subsetter->num_hmetrics > subsetter->num_glyphs)
+    return FT_Err_Invalid_Table;
+
+  if (subsetter->lens[SUBSET_hmtx]
+        < 4 * (FT_ULong)subsetter->num_hmetrics
+          + 2 * (FT_ULong)(subsetter->num_glyphs - subsetter->num_hmetrics))
+    return FT_Err_Invalid_Table;
+
+  long_offsets = subsetter->tables[SUBSET_head][LOCA_FORMAT_OFFSET] != 0;
+  loca_len = ((FT_ULong)subsetter->num_glyphs + 1) * (long_offsets ? 4 : 2);
+  if (subsetter->lens[SUBSET_loca] < loca_len)
+    return FT_Err_Invalid_Table;
+
+  subsetter->glyphs = (Subset_Glyph*)calloc(subsetter->num_glyphs,
+                                            sizeof (Subset_Glyph));
+  if (!subsetter->glyphs)
+    return FT_Err_Out_Of_Memory;
+
+  p = subsetter->tables[SUBSET_loca];
+  offset = long_offsets ? NEXT_ULONG(p) : 2 * (FT_ULong)NEXT_USHORT(p);
+
+  for (i = 0; i < subsetter->num_glyphs; i++)
+  {
+    Subset_Glyph* glyph = &subsetter->glyphs[i];
+    FT_ULong next_offset;
+
+
+    next_offset = long_offsets ? NEXT_ULONG(p) : 2 * (FT_ULong)NEXT_USHORT(p);
+    if (next_offset < offset
+        || next_offset > glyf_len)
+      return FT_Err_Invalid_Table;
+
+    glyph->offset = offset;
+    glyph->len = next_offset - offset;
+
+    offset = next_offset;
+  }
+
+  return TA_Err_Ok;
+}
+
+
+/* collect the data needed for the `maxp' table; */
+/* this also validates the composite glyph structure */
+
+static FT_Error
+subset_analyze_glyph(TA_Subsetter* subsetter,
+                     FT_UShort idx,
+                     FT_UInt depth)
+{
+  Subset_Glyph* glyph = &subsetter->glyphs[idx];
+  const FT_Byte* p;
+  const FT_Byte* endp;
+  FT_Short num_contours;
+
+  FT_Error error;
+
+
+  if (glyph->state == SUBSET_GLYPH_DONE)
+    return TA_Err_Ok;
+  if (glyph->state == SUBSET_GLYPH_ACTIVE
+      || depth > SUBSET_MAX_DEPTH)
+    return FT_Err_Invalid_Composite;
+
+  glyph->state = SUBSET_GLYPH_ACTIVE;
+
+  /* empty glyph */
+  if (!glyph->len)
+    goto Done;
+
+  if (glyph->len < 10)
+    return FT_Err_Invalid_Table;
+
+  p = subsetter->tables[SUBSET_glyf] + glyph->offset;
+  endp = p + glyph->len;
+
+  num_contours = (FT_Short)NEXT_USHORT(p);
+  p += 8; /* skip bounding box */
+
+  if (num_contours >= 0)
+  {
+    if (p + 2 * num_contours + 2 > endp)
+      return FT_Err_Invalid_Table;
+
+    if (num_contours)
+    {
+      const FT_Byte* q = p + 2 * (num_contours - 1);
+
+
+      glyph->num_points = (FT_ULong)NEXT_USHORT(q) + 1;
+      glyph->num_contours = (FT_ULong)num_contours;
+    }
+
+    p += 2 * num_contours;
+    glyph->ins_len = NEXT_USHORT(p);
+  }
+  else
+  {
+    FT_UShort flags;
+
+
+    do
+    {
+      FT_UShort component;
+      Subset_Glyph* c;
+
+
+      if (p + 4 > endp)
+        return FT_Err_Invalid_Table;
+
+      flags = NEXT_USHORT(p);
+      component = NEXT_USHORT(p);
+      if (component >= subsetter->num_glyphs)
+        return FT_Err_Invalid_Composite;
+
+      error = subset_analyze_glyph(subsetter, component, depth + 1);
+      if (error)
+        return error;
+
+      c = &subsetter->glyphs[component];
+      glyph->num_points += c->num_points;
+      glyph->num_contours += c->num_contours;
+      if (c->depth + 1 > glyph->depth)
+        glyph->depth = c->depth + 1;
+      glyph->num_components++;
+
+      /* skip arguments and scaling data */
+      p += (flags & ARGS_ARE_WORDS) ? 4 : 2;
+      if (flags & WE_HAVE_A_SCALE)
+        p += 2;
+      else if (flags & WE_HAVE_AN_XY_SCALE)
+        p += 4;
+      else if (flags & WE_HAVE_A_2X2)
+        p += 8;
+    } while (flags & MORE_COMPONENTS);
+
+    if (flags & WE_HAVE_INSTR)
+    {
+      if (p + 2 > endp)
+        return FT_Err_Invalid_Table;
+      glyph->ins_len = NEXT_USHORT(p);
+    }
+  }
+
+  if (p + glyph->ins_len > endp)
+    return FT_Err_Invalid_Table;
+
+Done:
+  glyph->state = SUBSET_GLYPH_DONE;
+
+  return TA_Err_Ok;
+}
+
+
+static int
+subset_mapping_compare(const void* a,
+                       const void* b)
+{
+  const Subset_Mapping* m1 = (const Subset_Mapping*)a;
+  const Subset_Mapping* m2 = (const Subset_Mapping*)b;
+
+
+  if (m1->charcode != m2->charcode)
+    return m1->charcode < m2->charcode ? -1 : 1;
+
+  return 0;
+}
+
+
+/* we let FreeType decode the `cmap' table */
+
+static FT_Error
+subset_parse_cmap(TA_Subsetter* subsetter)
+{
+  FT_Library lib = NULL;
+  FT_Face face = NULL;
+  FT_ULong charcode;
+  FT_UInt gindex;
+  FT_ULong i;
+
+  FT_Error error;
+
+
+  error = FT_Init_FreeType(&lib);
+  if (error)
+    return error;
+
+  error = FT_New_Memory_Face(lib,
+                             subsetter->buf,
+                             (FT_Long)subsetter->len,
+                             0,
+                             &face);
+  if (error)
+    goto Exit;
+
+  if (!face->charmap)
+  {
+    if (FT_Select_Charmap(face, FT_ENCODING_MS_SYMBOL))
+      goto Exit;
+    subsetter->is_symbol = 1;
+  }
+
+  for (charcode = FT_Get_First_Char(face, &gindex);
+       gindex;
+       charcode = FT_Get_Next_Char(face, charcode, &gindex))
+    subsetter->num_mappings++;
+
+  if (!subsetter->num_mappings)
+    goto Exit;
+
+  subsetter->mappings =
+    (Subset_Mapping*)malloc(subsetter->num_mappings
+                            * sizeof (Subset_Mapping));
+  if (!subsetter->mappings)
+  {
+    error = FT_Err_Out_Of_Memory;
+    goto Exit;
+  }
+
+  i = 0;
+  for (charcode = FT_Get_First_Char(face, &gindex);
+       gindex && i < subsetter->num_mappings;
+       charcode = FT_Get_Next_Char(face, charcode, &gindex))
+  {
+    subsetter->mappings[i].charcode = charcode;
+    subsetter->mappings[i].glyph_idx = (FT_UShort)gindex;
+    i++;
+  }
+  subsetter->num_mappings = i;
+
+  qsort(subsetter->mappings, subsetter->num_mappings,
+        sizeof (Subset_Mapping), subset_mapping_compare);
+
+Exit:
+  FT_Done_Face(face);
+  FT_Done_FreeType(lib);
+
+  return error;
+}
+
+
+/* the function declarations are in `ttfautohint.h' */
+
+TA_LIB_EXPORT void
+TTF_autohint_subsetter_done(TA_Subsetter* subsetter)
+{
+  if (!subsetter)
+    return;
+
+  free(subsetter->buf);
+  free(subsetter->glyphs);
+  free(subsetter->mappings);
+  free(subsetter);
+}
+
+
+TA_LIB_EXPORT TA_Error
+TTF_autohint_subsetter_new(const char* in_buf,
+                           size_t in_len,
+                           TA_Subsetter** subsetterp)
+{
+  TA_Subsetter* subsetter;
+  FT_UShort i;
+
+  FT_Error error;
+
+
+  if (!in_buf || !subsetterp)
+    return FT_Err_Invalid_Argument;
+
+  *subsetterp = NULL;
+
+  subsetter = (TA_Subsetter*)calloc(1, sizeof (TA_Subsetter));
+  if (!subsetter)
+    return FT_Err_Out_Of_Memory;
+
+  subsetter->buf = (FT_Byte*)malloc(in_len);
+  if (!subsetter->buf)
+  {
+    error = FT_Err_Out_Of_Memory;
+    goto Err;
+  }
+  memcpy(subsetter->buf, in_buf, in_len);
+  subsetter->len = in_len;
+
+  error = subset_parse_directory(subsetter);
+  if (error)
+    goto Err;
+
+  error = subset_parse_loca(subsetter);
+  if (error)
+    goto Err;
+
+  for (i = 0; i < subsetter->num_glyphs; i++)
+  {
+    error = subset_analyze_glyph(subsetter, i, 0);
+    if (error)
+      goto Err;
+  }
+
+  error = subset_parse_cmap(subsetter);
+  if (error)
+    goto Err;
+
+  *subsetterp = subsetter;
+
+  return TA_Err_Ok;
+
+Err:
+  TTF_autohint_subsetter_done(subsetter);
+
+  return error;
+}
+
+
+/* add glyph `idx' and all its components to the subset */
+
+static void
+subset_keep_glyph(TA_Subsetter* subsetter,
+                  FT_Byte* keep,
+                  FT_UShort idx)
+{
+  Subset_Glyph* glyph = &subsetter->glyphs[idx];
+  const FT_Byte* p;
+  FT_UShort flags;
+
+
+  if (keep[idx])
+    return;
+  keep[idx] = 1;
+
+  if (!glyph->num_components)
+    return;
+
+  /* the glyph structure has been validated already */
+  p = subsetter->tables[SUBSET_glyf] + glyph->offset + 10;
+
+  do
+  {
+    flags = NEXT_USHORT(p);
+    subset_keep_glyph(subsetter, keep, NEXT_USHORT(p));
+
+    p += (flags & ARGS_ARE_WORDS) ? 4 : 2;
+    if (flags & WE_HAVE_A_SCALE)
+      p += 2;
+    else if (flags & WE_HAVE_AN_XY_SCALE)
+      p += 4;
+    else if (flags & WE_HAVE_A_2X2)
+      p += 8;
+  } while (flags & MORE_COMPONENTS);
+}
+
+
+/* copy the glyph records and map the component indices; */
+/* glyph records get aligned to multiples of four bytes */
+
+static FT_Error
+subset_build_glyf_loca(TA_Subsetter* subsetter,
+                       const FT_UShort* old_indices,
+                       FT_UShort num_glyphs,
+                       const FT_UShort* map,
+                       FT_Byte** glyf_bufp,
+                       FT_ULong* glyf_lenp,
+                       FT_Byte** loca_bufp,
+                       FT_ULong* loca_lenp,
+                       FT_Bool* long_offsetsp)
+{
+  FT_Byte* glyf_buf;
+  FT_ULong glyf_len;
+  FT_Byte* loca_buf;
+  FT_ULong loca_len;
+  FT_Bool long_offsets;
+  FT_Byte* p;
+  FT_ULong offset;
+  FT_UShort i;
+
+
+  glyf_len = 0;
+  for (i = 0; i < num_glyphs; i++)
+    glyf_len += (subsetter->glyphs[old_indices[i]].len + 3) & ~3U;
+
+  long_offsets = glyf_len > 0xFFFF * 2;
+  loca_len = ((FT_ULong)num_glyphs + 1) * (long_offsets ? 4 : 2);
+
+  glyf_buf = subset_alloc_table(glyf_len);
+  loca_buf = subset_alloc_table(loca_len);
+  if (!glyf_buf || !loca_buf)
+  {
+    free(glyf_buf);
+    free(loca_buf);
+    return FT_Err_Out_Of_Memory;
+  }
+
+  p = loca_buf;
+  offset = 0;
+
+  for (i = 0; i < num_glyphs; i++)
+  {
+    Subset_Glyph* glyph = &subsetter->glyphs[old_indices[i]];
+    FT_Byte* g = glyf_buf + offset;
+
+
+    if (long_offsets)
+      p = subset_put_ulong(p, offset);
+    else
+      p = subset_put_ushort(p, offset / 2);
+
+    memcpy(g, subsetter->tables[SUBSET_glyf] + glyph->offset, glyph->len);
+
+    if (glyph->num_components)
+    {
+      FT_Byte* q = g + 10;
+      FT_UShort flags;
+
+
+      do
+      {
+        FT_UShort component;
+
+
+        flags = NEXT_USHORT(q);
+        component = NEXT_USHORT(q);
+        subset_put_ushort(q - 2, map[component]);
+
+        q += (flags & ARGS_ARE_WORDS) ? 4 : 2;
+        if (flags & WE_HAVE_A_SCALE)
+          q += 2;
+        else if (flags & WE_HAVE_AN_XY_SCALE)
+          q += 4;
+        else if (flags & WE_HAVE_A_2X2)
+          q += 8;
+      } while (flags & MORE_COMPONENTS);
+    }
+
+    offset += (glyph->len + 3) & ~3U;
+  }
+
+  if (long_offsets)
+    subset_put_ulong(p, offset);
+  else
+    subset_put_ushort(p, offset / 2);
+
+  *glyf_bufp = glyf_buf;
+  *glyf_lenp = glyf_len;
+  *loca_bufp = loca_buf;
+  *loca_lenp = loca_len;
+  *long_offsetsp = long_offsets;
+
+  return TA_Err_Ok;
+}
+
+
+static FT_Error
+subset_build_hmtx(TA_Subsetter* subsetter,
+                  const FT_UShort* old_indices,
+                  FT_UShort num_glyphs,
+                  FT_Byte** hmtx_bufp,
+                  FT_ULong* hmtx_lenp,
+                  FT_UShort* num_hmetricsp)
+{
+  const FT_Byte* hmtx = subsetter->tables[SUBSET_hmtx];
+  FT_UShort num_hmetrics = subsetter->num_hmetrics;
+
+  FT_Byte* buf;
+  FT_ULong len;
+  FT_UShort new_num_hmetrics;
+  FT_Byte* p;
+  FT_UShort i;
+
+
+#define ADVANCE(idx) \
+          (old_indices[idx] < num_hmetrics \
+             ? hmtx + 4 * old_indices[idx] \
+             : hmtx + 4 * (num_hmetrics - 1))
+#define LSB(idx) \
+          (old_indices[idx] < num_hmetrics \
+             ? hmtx + 4 * old_indices[idx] + 2 \
+             : hmtx + 4 * num_hmetrics \
+               + 2 * (old_indices[idx] - num_hmetrics))
+
+  /* trailing glyphs with the same advance width */
+  /* only need a left side bearing entry */
+  new_num_hmetrics = num_glyphs;
+  while (new_num_hmetrics > 1
+         && !memcmp(ADVANCE(new_num_hmetrics - 1),
+                    ADVANCE(new_num_hmetrics - 2),
+                    2))
+    new_num_hmetrics--;
+
+  len = 4 * (FT_ULong)new_num_hmetrics
+        + 2 * (FT_ULong)(num_glyphs - new_num_hmetrics);
+  buf = subset_alloc_table(len);
+  if (!buf)
+    return FT_Err_Out_Of_Memory;
+
+  p = buf;
+  for (i = 0; i < num_glyphs; i++)
+  {
+    if (i < new_num_hmetrics)
+    {
+      memcpy(p, ADVANCE(i), 2);
+      p += 2;
+    }
+    memcpy(p, LSB(i), 2);
+    p += 2;
+  }
+
+#undef ADVANCE
+#undef LSB
+
+  *hmtx_bufp = buf;
+  *hmtx_lenp = len;
+  *num_hmetricsp = new_num_hmetrics;
+
+  return TA_Err_Ok;
+}
+
+
+/* build a `cmap' table with a format 4 subtable and, if necessary, */
+/* a format 12 subtable; consecutive character codes mapped to */
+/* consecutive glyph indices form a segment (or group) */
+
+static FT_Error
+subset_build_cmap(TA_Subsetter* subsetter,
+                  const FT_UShort* map,
+                  FT_Byte** cmap_bufp,
+                  FT_ULong* cmap_lenp)
+{
+  Subset_Mapping* mappings;
+  FT_ULong num_mappings;
+  FT_ULong num_segments;
+  FT_ULong num_groups;
+  FT_ULong format4_len;
+  FT_ULong format12_len;
+  FT_Bool have_format4;
+  FT_Bool have_format12;
+  FT_Bool need_format12;
+  FT_UShort num_subtables;
+
+  FT_Byte* buf;
+  FT_ULong len;
+  FT_Byte* p;
+  FT_ULong i;
+
+
+  mappings = (Subset_Mapping*)malloc((subsetter->num_mappings + 1)
+                                     * sizeof (Subset_Mapping));
+  if (!mappings)
+    return FT_Err_Out_Of_Memory;
+
+  num_mappings = 0;
+  num_segments = 0;
+  num_groups = 0;
+  need_format12 = 0;
+
+  for (i = 0; i < subsetter->num_mappings; i++)
+  {
+    Subset_Mapping* m = &subsetter->mappings[i];
+    Subset_Mapping* prev = num_mappings ? &mappings[num_mappings - 1]
+                                        : NULL;
+    FT_Bool is_continuation;
+
+
+    if (map[m->glyph_idx] == 0xFFFF)
+      continue;
+
+    is_continuation = prev
+                      && m->charcode == prev->charcode + 1
+                      && map[m->glyph_idx] == prev->glyph_idx + 1;
+
+    if (m->charcode > 0xFFFF)
+      need_format12 = 1;
+    /* 0xFFFF is reserved for the final segment of format 4 */
+    else if (m->charcode < 0xFFFF && !is_continuation)
+      num_segments++;
+
+    if (!is_continuation)
+      num_groups++;
+
+    mappings[num_mappings].charcode = m->charcode;
+    mappings[num_mappings].glyph_idx = map[m->glyph_idx];
+    num_mappings++;
+  }
+
+  num_segments++;
+  format4_len = 16 + 8 * num_segments;
+  format12_len = 16 + 12 * num_groups;
+
+  have_format4 = format4_len <= 0xFFFF;
+  have_format12 = !subsetter->is_symbol && (need_format12 || !have_format4);
+  num_subtables = have_format4 + have_format12;
+
+  len = 4 + 8 * (FT_ULong)num_subtables
+        + (have_format4 ? format4_len : 0)
+        + (have_format12 ? format12_len : 0);
+  buf = subset_alloc_table(len);
+  if (!buf)
+  {
+    free(mappings);
+    return FT_Err_Out_Of_Memory;
+  }
+
+  p = buf;
+  p = subset_put_ushort(p, 0); /* version */
+  p = subset_put_ushort(p, num_subtables);
+
+  if (have_format4)
+  {
+    p = subset_put_ushort(p, 3);
+    p = subset_put_ushort(p, subsetter->is_symbol ? 0 : 1);
+    p = subset_put_ulong(p, 4 + 8 * (FT_ULong)num_subtables);
+  }
+  if (have_format12)
+  {
+    p = subset_put_ushort(p, 3);
+    p = subset_put_ushort(p, 10);
+    p = subset_put_ulong(p, 4 + 8 * (FT_ULong)num_subtables
+                            + (have_format4 ? format4_len : 0));
+  }
+
+  if (have_format4)
+  {
+    FT_ULong search_range;
+    FT_ULong entry_selector;
+    FT_Byte* end_codes;
+    FT_Byte* start_codes;
+    FT_Byte* id_deltas;
+    FT_ULong seg;
+
+
+    for (entry_selector = 0;
+         (2UL << entry_selector) <= num_segments;
+         entry_selector++)
+      ;
+    search_range = 2UL << entry_selector;
+
+    p = subset_put_ushort(p, 4);
+    p = subset_put_ushort(p, format4_len);
+    p = subset_put_ushort(p, 0); /* language */
+    p = subset_put_ushort(p, 2 * num_segments);
+    p = subset_put_ushort(p, search_range);
+    p = subset_put_ushort(p, entry_selector);
+    p = subset_put_ushort(p, 2 * num_segments - search_range);
+
+    end_codes = p;
+    start_codes = end_codes + 2 * num_segments + 2; /* skip `reservedPad' */
+    id_deltas = start_codes + 2 * num_segments;
+    /* the `idRangeOffset' array is already zeroed */
+
+    seg = 0;
+    for (i = 0; i < num_mappings; i++)
+    {
+      Subset_Mapping* m = &mappings[i];
+
+
+      if (m->charcode >= 0xFFFF)
+        break;
+
+      if (i
+          && m->charcode == mappings[i - 1].charcode + 1
+          && m->glyph_idx == mappings[i - 1].glyph_idx + 1)
+      {
+        subset_put_ushort(end_codes + 2 * (seg - 1), m->charcode);
+        continue;
+      }
+
+      subset_put_ushort(start_codes + 2 * seg, m->charcode);
+      subset_put_ushort(end_codes + 2 * seg, m->charcode);
+      subset_put_ushort(id_deltas + 2 * seg,
+                        (m->glyph_idx - m->charcode) & 0xFFFF);
+      seg++;
+    }
+
+    /* the final segment maps 0xFFFF to glyph 0 */
+    subset_put_ushort(start_codes + 2 * seg, 0xFFFF);
+    subset_put_ushort(end_codes + 2 * seg, 0xFFFF);
+    subset_put_ushort(id_deltas + 2 * seg, 1);
+
+    p = id_deltas + 4 * num_segments;
+  }
+
+  if (have_format12)
+  {
+    FT_Byte* group = NULL;
+
+
+    p = subset_put_ushort(p, 12);
+    p = subset_put_ushort(p, 0); /* reserved */
+    p = subset_put_ulong(p, format12_len);
+    p = subset_put_ulong(p, 0); /* language */
+    p = subset_put_ulong(p, num_groups);
+
+    for (i = 0; i < num_mappings; i++)
+    {
+      Subset_Mapping* m = &mappings[i];
+
+
+      if (i
+          && m->charcode == mappings[i - 1].charcode + 1
+          && m->glyph_idx == mappings[i - 1].glyph_idx + 1)
+      {
+        subset_put_ulong(group + 4, m->charcode);
+        continue;
+      }
+
+      group = p;
+      p = subset_put_ulong(p, m->charcode);
+      p = subset_put_ulong(p, m->charcode);
+      p = subset_put_ulong(p, m->glyph_idx);
+    }
+  }
+
+  free(mappings);
+
+  *cmap_bufp = buf;
+  *cmap_lenp = len;
+
+  return TA_Err_Ok;
+}
+
+
+static FT_Error
+subset_add_table(FONT* font,
+                 FT_ULong tag,
+                 FT_Byte* buf,
+                 FT_ULong len)
+{
+  SFNT* sfnt = &font->sfnts[0];
+  FT_Error error;
+
+
+  if (!buf)
+    return FT_Err_Out_Of_Memory;
+
+  error = TA_sfnt_add_table_info(sfnt);
+  if (!error)
+    error = TA_font_add_table(font,
+                              &sfnt->table_infos[sfnt->num_table_infos - 1],
+                              tag, len, buf);
+  if (error)
+    free(buf);
+
+  return error;
+}
+
+
+static FT_Byte*
+subset_copy_table(TA_Subsetter* subsetter,
+                  int which,
+                  FT_ULong len)
+{
+  FT_Byte* buf = subset_alloc_table(len);
+
+
+  if (buf)
+    memcpy(buf, subsetter->tables[which],
+           len < subsetter->lens[which] ? len : subsetter->lens[which]);
+
+  return buf;
+}
+
+
+TA_LIB_EXPORT TA_Error
+TTF_autohint_subset(TA_Subsetter* subsetter,
+                    const unsigned int* glyph_indices,
+                    size_t num_glyph_indices,
+                    TA_Alloc_Func allocate,
+                    char** out_bufp,
+                    size_t* out_lenp)
+{
+  FONT* font = NULL;
+
+  FT_Byte* keep = NULL;
+  FT_UShort* map = NULL;
+  FT_UShort* old_indices = NULL;
+  FT_UShort num_glyphs;
+
+  FT_Byte* buf;
+  FT_ULong len;
+  FT_Byte* glyf_buf;
+  FT_ULong glyf_len;
+  FT_Byte* loca_buf;
+  FT_ULong loca_len;
+  FT_Bool long_offsets;
+  FT_UShort num_hmetrics;
+  const FT_Byte* p;
+  size_t i;
+
+  FT_Error error;
+
+
+  if (!subsetter || (num_glyph_indices && !glyph_indices)
+      || !out_bufp || !out_lenp)
+    return FT_Err_Invalid_Argument;
+
+  *out_bufp = NULL;
+  *out_lenp = 0;
+
+  keep = (FT_Byte*)calloc(subsetter->num_glyphs, 1);
+  map = (FT_UShort*)malloc(subsetter->num_glyphs * sizeof (FT_UShort));
+  old_indices = (FT_UShort*)malloc(subsetter->num_glyphs
+                                   * sizeof (FT_UShort));
+  font = (FONT*)calloc(1, sizeof (FONT));
+  if (font)
+    font->sfnts = (SFNT*)calloc(1, sizeof (SFNT));
+  if (!keep || !map || !old_indices || !font || !font->sfnts)
+  {
+    error = FT_Err_Out_Of_Memory;
+    goto Exit;
+  }
+
+  /* glyph 0 is always part of a subset */
+  subset_keep_glyph(subsetter, keep, 0);
+  for (i = 0; i < num_glyph_indices; i++)
+  {
+    if (glyph_indices[i] >= subsetter->num_glyphs)
+    {
+      error = FT_Err_Invalid_Glyph_Index;
+      goto Exit;
+    }
+
+    subset_keep_glyph(subsetter, keep, (FT_UShort)glyph_indices[i]);
+  }
+
+  num_glyphs = 0;
+  for (i = 0; i < subsetter->num_glyphs; i++)
+  {
+    if (keep[i])
+    {
+      map[i] = num_glyphs;
+      old_indices[num_glyphs++] = (FT_UShort)i;
+    }
+    else
+      map[i] = 0xFFFF;
+  }
+
+  font->num_sfnts = 1;
+  font->allocate = allocate ? allocate : malloc;
+
+  /* keep the modification date of the master font */
+  p = subsetter->tables[SUBSET_head] + HEAD_MODIFIED_OFFSET;
+  {
+    unsigned long long modified;
+
+
+    modified = (unsigned long long)NEXT_ULONG(p) << 32;
+    modified |= NEXT_ULONG(p);
+    font->epoch = modified > SUBSET_SECONDS_TO_1970
+                    ? modified - SUBSET_SECONDS_TO_1970
+                    : 0;
+  }
+
+  /* `glyf' and `loca' */
+  error = subset_build_glyf_loca(subsetter, old_indices, num_glyphs, map,
+                                 &glyf_buf, &glyf_len,
+                                 &loca_buf, &loca_len,
+                                 &long_offsets);
+  if (error)
+    goto Exit;
+
+  error = subset_add_table(font, TTAG_glyf, glyf_buf, glyf_len);
+  if (error)
+  {
+    free(loca_buf);
+    goto Exit;
+  }
+  error = subset_add_table(font, TTAG_loca, loca_buf, loca_len);
+  if (error)
+    goto Exit;
+
+  /* `head' */
+  len = subsetter->lens[SUBSET_head];
+  buf = subset_copy_table(subsetter, SUBSET_head, len);
+  if (buf)
+  {
+    buf[LOCA_FORMAT_OFFSET - 1] = 0;
+    buf[LOCA_FORMAT_OFFSET] = long_offsets;
+  }
+  error = subset_add_table(font, TTAG_head, buf, len);
+  if (error)
+    goto Exit;
+
+  /* `hmtx' and `hhea' */
+  error = subset_build_hmtx(subsetter, old_indices, num_glyphs,
+                            &buf, &len, &num_hmetrics);
+  if (error)
+    goto Exit;
+  error = subset_add_table(font, TTAG_hmtx, buf, len);
+  if (error)
+    goto Exit;
+
+  len = subsetter->lens[SUBSET_hhea];
+  buf = subset_copy_table(subsetter, SUBSET_hhea, len);
+  if (buf)
+    subset_put_ushort(buf + HHEA_NUM_HMETRICS_OFFSET, num_hmetrics);
+  error = subset_add_table(font, TTAG_hhea, buf, len);
+  if (error)
+    goto Exit;
+
+  /* `maxp' */
+  len = subsetter->lens[SUBSET_maxp];
+  buf = subset_copy_table(subsetter, SUBSET_maxp, len);
+  if (buf)
+  {
+    subset_put_ushort(buf + MAXP_NUM_GLYPHS, num_glyphs);
+
+    if (len >= MAXP_LEN)
+    {
+      FT_ULong max_points = 0;
+      FT_ULong max_contours = 0;
+      FT_ULong max_composite_points = 0;
+      FT_ULong max_composite_contours = 0;
+      FT_ULong max_components = 0;
+      FT_ULong max_depth = 0;
+      FT_ULong max_instructions;
+
+
+      /* the bytecode of `fpgm' and `prep' is unchanged */
+      max_instructions = subsetter->lens[SUBSET_fpgm];
+      if (subsetter->lens[SUBSET_prep] > max_instructions)
+        max_instructions = subsetter->lens[SUBSET_prep];
+
+      for (i = 0; i < num_glyphs; i++)
+      {
+        Subset_Glyph* glyph = &subsetter->glyphs[old_indices[i]];
+
+
+        if (glyph->num_components)
+        {
+          if (glyph->num_points > max_composite_points)
+            max_composite_points = glyph->num_points;
+          if (glyph->num_contours > max_composite_contours)
+            max_composite_contours = glyph->num_contours;
+          if (glyph->num_components > max_components)
+            max_components = glyph->num_components;
+          if (glyph->depth > max_depth)
+            max_depth = glyph->depth;
+        }
+        else
+        {
+          if (glyph->num_points > max_points)
+            max_points = glyph->num_points;
+          if (glyph->num_contours > max_contours)
+            max_contours = glyph->num_contours;
+        }
+
+        if (glyph->ins_len > max_instructions)
+          max_instructions = glyph->ins_len;
+      }
+
+#define CLAMP(x) ((x) > 0xFFFF ? 0xFFFF : (x))
+
+      subset_put_ushort(buf + MAXP_MAX_POINTS, CLAMP(max_points));
+      subset_put_ushort(buf + MAXP_MAX_CONTOURS, CLAMP(max_contours));
+      subset_put_ushort(buf + MAXP_MAX_COMPOSITE_POINTS,
+                        CLAMP(max_composite_points));
+      subset_put_ushort(buf + MAXP_MAX_COMPOSITE_CONTOURS,
+                        CLAMP(max_composite_contours));
+      subset_put_ushort(buf + MAXP_MAX_INSTRUCTIONS_OFFSET,
+                        CLAMP(max_instructions));
+      subset_put_ushort(buf + MAXP_MAX_COMPONENTS_OFFSET, max_components);
+      subset_put_ushort(buf + MAXP_MAX_COMPONENT_DEPTH_OFFSET, max_depth);
+
+#undef CLAMP
+    }
+  }
+  error = subset_add_table(font, TTAG_maxp, buf, len);
+  if (error)
+    goto Exit;
+
+  /* `cmap' and `OS/2' */
+  if (subsetter->tables[SUBSET_cmap])
+  {
+    error = subset_build_cmap(subsetter, map, &buf, &len);
+    if (error)
+      goto Exit;
+    error = subset_add_table(font, TTAG_cmap, buf, len);
+    if (error)
+      goto Exit;
+  }
+
+  if (subsetter->tables[SUBSET_OS2])
+  {
+    len = subsetter->lens[SUBSET_OS2];
+    buf = subset_copy_table(subsetter, SUBSET_OS2, len);
+    if (buf && len >= OS2_LAST_CHAR_INDEX_OFFSET + 2)
+    {
+      FT_ULong first = ULONG_MAX;
+      FT_ULong last = 0;
+
+
+      for (i = 0; i < subsetter->num_mappings; i++)
+      {
+        Subset_Mapping* m = &subsetter->mappings[i];
+
+
+        if (map[m->glyph_idx] == 0xFFFF)
+          continue;
+
+        if (m->charcode < first)
+          first = m->charcode;
+        if (m->charcode > last)
+          last = m->charcode;
+      }
+
+      /* both fields are 16-bit values; code points */
+      /* in supplementary planes are mapped to 0xFFFF */
+      if (first <= last)
+      {
+        subset_put_ushort(buf + OS2_FIRST_CHAR_INDEX_OFFSET,
+                          first > 0xFFFF ? 0xFFFF : first);
+        subset_put_ushort(buf + OS2_LAST_CHAR_INDEX_OFFSET,
+                          last > 0xFFFF ? 0xFFFF : last);
+      }
+    }
+    error = subset_add_table(font, TTAG_OS2, buf, len);
+    if (error)
+      goto Exit;
+  }
+
+  /* `post' without glyph names */
+  if (subsetter->lens[SUBSET_post] >= POST_LEN)
+  {
+    buf = subset_copy_table(subsetter, SUBSET_post, POST_LEN);
+    if (buf)
+      subset_put_ulong(buf, 0x00030000UL);
+    error = subset_add_table(font, TTAG_post, buf, POST_LEN);
+    if (error)
+      goto Exit;
+  }
+
+  for (i = 0; i < sizeof (subset_copied) / sizeof (subset_copied[0]); i++)
+  {
+    int which = subset_copied[i];
+
+
+    if (!subsetter->tables[which])
+      continue;
+
+    len = subsetter->lens[which];
+    error = subset_add_table(font, subset_tags[which],
+                             subset_copy_table(subsetter, which, len), len);
+    if (error)
+      goto Exit;
+  }
+
+  error = TA_font_build_TTF(font);
+  if (error)
+    goto Exit;
+
+  *out_bufp = (char*)font->out_buf;
+  *out_lenp = font->out_len;
+
+Exit:
+  if (font)
+  {
+    FT_ULong j;
+
+
+    for (j = 0; j < font->num_tables; j++)
+      free(font->tables[j].buf);
+    free(font->tables);
+
+    if (font->sfnts)
+      free(font->sfnts[0].table_infos);
+    free(font->sfnts);
+    free(font);
+  }
+
+  free(keep);
+  free(map);
+  free(old_indices);
+
+  return error;
+}
+
+/* end of tasubset.c */
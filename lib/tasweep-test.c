@@ -0,0 +1,214 @@
+/* tasweep-test.c */
+
+/*
+ * Copyright (C) 2022 by Werner Lemberg.
+ *
+ * This file is part of the ttfautohint library, and may only be used,
+ * modified, and distributed under the terms given in `COPYING'.  By
+ * continuing to use, modify, or distribute this file you indicate that you
+ * have read `COPYING' and understand and accept it fully.
+ *
+ * The file `COPYING' mentioned in the previous paragraph is distributed
+ * with the ttfautohint library.
+ */
+
+/*
+ * Compile with
+ *
+ *   $(CC) $(CFLAGS) $(FREETYPE_CFLAGS) \
+ *         -I.. -I. \
+ *         -o tasweep-test tasweep-test.c tasweep.c
+ *
+ * after configuration.  The program runs `TA_sweep' on synthetic
+ * sequences of hints records (one letter per PPEM value) and compares the
+ * recorded hints with the expected ones.  The resulting binary aborts
+ * with an assertion message in case of an error, otherwise it produces no
+ * output.
+ */
+
+
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "tasweep.h"
+
+
+#define MIN_SIZE 8
+#define MAX_SIZE 50
+#define NUM_SIZES (MAX_SIZE - MIN_SIZE + 1)
+
+#define STABLE_SIZE 8
+
+
+typedef struct Sim_
+{
+  /* the hints record for each PPEM value, starting with `MIN_SIZE' */
+  const char* hints;
+
+  /* the recorded hints: letter and starting PPEM value */
+  char records[NUM_SIZES + 1];
+  FT_UInt sizes[NUM_SIZES];
+  int num_records;
+
+  FT_UInt last_added;
+  int num_calls;
+} Sim;
+
+
+static FT_Error
+sim_sweep_size(void* data,
+               FT_UInt size,
+               FT_Bool add,
+               FT_Bool* is_different)
+{
+  Sim* sim = (Sim*)data;
+  char c;
+
+
+  assert(size >= MIN_SIZE && size <= MAX_SIZE);
+  c = sim->hints[size - MIN_SIZE];
+
+  /* records must be added with increasing PPEM values */
+  if (add)
+  {
+    assert(size > sim->last_added);
+    sim->last_added = size;
+  }
+
+  *is_different = !sim->num_records
+                  || sim->records[sim->num_records - 1] != c;
+
+  if (add && *is_different)
+  {
+    sim->sizes[sim->num_records] = size;
+    sim->records[sim->num_records++] = c;
+  }
+
+  sim->num_calls++;
+
+  return FT_Err_Ok;
+}
+
+
+static void
+run(Sim* sim,
+    const char* hints,
+    FT_UInt stable_size)
+{
+  assert(strlen(hints) == NUM_SIZES);
+
+  memset(sim, 0, sizeof (Sim));
+  sim->hints = hints;
+
+  assert(!TA_sweep(MIN_SIZE, MAX_SIZE, stable_size, sim_sweep_size, sim));
+}
+
+
+/* `hints' with letter `c' from PPEM value `from' to `to' */
+
+static char*
+set(char* hints,
+    FT_UInt from,
+    FT_UInt to,
+    char c)
+{
+  FT_UInt i;
+
+
+  for (i = from; i <= to; i++)
+    hints[i - MIN_SIZE] = c;
+
+  return hints;
+}
+
+
+static char*
+all(char* hints,
+    char c)
+{
+  memset(hints, c, NUM_SIZES);
+  hints[NUM_SIZES] = '\0';
+
+  return hints;
+}
+
+
+/* check that the adaptive sweep gives the same records as the full one */
+
+static void
+check_exact(const char* hints)
+{
+  Sim full;
+  Sim adaptive;
+
+
+  run(&full, hints, 0);
+  assert(full.num_calls == NUM_SIZES);
+
+  run(&adaptive, hints, STABLE_SIZE);
+  assert(adaptive.num_records == full.num_records);
+  assert(!strcmp(adaptive.records, full.records));
+  assert(!memcmp(adaptive.sizes, full.sizes,
+                 (size_t)full.num_records * sizeof (FT_UInt)));
+}
+
+
+int
+main(void)
+{
+  char hints[NUM_SIZES + 1];
+  Sim sim;
+  FT_UInt size;
+
+
+  /* With `STABLE_SIZE' set to 8, PPEM values 8 to 12 are computed; */
+  /* probing then starts at 12 with PPEM values 14, 18, 26, 34, */
+  /* 42, and 50. */
+
+  /* constant hints: most PPEM values get skipped */
+  all(hints, 'A');
+  check_exact(hints);
+  run(&sim, hints, STABLE_SIZE);
+  assert(sim.num_calls < NUM_SIZES / 2);
+
+  /* constant hints below `stable_size': no skipping */
+  run(&sim, hints, MAX_SIZE + 1);
+  assert(sim.num_calls == NUM_SIZES);
+
+  /* A -> B: the change is found at the right PPEM value */
+  check_exact(set(all(hints, 'A'), 16, MAX_SIZE, 'B'));
+
+  /* A -> B -> A -> B between two probes (14 and 18) that differ: */
+  /* all changes are found, not only one of them */
+  check_exact(set(set(all(hints, 'A'), 15, 15, 'B'), 18, MAX_SIZE, 'B'));
+
+  /* A -> B -> A with B covering a probe (26) */
+  check_exact(set(all(hints, 'A'), 24, 27, 'B'));
+
+  /* A -> B -> A between two probes (18 and 26) with identical records: */
+  /* this is the documented loss of the heuristic */
+  set(all(hints, 'A'), 20, 21, 'B');
+
+  run(&sim, hints, 0);
+  assert(!strcmp(sim.records, "ABA"));
+
+  run(&sim, hints, STABLE_SIZE);
+  assert(!strcmp(sim.records, "A"));
+
+  /* a change at the last PPEM value */
+  check_exact(set(all(hints, 'A'), MAX_SIZE, MAX_SIZE, 'B'));
+
+  /* changes everywhere: no skipping at all */
+  all(hints, 'A');
+  for (size = MIN_SIZE; size <= MAX_SIZE; size += 2)
+    set(hints, size, size, 'B');
+  check_exact(hints);
+
+  return EXIT_SUCCESS;
+}
+
+/* end of tasweep-test.c */
@@ -0,0 +1,88 @@
+/* tasweep.c */
+
+/*
+ * Copyright (C) 2022 by Werner Lemberg.
+ *
+ * This file is part of the ttfautohint library, and may only be used,
+ * modified, and distributed under the terms given in `COPYING'.  By
+ * continuing to use, modify, or distribute this file you indicate that you
+ * have read `COPYING' and understand and accept it fully.
+ *
+ * The file `COPYING' mentioned in the previous paragraph is distributed
+ * with the ttfautohint library.
+ */
+
+
+#include "tasweep.h"
+
+
+FT_Error
+TA_sweep(FT_UInt min_size,
+         FT_UInt max_size,
+         FT_UInt stable_size,
+         TA_Sweep_Func func,
+         void* data)
+{
+  FT_Error error;
+
+  FT_UInt size;
+  FT_UInt num_stable = 0;
+  FT_UInt exact_max = 0; /* all PPEM values up to this one get computed */
+
+
+  size = min_size;
+  while (size <= max_size)
+  {
+    FT_Bool is_different;
+    FT_UInt lo, hi, step;
+
+
+    error = func(data, size, 1, &is_different);
+    if (error)
+      return error;
+
+    num_stable = is_different ? 0 : num_stable + 1;
+
+    if (!stable_size
+        || size < stable_size
+        || size < exact_max
+        || num_stable < TA_SWEEP_MIN_STABLE)
+    {
+      size++;
+      continue;
+    }
+
+    /* probe with increasing steps until the records differ */
+    lo = size;
+    hi = size;
+    step = 2;
+    while (lo < max_size)
+    {
+      hi = lo + step;
+      if (hi > max_size)
+        hi = max_size;
+
+      error = func(data, hi, 0, &is_different);
+      if (error)
+        return error;
+
+      if (is_different)
+        break;
+
+      lo = hi;
+      if (step < TA_SWEEP_MAX_STEP)
+        step *= 2;
+    }
+
+    /* the values in the range ]lo;hi] differ from the last records */
+    /* somewhere; we compute all of them (if `lo' is `max_size', */
+    /* the loop ends) */
+    exact_max = hi;
+    num_stable = 0;
+    size = lo + 1;
+  }
+
+  return FT_Err_Ok;
+}
+
+/* end of tasweep.c */
@@ -0,0 +1,69 @@
+/* tasweep.h */
+
+/*
+ * Copyright (C) 2022 by Werner Lemberg.
+ *
+ * This file is part of the ttfautohint library, and may only be used,
+ * modified, and distributed under the terms given in `COPYING'.  By
+ * continuing to use, modify, or distribute this file you indicate that you
+ * have read `COPYING' and understand and accept it fully.
+ *
+ * The file `COPYING' mentioned in the previous paragraph is distributed
+ * with the ttfautohint library.
+ */
+
+
+#ifndef TASWEEP_H_
+#define TASWEEP_H_
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+
+
+/* the number of consecutive PPEM values with unchanged hints records */
+/* before `adaptive-sweep' starts to skip PPEM values */
+#define TA_SWEEP_MIN_STABLE 4
+
+/* the maximum number of PPEM values skipped at once */
+#define TA_SWEEP_MAX_STEP 8
+
+
+/*
+ * Hint a glyph at PPEM value `size' and compare the resulting hints
+ * records with the last ones, setting `is_different' accordingly.  If
+ * `add' is set, new records get appended; otherwise, nothing changes
+ * (this is used for probing).
+ */
+
+typedef FT_Error
+(*TA_Sweep_Func)(void* data,
+                 FT_UInt size,
+                 FT_Bool add,
+                 FT_Bool* is_different);
+
+
+/*
+ * Call `func' with `add' set for all PPEM values from `min_size' to
+ * `max_size' in increasing order.
+ *
+ * If `stable_size' is non-zero, PPEM values get skipped as soon as the
+ * records have been unchanged for `TA_SWEEP_MIN_STABLE' values and the
+ * size is at least `stable_size': `func' probes PPEM values with
+ * increasing steps, assuming that nothing changes between two probes
+ * with identical records.  This is a heuristic that can lose hints
+ * records: if the records change and change back between two probes,
+ * the change is not seen.  As soon as a probe finds different records,
+ * however, all PPEM values since the previous probe get computed with
+ * `add' set, thus finding all changes in this range.
+ */
+
+FT_Error
+TA_sweep(FT_UInt min_size,
+         FT_UInt max_size,
+         FT_UInt stable_size,
+         TA_Sweep_Func func,
+         void* data);
+
+#endif /* TASWEEP_H_ */
+
+/* end of tasweep.h */
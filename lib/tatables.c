@@ -17,6 +17,7 @@
 #include <stdlib.h>
 
 #include "ta.h"
+#include "tasimd.h"
 
 
 FT_Error
@@ -47,25 +48,39 @@ FT_ULong
 TA_table_compute_checksum(FT_Byte* buf,
                           FT_ULong len)
 {
-  FT_Byte* end_buf = buf + len;
-  FT_ULong checksum = 0;
+  FT_ULong checksum = ta_simd_checksum(buf, len / 4);
 
 
-  /* we expect that the length of `buf' is a multiple of 4 */
+  buf += len & ~3U;
 
-  while (buf < end_buf)
-    checksum += NEXT_ULONG(buf);
+  /* we don't access the padding bytes (which are zero by definition) */
+  /* since `buf' might be a view into the input font */
+  switch (len % 4)
+  {
+  case 3:
+    checksum += (FT_ULong)buf[2] << 8;
+    /* fall through */
+  case 2:
+    checksum += (FT_ULong)buf[1] << 16;
+    /* fall through */
+  case 1:
+    checksum += (FT_ULong)buf[0] << 24;
+    /* fall through */
+  default:
+    break;
+  }
 
   return checksum;
 }
 
 
-FT_Error
-TA_font_add_table(FONT* font,
-                  SFNT_Table_Info* table_info,
-                  FT_ULong tag,
-                  FT_ULong len,
-                  FT_Byte* buf)
+static FT_Error
+TA_font_append_table(FONT* font,
+                     SFNT_Table_Info* table_info,
+                     FT_ULong tag,
+                     FT_ULong len,
+                     FT_Byte* buf,
+                     FT_Bool is_view)
 {
   SFNT_Table* tables_new;
   SFNT_Table* table_last;
@@ -87,10 +102,14 @@ TA_font_add_table(FONT* font,
   table_last->tag = tag;
   table_last->len = len;
   table_last->buf = buf;
-  table_last->checksum = TA_table_compute_checksum(buf, len);
+  /* the checksum of a view gets computed */
+  /* in `TA_font_compute_view_checksums' */
+  table_last->checksum = is_view ? 0
+                                 : TA_table_compute_checksum(buf, len);
   table_last->offset = 0; /* set in `TA_font_compute_table_offsets' */
   table_last->data = NULL;
   table_last->processed = 0;
+  table_last->is_view = is_view;
 
   /* link table and table info */
   *table_info = font->num_tables - 1;
@@ -99,6 +118,50 @@ TA_font_add_table(FONT* font,
 }
 
 
+FT_Error
+TA_font_add_table(FONT* font,
+                  SFNT_Table_Info* table_info,
+                  FT_ULong tag,
+                  FT_ULong len,
+                  FT_Byte* buf)
+{
+  return TA_font_append_table(font, table_info, tag, len, buf, 0);
+}
+
+
+/* `buf' points into `font->in_buf' and must not be modified */
+
+FT_Error
+TA_font_add_table_view(FONT* font,
+                       SFNT_Table_Info* table_info,
+                       FT_ULong tag,
+                       FT_ULong len,
+                       FT_Byte* buf)
+{
+  return TA_font_append_table(font, table_info, tag, len, buf, 1);
+}
+
+
+/* tables passed through unchanged need their checksum */
+/* only while building the output font */
+
+void
+TA_font_compute_view_checksums(FONT* font)
+{
+  FT_ULong i;
+
+
+  for (i = 0; i < font->num_tables; i++)
+  {
+    SFNT_Table* table = &font->tables[i];
+
+
+    if (table->is_view)
+      table->checksum = TA_table_compute_checksum(table->buf, table->len);
+  }
+}
+
+
 void
 TA_sfnt_sort_table_info(SFNT* sfnt,
                         FONT* font)
@@ -161,8 +224,7 @@ TA_font_compute_table_offsets(FONT* font,
 
     table->offset = offset;
 
-    /* table offsets must be multiples of 4; */
-    /* this also fits the actual buffer lengths */
+    /* table offsets must be multiples of 4 */
     offset += (table->len + 3) & ~3U;
   }
 }
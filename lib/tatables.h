@@ -32,6 +32,15 @@ TA_font_add_table(FONT* font,
                   FT_ULong tag,
                   FT_ULong len,
                   FT_Byte* buf);
+FT_Error
+TA_font_add_table_view(FONT* font,
+                       SFNT_Table_Info* table_info,
+                       FT_ULong tag,
+                       FT_ULong len,
+                       FT_Byte* buf);
+
+void
+TA_font_compute_view_checksums(FONT* font);
 
 void
 TA_sfnt_sort_table_info(SFNT* sfnt,
@@ -0,0 +1,230 @@
+/* tathread.c */
+
+/*
+ * Copyright (C) 2022 by Werner Lemberg.
+ *
+ * This file is part of the ttfautohint library, and may only be used,
+ * modified, and distributed under the terms given in `COPYING'.  By
+ * continuing to use, modify, or distribute this file you indicate that you
+ * have read `COPYING' and understand and accept it fully.
+ *
+ * The file `COPYING' mentioned in the previous paragraph is distributed
+ * with the ttfautohint library.
+ */
+
+
+#include <stdlib.h>
+#include <stdint.h>
+
+#include "tathread.h"
+
+
+void
+ta_mutex_init(TA_Mutex mutex)
+{
+#if defined TA_THREADS_POSIX
+  pthread_mutex_init(&mutex->mutex, NULL);
+#elif defined TA_THREADS_WINDOWS
+  InitializeCriticalSection(&mutex->mutex);
+#else
+  mutex->dummy = 0;
+#endif
+}
+
+
+void
+ta_mutex_lock(TA_Mutex mutex)
+{
+#if defined TA_THREADS_POSIX
+  pthread_mutex_lock(&mutex->mutex);
+#elif defined TA_THREADS_WINDOWS
+  EnterCriticalSection(&mutex->mutex);
+#else
+  (void)mutex;
+#endif
+}
+
+
+void
+ta_mutex_unlock(TA_Mutex mutex)
+{
+#if defined TA_THREADS_POSIX
+  pthread_mutex_unlock(&mutex->mutex);
+#elif defined TA_THREADS_WINDOWS
+  LeaveCriticalSection(&mutex->mutex);
+#else
+  (void)mutex;
+#endif
+}
+
+
+void
+ta_mutex_done(TA_Mutex mutex)
+{
+#if defined TA_THREADS_POSIX
+  pthread_mutex_destroy(&mutex->mutex);
+#elif defined TA_THREADS_WINDOWS
+  DeleteCriticalSection(&mutex->mutex);
+#else
+  (void)mutex;
+#endif
+}
+
+
+unsigned long
+ta_thread_id(void)
+{
+#if defined TA_THREADS_POSIX
+  /* `pthread_t' is an integer or a pointer, depending on the platform */
+  return (unsigned long)(uintptr_t)pthread_self();
+#elif defined TA_THREADS_WINDOWS
+  return (unsigned long)GetCurrentThreadId();
+#else
+  return 0;
+#endif
+}
+
+
+/* the data shared by all threads of `ta_thread_run_jobs' */
+typedef struct Jobs_
+{
+  TA_MutexRec mutex;
+  FT_Long next_job;
+  FT_Long num_jobs;
+
+  TA_Job_Func func;
+  void* data;
+} Jobs;
+
+
+static FT_Long
+get_next_job(Jobs* jobs)
+{
+  FT_Long idx;
+
+
+  ta_mutex_lock(&jobs->mutex);
+  idx = jobs->next_job < jobs->num_jobs ? jobs->next_job++ : -1;
+  ta_mutex_unlock(&jobs->mutex);
+
+  return idx;
+}
+
+
+static void
+run_jobs(Jobs* jobs)
+{
+  FT_Long idx;
+
+
+  while ((idx = get_next_job(jobs)) >= 0)
+    jobs->func(idx, jobs->data);
+}
+
+
+#if defined TA_THREADS_POSIX
+
+typedef pthread_t Thread;
+
+static void*
+thread_func(void* arg)
+{
+  run_jobs((Jobs*)arg);
+  return NULL;
+}
+
+static int
+thread_create(Thread* thread,
+              Jobs* jobs)
+{
+  return !pthread_create(thread, NULL, thread_func, jobs);
+}
+
+static void
+thread_join(Thread thread)
+{
+  pthread_join(thread, NULL);
+}
+
+#elif defined TA_THREADS_WINDOWS
+
+typedef HANDLE Thread;
+
+static DWORD WINAPI
+thread_func(LPVOID arg)
+{
+  run_jobs((Jobs*)arg);
+  return 0;
+}
+
+static int
+thread_create(Thread* thread,
+              Jobs* jobs)
+{
+  *thread = CreateThread(NULL, 0, thread_func, jobs, 0, NULL);
+  return *thread != NULL;
+}
+
+static void
+thread_join(Thread thread)
+{
+  WaitForSingleObject(thread, INFINITE);
+  CloseHandle(thread);
+}
+
+#endif /* TA_THREADS_WINDOWS */
+
+
+void
+ta_thread_run_jobs(FT_UInt num_threads,
+                   FT_Long num_jobs,
+                   TA_Job_Func func,
+                   void* data)
+{
+  Jobs jobs;
+
+#if defined TA_THREADS_POSIX || defined TA_THREADS_WINDOWS
+  Thread* threads = NULL;
+  FT_UInt num_started = 0;
+  FT_UInt i;
+#endif
+
+
+  ta_mutex_init(&jobs.mutex);
+  jobs.next_job = 0;
+  jobs.num_jobs = num_jobs;
+  jobs.func = func;
+  jobs.data = data;
+
+#if defined TA_THREADS_POSIX || defined TA_THREADS_WINDOWS
+  if ((FT_Long)num_threads > num_jobs)
+    num_threads = (FT_UInt)num_jobs;
+
+  /* the calling thread is a worker also */
+  if (num_threads > 1)
+    threads = (Thread*)malloc((num_threads - 1) * sizeof (Thread));
+  if (threads)
+  {
+    for (i = 0; i < num_threads - 1; i++)
+    {
+      if (!thread_create(&threads[num_started], &jobs))
+        break;
+      num_started++;
+    }
+  }
+#else
+  (void)num_threads;
+#endif
+
+  run_jobs(&jobs);
+
+#if defined TA_THREADS_POSIX || defined TA_THREADS_WINDOWS
+  for (i = 0; i < num_started; i++)
+    thread_join(threads[i]);
+  free(threads);
+#endif
+
+  ta_mutex_done(&jobs.mutex);
+}
+
+/* end of tathread.c */
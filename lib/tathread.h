@@ -0,0 +1,96 @@
+/* tathread.h */
+
+/*
+ * Copyright (C) 2022 by Werner Lemberg.
+ *
+ * This file is part of the ttfautohint library, and may only be used,
+ * modified, and distributed under the terms given in `COPYING'.  By
+ * continuing to use, modify, or distribute this file you indicate that you
+ * have read `COPYING' and understand and accept it fully.
+ *
+ * The file `COPYING' mentioned in the previous paragraph is distributed
+ * with the ttfautohint library.
+ */
+
+
+/* a minimal threading layer, selected by gnulib's `threadlib' test */
+
+#ifndef TATHREAD_H_
+#define TATHREAD_H_
+
+#include <config.h>
+
+#include "tatypes.h"
+
+#if defined USE_POSIX_THREADS || defined USE_ISOC_AND_POSIX_THREADS
+#  define TA_THREADS_POSIX
+#  include <pthread.h>
+#elif defined USE_WINDOWS_THREADS
+#  define TA_THREADS_WINDOWS
+#  define WIN32_LEAN_AND_MEAN
+#  include <windows.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+typedef struct TA_MutexRec_
+{
+#if defined TA_THREADS_POSIX
+  pthread_mutex_t mutex;
+#elif defined TA_THREADS_WINDOWS
+  CRITICAL_SECTION mutex;
+#else
+  int dummy;
+#endif
+} TA_MutexRec, *TA_Mutex;
+
+
+void
+ta_mutex_init(TA_Mutex mutex);
+
+void
+ta_mutex_lock(TA_Mutex mutex);
+
+void
+ta_mutex_unlock(TA_Mutex mutex);
+
+void
+ta_mutex_done(TA_Mutex mutex);
+
+
+/* an identifier of the calling thread (0 without thread support) */
+unsigned long
+ta_thread_id(void);
+
+
+/* a job function gets called with index values 0, 1, ..., `num_jobs'-1 */
+typedef void
+(*TA_Job_Func)(FT_Long idx,
+               void* data);
+
+/*
+ * Call `func' for all indices in the range [0;num_jobs), using at most
+ * `num_threads' threads (including the calling thread); each index is
+ * handled exactly once, in no particular order.  The function returns
+ * after all jobs are finished.
+ *
+ * Without thread support, or if starting a thread fails, the remaining
+ * jobs are executed in the calling thread.
+ */
+
+void
+ta_thread_run_jobs(FT_UInt num_threads,
+                   FT_Long num_jobs,
+                   TA_Job_Func func,
+                   void* data);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TATHREAD_H_ */
+
+/* end of tathread.h */
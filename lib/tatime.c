@@ -17,6 +17,11 @@
 
 #include "ta.h"
 
+#ifdef _WIN32
+#  define WIN32_LEAN_AND_MEAN
+#  include <windows.h>
+#endif
+
 
 void
 TA_get_current_time(FONT* font,
@@ -39,4 +44,31 @@ TA_get_current_time(FONT* font,
   *low = (FT_ULong)seconds_to_today;
 }
 
+
+unsigned long long
+TA_get_monotonic_time(void)
+{
+#ifdef _WIN32
+  static LARGE_INTEGER freq;
+  LARGE_INTEGER count;
+
+
+  if (!freq.QuadPart)
+    QueryPerformanceFrequency(&freq);
+  QueryPerformanceCounter(&count);
+
+  return (unsigned long long)(count.QuadPart / freq.QuadPart) * 1000000000ULL
+         + (unsigned long long)(count.QuadPart % freq.QuadPart)
+           * 1000000000ULL / (unsigned long long)freq.QuadPart;
+#else
+  struct timespec ts;
+
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (unsigned long long)ts.tv_sec * 1000000000ULL
+         + (unsigned long long)ts.tv_nsec;
+#endif
+}
+
 /* end of tatime.c */
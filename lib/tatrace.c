@@ -0,0 +1,122 @@
+/* tatrace.c */
+
+/*
+ * Copyright (C) 2022 by Werner Lemberg.
+ *
+ * This file is part of the ttfautohint library, and may only be used,
+ * modified, and distributed under the terms given in `COPYING'.  By
+ * continuing to use, modify, or distribute this file you indicate that you
+ * have read `COPYING' and understand and accept it fully.
+ *
+ * The file `COPYING' mentioned in the previous paragraph is distributed
+ * with the ttfautohint library.
+ */
+
+
+#include <stdarg.h>
+#include <stdlib.h>
+
+#include "ta.h"
+#include "tatrace.h"
+
+
+FT_Error
+ta_trace_new(FILE* file,
+             FT_Bool ppem,
+             TA_Trace* atrace)
+{
+  TA_Trace trace;
+
+
+  trace = (TA_Trace)malloc(sizeof (TA_TraceRec));
+  if (!trace)
+    return FT_Err_Out_Of_Memory;
+
+  trace->file = file;
+  trace->ppem = ppem;
+  ta_mutex_init(&trace->mutex);
+  trace->start = TA_get_monotonic_time();
+  trace->have_events = 0;
+
+  fprintf(file, "{\"traceEvents\": [\n");
+
+  *atrace = trace;
+
+  return FT_Err_Ok;
+}
+
+
+void
+ta_trace_done(TA_Trace trace)
+{
+  if (!trace)
+    return;
+
+  fprintf(trace->file, "\n],\n"
+                       "\"displayTimeUnit\": \"ms\"}\n");
+  fflush(trace->file);
+
+  ta_mutex_done(&trace->mutex);
+  free(trace);
+}
+
+
+unsigned long long
+ta_trace_now(void)
+{
+  return TA_get_monotonic_time();
+}
+
+
+void
+ta_trace_span(TA_Trace trace,
+              const char* category,
+              const char* name,
+              unsigned long long start,
+              const char* args,
+              ...)
+{
+  unsigned long long end;
+  unsigned long tid;
+
+
+  if (!trace)
+    return;
+
+  end = ta_trace_now();
+  tid = ta_thread_id();
+
+  if (start < trace->start)
+    start = trace->start;
+
+  ta_mutex_lock(&trace->mutex);
+
+  /* times are given in microseconds */
+  fprintf(trace->file,
+          "%s{\"name\": \"%s\", \"cat\": \"%s\", \"ph\": \"X\","
+          " \"ts\": %.3f, \"dur\": %.3f, \"pid\": 1, \"tid\": %lu",
+          trace->have_events ? ",\n" : "",
+          name, category,
+          (double)(start - trace->start) / 1000.0,
+          (double)(end - start) / 1000.0,
+          tid);
+
+  if (args)
+  {
+    va_list ap;
+
+
+    fprintf(trace->file, ", \"args\": {");
+    va_start(ap, args);
+    vfprintf(trace->file, args, ap);
+    va_end(ap);
+    fprintf(trace->file, "}");
+  }
+
+  fprintf(trace->file, "}");
+  trace->have_events = 1;
+
+  ta_mutex_unlock(&trace->mutex);
+}
+
+/* end of tatrace.c */
@@ -0,0 +1,90 @@
+/* tatrace.h */
+
+/*
+ * Copyright (C) 2022 by Werner Lemberg.
+ *
+ * This file is part of the ttfautohint library, and may only be used,
+ * modified, and distributed under the terms given in `COPYING'.  By
+ * continuing to use, modify, or distribute this file you indicate that you
+ * have read `COPYING' and understand and accept it fully.
+ *
+ * The file `COPYING' mentioned in the previous paragraph is distributed
+ * with the ttfautohint library.
+ */
+
+
+/*
+ * Event tracing in the `Trace Event Format' used by Chrome's
+ * `about:tracing' and by Perfetto.  Spans are written as `complete'
+ * events (phase `X') as soon as they end, thus the output file is valid
+ * JSON only after `ta_trace_done' has been called.
+ *
+ * If tracing is off, the `trace' argument of all functions is NULL, and
+ * callers should avoid any work (like reading the clock) in this case;
+ * the `TA_TRACE_START' macro helps with that.
+ */
+
+#ifndef TATRACE_H_
+#define TATRACE_H_
+
+#include <stdio.h>
+
+#include "tatypes.h"
+#include "tathread.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+typedef struct TA_TraceRec_
+{
+  FILE* file;
+  FT_Bool ppem; /* emit a span for each PPEM value of a glyph */
+
+  TA_MutexRec mutex;
+  unsigned long long start; /* the time of `ta_trace_new' */
+  FT_Bool have_events;
+} TA_TraceRec, *TA_Trace;
+
+
+FT_Error
+ta_trace_new(FILE* file,
+             FT_Bool ppem,
+             TA_Trace* atrace);
+
+void
+ta_trace_done(TA_Trace trace);
+
+/* return the current time (to be passed to `ta_trace_span') */
+unsigned long long
+ta_trace_now(void);
+
+/*
+ * Emit a span from `start' until now.  If `args' is not NULL, it is a
+ * `printf' format string (followed by its arguments) for the members of
+ * the event's JSON `args' object, for example
+ *
+ *   ta_trace_span(trace, "glyph", "glyph", start,
+ *                 "\"index\": %ld", idx);
+ */
+void
+ta_trace_span(TA_Trace trace,
+              const char* category,
+              const char* name,
+              unsigned long long start,
+              const char* args,
+              ...);
+
+
+#define TA_TRACE_START(trace) \
+          ((trace) ? ta_trace_now() : 0)
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TATRACE_H_ */
+
+/* end of tatrace.h */
@@ -86,6 +86,7 @@ TA_font_build_TTC_header(FONT* font,
 
   /* the first SFNT table immediately follows the subfont TTF headers */
   TA_font_compute_table_offsets(font, TTF_offset);
+  TA_font_compute_view_checksums(font);
 
   if (font->have_DSIG)
   {
@@ -249,9 +250,10 @@ TA_font_build_TTC(FONT* font)
     SFNT_Table* table = &tables[j];
 
 
-    /* buffer length is a multiple of 4 */
-    memcpy(font->out_buf + table->offset,
-           table->buf, (table->len + 3) & ~3U);
+    /* views into the input font aren't padded */
+    memcpy(font->out_buf + table->offset, table->buf, table->len);
+    memset(font->out_buf + table->offset + table->len, 0,
+           ((table->len + 3) & ~3U) - table->len);
   }
 
   error = TA_Err_Ok;
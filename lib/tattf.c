@@ -263,6 +263,7 @@ TA_font_build_TTF(FONT* font)
   }
 
   TA_sfnt_sort_table_info(sfnt, font);
+  TA_font_compute_view_checksums(font);
 
   /* the first SFNT table immediately follows the header */
   (void)TA_sfnt_build_TTF_header(sfnt, font, NULL, &SFNT_offset, 0);
@@ -297,9 +298,10 @@ TA_font_build_TTF(FONT* font)
     SFNT_Table* table = &tables[i];
 
 
-    /* buffer length is a multiple of 4 */
-    memcpy(font->out_buf + table->offset,
-           table->buf, (table->len + 3) & ~3U);
+    /* views into the input font aren't padded */
+    memcpy(font->out_buf + table->offset, table->buf, table->len);
+    memset(font->out_buf + table->offset + table->len, 0,
+           ((table->len + 3) & ~3U) - table->len);
   }
 
   error = TA_Err_Ok;
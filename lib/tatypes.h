@@ -76,7 +76,6 @@ extern int _ta_debug_global;
 extern int _ta_debug_disable_horz_hints;
 extern int _ta_debug_disable_vert_hints;
 extern int _ta_debug_disable_blue_hints;
-extern void* _ta_debug_hints;
 
 #else /* !TA_DEBUG */
 
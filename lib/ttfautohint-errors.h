@@ -119,6 +119,10 @@ TA_ERRORDEF_(Control_Flex_Error,           0x211,
              "internal flex error")
 TA_ERRORDEF_(Control_Too_Much_Widths,      0x212,
              "too much stem width values")
+TA_ERRORDEF_(Control_Invalid_Binary,       0x213,
+             "invalid compiled control instructions")
+TA_ERRORDEF_(Control_Binary_Mismatch,      0x214,
+             "compiled control instructions don't match font")
 
 /* error codes in the range 0x300-0x3FF are related to the reference font; */
 /* subtract 0x300 to get the normal FreeType meaning */
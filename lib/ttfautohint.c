@@ -23,6 +23,7 @@
 #include <ctype.h>
 
 #include "ta.h"
+#include "tasimd.h"
 
 
 #define COMPARE(str) \
@@ -61,6 +62,8 @@ TTF_autohint(const char* options,
   FILE* in_file = NULL;
   FILE* out_file = NULL;
   FILE* control_file = NULL;
+  FILE* control_binary_file = NULL;
+  FILE* trace_file = NULL;
 
   FILE* reference_file = NULL;
   FT_Long reference_index = 0;
@@ -74,6 +77,10 @@ TTF_autohint(const char* options,
   size_t control_len = 0;
   const char* reference_buf = NULL;
   size_t reference_len = 0;
+  const char* previous_buf = NULL;
+  size_t previous_len = 0;
+  const char* previous_control_buf = NULL;
+  size_t previous_control_len = 0;
 
   const unsigned char** error_stringp = NULL;
 
@@ -85,6 +92,9 @@ TTF_autohint(const char* options,
   const char* x_height_snapping_exceptions_string = NULL;
   number_range* x_height_snapping_exceptions = NULL;
 
+  const char* hint_glyphs_string = NULL;
+  number_range* hint_glyphs = NULL;
+
   FT_Long fallback_stem_width = 0;
 
   FT_Int gray_stem_width_mode = TA_STEM_WIDTH_MODE_QUANTIZED;
@@ -93,6 +103,8 @@ TTF_autohint(const char* options,
 
   TA_Progress_Func progress = NULL;
   void* progress_data = NULL;
+  TA_Glyph_Report_Func glyph_report = NULL;
+  void* glyph_report_data = NULL;
   TA_Error_Func err = NULL;
   void* err_data = NULL;
   TA_Info_Func info = NULL;
@@ -105,6 +117,7 @@ TTF_autohint(const char* options,
   FT_Bool windows_compatibility = 0;
   FT_Bool ignore_restrictions = 0;
   FT_Bool adjust_subglyphs = 0;
+  FT_Bool adaptive_sweep = 0;
   FT_Bool hint_composites = 0;
   FT_Bool symbol = 0;
   FT_Bool fallback_scaling = 0;
@@ -119,6 +132,14 @@ TTF_autohint(const char* options,
   FT_Bool debug = 0;
   FT_Bool TTFA_info = 0;
   unsigned long long epoch = ULLONG_MAX;
+  FT_UInt num_threads = 1;
+  const char* simd_string = NULL;
+  FT_Int simd_level = TA_SIMD_MAX;
+  FT_Bool trace_ppem = 0;
+
+  TA_Trace trace = NULL;
+  unsigned long long trace_start = 0;
+  unsigned long long phase_start = 0;
 
   const char* op;
 
@@ -158,7 +179,9 @@ TTF_autohint(const char* options,
     /* the `COMPARE' macro uses `len' and `start' */
 
     /* handle options -- don't forget to update parameter dump below! */
-    if (COMPARE("adjust-subglyphs"))
+    if (COMPARE("adaptive-sweep"))
+      adaptive_sweep = (FT_Bool)va_arg(ap, FT_Int);
+    else if (COMPARE("adjust-subglyphs"))
       adjust_subglyphs = (FT_Bool)va_arg(ap, FT_Int);
     else if (COMPARE("alloc-func"))
       allocate = va_arg(ap, TA_Alloc_Func);
@@ -172,6 +195,8 @@ TTF_autohint(const char* options,
       control_file = NULL;
       control_len = va_arg(ap, size_t);
     }
+    else if (COMPARE("control-binary-file"))
+      control_binary_file = va_arg(ap, FILE*);
     else if (COMPARE("control-file"))
     {
       control_file = va_arg(ap, FILE*);
@@ -220,6 +245,10 @@ TTF_autohint(const char* options,
       gdi_cleartype_stem_width_mode = arg ? TA_STEM_WIDTH_MODE_STRONG
                                           : TA_STEM_WIDTH_MODE_QUANTIZED;
     }
+    else if (COMPARE("glyph-report-callback"))
+      glyph_report = va_arg(ap, TA_Glyph_Report_Func);
+    else if (COMPARE("glyph-report-callback-data"))
+      glyph_report_data = va_arg(ap, void*);
     else if (COMPARE("gray-stem-width-mode"))
       gray_stem_width_mode = va_arg(ap, FT_Int);
     else if (COMPARE("gray-strong-stem-width"))
@@ -238,6 +267,8 @@ TTF_autohint(const char* options,
       hinting_range_min = (FT_Long)va_arg(ap, FT_UInt);
     else if (COMPARE("hint-composites"))
       hint_composites = (FT_Bool)va_arg(ap, FT_Int);
+    else if (COMPARE("hint-glyphs"))
+      hint_glyphs_string = va_arg(ap, const char*);
     else if (COMPARE("ignore-restrictions"))
       ignore_restrictions = (FT_Bool)va_arg(ap, FT_Int);
     else if (COMPARE("in-buffer"))
@@ -282,6 +313,14 @@ TTF_autohint(const char* options,
     }
     else if (COMPARE("pre-hinting"))
       adjust_subglyphs = (FT_Bool)va_arg(ap, FT_Int);
+    else if (COMPARE("previous-buffer"))
+      previous_buf = va_arg(ap, const char*);
+    else if (COMPARE("previous-buffer-len"))
+      previous_len = va_arg(ap, size_t);
+    else if (COMPARE("previous-control-buffer"))
+      previous_control_buf = va_arg(ap, const char*);
+    else if (COMPARE("previous-control-buffer-len"))
+      previous_control_len = va_arg(ap, size_t);
     else if (COMPARE("progress-callback"))
       progress = va_arg(ap, TA_Progress_Func);
     else if (COMPARE("progress-callback-data"))
@@ -306,8 +345,16 @@ TTF_autohint(const char* options,
       reference_index = (FT_Long)va_arg(ap, FT_UInt);
     else if (COMPARE("reference-name"))
       reference_name = va_arg(ap, const char*);
+    else if (COMPARE("simd"))
+      simd_string = va_arg(ap, const char*);
     else if (COMPARE("symbol"))
       symbol = (FT_Bool)va_arg(ap, FT_Int);
+    else if (COMPARE("threads"))
+      num_threads = va_arg(ap, FT_UInt);
+    else if (COMPARE("trace-file"))
+      trace_file = va_arg(ap, FILE*);
+    else if (COMPARE("trace-ppem"))
+      trace_ppem = (FT_Bool)va_arg(ap, FT_Int);
     else if (COMPARE("TTFA-info"))
       TTFA_info = (FT_Bool)va_arg(ap, FT_Int);
     else if (COMPARE("windows-compatibility"))
@@ -337,8 +384,10 @@ TTF_autohint(const char* options,
     goto Err1;
   }
 
+  /* compiling control instructions doesn't produce an output font */
   if (!(out_file
-        || (out_bufp && out_lenp)))
+        || (out_bufp && out_lenp)
+        || control_binary_file))
   {
     error = FT_Err_Invalid_Argument;
     goto Err1;
@@ -441,6 +490,16 @@ TTF_autohint(const char* options,
     default_script = (TA_Script)i;
   }
 
+  if (simd_string)
+  {
+    simd_level = ta_simd_parse_level(simd_string);
+    if (simd_level < 0)
+    {
+      error = FT_Err_Invalid_Argument;
+      goto Err1;
+    }
+  }
+
   if (x_height_snapping_exceptions_string)
   {
     const char* s = number_set_parse(x_height_snapping_exceptions_string,
@@ -459,6 +518,26 @@ TTF_autohint(const char* options,
     }
   }
 
+  if (hint_glyphs_string)
+  {
+    const char* s = number_set_parse(hint_glyphs_string,
+                                     &hint_glyphs,
+                                     0,
+                                     0xFFFF);
+    if (*s)
+    {
+      number_set_free(x_height_snapping_exceptions);
+
+      /* we map numberset.h's error codes to values starting with 0x400 */
+      error = 0x400 - (FT_Error)(uintptr_t)hint_glyphs;
+      errlinenum = 0;
+      errline = (char*)hint_glyphs_string;
+      errpos = (char*)s;
+
+      goto Err1;
+    }
+  }
+
   font->reference_index = reference_index;
   font->reference_name = reference_name;
 
@@ -467,6 +546,7 @@ TTF_autohint(const char* options,
   font->hinting_limit = (FT_UInt)hinting_limit;
   font->increase_x_height = (FT_UInt)increase_x_height;
   font->x_height_snapping_exceptions = x_height_snapping_exceptions;
+  font->hint_glyphs = hint_glyphs;
   font->fallback_stem_width = (FT_UInt)fallback_stem_width;
 
   font->gray_stem_width_mode = gray_stem_width_mode;
@@ -476,6 +556,7 @@ TTF_autohint(const char* options,
   font->windows_compatibility = windows_compatibility;
   font->ignore_restrictions = ignore_restrictions;
   font->adjust_subglyphs = adjust_subglyphs;
+  font->adaptive_sweep = adaptive_sweep;
   font->hint_composites = hint_composites;
   font->fallback_style = fallback_style;
   font->fallback_scaling = fallback_scaling;
@@ -488,17 +569,32 @@ No_check:
 
   font->progress = progress;
   font->progress_data = progress_data;
+  font->glyph_report = glyph_report;
+  font->glyph_report_data = glyph_report_data;
   font->info = info;
   font->info_post = info_post;
   font->info_data = info_data;
 
   font->debug = debug;
+  font->num_threads = num_threads;
+  font->simd_level = simd_level;
   font->dehint = dehint;
   font->TTFA_info = TTFA_info;
   font->epoch = epoch;
 
   font->gasp_idx = MISSING;
 
+  if (trace_file)
+  {
+    error = ta_trace_new(trace_file, trace_ppem, &font->trace);
+    if (error)
+      goto Err;
+
+    trace = font->trace;
+    trace_start = ta_trace_now();
+    phase_start = trace_start;
+  }
+
   /* start with processing the data */
 
   if (in_file)
@@ -551,6 +647,44 @@ No_check:
     font->reference_len = reference_len;
   }
 
+  /* a valid TTF can never be that small; */
+  /* we simply ignore such a previous font */
+  if (previous_buf && previous_len >= 100)
+  {
+    font->previous_buf = (const FT_Byte*)previous_buf;
+    font->previous_len = previous_len;
+
+    if (previous_control_buf)
+    {
+      font->previous_control_buf = previous_control_buf;
+      font->previous_control_len = previous_control_len;
+    }
+  }
+  else if (font->hint_glyphs)
+  {
+    /* if we hint only some glyphs, the remaining ones */
+    /* keep the bytecode of an already processed input font */
+    font->previous_buf = font->in_buf;
+    font->previous_len = font->in_len;
+  }
+
+  /* removing all hints is a pure byte transformation */
+  /* which doesn't need FreeType faces */
+  if (font->dehint
+      && !font->control_buf
+      && !debug
+      && !control_binary_file)
+  {
+    error = TA_font_dehint(font);
+    if (error)
+      goto Err;
+
+    ta_trace_span(trace, "phase", "dehint", phase_start, NULL);
+    phase_start = TA_TRACE_START(trace);
+
+    goto Build;
+  }
+
   error = TA_font_init(font);
   if (error)
     goto Err;
@@ -588,6 +722,9 @@ No_check:
       goto Err;
   }
 
+  ta_trace_span(trace, "phase", "load", phase_start, NULL);
+  phase_start = TA_TRACE_START(trace);
+
   /* process control instructions */
   error = TA_control_parse_buffer(font,
                                   &error_string,
@@ -616,10 +753,20 @@ No_check:
     free(s);
   }
 
+  /* if requested, store the parsed control instructions and exit */
+  if (control_binary_file)
+  {
+    error = TA_control_binary_file_write(font, control_binary_file);
+    goto Err;
+  }
+
   error = TA_control_build_tree(font);
   if (error)
     goto Err;
 
+  ta_trace_span(trace, "phase", "control instructions", phase_start, NULL);
+  phase_start = TA_TRACE_START(trace);
+
   /* loop again over subfonts and continue processing */
   for (i = 0; i < font->num_sfnts; i++)
   {
@@ -637,7 +784,8 @@ No_check:
 
 
       /* check lower byte of the `fsType' field */
-      if (OS2_table->buf[OS2_FSTYPE_OFFSET + 1] == 0x02
+      if (OS2_table->len > OS2_FSTYPE_OFFSET + 1
+          && OS2_table->buf[OS2_FSTYPE_OFFSET + 1] == 0x02
           && !font->ignore_restrictions)
       {
         error = TA_Err_Missing_Legal_Permission;
@@ -721,40 +869,24 @@ No_check:
     }
   }
 
-  /* loop again over subfonts */
-  for (i = 0; i < font->num_sfnts; i++)
+  /* compare with the output of a previous run */
+  if (!font->dehint)
   {
-    SFNT* sfnt = &font->sfnts[i];
-
-
-    error = ta_loader_init(font);
+    error = TA_font_init_previous(font);
     if (error)
       goto Err;
+  }
 
-    error = TA_sfnt_build_gasp_table(sfnt, font);
-    if (error)
-      goto Err;
-    if (!font->dehint)
-    {
-      error = TA_sfnt_build_cvt_table(sfnt, font);
-      if (error)
-        goto Err;
-      error = TA_sfnt_build_fpgm_table(sfnt, font);
-      if (error)
-        goto Err;
-      error = TA_sfnt_build_prep_table(sfnt, font);
-      if (error)
-        goto Err;
-    }
-    error = TA_sfnt_build_glyf_table(sfnt, font);
-    if (error)
-      goto Err;
-    error = TA_sfnt_build_loca_table(sfnt, font);
-    if (error)
-      goto Err;
+  ta_trace_span(trace, "phase", "analyze", phase_start, NULL);
+  phase_start = TA_TRACE_START(trace);
 
-    ta_loader_done(font);
-  }
+  /* build the hinting tables of all subfonts */
+  error = TA_font_hint_sfnts(font);
+  if (error)
+    goto Err;
+
+  ta_trace_span(trace, "phase", "hint", phase_start, NULL);
+  phase_start = TA_TRACE_START(trace);
 
   for (i = 0; i < font->num_sfnts; i++)
   {
@@ -793,6 +925,10 @@ No_check:
     }
   }
 
+  ta_trace_span(trace, "phase", "update tables", phase_start, NULL);
+  phase_start = TA_TRACE_START(trace);
+
+Build:
   if (font->num_sfnts == 1)
     error = TA_font_build_TTF(font);
   else
@@ -800,6 +936,9 @@ No_check:
   if (error)
     goto Err;
 
+  ta_trace_span(trace, "phase", "build font", phase_start, NULL);
+  phase_start = TA_TRACE_START(trace);
+
   if (out_file)
   {
     error = TA_font_file_write(font, out_file);
@@ -812,9 +951,16 @@ No_check:
     *out_lenp = font->out_len;
   }
 
+  ta_trace_span(trace, "phase", "write", phase_start, NULL);
+
   error = TA_Err_Ok;
 
 Err:
+  ta_trace_span(trace, "phase", "TTF_autohint", trace_start,
+                "\"error\": %d", error);
+  ta_trace_done(trace);
+  font->trace = NULL;
+
   TA_control_free(font->control);
   TA_control_free_tree(font);
   TA_font_unload(font, in_buf, out_bufp, control_buf, reference_buf);